@@ -52,6 +52,8 @@
 #include "fmt.h"
 #include "DownloadFailureException.h"
 #include "error_code.h"
+#include "Metrics.h"
+#include "TimerA2.h"
 
 namespace aria2 {
 
@@ -162,6 +164,7 @@ void AbstractDiskWriter::seek(off_t offset)
 
 void AbstractDiskWriter::writeData(const unsigned char* data, size_t len, off_t offset)
 {
+  Timer start;
   seek(offset);
   if(writeDataInternal(data, len) < 0) {
     int errNum = errno;
@@ -183,6 +186,8 @@ void AbstractDiskWriter::writeData(const unsigned char* data, size_t len, off_t
          error_code::FILE_IO_ERROR);
     }
   }
+  global::metrics.observeDiskWrite
+    (Timer().getTimeInMicros()-start.getTimeInMicros());
 }
 
 ssize_t AbstractDiskWriter::readData(unsigned char* data, size_t len, off_t offset)
@@ -40,7 +40,9 @@ namespace aria2 {
 
 AutoSaveCommand::AutoSaveCommand
 (cuid_t cuid, DownloadEngine* e, time_t interval)
-  : TimeBasedCommand(cuid, e, interval, true)
+  : TimeBasedCommand(cuid, e, 1, true),
+    saveInterval_(interval),
+    credit_(0)
 {}
 
 AutoSaveCommand::~AutoSaveCommand() {}
@@ -55,7 +57,12 @@ void AutoSaveCommand::preProcess()
 
 void AutoSaveCommand::process()
 {
-  getDownloadEngine()->getRequestGroupMan()->save();
+  const SharedHandle<RequestGroupMan>& rgman =
+    getDownloadEngine()->getRequestGroupMan();
+  credit_ += rgman->getRequestGroups().size();
+  size_t num = credit_/saveInterval_;
+  credit_ %= saveInterval_;
+  rgman->saveNext(num);
 }
 
 } // namespace aria2
@@ -39,8 +39,17 @@
 
 namespace aria2 {
 
+// Saves control files so that each RequestGroup is saved once per
+// saveInterval seconds. Instead of saving all RequestGroups at once,
+// this command runs every second and saves a portion of them, so that
+// disk writes are spread across the interval.
 class AutoSaveCommand : public TimeBasedCommand
 {
+private:
+  time_t saveInterval_;
+  // Accumulates the number of RequestGroups per second multiplied by
+  // saveInterval_.
+  size_t credit_;
 public:
   AutoSaveCommand(cuid_t cuid, DownloadEngine* e, time_t interval);
 
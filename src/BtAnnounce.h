@@ -44,6 +44,8 @@
 
 namespace aria2 {
 
+struct UDPTrackerRequest;
+
 class BtAnnounce {
 public:
   virtual ~BtAnnounce() {}
@@ -97,6 +99,21 @@ public:
   virtual void processAnnounceResponse(const unsigned char* trackerResponse,
                                        size_t trackerResponseLength) = 0;
 
+  /**
+   * Creates the announce request to the UDP tracker at
+   * remoteAddr:remotePort. Call this function after getAnnounceUrl()
+   * returned UDP tracker URI.
+   */
+  virtual SharedHandle<UDPTrackerRequest>
+  createUDPTrackerRequest(const std::string& remoteAddr, uint16_t remotePort)
+    = 0;
+
+  /**
+   * Processes the completed announce request to the UDP tracker.
+   */
+  virtual void processUDPTrackerResponse
+  (const SharedHandle<UDPTrackerRequest>& req) = 0;
+
   /**
    * Returns true if no more announce is needed.
    */
@@ -53,10 +53,13 @@ typedef std::map<std::string, uint8_t> Extensions;
 
 #define DEFAULT_MAX_OUTSTANDING_REQUEST 6
 
-#define OUTSTANDING_REQUEST_STEP 6
+// Upper Bound of the number of outstanding request.  250 is the
+// request queue length many clients accept from a peer.
+#define UB_MAX_OUTSTANDING_REQUEST 250
 
-// Upper Bound of the number of outstanding request
-#define UB_MAX_OUTSTANDING_REQUEST 100
+// In end game, the maximum number of peers a block is requested from
+// at the same time.
+#define END_GAME_MAX_BLOCK_REQUEST 2
 
 #define METADATA_PIECE_SIZE (16*1024)
 
@@ -36,11 +36,15 @@
 #define D_BT_INTERACTIVE_H
 
 #include "common.h"
+
+#include <vector>
+
 #include "SharedHandle.h"
 
 namespace aria2 {
 
 class BtMessage;
+class DigestStream;
 
 class BtInteractive {
 public:
@@ -67,6 +71,11 @@ public:
   virtual size_t countReceivedMessageInIteration() const = 0;
 
   virtual size_t countOutstandingRequest() = 0;
+
+  // Appends the streams hashing pieces which are completed but not
+  // verified yet to streams.
+  virtual void getHashPendingStreams
+  (std::vector<SharedHandle<DigestStream> >& streams) = 0;
 };
 
 typedef SharedHandle<BtInteractive> BtInteractiveHandle;
@@ -84,6 +84,12 @@ public:
 
   virtual void addOutstandingRequest(const RequestSlot& slot) = 0;
 
+  // Removes the outstanding request and queues cancel message for it,
+  // because the block has been received from another peer.  Returns
+  // true if the request was found.
+  virtual bool doCancelOutstandingRequestAction
+  (size_t index, uint32_t begin, size_t length) = 0;
+
   virtual size_t countOutstandingUpload() = 0;
 };
 
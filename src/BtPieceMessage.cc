@@ -55,6 +55,8 @@
 #include "PeerConnection.h"
 #include "fmt.h"
 #include "DownloadContext.h"
+#include "wallclock.h"
+#include "Metrics.h"
 
 namespace aria2 {
 
@@ -104,9 +106,24 @@ void BtPieceMessage::doReceivedAction()
   RequestSlot slot = getBtMessageDispatcher()->getOutstandingRequest
     (index_, begin_, blockLength_);
   getPeer()->updateDownloadLength(blockLength_);
+  global::metrics.addReceivedBytes(Metrics::PROTO_BITTORRENT, blockLength_);
   if(!RequestSlot::isNull(slot)) {
     getPeer()->snubbing(false);
+    getPeer()->updateBlockRtt
+      (slot.getDispatchedTime().differenceInMillis(global::wallclock));
     SharedHandle<Piece> piece = getPieceStorage()->getPiece(index_);
+    if(piece->hasBlock(slot.getBlockIndex())) {
+      // In end game, the block may have been received from another
+      // peer.
+      A2_LOG_DEBUG(fmt("CUID#%lld - Discarding duplicate block, index=%lu,"
+                       " begin=%u",
+                       getCuid(),
+                       static_cast<unsigned long>(index_),
+                       begin_));
+      getPieceStorage()->addWastedLength(blockLength_);
+      getBtMessageDispatcher()->removeOutstandingRequest(slot);
+      return;
+    }
     off_t offset = (off_t)index_*downloadContext_->getPieceLength()+begin_;
     A2_LOG_DEBUG(fmt(MSG_PIECE_RECEIVED,
                      getCuid(),
@@ -124,10 +141,13 @@ void BtPieceMessage::doReceivedAction()
     piece->updateHash(begin_, block_, blockLength_);
     getBtMessageDispatcher()->removeOutstandingRequest(slot);
     if(piece->pieceComplete()) {
-      if(checkPieceHash(piece)) {
-        onNewPiece(piece);
-      } else {
-        onWrongPiece(piece);
+      calculatePieceHash(piece);
+      if(piece->isHashPending()) {
+        A2_LOG_DEBUG(fmt("CUID#%lld - Waiting for hash, index=%lu",
+                         getCuid(),
+                         static_cast<unsigned long>(piece->getIndex())));
+        hashPendingPiece_ = piece;
+      } else if(!verifyPiece(piece)) {
         throw DL_ABORT_EX("Bad piece hash.");
       }
     }
@@ -136,6 +156,7 @@ void BtPieceMessage::doReceivedAction()
                      getCuid(),
                      static_cast<unsigned long>(index_),
                      begin_));
+    getPieceStorage()->addWastedLength(blockLength_);
   }
 }
 
@@ -186,6 +207,7 @@ void BtPieceMessage::send()
   }
   writtenLength = getPeerConnection()->sendPendingData();
   getPeer()->updateUploadLength(writtenLength);
+  global::metrics.addSentBytes(Metrics::PROTO_BITTORRENT, writtenLength);
   setSendingInProgress(!getPeerConnection()->sendBufferIsEmpty());
 }
 
@@ -213,22 +235,43 @@ std::string BtPieceMessage::toString() const
                    util::itos(begin_), ", length=", util::itos(blockLength_));
 }
 
-bool BtPieceMessage::checkPieceHash(const SharedHandle<Piece>& piece)
+void BtPieceMessage::calculatePieceHash(const SharedHandle<Piece>& piece)
 {
-  if(!getPieceStorage()->isEndGame() && piece->isHashCalculated()) {
+  if(piece->isHashCalculated()) {
     A2_LOG_DEBUG(fmt("Hash is available!! index=%lu",
                      static_cast<unsigned long>(piece->getIndex())));
-    return
-      piece->getHashString()==downloadContext_->getPieceHash(piece->getIndex());
   } else {
+    // Some blocks could not be hashed when they were received. Read
+    // them back from disk.
     off_t offset = (off_t)piece->getIndex()*downloadContext_->getPieceLength();
-    
-    return message_digest::staticSHA1DigestHexDigest
-      (getPieceStorage()->getDiskAdaptor(), offset, piece->getLength())
-      == downloadContext_->getPieceHash(piece->getIndex());
+    size_t readLength = piece->updateHashWithRead
+      (getPieceStorage()->getDiskAdaptor(), offset);
+    getPieceStorage()->addHashReread(readLength);
+    A2_LOG_DEBUG(fmt("Read %lu bytes to calculate hash, index=%lu",
+                     static_cast<unsigned long>(readLength),
+                     static_cast<unsigned long>(piece->getIndex())));
+  }
+}
+
+bool BtPieceMessage::verifyPiece(const SharedHandle<Piece>& piece)
+{
+  if(piece->getHashString() ==
+     downloadContext_->getPieceHash(piece->getIndex())) {
+    onNewPiece(piece);
+    return true;
+  } else {
+    onWrongPiece(piece);
+    return false;
   }
 }
 
+bool BtPieceMessage::verifyHashPendingPiece()
+{
+  SharedHandle<Piece> piece;
+  piece.swap(hashPendingPiece_);
+  return verifyPiece(piece);
+}
+
 void BtPieceMessage::onNewPiece(const SharedHandle<Piece>& piece)
 {
   A2_LOG_INFO(fmt(MSG_GOT_NEW_PIECE,
@@ -243,6 +286,7 @@ void BtPieceMessage::onWrongPiece(const SharedHandle<Piece>& piece)
   A2_LOG_INFO(fmt(MSG_GOT_WRONG_PIECE,
                   getCuid(),
                   static_cast<unsigned long>(piece->getIndex())));
+  global::metrics.increasePieceHashFailures();
   erasePieceOnDisk(piece);
   piece->clearAllBlock();
   piece->destroyHashContext();
@@ -53,10 +53,18 @@ private:
   unsigned char* block_;
   unsigned char* rawData_;
   SharedHandle<DownloadContext> downloadContext_;
+  // The piece completed by this message while its hash is still
+  // calculated on DigestThreadPool.
+  SharedHandle<Piece> hashPendingPiece_;
 
   static size_t MESSAGE_HEADER_LENGTH;
 
-  bool checkPieceHash(const SharedHandle<Piece>& piece);
+  // Feeds the data of piece which is not hashed yet to its hash.
+  void calculatePieceHash(const SharedHandle<Piece>& piece);
+
+  // Compares the hash of piece with the expected one and calls
+  // onNewPiece() or onWrongPiece(). Returns true if it matches.
+  bool verifyPiece(const SharedHandle<Piece>& piece);
 
   void onNewPiece(const SharedHandle<Piece>& piece);
 
@@ -98,8 +106,22 @@ public:
   static BtPieceMessageHandle create
   (const unsigned char* data, size_t dataLength);
 
+  // If this message completes a piece whose hash is still calculated
+  // on DigestThreadPool, the piece is kept and verified later by
+  // verifyHashPendingPiece(). Otherwise, the piece is verified here
+  // and DlAbortEx is thrown if it is wrong.
   virtual void doReceivedAction();
 
+  const SharedHandle<Piece>& getHashPendingPiece() const
+  {
+    return hashPendingPiece_;
+  }
+
+  // Verifies the piece returned by getHashPendingPiece(), waiting for
+  // its hash if it is still calculated. Returns false if the piece is
+  // wrong.
+  bool verifyHashPendingPiece();
+
   unsigned char* createMessageHeader();
 
   size_t getMessageHeaderLength();
@@ -51,6 +51,10 @@ public:
 
   virtual void save() = 0;
 
+  // Returns true if the download progress may have changed since the
+  // last save().
+  virtual bool isDirty() = 0;
+
   virtual void load() = 0;
 
   virtual void removeFile() = 0;
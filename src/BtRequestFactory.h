@@ -73,11 +73,13 @@ public:
   (std::vector<SharedHandle<BtMessage> >& requests, size_t max) = 0;
 
   /**
-   * Use this method in end game mode.
-   *
+   * Use this method in end game mode.  Blocks already requested from
+   * maxBlockRequest peers or more are skipped and blocks with fewer
+   * outstanding requests are chosen first.
    */
   virtual void createRequestMessagesOnEndGame
-  (std::vector<SharedHandle<BtMessage> >& requests, size_t max) = 0;
+  (std::vector<SharedHandle<BtMessage> >& requests, size_t max,
+   size_t maxBlockRequest) = 0;
 
   /**
    * Stores the list of index of pieces added using addTargetPiece() into
@@ -34,6 +34,7 @@
 /* copyright --> */
 #include "BtRuntime.h"
 #include "BtConstants.h"
+#include "Metrics.h"
 
 namespace aria2 {
 
@@ -58,4 +59,16 @@ void BtRuntime::setMaxPeers(unsigned int maxPeers)
   }
 }
 
+void BtRuntime::increaseConnections()
+{
+  ++connections_;
+  global::metrics.increasePeerConnections();
+}
+
+void BtRuntime::decreaseConnections()
+{
+  --connections_;
+  global::metrics.decreasePeerConnections();
+}
+
 } // namespace aria2
@@ -83,9 +83,9 @@ public:
 
   unsigned int getConnections() const { return connections_; }
 
-  void increaseConnections() { ++connections_; }
+  void increaseConnections();
 
-  void decreaseConnections() { --connections_; }
+  void decreaseConnections();
 
   bool lessThanMaxPeers() const
   {
@@ -43,6 +43,7 @@
 #include "PeerListenCommand.h"
 #include "TrackerWatcherCommand.h"
 #include "SeedCheckCommand.h"
+#include "PieceIndexCommand.h"
 #include "PeerChokeCommand.h"
 #include "ActivePeerConnectionCommand.h"
 #include "PeerListenCommand.h"
@@ -182,6 +183,14 @@ void BtSetup::setup(std::vector<Command*>& commands,
       c->setBtRuntime(btRuntime);
       commands.push_back(c);
     }
+    if(e->getPieceHashIndex()) {
+      PieceIndexCommand* c =
+        new PieceIndexCommand(e->newCUID(), requestGroup, e,
+                              e->getPieceHashIndex());
+      c->setPieceStorage(pieceStorage);
+      c->setBtRuntime(btRuntime);
+      commands.push_back(c);
+    }
   }
   if(PeerListenCommand::getNumInstance() == 0) {
     static int families[] = { AF_INET, AF_INET6 };
@@ -60,12 +60,12 @@ CheckIntegrityCommand::~CheckIntegrityCommand() {}
 bool CheckIntegrityCommand::executeInternal()
 {
   if(getRequestGroup()->isHaltRequested()) {
-    getDownloadEngine()->getCheckIntegrityMan()->dropPickedEntry();
+    getDownloadEngine()->getCheckIntegrityMan()->dropPickedEntry(entry_);
     return true;
   }
   entry_->validateChunk();
   if(entry_->finished()) {
-    getDownloadEngine()->getCheckIntegrityMan()->dropPickedEntry();
+    getDownloadEngine()->getCheckIntegrityMan()->dropPickedEntry(entry_);
     // Enable control file saving here. See also
     // RequestGroup::processCheckIntegrityEntry() to know why this is
     // needed.
@@ -99,7 +99,7 @@ bool CheckIntegrityCommand::executeInternal()
 
 bool CheckIntegrityCommand::handleException(Exception& e)
 {
-  getDownloadEngine()->getCheckIntegrityMan()->dropPickedEntry();
+  getDownloadEngine()->getCheckIntegrityMan()->dropPickedEntry(entry_);
   A2_LOG_ERROR_EX(fmt(MSG_FILE_VALIDATION_FAILURE,
                    getCuid()),
                   e);
@@ -0,0 +1,172 @@
+/* <!-- copyright */
+/*
+ * aria2 - The high speed download utility
+ *
+ * Copyright (C) 2011 Tatsuhiro Tsujikawa
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.  If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so.  If you
+ * do not wish to do so, delete this exception statement from your
+ * version.  If you delete this exception statement from all source
+ * files in the program, then also delete it here.
+ */
+/* copyright --> */
+#include "CommandProfiler.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+
+#include "LogFactory.h"
+#include "Logger.h"
+#include "fmt.h"
+#include "util.h"
+
+namespace aria2 {
+
+CommandProfiler::CommandProfiler()
+  : slowThreshold_(0)
+{}
+
+void CommandProfiler::commandExecuted
+(const char* typeName, cuid_t cuid, int64_t micros)
+{
+  Stat& stat = stats_[typeName];
+  ++stat.count;
+  stat.total += micros;
+  stat.max = std::max(stat.max, micros);
+  if(slowThreshold_ > 0 && micros >= slowThreshold_) {
+    A2_LOG_NOTICE(fmt("CUID#%lld - %s took %lld ms to execute.",
+                      cuid,
+                      getCommandName(typeName).c_str(),
+                      static_cast<long long int>(micros/1000)));
+  }
+}
+
+std::map<std::string, CommandProfiler::Stat> CommandProfiler::getStats() const
+{
+  std::map<std::string, Stat> stats;
+  for(std::map<const char*, Stat>::const_iterator i = stats_.begin(),
+        eoi = stats_.end(); i != eoi; ++i) {
+    Stat& stat = stats[getCommandName((*i).first)];
+    stat.count += (*i).second.count;
+    stat.total += (*i).second.total;
+    stat.max = std::max(stat.max, (*i).second.max);
+  }
+  return stats;
+}
+
+namespace {
+std::string microsToSeconds(int64_t micros)
+{
+  return fmt("%lld.%06lld",
+             static_cast<long long int>(micros/1000000),
+             static_cast<long long int>(micros%1000000));
+}
+} // namespace
+
+std::string CommandProfiler::toText() const
+{
+  std::map<std::string, Stat> stats = getStats();
+  std::string out =
+    "# HELP aria2_command_executions_total Command executions.\n"
+    "# TYPE aria2_command_executions_total counter\n";
+  for(std::map<std::string, Stat>::const_iterator i = stats.begin(),
+        eoi = stats.end(); i != eoi; ++i) {
+    out += fmt("aria2_command_executions_total{command=\"%s\"} %s\n",
+               (*i).first.c_str(), util::uitos((*i).second.count).c_str());
+  }
+  out +=
+    "# HELP aria2_command_seconds_total Time spent executing commands.\n"
+    "# TYPE aria2_command_seconds_total counter\n";
+  for(std::map<std::string, Stat>::const_iterator i = stats.begin(),
+        eoi = stats.end(); i != eoi; ++i) {
+    out += fmt("aria2_command_seconds_total{command=\"%s\"} %s\n",
+               (*i).first.c_str(), microsToSeconds((*i).second.total).c_str());
+  }
+  return out;
+}
+
+namespace {
+class TotalGreater {
+public:
+  bool operator()
+  (const std::pair<std::string, CommandProfiler::Stat>& lhs,
+   const std::pair<std::string, CommandProfiler::Stat>& rhs) const
+  {
+    return lhs.second.total > rhs.second.total;
+  }
+};
+} // namespace
+
+void CommandProfiler::logStats() const
+{
+  std::map<std::string, Stat> statMap = getStats();
+  std::vector<std::pair<std::string, Stat> > stats
+    (statMap.begin(), statMap.end());
+  std::sort(stats.begin(), stats.end(), TotalGreater());
+  for(std::vector<std::pair<std::string, Stat> >::const_iterator i =
+        stats.begin(), eoi = stats.end(); i != eoi; ++i) {
+    const Stat& stat = (*i).second;
+    A2_LOG_INFO(fmt("CommandProfile: %s count=%s, total=%sms, avg=%sus,"
+                    " max=%sus",
+                    (*i).first.c_str(),
+                    util::uitos(stat.count).c_str(),
+                    util::itos(stat.total/1000).c_str(),
+                    util::itos(stat.total/stat.count).c_str(),
+                    util::itos(stat.max).c_str()));
+  }
+}
+
+std::string CommandProfiler::getCommandName(const char* typeName)
+{
+  // Itanium C++ ABI: N <length> <name> ... E for a class in a
+  // namespace, <length> <name> for a class in the global namespace.
+  bool nested = typeName[0] == 'N';
+  const char* p = nested ? typeName+1 : typeName;
+  const char* name = 0;
+  size_t nameLength = 0;
+  while('0' <= *p && *p <= '9') {
+    char* end;
+    unsigned long length = strtoul(p, &end, 10);
+    if(strlen(end) < length) {
+      return typeName;
+    }
+    name = end;
+    nameLength = length;
+    p = end+length;
+  }
+  if(nested && *p == 'E') {
+    ++p;
+  } else if(nested) {
+    return typeName;
+  }
+  if(!name || *p != '\0') {
+    return typeName;
+  }
+  return std::string(name, nameLength);
+}
+
+} // namespace aria2
@@ -0,0 +1,94 @@
+/* <!-- copyright */
+/*
+ * aria2 - The high speed download utility
+ *
+ * Copyright (C) 2011 Tatsuhiro Tsujikawa
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.  If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so.  If you
+ * do not wish to do so, delete this exception statement from your
+ * version.  If you delete this exception statement from all source
+ * files in the program, then also delete it here.
+ */
+/* copyright --> */
+#ifndef D_COMMAND_PROFILER_H
+#define D_COMMAND_PROFILER_H
+
+#include "common.h"
+
+#include <string>
+#include <map>
+
+#include "Command.h"
+
+namespace aria2 {
+
+// Collects the time spent in Command::execute() grouped by Command
+// subclass. DownloadEngine only measures commands when a
+// CommandProfiler is set, so that there is no overhead by default.
+class CommandProfiler {
+public:
+  struct Stat {
+    uint64_t count;
+    // Total and maximum execution time in microseconds.
+    int64_t total;
+    int64_t max;
+    Stat():count(0), total(0), max(0) {}
+  };
+private:
+  // Keyed by std::type_info::name() of the command. The pointer is
+  // used as a key to avoid creating std::string for each execution.
+  std::map<const char*, Stat> stats_;
+  // Executions which take at least this microseconds are logged. 0
+  // disables logging.
+  int64_t slowThreshold_;
+public:
+  CommandProfiler();
+
+  void setSlowThreshold(int64_t micros)
+  {
+    slowThreshold_ = micros;
+  }
+
+  // typeName is std::type_info::name() of the executed command.
+  void commandExecuted(const char* typeName, cuid_t cuid, int64_t micros);
+
+  // Returns statistics keyed by readable command name.
+  std::map<std::string, Stat> getStats() const;
+
+  // Returns statistics in Prometheus text exposition format.
+  std::string toText() const;
+
+  // Logs statistics sorted by total execution time in descending
+  // order.
+  void logStats() const;
+
+  // Returns the class name from std::type_info::name(). If typeName
+  // is not a mangled class name, returns typeName as is.
+  static std::string getCommandName(const char* typeName);
+};
+
+} // namespace aria2
+
+#endif // D_COMMAND_PROFILER_H
@@ -0,0 +1,118 @@
+/* <!-- copyright */
+/*
+ * aria2 - The high speed download utility
+ *
+ * Copyright (C) 2011 Tatsuhiro Tsujikawa
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.  If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so.  If you
+ * do not wish to do so, delete this exception statement from your
+ * version.  If you delete this exception statement from all source
+ * files in the program, then also delete it here.
+ */
+/* copyright --> */
+#include "DHKeyPool.h"
+
+#include <algorithm>
+
+#include "DHKeyExchange.h"
+#include "MSEHandshake.h"
+
+namespace aria2 {
+
+const size_t DHKeyPool::DEFAULT_CAPACITY;
+
+const size_t DHKeyPool::MAX_CAPACITY;
+
+const size_t DHKeyPool::SHRINK_DELAY;
+
+DHKeyPool::DHKeyPool(size_t capacity)
+  : capacity_(capacity),
+    numHit_(0),
+    numMiss_(0),
+    lastNumHit_(0),
+    lastNumMiss_(0),
+    numIdle_(0),
+    numHandshake_(0),
+    handshakeTime_(0)
+{}
+
+DHKeyPool::~DHKeyPool() {}
+
+SharedHandle<DHKeyExchange> DHKeyPool::pop()
+{
+  if(keys_.empty()) {
+    ++numMiss_;
+    return MSEHandshake::createDHKeyExchange();
+  } else {
+    ++numHit_;
+    SharedHandle<DHKeyExchange> dh = keys_.front();
+    keys_.pop_front();
+    return dh;
+  }
+}
+
+size_t DHKeyPool::refill(size_t num)
+{
+  size_t count = 0;
+  for(; count < num && keys_.size() < capacity_; ++count) {
+    keys_.push_back(MSEHandshake::createDHKeyExchange());
+  }
+  return count;
+}
+
+void DHKeyPool::setCapacity(size_t capacity)
+{
+  capacity_ = capacity;
+  if(keys_.size() > capacity_) {
+    keys_.erase(keys_.begin()+capacity_, keys_.end());
+  }
+}
+
+void DHKeyPool::adjustCapacity()
+{
+  uint64_t numMiss = numMiss_-lastNumMiss_;
+  uint64_t demand = numHit_-lastNumHit_+numMiss;
+  lastNumHit_ = numHit_;
+  lastNumMiss_ = numMiss_;
+  if(numMiss > 0) {
+    numIdle_ = 0;
+    setCapacity(std::min(capacity_*2, MAX_CAPACITY));
+  } else if(demand*4 < capacity_ && capacity_ > DEFAULT_CAPACITY) {
+    if(++numIdle_ >= SHRINK_DELAY) {
+      numIdle_ = 0;
+      setCapacity(std::max(capacity_/2, DEFAULT_CAPACITY));
+    }
+  } else {
+    numIdle_ = 0;
+  }
+}
+
+void DHKeyPool::addHandshakeTime(int64_t time)
+{
+  ++numHandshake_;
+  handshakeTime_ += time;
+}
+
+} // namespace aria2
@@ -0,0 +1,134 @@
+/* <!-- copyright */
+/*
+ * aria2 - The high speed download utility
+ *
+ * Copyright (C) 2011 Tatsuhiro Tsujikawa
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.  If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so.  If you
+ * do not wish to do so, delete this exception statement from your
+ * version.  If you delete this exception statement from all source
+ * files in the program, then also delete it here.
+ */
+/* copyright --> */
+#ifndef D_DH_KEY_POOL_H
+#define D_DH_KEY_POOL_H
+
+#include "common.h"
+
+#include <deque>
+
+#include "SharedHandle.h"
+
+namespace aria2 {
+
+class DHKeyExchange;
+
+// Pool of DHKeyExchange objects whose public keys are generated in
+// advance, so that MSE handshake does not have to do the modular
+// exponentiation when a connection arrives. The pool is refilled by
+// DHKeyPoolCommand. This class also keeps the statistics of MSE
+// handshakes so that they can be reported with the pool statistics.
+class DHKeyPool {
+private:
+  std::deque<SharedHandle<DHKeyExchange> > keys_;
+  size_t capacity_;
+  uint64_t numHit_;
+  uint64_t numMiss_;
+  // numHit_ and numMiss_ at the last adjustCapacity() call.
+  uint64_t lastNumHit_;
+  uint64_t lastNumMiss_;
+  // The number of consecutive adjustCapacity() calls which saw
+  // little demand.
+  size_t numIdle_;
+  uint64_t numHandshake_;
+  // The sum of the time taken by MSE handshakes, in milliseconds.
+  int64_t handshakeTime_;
+public:
+  DHKeyPool(size_t capacity = DEFAULT_CAPACITY);
+
+  ~DHKeyPool();
+
+  // Returns pooled DHKeyExchange. If the pool is empty, new one is
+  // created.
+  SharedHandle<DHKeyExchange> pop();
+
+  // Generates at most num keys until the pool is full. Returns the
+  // number of keys generated.
+  size_t refill(size_t num);
+
+  size_t size() const
+  {
+    return keys_.size();
+  }
+
+  size_t getCapacity() const
+  {
+    return capacity_;
+  }
+
+  // Sets capacity and drops the keys exceeding it.
+  void setCapacity(size_t capacity);
+
+  // Called once a second. Doubles the capacity, up to MAX_CAPACITY,
+  // if a handshake could not get a key from the pool since the last
+  // call. If fewer than a quarter of the capacity was used in each
+  // of the last SHRINK_DELAY calls, halves the capacity, down to
+  // DEFAULT_CAPACITY, so that the keys pooled for a burst of
+  // connections are released.
+  void adjustCapacity();
+
+  uint64_t getNumHit() const
+  {
+    return numHit_;
+  }
+
+  uint64_t getNumMiss() const
+  {
+    return numMiss_;
+  }
+
+  // Records that MSE handshake completed in time milliseconds.
+  void addHandshakeTime(int64_t time);
+
+  uint64_t getNumHandshake() const
+  {
+    return numHandshake_;
+  }
+
+  int64_t getHandshakeTime() const
+  {
+    return handshakeTime_;
+  }
+
+  static const size_t DEFAULT_CAPACITY = 32;
+
+  static const size_t MAX_CAPACITY = 512;
+
+  static const size_t SHRINK_DELAY = 30;
+};
+
+} // namespace aria2
+
+#endif // D_DH_KEY_POOL_H
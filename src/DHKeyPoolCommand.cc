@@ -0,0 +1,100 @@
+/* <!-- copyright */
+/*
+ * aria2 - The high speed download utility
+ *
+ * Copyright (C) 2011 Tatsuhiro Tsujikawa
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.  If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so.  If you
+ * do not wish to do so, delete this exception statement from your
+ * version.  If you delete this exception statement from all source
+ * files in the program, then also delete it here.
+ */
+/* copyright --> */
+#include "DHKeyPoolCommand.h"
+
+#include "DHKeyPool.h"
+#include "DownloadEngine.h"
+#include "RequestGroupMan.h"
+#include "LogFactory.h"
+#include "Logger.h"
+#include "fmt.h"
+
+namespace aria2 {
+
+DHKeyPoolCommand::DHKeyPoolCommand
+(cuid_t cuid, DownloadEngine* e, const SharedHandle<DHKeyPool>& pool)
+  : TimeBasedCommand(cuid, e, 1, true),
+    pool_(pool)
+{}
+
+DHKeyPoolCommand::~DHKeyPoolCommand() {}
+
+void DHKeyPoolCommand::preProcess()
+{
+  if(getDownloadEngine()->getRequestGroupMan()->downloadFinished() ||
+     getDownloadEngine()->isHaltRequested()) {
+    enableExit();
+  }
+}
+
+namespace {
+// Each key costs a 768-bit modular exponentiation, so the pool is
+// filled a few keys per event loop iteration, not to delay socket
+// I/O.
+const size_t KEYS_PER_EXECUTE = 2;
+} // namespace
+
+void DHKeyPoolCommand::process()
+{
+  size_t capacity = pool_->getCapacity();
+  pool_->adjustCapacity();
+  if(capacity != pool_->getCapacity()) {
+    A2_LOG_DEBUG(fmt("DHKeyPool capacity was changed to %lu",
+                     static_cast<unsigned long>(pool_->getCapacity())));
+  }
+}
+
+void DHKeyPoolCommand::postProcess()
+{
+  if(pool_->size() < pool_->getCapacity()) {
+    pool_->refill(KEYS_PER_EXECUTE);
+    if(pool_->size() < pool_->getCapacity()) {
+      getDownloadEngine()->setNoWait(true);
+    }
+  }
+}
+
+SharedHandle<DHKeyPool> DHKeyPoolCommand::getDHKeyPool(DownloadEngine* e)
+{
+  SharedHandle<DHKeyPool> pool = e->getDHKeyPool();
+  if(!pool) {
+    pool.reset(new DHKeyPool());
+    e->setDHKeyPool(pool);
+    e->addRoutineCommand(new DHKeyPoolCommand(e->newCUID(), e, pool));
+  }
+  return pool;
+}
+
+} // namespace aria2
@@ -43,6 +43,7 @@
 #include "DHTConstants.h"
 #include "fmt.h"
 #include "DHTNode.h"
+#include "Metrics.h"
 
 namespace aria2 {
 
@@ -79,6 +80,7 @@ DHTMessageDispatcherImpl::sendMessage
 {
   try {
     if(entry->message->send()) {
+      global::metrics.increaseDhtMessagesSent();
       if(!entry->message->isReply()) {
         tracker_->addMessage(entry->message, entry->timeout, entry->callback);
       }
@@ -53,6 +53,7 @@
 #include "util.h"
 #include "bencode2.h"
 #include "fmt.h"
+#include "Metrics.h"
 
 namespace aria2 {
 
@@ -75,6 +76,7 @@ SharedHandle<DHTMessage> DHTMessageReceiver::receiveMessage()
     if(length <= 0) {
       return SharedHandle<DHTMessage>();
     }
+    global::metrics.increaseDhtMessagesReceived();
     bool isReply = false;
     SharedHandle<ValueBase> decoded = bencode2::decode(data, length);
     const Dict* dict = asDict(decoded);
@@ -33,6 +33,9 @@
  */
 /* copyright --> */
 #include "DefaultBtAnnounce.h"
+
+#include <cstring>
+
 #include "LogFactory.h"
 #include "Logger.h"
 #include "util.h"
@@ -52,6 +55,8 @@
 #include "bittorrent_helper.h"
 #include "wallclock.h"
 #include "uri.h"
+#include "UDPTrackerRequest.h"
+#include "a2netcompat.h"
 
 namespace aria2 {
 
@@ -284,6 +289,80 @@ DefaultBtAnnounce::processAnnounceResponse(const unsigned char* trackerResponse,
   }
 }
 
+SharedHandle<UDPTrackerRequest>
+DefaultBtAnnounce::createUDPTrackerRequest
+(const std::string& remoteAddr, uint16_t remotePort)
+{
+  SharedHandle<UDPTrackerRequest> req(new UDPTrackerRequest());
+  req->remoteAddr = remoteAddr;
+  req->remotePort = remotePort;
+  req->action = UDPT_ACT_ANNOUNCE;
+  req->infohash = std::string(bittorrent::getInfoHash(downloadContext_),
+                              bittorrent::getInfoHash(downloadContext_)+
+                              INFO_HASH_LENGTH);
+  const unsigned char* peerId = bittorrent::getStaticPeerId();
+  req->peerId = std::string(&peerId[0], &peerId[PEER_ID_LENGTH]);
+  TransferStat stat = peerStorage_->calculateStat();
+  req->downloaded = stat.getSessionDownloadLength();
+  req->left =
+    pieceStorage_->getTotalLength()-pieceStorage_->getCompletedLength();
+  req->uploaded = stat.getSessionUploadLength();
+  switch(announceList_.getEvent()) {
+  case AnnounceTier::STARTED:
+  case AnnounceTier::STARTED_AFTER_COMPLETION:
+    req->event = UDPT_EVT_STARTED;
+    break;
+  case AnnounceTier::STOPPED:
+    req->event = UDPT_EVT_STOPPED;
+    break;
+  case AnnounceTier::COMPLETED:
+    req->event = UDPT_EVT_COMPLETED;
+    break;
+  default:
+    req->event = UDPT_EVT_NONE;
+  }
+  if(!option_->blank(PREF_BT_EXTERNAL_IP)) {
+    struct in_addr addr;
+    if(inet_aton(option_->get(PREF_BT_EXTERNAL_IP).c_str(), &addr) != 0) {
+      // Keep network byte order
+      memcpy(&req->ip, &addr.s_addr, sizeof(req->ip));
+    }
+  }
+  // Use last 4 bytes of peer ID as a key
+  req->key = bittorrent::getIntParam(peerId, PEER_ID_LENGTH-4);
+  if(!btRuntime_->lessThanMinPeers() || btRuntime_->isHalt()) {
+    req->numWant = 0;
+  } else {
+    req->numWant = 50;
+  }
+  req->port = btRuntime_->getListenPort();
+  return req;
+}
+
+void DefaultBtAnnounce::processUDPTrackerResponse
+(const SharedHandle<UDPTrackerRequest>& req)
+{
+  const SharedHandle<UDPTrackerReply>& reply = req->reply;
+  A2_LOG_DEBUG("Now processing UDP tracker response.");
+  if(reply->interval > 0) {
+    minInterval_ = reply->interval;
+    A2_LOG_DEBUG(fmt("Min interval:%ld", static_cast<long int>(minInterval_)));
+    interval_ = minInterval_;
+  }
+  complete_ = reply->seeders;
+  A2_LOG_DEBUG(fmt("Complete:%d", reply->seeders));
+  incomplete_ = reply->leechers;
+  A2_LOG_DEBUG(fmt("Incomplete:%d", reply->leechers));
+  if(!btRuntime_->isHalt() && btRuntime_->lessThanMinPeers()) {
+    std::vector<SharedHandle<Peer> > peers;
+    for(std::vector<std::pair<std::string, uint16_t> >::const_iterator i =
+          reply->peers.begin(), eoi = reply->peers.end(); i != eoi; ++i) {
+      peers.push_back(SharedHandle<Peer>(new Peer((*i).first, (*i).second)));
+    }
+    peerStorage_->addPeer(peers);
+  }
+}
+
 bool DefaultBtAnnounce::noMoreAnnounce() {
   return (trackers_ == 0 &&
           btRuntime_->isHalt() &&
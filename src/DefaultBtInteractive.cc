@@ -36,6 +36,7 @@
 
 #include <cstring>
 #include <vector>
+#include <algorithm>
 
 #include "prefs.h"
 #include "message.h"
@@ -73,6 +74,8 @@
 #include "UTMetadataRequestFactory.h"
 #include "UTMetadataRequestTracker.h"
 #include "wallclock.h"
+#include "RecoverableException.h"
+#include "DigestThreadPool.h"
 
 namespace aria2 {
 
@@ -95,6 +98,8 @@ DefaultBtInteractive::DefaultBtInteractive
     dhtEnabled_(false),
     numReceivedMessage_(0),
     maxOutstandingRequest_(DEFAULT_MAX_OUTSTANDING_REQUEST),
+    pipelineTimer_(global::wallclock),
+    pipelineDownloadLength_(0),
     requestGroupMan_(0)
 {}
 
@@ -272,7 +277,6 @@ void DefaultBtInteractive::sendKeepAlive() {
 }
 
 size_t DefaultBtInteractive::receiveMessages() {
-  size_t countOldOutstandingRequest = dispatcher_->countOutstandingRequest();
   size_t msgcount = 0;
   for(int i = 0; i < UB_MAX_OUTSTANDING_REQUEST+50; ++i) {
     if(requestGroupMan_->doesOverallDownloadSpeedExceed() ||
@@ -304,24 +308,112 @@ size_t DefaultBtInteractive::receiveMessages() {
         floodingStat_.incChokeUnchokeCount();
       }
       break;
-    case BtPieceMessage::ID:
+    case BtPieceMessage::ID: {
       peerStorage_->updateTransferStatFor(peer_);
+      SharedHandle<BtPieceMessage> pieceMessage =
+        static_pointer_cast<BtPieceMessage>(message);
+      if(pieceMessage->getHashPendingPiece()) {
+        hashPendingMessages_.push_back(pieceMessage);
+      }
+      if(pieceStorage_->isEndGame() || pieceStorage_->isStreamingMode()) {
+        cancelEndGameRequest(pieceMessage->getIndex(),
+                             pieceMessage->getBegin(),
+                             pieceMessage->getBlockLength());
+      }
+    }
       // pass through
     case BtRequestMessage::ID:
       inactiveTimer_ = global::wallclock;
       break;
     }
   }
-  if(!pieceStorage_->isEndGame() &&
-     countOldOutstandingRequest >= maxOutstandingRequest_ &&
-     dispatcher_->countOutstandingRequest() == 0){
-    maxOutstandingRequest_ =
-      std::min((size_t)UB_MAX_OUTSTANDING_REQUEST,
-               maxOutstandingRequest_+OUTSTANDING_REQUEST_STEP);
-  }
+  updateMaxOutstandingRequest();
   return msgcount;
 }
 
+void DefaultBtInteractive::cancelEndGameRequest
+(size_t index, uint32_t begin, size_t length)
+{
+  // Other peers may still have this block outstanding.  Cancel them
+  // now rather than in their next checkRequestSlotAndDoNecessaryThing(),
+  // which runs only once a second.
+  std::vector<SharedHandle<Peer> > activePeers;
+  peerStorage_->getActivePeers(activePeers);
+  for(std::vector<SharedHandle<Peer> >::const_iterator i =
+        activePeers.begin(), eoi = activePeers.end(); i != eoi; ++i) {
+    if((*i).get() == peer_.get()) {
+      continue;
+    }
+    try {
+      if((*i)->cancelOutstandingRequest(index, begin, length)) {
+        A2_LOG_DEBUG(fmt("CUID#%lld - Canceled end game request to %s:%u,"
+                         " index=%lu, begin=%u",
+                         cuid_,
+                         (*i)->getIPAddress().c_str(), (*i)->getPort(),
+                         static_cast<unsigned long>(index), begin));
+      }
+    } catch(RecoverableException& e) {
+      // The error will be caught again by the command of that peer.
+      A2_LOG_DEBUG_EX(fmt("CUID#%lld - Failed to send cancel to %s:%u",
+                          cuid_,
+                          (*i)->getIPAddress().c_str(), (*i)->getPort()),
+                      e);
+    }
+  }
+}
+
+bool DefaultBtInteractive::isFastPeer()
+{
+  unsigned int numConnections = btRuntime_->getConnections();
+  if(numConnections == 0) {
+    return true;
+  }
+  TransferStat stat = peerStorage_->calculateStat();
+  return peer_->calculateDownloadSpeed() >=
+    stat.getDownloadSpeed()/numConnections;
+}
+
+void DefaultBtInteractive::updateMaxOutstandingRequest()
+{
+  int64_t rtt = peer_->getMinBlockRtt();
+  if(rtt == 0) {
+    return;
+  }
+  // PeerStat's speed is averaged over 15 seconds or more, which is far
+  // too slow to follow the queue depth.  Measure the download rate
+  // over at least 2 round trips instead.
+  int64_t elapsed = pipelineTimer_.differenceInMillis(global::wallclock);
+  if(elapsed < std::max(rtt*2, (int64_t)100)) {
+    return;
+  }
+  uint64_t length = peer_->getSessionDownloadLength();
+  unsigned int speed = (length-pipelineDownloadLength_)*1000/elapsed;
+  pipelineTimer_ = global::wallclock;
+  pipelineDownloadLength_ = length;
+  maxOutstandingRequest_ = calculateMaxOutstandingRequest(speed, rtt);
+}
+
+size_t DefaultBtInteractive::calculateMaxOutstandingRequest
+(unsigned int downloadSpeed, int64_t blockRtt)
+{
+  // Bandwidth-delay product in blocks, rounded up.
+  uint64_t bdp =
+    ((uint64_t)downloadSpeed*blockRtt+MAX_BLOCK_LENGTH*1000-1)/
+    (MAX_BLOCK_LENGTH*1000);
+  // Keep twice the BDP in flight.  While the queue depth is what limits
+  // the speed, the measured speed follows the queue depth and this
+  // doubles it on every update; once the link is the bottleneck, the
+  // speed stops growing and this leaves one BDP of slack.
+  uint64_t num = bdp*2;
+  if(num < DEFAULT_MAX_OUTSTANDING_REQUEST) {
+    return DEFAULT_MAX_OUTSTANDING_REQUEST;
+  } else if(num > UB_MAX_OUTSTANDING_REQUEST) {
+    return UB_MAX_OUTSTANDING_REQUEST;
+  } else {
+    return num;
+  }
+}
+
 void DefaultBtInteractive::decideInterest() {
   if(pieceStorage_->hasMissingPiece(peer_)) {
     if(!peer_->amInterested()) {
@@ -382,9 +474,6 @@ void DefaultBtInteractive::addRequests() {
   if(!pieceStorage_->isEndGame() && !pieceStorage_->hasMissingUnusedPiece()) {
     pieceStorage_->enterEndGame();
   }
-  if(pieceStorage_->isEndGame()) {
-    maxOutstandingRequest_ = 2;
-  }
   fillPiece(maxOutstandingRequest_);
   size_t reqNumToCreate =
     maxOutstandingRequest_ <= dispatcher_->countOutstandingRequest() ?
@@ -393,15 +482,60 @@ void DefaultBtInteractive::addRequests() {
     std::vector<SharedHandle<BtMessage> > requests;
     requests.reserve(reqNumToCreate);
     if(pieceStorage_->isEndGame()) {
-      btRequestFactory_->createRequestMessagesOnEndGame(requests,reqNumToCreate);
+      // Only peers which are faster than average may request blocks
+      // which have already been requested from another peer.
+      btRequestFactory_->createRequestMessagesOnEndGame
+        (requests, reqNumToCreate,
+         isFastPeer() ? END_GAME_MAX_BLOCK_REQUEST : 1);
     } else {
       btRequestFactory_->createRequestMessages(requests, reqNumToCreate);
+      if(requests.size() < reqNumToCreate &&
+         pieceStorage_->isStreamingMode() && isFastPeer()) {
+        // Pieces in the stream window may be shared with other
+        // peers. Request their blocks again as in end game, so that
+        // a slow peer does not hold up the playback.
+        btRequestFactory_->createRequestMessagesOnEndGame
+          (requests, reqNumToCreate, END_GAME_MAX_BLOCK_REQUEST);
+      }
     }
     dispatcher_->addMessageToQueue(requests);
   }
 }
 
+void DefaultBtInteractive::verifyHashPendingPieces()
+{
+  for(std::deque<SharedHandle<BtPieceMessage> >::iterator i =
+        hashPendingMessages_.begin(); i != hashPendingMessages_.end();) {
+    if((*i)->getHashPendingPiece()->isHashPending()) {
+      ++i;
+      continue;
+    }
+    SharedHandle<BtPieceMessage> message = *i;
+    i = hashPendingMessages_.erase(i);
+    if(!message->verifyHashPendingPiece()) {
+      throw DL_ABORT_EX("Bad piece hash.");
+    }
+  }
+}
+
+void DefaultBtInteractive::getHashPendingStreams
+(std::vector<SharedHandle<DigestStream> >& streams)
+{
+  for(std::deque<SharedHandle<BtPieceMessage> >::const_iterator i =
+        hashPendingMessages_.begin(), eoi = hashPendingMessages_.end();
+      i != eoi; ++i) {
+    streams.push_back((*i)->getHashPendingPiece()->getDigestStream());
+  }
+}
+
 void DefaultBtInteractive::cancelAllPiece() {
+  // Completed pieces are not requested again, so verify them before
+  // this peer goes away, waiting for their hash if necessary.
+  while(!hashPendingMessages_.empty()) {
+    SharedHandle<BtPieceMessage> message = hashPendingMessages_.front();
+    hashPendingMessages_.pop_front();
+    message->verifyHashPendingPiece();
+  }
   btRequestFactory_->removeAllTargetPiece();
   if(metadataGetMode_ && downloadContext_->getTotalLength() > 0) {
     std::vector<size_t> metadataRequests =
@@ -543,6 +677,7 @@ void DefaultBtInteractive::doInteractionProcessing() {
     checkHave();
     sendKeepAlive();
     numReceivedMessage_ = receiveMessages();
+    verifyHashPendingPieces();
     btRequestFactory_->removeCompletedPiece();
     decideInterest();
     if(!pieceStorage_->downloadFinished()) {
@@ -39,6 +39,8 @@
 
 #include  <limits.h>
 
+#include <deque>
+
 #include "TimerA2.h"
 #include "Command.h"
 
@@ -50,6 +52,7 @@ class PieceStorage;
 class PeerStorage;
 class Peer;
 class BtMessage;
+class BtPieceMessage;
 class BtMessageReceiver;
 class BtMessageDispatcher;
 class BtMessageFactory;
@@ -141,8 +144,17 @@ private:
 
   size_t maxOutstandingRequest_;
 
+  // The time and peer's session download length when
+  // maxOutstandingRequest_ was last updated.
+  Timer pipelineTimer_;
+  uint64_t pipelineDownloadLength_;
+
   RequestGroupMan* requestGroupMan_;
 
+  // Messages which completed a piece whose hash is still calculated
+  // on DigestThreadPool.
+  std::deque<SharedHandle<BtPieceMessage> > hashPendingMessages_;
+
   static const time_t FLOODING_CHECK_INTERVAL = 5;
 
   void addBitfieldMessageToQueue();
@@ -153,11 +165,17 @@ private:
   void sendKeepAlive();
   void decideInterest();
   void fillPiece(size_t maxMissingBlock);
+  void updateMaxOutstandingRequest();
+  void cancelEndGameRequest(size_t index, uint32_t begin, size_t length);
+  bool isFastPeer();
   void addRequests();
   void detectMessageFlooding();
   void checkActiveInteraction();
   void addPeerExchangeMessage();
   void addPortMessageToQueue();
+  // Verifies the pieces in hashPendingMessages_ whose hash is
+  // calculated.
+  void verifyHashPendingPieces();
 
 public:
   DefaultBtInteractive(const SharedHandle<DownloadContext>& downloadContext,
@@ -165,6 +183,13 @@ public:
 
   virtual ~DefaultBtInteractive();
 
+  // Returns the number of requests to keep outstanding for a peer
+  // which sends downloadSpeed bytes per second and whose block round
+  // trip time is blockRtt milliseconds.  The result is in
+  // [DEFAULT_MAX_OUTSTANDING_REQUEST, UB_MAX_OUTSTANDING_REQUEST].
+  static size_t calculateMaxOutstandingRequest
+  (unsigned int downloadSpeed, int64_t blockRtt);
+
   virtual void initiateHandshake();
 
   virtual SharedHandle<BtMessage> receiveHandshake(bool quickReply = false);
@@ -189,6 +214,9 @@ public:
 
   virtual size_t countOutstandingRequest();
 
+  virtual void getHashPendingStreams
+  (std::vector<SharedHandle<DigestStream> >& streams);
+
   void setCuid(cuid_t cuid)
   {
     cuid_ = cuid;
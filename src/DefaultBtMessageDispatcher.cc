@@ -66,9 +66,22 @@ DefaultBtMessageDispatcher::DefaultBtMessageDispatcher()
     requestTimeout_(0)
 {}
 
+namespace {
+// Must be called when slot is removed from requestSlots_ so that the
+// number of outstanding requests for the block is kept accurate.
+void releaseRequestSlot(const RequestSlot& slot)
+{
+  if(slot.getPiece()) {
+    slot.getPiece()->removeBlockRequest(slot.getBlockIndex());
+  }
+}
+} // namespace
+
 DefaultBtMessageDispatcher::~DefaultBtMessageDispatcher()
 {
   A2_LOG_DEBUG("DefaultBtMessageDispatcher::deleted");
+  std::for_each(requestSlots_.begin(), requestSlots_.end(),
+                releaseRequestSlot);
 }
 
 void DefaultBtMessageDispatcher::addMessageToQueue
@@ -160,6 +173,7 @@ public:
                      slot.getBegin(),
                      static_cast<unsigned long>(slot.getBlockIndex())));
     piece_->cancelBlock(slot.getBlockIndex());
+    releaseRequestSlot(slot);
   }
 };
 } // namespace
@@ -212,6 +226,7 @@ public:
                        static_cast<unsigned long>(slot.getBlockIndex())));
       SharedHandle<Piece> piece = pieceStorage_->getPiece(slot.getIndex());
       piece->cancelBlock(slot.getBlockIndex());
+      releaseRequestSlot(slot);
     }
   }
 
@@ -288,6 +303,7 @@ public:
                        slot.getBegin(),
                        static_cast<unsigned long>(slot.getBlockIndex())));
       slot.getPiece()->cancelBlock(slot.getBlockIndex());
+      releaseRequestSlot(slot);
       peer_->snubbing(true);
     } else if(slot.getPiece()->hasBlock(slot.getBlockIndex())) {
       A2_LOG_DEBUG(fmt(MSG_DELETING_REQUEST_SLOT_ACQUIRED,
@@ -299,6 +315,7 @@ public:
         (messageFactory_->createCancelMessage(slot.getIndex(),
                                               slot.getBegin(),
                                               slot.getLength()));
+      releaseRequestSlot(slot);
     }
   }
 };
@@ -413,7 +430,30 @@ void DefaultBtMessageDispatcher::addOutstandingRequest
     std::lower_bound(requestSlots_.begin(), requestSlots_.end(), slot);
   if(i == requestSlots_.end() || (*i) != slot) {
     requestSlots_.insert(i, slot);
+    if(slot.getPiece()) {
+      slot.getPiece()->addBlockRequest(slot.getBlockIndex());
+    }
+  }
+}
+
+bool DefaultBtMessageDispatcher::doCancelOutstandingRequestAction
+(size_t index, uint32_t begin, size_t length)
+{
+  RequestSlot rs(index, begin, length, 0);
+  std::deque<RequestSlot>::iterator i =
+    std::lower_bound(requestSlots_.begin(), requestSlots_.end(), rs);
+  if(i == requestSlots_.end() || (*i) != rs) {
+    return false;
   }
+  A2_LOG_DEBUG(fmt(MSG_DELETING_REQUEST_SLOT_ACQUIRED,
+                   cuid_,
+                   static_cast<unsigned long>(index),
+                   begin,
+                   static_cast<unsigned long>((*i).getBlockIndex())));
+  addMessageToQueue(messageFactory_->createCancelMessage(index, begin, length));
+  releaseRequestSlot(*i);
+  requestSlots_.erase(i);
+  return true;
 }
 
 size_t DefaultBtMessageDispatcher::countOutstandingUpload()
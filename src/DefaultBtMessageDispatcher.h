@@ -108,6 +108,9 @@ public:
 
   virtual void addOutstandingRequest(const RequestSlot& requestSlot);
 
+  virtual bool doCancelOutstandingRequestAction
+  (size_t index, uint32_t begin, size_t length);
+
   virtual size_t countOutstandingUpload();
 
   const std::deque<SharedHandle<BtMessage> >& getMessageQueue() const
@@ -75,6 +75,36 @@ std::string createFilename
 }
 } // namespace
 
+namespace {
+// Returns the number of in-flight pieces followed by each in-flight
+// piece, serialized in the control file format.
+std::string createInFlightPieceData
+(const SharedHandle<PieceStorage>& pieceStorage)
+{
+  std::vector<SharedHandle<Piece> > inFlightPieces;
+  inFlightPieces.reserve(pieceStorage->countInFlightPiece());
+  pieceStorage->getInFlightPieces(inFlightPieces);
+  std::string data;
+  uint32_t numInFlightPieceNL = htonl(inFlightPieces.size());
+  data.append(reinterpret_cast<const char*>(&numInFlightPieceNL),
+              sizeof(numInFlightPieceNL));
+  for(std::vector<SharedHandle<Piece> >::const_iterator itr =
+        inFlightPieces.begin(), eoi = inFlightPieces.end();
+      itr != eoi; ++itr) {
+    uint32_t indexNL = htonl((*itr)->getIndex());
+    data.append(reinterpret_cast<const char*>(&indexNL), sizeof(indexNL));
+    uint32_t lengthNL = htonl((*itr)->getLength());
+    data.append(reinterpret_cast<const char*>(&lengthNL), sizeof(lengthNL));
+    uint32_t bitfieldLengthNL = htonl((*itr)->getBitfieldLength());
+    data.append(reinterpret_cast<const char*>(&bitfieldLengthNL),
+                sizeof(bitfieldLengthNL));
+    data.append(reinterpret_cast<const char*>((*itr)->getBitfield()),
+                (*itr)->getBitfieldLength());
+  }
+  return data;
+}
+} // namespace
+
 DefaultBtProgressInfoFile::DefaultBtProgressInfoFile
 (const SharedHandle<DownloadContext>& dctx,
  const PieceStorageHandle& pieceStorage,
@@ -82,7 +112,13 @@ DefaultBtProgressInfoFile::DefaultBtProgressInfoFile
   : dctx_(dctx),
     pieceStorage_(pieceStorage),
     option_(option),
-    filename_(createFilename(dctx_, getSuffix()))
+    filename_(createFilename(dctx_, getSuffix())),
+    saved_(false),
+    savedCompletedLength_(0),
+    savedNumInFlightPiece_(0),
+    savedUploadLength_(0),
+    inPlaceSaved_(false),
+    savedFileLength_(0)
 {}
 
 DefaultBtProgressInfoFile::~DefaultBtProgressInfoFile() {}
@@ -90,6 +126,8 @@ DefaultBtProgressInfoFile::~DefaultBtProgressInfoFile() {}
 void DefaultBtProgressInfoFile::updateFilename()
 {
   filename_ = createFilename(dctx_, getSuffix());
+  saved_ = false;
+  inPlaceSaved_ = false;
 }
 
 bool DefaultBtProgressInfoFile::isTorrentDownload()
@@ -104,7 +142,115 @@ bool DefaultBtProgressInfoFile::isTorrentDownload()
 // Since version 0001, Integers are saved in binary form, network byte order.
 void DefaultBtProgressInfoFile::save()
 {
+  uint64_t completedLength = pieceStorage_->getCompletedLength();
+  size_t numInFlightPiece = pieceStorage_->countInFlightPiece();
+  uint64_t uploadLength = getUploadLength();
+  if(!inPlaceSaved_ || !option_->getAsBool(PREF_AUTO_SAVE_IN_PLACE) ||
+     !saveInPlace()) {
+    saveFull();
+  }
+  savedCompletedLength_ = completedLength;
+  savedNumInFlightPiece_ = numInFlightPiece;
+  savedUploadLength_ = uploadLength;
+  saved_ = true;
+}
+
+bool DefaultBtProgressInfoFile::isDirty()
+{
+  return !saved_ ||
+    savedCompletedLength_ != pieceStorage_->getCompletedLength() ||
+    savedNumInFlightPiece_ != pieceStorage_->countInFlightPiece() ||
+    savedUploadLength_ != getUploadLength();
+}
+
+uint64_t DefaultBtProgressInfoFile::getUploadLength()
+{
+#ifdef ENABLE_BITTORRENT
+  if(isTorrentDownload()) {
+    TransferStat stat = peerStorage_->calculateStat();
+    return stat.getAllTimeUploadLength();
+  }
+#endif // ENABLE_BITTORRENT
+  return 0;
+}
+
+size_t DefaultBtProgressInfoFile::getUploadLengthOffset()
+{
+  // version(2) + extension(4) + infoHashLength(4) + infoHash +
+  // pieceLength(4) + totalLength(8)
+  size_t offset = 2+4+4+4+8;
+#ifdef ENABLE_BITTORRENT
+  if(isTorrentDownload()) {
+    offset += INFO_HASH_LENGTH;
+  }
+#endif // ENABLE_BITTORRENT
+  return offset;
+}
+
+// Overwrites uploadLength, changed bytes of bitfield and in-flight
+// pieces in the control file written by the last saveFull() call.
+// Returns false if the file cannot be updated in place, in which case
+// the caller must write whole file.
+bool DefaultBtProgressInfoFile::saveInPlace()
+{
+  size_t bitfieldLength = pieceStorage_->getBitfieldLength();
+  if(bitfieldLength != savedBitfield_.size()) {
+    return false;
+  }
+  File f(filename_);
+  if(!f.isFile() || f.size() != savedFileLength_) {
+    return false;
+  }
+  std::string inFlightData = createInFlightPieceData(pieceStorage_);
+  size_t uploadLengthOffset = getUploadLengthOffset();
+  // uploadLength(8) + bitfieldLength(4)
+  size_t bitfieldOffset = uploadLengthOffset+8+4;
+  size_t inFlightOffset = bitfieldOffset+bitfieldLength;
+  // The file is not truncated here, so shrinking in-flight pieces
+  // needs full write.
+  if(inFlightOffset+inFlightData.size() < savedFileLength_) {
+    return false;
+  }
   A2_LOG_INFO(fmt(MSG_SAVING_SEGMENT_FILE, filename_.c_str()));
+  std::fstream o(filename_.c_str(),
+                 std::ios::in|std::ios::out|std::ios::binary);
+  if(!o) {
+    return false;
+  }
+  uint64_t uploadLengthNL = hton64(getUploadLength());
+  o.seekp(uploadLengthOffset);
+  o.write(reinterpret_cast<const char*>(&uploadLengthNL),
+          sizeof(uploadLengthNL));
+  const unsigned char* bitfield = pieceStorage_->getBitfield();
+  for(size_t i = 0; i < bitfieldLength;) {
+    if(bitfield[i] == savedBitfield_[i]) {
+      ++i;
+      continue;
+    }
+    size_t first = i;
+    for(; i < bitfieldLength && bitfield[i] != savedBitfield_[i]; ++i);
+    o.seekp(bitfieldOffset+first);
+    o.write(reinterpret_cast<const char*>(bitfield+first), i-first);
+  }
+  o.seekp(inFlightOffset);
+  o.write(inFlightData.data(), inFlightData.size());
+  o.flush();
+  if(!o) {
+    // The file is partially updated. Force full write next time.
+    inPlaceSaved_ = false;
+    throw DL_ABORT_EX
+      (fmt(EX_SEGMENT_FILE_WRITE, filename_.c_str()));
+  }
+  savedBitfield_.assign(bitfield, bitfield+bitfieldLength);
+  savedFileLength_ = inFlightOffset+inFlightData.size();
+  A2_LOG_INFO(MSG_SAVED_SEGMENT_FILE);
+  return true;
+}
+
+void DefaultBtProgressInfoFile::saveFull()
+{
+  A2_LOG_INFO(fmt(MSG_SAVING_SEGMENT_FILE, filename_.c_str()));
+  inPlaceSaved_ = false;
   std::string filenameTemp = filename_+"__temp";
   {
     std::ofstream o(filenameTemp.c_str(), std::ios::out|std::ios::binary);
@@ -158,13 +304,7 @@ void DefaultBtProgressInfoFile::save()
     o.write(reinterpret_cast<const char*>(&totalLengthNL),
             sizeof(totalLengthNL));
     // uploadLength: 64 bits
-    uint64_t uploadLengthNL = 0;
-#ifdef ENABLE_BITTORRENT
-    if(torrentDownload) {
-      TransferStat stat = peerStorage_->calculateStat();
-      uploadLengthNL = hton64(stat.getAllTimeUploadLength());
-    }
-#endif // ENABLE_BITTORRENT
+    uint64_t uploadLengthNL = hton64(getUploadLength());
     o.write(reinterpret_cast<const char*>(&uploadLengthNL),
             sizeof(uploadLengthNL));
     // bitfieldLength: 32 bits
@@ -175,26 +315,9 @@ void DefaultBtProgressInfoFile::save()
     o.write(reinterpret_cast<const char*>(pieceStorage_->getBitfield()),
             pieceStorage_->getBitfieldLength());
     // the number of in-flight piece: 32 bits
-    // TODO implement this
-    uint32_t numInFlightPieceNL = htonl(pieceStorage_->countInFlightPiece());
-    o.write(reinterpret_cast<const char*>(&numInFlightPieceNL),
-            sizeof(numInFlightPieceNL));
-    std::vector<SharedHandle<Piece> > inFlightPieces;
-    inFlightPieces.reserve(pieceStorage_->countInFlightPiece());
-    pieceStorage_->getInFlightPieces(inFlightPieces);
-    for(std::vector<SharedHandle<Piece> >::const_iterator itr =
-          inFlightPieces.begin(), eoi = inFlightPieces.end();
-        itr != eoi; ++itr) {
-      uint32_t indexNL = htonl((*itr)->getIndex());
-      o.write(reinterpret_cast<const char*>(&indexNL), sizeof(indexNL));
-      uint32_t lengthNL = htonl((*itr)->getLength());
-      o.write(reinterpret_cast<const char*>(&lengthNL), sizeof(lengthNL));
-      uint32_t bitfieldLengthNL = htonl((*itr)->getBitfieldLength());
-      o.write(reinterpret_cast<const char*>(&bitfieldLengthNL),
-              sizeof(bitfieldLengthNL));
-      o.write(reinterpret_cast<const char*>((*itr)->getBitfield()),
-              (*itr)->getBitfieldLength());
-    }
+    // in-flight pieces
+    std::string inFlightData = createInFlightPieceData(pieceStorage_);
+    o.write(inFlightData.data(), inFlightData.size());
     o.flush();
     if(!o) {
       throw DL_ABORT_EX
@@ -206,6 +329,11 @@ void DefaultBtProgressInfoFile::save()
     throw DL_ABORT_EX
       (fmt(EX_SEGMENT_FILE_WRITE, filename_.c_str()));
   }
+  savedBitfield_.assign(pieceStorage_->getBitfield(),
+                        pieceStorage_->getBitfield()+
+                        pieceStorage_->getBitfieldLength());
+  savedFileLength_ = File(filename_).size();
+  inPlaceSaved_ = true;
 }
 
 #define CHECK_STREAM(in, length)                                        \
@@ -424,6 +552,8 @@ void DefaultBtProgressInfoFile::load()
 
 void DefaultBtProgressInfoFile::removeFile()
 {
+  saved_ = false;
+  inPlaceSaved_ = false;
   if(exists()) {
     File f(filename_);
     f.remove();
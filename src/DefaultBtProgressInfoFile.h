@@ -37,6 +37,8 @@
 
 #include "BtProgressInfoFile.h"
 
+#include <vector>
+
 namespace aria2 {
 
 class DownloadContext;
@@ -55,9 +57,27 @@ private:
 #endif // ENABLE_BITTORRENT
   const Option* option_;
   std::string filename_;
+  // Progress at the last save(), used to detect changes.
+  bool saved_;
+  uint64_t savedCompletedLength_;
+  size_t savedNumInFlightPiece_;
+  uint64_t savedUploadLength_;
+  // True if the file on disk was written by saveFull() and only
+  // updated by saveInPlace() since then.
+  bool inPlaceSaved_;
+  std::vector<unsigned char> savedBitfield_;
+  uint64_t savedFileLength_;
 
   bool isTorrentDownload();
 
+  uint64_t getUploadLength();
+
+  size_t getUploadLengthOffset();
+
+  void saveFull();
+
+  bool saveInPlace();
+
   static const std::string V0000;
   static const std::string V0001;
 public:
@@ -71,8 +91,12 @@ public:
   
   virtual bool exists();
 
+  // If PREF_AUTO_SAVE_IN_PLACE is true and the control file was
+  // written by this object, only changed parts are overwritten.
   virtual void save();
 
+  virtual bool isDirty();
+
   virtual void load();
 
   virtual void removeFile();
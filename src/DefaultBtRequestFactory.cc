@@ -60,6 +60,14 @@ DefaultBtRequestFactory::~DefaultBtRequestFactory() {}
 
 void DefaultBtRequestFactory::addTargetPiece(const SharedHandle<Piece>& piece)
 {
+  // In streaming mode, PieceStorage may return a piece which is
+  // already targeted.
+  for(std::deque<SharedHandle<Piece> >::const_iterator i = pieces_.begin(),
+        eoi = pieces_.end(); i != eoi; ++i) {
+    if((*i).get() == piece.get()) {
+      return;
+    }
+  }
   pieces_.push_back(piece);
 }
 
@@ -181,46 +189,67 @@ void DefaultBtRequestFactory::createRequestMessages
   }
 }
 
+namespace {
+struct EndGameBlock {
+  SharedHandle<Piece> piece;
+  size_t blockIndex;
+  size_t numRequest;
+
+  EndGameBlock(const SharedHandle<Piece>& piece, size_t blockIndex):
+    piece(piece), blockIndex(blockIndex),
+    numRequest(piece->countBlockRequest(blockIndex)) {}
+
+  bool operator<(const EndGameBlock& rhs) const
+  {
+    return numRequest < rhs.numRequest;
+  }
+};
+} // namespace
+
 void DefaultBtRequestFactory::createRequestMessagesOnEndGame
-(std::vector<SharedHandle<BtMessage> >& requests, size_t max)
+(std::vector<SharedHandle<BtMessage> >& requests, size_t max,
+ size_t maxBlockRequest)
 {
+  std::vector<EndGameBlock> blocks;
   for(std::deque<SharedHandle<Piece> >::iterator itr = pieces_.begin(),
-        eoi = pieces_.end(); itr != eoi && requests.size() < max; ++itr) {
+        eoi = pieces_.end(); itr != eoi; ++itr) {
     SharedHandle<Piece>& piece = *itr;
     const size_t mislen = piece->getBitfieldLength();
     array_ptr<unsigned char> misbitfield(new unsigned char[mislen]);
 
     piece->getAllMissingBlockIndexes(misbitfield, mislen);
 
-    std::vector<size_t> missingBlockIndexes;
     size_t blockIndex = 0;
     for(size_t i = 0; i < mislen; ++i) {
       unsigned char bits = misbitfield[i];
       unsigned char mask = 128;
       for(size_t bi = 0; bi < 8; ++bi, mask >>= 1, ++blockIndex) {
-        if(bits & mask) {
-          missingBlockIndexes.push_back(blockIndex);
+        if((bits & mask) &&
+           piece->countBlockRequest(blockIndex) < maxBlockRequest &&
+           !dispatcher_->isOutstandingRequest(piece->getIndex(),
+                                              blockIndex)) {
+          blocks.push_back(EndGameBlock(piece, blockIndex));
         }
       }
     }
-    std::random_shuffle(missingBlockIndexes.begin(), missingBlockIndexes.end(),
-                        *(SimpleRandomizer::getInstance().get()));
-    for(std::vector<size_t>::const_iterator bitr = missingBlockIndexes.begin(),
-          eoi2 = missingBlockIndexes.end();
-        bitr != eoi2 && requests.size() < max; ++bitr) {
-      const size_t& blockIndex = *bitr;
-      if(!dispatcher_->isOutstandingRequest(piece->getIndex(),
-                                           blockIndex)) {
-        A2_LOG_DEBUG
-          (fmt("Creating RequestMessage index=%lu, begin=%u,"
-               " blockIndex=%lu",
-               static_cast<unsigned long>(piece->getIndex()),
-               static_cast<unsigned int>(blockIndex*piece->getBlockLength()),
-               static_cast<unsigned long>(blockIndex)));
-        requests.push_back(messageFactory_->createRequestMessage
-                           (piece, blockIndex));
-      }
-    }
+  }
+  // Shuffle first so that peers which have the same blocks do not
+  // request them in the same order.
+  std::random_shuffle(blocks.begin(), blocks.end(),
+                      *(SimpleRandomizer::getInstance().get()));
+  std::stable_sort(blocks.begin(), blocks.end());
+  for(std::vector<EndGameBlock>::const_iterator i = blocks.begin(),
+        eoi = blocks.end(); i != eoi && requests.size() < max; ++i) {
+    A2_LOG_DEBUG
+      (fmt("Creating RequestMessage index=%lu, begin=%u,"
+           " blockIndex=%lu, numRequest=%lu",
+           static_cast<unsigned long>((*i).piece->getIndex()),
+           static_cast<unsigned int>
+           ((*i).blockIndex*(*i).piece->getBlockLength()),
+           static_cast<unsigned long>((*i).blockIndex),
+           static_cast<unsigned long>((*i).numRequest)));
+    requests.push_back(messageFactory_->createRequestMessage
+                       ((*i).piece, (*i).blockIndex));
   }
 }
 
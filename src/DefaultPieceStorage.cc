@@ -56,6 +56,7 @@
 #include "Option.h"
 #include "fmt.h"
 #include "RarestPieceSelector.h"
+#include "StreamPieceSelector.h"
 #include "array_fun.h"
 #include "PieceStatMan.h"
 #include "wallclock.h"
@@ -74,9 +75,13 @@ DefaultPieceStorage::DefaultPieceStorage
    diskWriterFactory_(new DefaultDiskWriterFactory()),
    endGame_(false),
    endGamePieceNum_(END_GAME_PIECE_NUM),
+   wastedLength_(0),
+   numHashReread_(0),
+   hashRereadLength_(0),
    option_(option),
    pieceStatMan_(new PieceStatMan(downloadContext->getNumPieces(), true)),
-   pieceSelector_(new RarestPieceSelector(pieceStatMan_))
+   pieceSelector_(new RarestPieceSelector(pieceStatMan_)),
+   streamPieceShared_(false)
 {}
 
 DefaultPieceStorage::~DefaultPieceStorage()
@@ -187,6 +192,20 @@ void DefaultPieceStorage::getMissingPiece
       misBlock += pieces.back()->countMissingBlock();
     }
   } else {
+    size_t first, last;
+    if(streamPieceSelector_ &&
+       streamPieceSelector_->getWindow(first, last, blocks)) {
+      // Pieces in the stream window which are being downloaded from
+      // other peers are shared with this peer, so that their blocks
+      // can be requested from more than one peer as in end game.
+      for(size_t i = first; i < last; ++i) {
+        if(bitfieldMan_->isUseBitSet(i) && !bitfieldMan_->isBitSet(i) &&
+           bitfield::test(bitfield, blocks, i)) {
+          pieces.push_back(checkOutPiece(i));
+          streamPieceShared_ = true;
+        }
+      }
+    }
     bool r = bitfieldMan_->getAllMissingUnusedIndexes
       (misbitfield, mislen, bitfield, length);
     if(!r) {
@@ -433,6 +452,17 @@ void DefaultPieceStorage::completePiece(const SharedHandle<Piece>& piece)
     } else {
       A2_LOG_INFO(MSG_DOWNLOAD_COMPLETED);
     }
+    if(wastedLength_ > 0) {
+      A2_LOG_INFO(fmt("%s bytes were downloaded more than once or"
+                      " without request.",
+                      util::uitos(wastedLength_).c_str()));
+    }
+    if(numHashReread_ > 0) {
+      A2_LOG_INFO(fmt("%lu pieces were read back from disk to calculate"
+                      " hash, %s bytes in total.",
+                      static_cast<unsigned long>(numHashReread_),
+                      util::uitos(hashRereadLength_).c_str()));
+    }
 #ifdef ENABLE_BITTORRENT
     if(downloadContext_->hasAttribute(bittorrent::BITTORRENT)) {
       SharedHandle<TorrentAttribute> torrentAttrs =
@@ -458,13 +488,29 @@ void DefaultPieceStorage::cancelPiece(const SharedHandle<Piece>& piece)
     return;
   }
   bitfieldMan_->unsetUseBit(piece->getIndex());
-  if(!isEndGame()) {
+  // A shared piece may still be used by other peers, so it must stay
+  // in usedPieces_.
+  if(!isEndGame() && !streamPieceShared_) {
     if(piece->getCompletedLength() == 0) {
       deleteUsedPiece(piece);
     }
   }
 }
 
+bool DefaultPieceStorage::isStreamingMode()
+{
+  size_t first, last;
+  return streamPieceSelector_ &&
+    streamPieceSelector_->getWindow(first, last, bitfieldMan_->countBlock());
+}
+
+void DefaultPieceStorage::setStreamPieceSelector
+(const SharedHandle<StreamPieceSelector>& pieceSelector)
+{
+  pieceSelector_ = pieceSelector;
+  streamPieceSelector_ = pieceSelector;
+}
+
 bool DefaultPieceStorage::hasPiece(size_t index)
 {
   return bitfieldMan_->isBitSet(index);
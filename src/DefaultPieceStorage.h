@@ -48,6 +48,7 @@ class DiskWriterFactory;
 class FileEntry;
 class PieceStatMan;
 class PieceSelector;
+class StreamPieceSelector;
 
 #define END_GAME_PIECE_NUM 20
 
@@ -79,6 +80,9 @@ private:
 
   bool endGame_;
   size_t endGamePieceNum_;
+  uint64_t wastedLength_;
+  size_t numHashReread_;
+  uint64_t hashRereadLength_;
   const Option* option_;
   std::deque<HaveEntry> haves_;
 
@@ -86,6 +90,12 @@ private:
 
   SharedHandle<PieceSelector> pieceSelector_;
 
+  SharedHandle<StreamPieceSelector> streamPieceSelector_;
+
+  // True if a piece in the stream window has been shared by more
+  // than one peer.
+  bool streamPieceShared_;
+
 #ifdef ENABLE_BITTORRENT
   void getMissingPiece
   (std::vector<SharedHandle<Piece> >& pieces,
@@ -216,6 +226,29 @@ public:
     endGame_ = true;
   }
 
+  virtual bool isStreamingMode();
+
+  virtual void addWastedLength(size_t length)
+  {
+    wastedLength_ += length;
+  }
+
+  virtual uint64_t getWastedLength()
+  {
+    return wastedLength_;
+  }
+
+  virtual void addHashReread(size_t length)
+  {
+    ++numHashReread_;
+    hashRereadLength_ += length;
+  }
+
+  virtual size_t getNumHashReread()
+  {
+    return numHashReread_;
+  }
+
   virtual SharedHandle<DiskAdaptor> getDiskAdaptor();
 
   virtual size_t getPieceLength(size_t index);
@@ -278,6 +311,11 @@ public:
   {
     return pieceSelector_;
   }
+
+  // Sets pieceSelector as piece selector. Its window is also used to
+  // share pieces which are being downloaded between peers.
+  void setStreamPieceSelector
+  (const SharedHandle<StreamPieceSelector>& pieceSelector);
 };
 
 typedef SharedHandle<DefaultPieceStorage> DefaultPieceStorageHandle;
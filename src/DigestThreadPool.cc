@@ -0,0 +1,302 @@
+/* <!-- copyright */
+/*
+ * aria2 - The high speed download utility
+ *
+ * Copyright (C) 2011 Tatsuhiro Tsujikawa
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.  If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so.  If you
+ * do not wish to do so, delete this exception statement from your
+ * version.  If you delete this exception statement from all source
+ * files in the program, then also delete it here.
+ */
+/* copyright --> */
+#include "DigestThreadPool.h"
+
+#include <unistd.h>
+#include <fcntl.h>
+
+#include <cassert>
+#include <cerrno>
+#include <csignal>
+
+#include "MessageDigest.h"
+#include "LogFactory.h"
+#include "Logger.h"
+#include "fmt.h"
+#include "util.h"
+
+namespace aria2 {
+
+SharedHandle<DigestThreadPool> DigestThreadPool::instance_;
+
+#ifdef HAVE_PTHREAD
+
+DigestThreadPool::DigestThreadPool(size_t numThreads)
+  : numThreads_(0),
+    stop_(false)
+{
+  notifyFd_[0] = notifyFd_[1] = -1;
+  pthread_mutex_init(&mutex_, 0);
+  pthread_cond_init(&workCond_, 0);
+  pthread_cond_init(&doneCond_, 0);
+  if(numThreads == 0 || !openNotifyPipe()) {
+    return;
+  }
+  // Signals must be delivered to the main thread, so block them in
+  // workers. The signal mask is inherited by the created threads.
+  sigset_t all, orig;
+  sigfillset(&all);
+  pthread_sigmask(SIG_SETMASK, &all, &orig);
+  for(size_t i = 0; i < numThreads; ++i) {
+    pthread_t thread;
+    int r = pthread_create(&thread, 0, &DigestThreadPool::run, this);
+    if(r != 0) {
+      A2_LOG_WARN(fmt("Failed to create hash thread, cause: %s",
+                      util::safeStrerror(r).c_str()));
+      break;
+    }
+    threads_.push_back(thread);
+  }
+  pthread_sigmask(SIG_SETMASK, &orig, 0);
+  numThreads_ = threads_.size();
+  A2_LOG_DEBUG(fmt("Started %lu hash threads.",
+                   static_cast<unsigned long>(numThreads_)));
+}
+
+DigestThreadPool::~DigestThreadPool()
+{
+  pthread_mutex_lock(&mutex_);
+  stop_ = true;
+  pthread_cond_broadcast(&workCond_);
+  pthread_mutex_unlock(&mutex_);
+  for(std::vector<pthread_t>::const_iterator i = threads_.begin(),
+        eoi = threads_.end(); i != eoi; ++i) {
+    pthread_join(*i, 0);
+  }
+  pthread_cond_destroy(&doneCond_);
+  pthread_cond_destroy(&workCond_);
+  pthread_mutex_destroy(&mutex_);
+  for(int i = 0; i < 2; ++i) {
+    if(notifyFd_[i] != -1) {
+      close(notifyFd_[i]);
+    }
+  }
+}
+
+bool DigestThreadPool::openNotifyPipe()
+{
+  if(pipe(notifyFd_) == -1) {
+    int errNum = errno;
+    A2_LOG_WARN(fmt("Failed to create pipe for hash threads, cause: %s",
+                    util::safeStrerror(errNum).c_str()));
+    notifyFd_[0] = notifyFd_[1] = -1;
+    return false;
+  }
+  for(int i = 0; i < 2; ++i) {
+    int flags;
+    while((flags = fcntl(notifyFd_[i], F_GETFL, 0)) == -1 && errno == EINTR);
+    while(fcntl(notifyFd_[i], F_SETFL, flags|O_NONBLOCK) == -1 &&
+          errno == EINTR);
+  }
+  return true;
+}
+
+void* DigestThreadPool::run(void* arg)
+{
+  static_cast<DigestThreadPool*>(arg)->work();
+  return 0;
+}
+
+void DigestThreadPool::work()
+{
+  pthread_mutex_lock(&mutex_);
+  while(1) {
+    while(queue_.empty() && !stop_) {
+      pthread_cond_wait(&workCond_, &mutex_);
+    }
+    // Queued streams are drained before stopping.
+    if(queue_.empty()) {
+      break;
+    }
+    DigestStream* stream = queue_.front();
+    queue_.pop_front();
+    stream->working_.swap(stream->pending_);
+    pthread_mutex_unlock(&mutex_);
+    // Only this thread touches the context and working_ of stream
+    // until busy_ is cleared, so they are used without holding the
+    // lock.
+    stream->ctx_->update(&stream->working_[0], stream->working_.size());
+    stream->working_.clear();
+    pthread_mutex_lock(&mutex_);
+    if(stream->pending_.empty()) {
+      stream->busy_ = false;
+      pthread_cond_broadcast(&doneCond_);
+      if(stream->notify_) {
+        stream->notify_ = false;
+        // If the pipe is full, a notification is already pending.
+        char c = 0;
+        while(write(notifyFd_[1], &c, 1) == -1 && errno == EINTR);
+      }
+    } else {
+      // More data arrived meanwhile. Requeue stream so that its data
+      // is hashed in order by one thread at a time.
+      queue_.push_back(stream);
+    }
+  }
+  pthread_mutex_unlock(&mutex_);
+}
+
+void DigestThreadPool::submit
+(DigestStream* stream, const unsigned char* data, size_t length)
+{
+  pthread_mutex_lock(&mutex_);
+  stream->pending_.insert(stream->pending_.end(), &data[0], &data[length]);
+  if(!stream->busy_) {
+    stream->busy_ = true;
+    queue_.push_back(stream);
+    pthread_cond_signal(&workCond_);
+  }
+  pthread_mutex_unlock(&mutex_);
+}
+
+void DigestThreadPool::wait(DigestStream* stream)
+{
+  pthread_mutex_lock(&mutex_);
+  while(stream->busy_) {
+    pthread_cond_wait(&doneCond_, &mutex_);
+  }
+  stream->notify_ = false;
+  pthread_mutex_unlock(&mutex_);
+}
+
+bool DigestThreadPool::busy(const DigestStream* stream)
+{
+  pthread_mutex_lock(&mutex_);
+  bool b = stream->busy_;
+  pthread_mutex_unlock(&mutex_);
+  return b;
+}
+
+bool DigestThreadPool::requestNotification(DigestStream* stream)
+{
+  pthread_mutex_lock(&mutex_);
+  bool b = stream->busy_;
+  if(b) {
+    stream->notify_ = true;
+  }
+  pthread_mutex_unlock(&mutex_);
+  return b;
+}
+
+void DigestThreadPool::clearNotification()
+{
+  if(notifyFd_[0] == -1) {
+    return;
+  }
+  char buf[256];
+  ssize_t r;
+  while((r = read(notifyFd_[0], buf, sizeof(buf))) > 0 ||
+        (r == -1 && errno == EINTR));
+}
+
+#else // !HAVE_PTHREAD
+
+DigestThreadPool::DigestThreadPool(size_t numThreads)
+  : numThreads_(0)
+{
+  notifyFd_[0] = notifyFd_[1] = -1;
+  if(numThreads > 0) {
+    A2_LOG_WARN("Hash threads are not supported on this platform."
+                " Hashing is done in the main thread.");
+  }
+}
+
+DigestThreadPool::~DigestThreadPool() {}
+
+void DigestThreadPool::submit
+(DigestStream* stream, const unsigned char* data, size_t length)
+{
+  // Never called because numThreads_ is 0.
+  assert(0);
+}
+
+void DigestThreadPool::wait(DigestStream* stream) {}
+
+bool DigestThreadPool::busy(const DigestStream* stream)
+{
+  return false;
+}
+
+bool DigestThreadPool::requestNotification(DigestStream* stream)
+{
+  return false;
+}
+
+void DigestThreadPool::clearNotification() {}
+
+#endif // !HAVE_PTHREAD
+
+DigestStream::DigestStream
+(const SharedHandle<MessageDigest>& ctx,
+ const SharedHandle<DigestThreadPool>& pool)
+  : ctx_(ctx),
+    pool_(pool),
+    busy_(false),
+    notify_(false)
+{}
+
+DigestStream::~DigestStream()
+{
+  wait();
+}
+
+void DigestStream::update(const unsigned char* data, size_t length)
+{
+  if(!pool_ || pool_->getNumThreads() == 0) {
+    ctx_->update(data, length);
+  } else if(length > 0) {
+    pool_->submit(this, data, length);
+  }
+}
+
+void DigestStream::wait()
+{
+  if(pool_ && pool_->getNumThreads() > 0) {
+    pool_->wait(this);
+  }
+}
+
+bool DigestStream::busy() const
+{
+  return pool_ && pool_->getNumThreads() > 0 && pool_->busy(this);
+}
+
+bool DigestStream::requestNotification()
+{
+  return pool_ && pool_->getNumThreads() > 0 &&
+    pool_->requestNotification(this);
+}
+
+} // namespace aria2
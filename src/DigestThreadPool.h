@@ -0,0 +1,197 @@
+/* <!-- copyright */
+/*
+ * aria2 - The high speed download utility
+ *
+ * Copyright (C) 2011 Tatsuhiro Tsujikawa
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.  If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so.  If you
+ * do not wish to do so, delete this exception statement from your
+ * version.  If you delete this exception statement from all source
+ * files in the program, then also delete it here.
+ */
+/* copyright --> */
+#ifndef D_DIGEST_THREAD_POOL_H
+#define D_DIGEST_THREAD_POOL_H
+
+#include "common.h"
+
+#include <deque>
+#include <vector>
+
+#ifdef HAVE_PTHREAD
+# include <pthread.h>
+#endif // HAVE_PTHREAD
+
+#include "SharedHandle.h"
+
+namespace aria2 {
+
+class MessageDigest;
+class DigestStream;
+
+// Runs MessageDigest::update() for DigestStream objects on a fixed
+// number of worker threads, so that hashing downloaded data does not
+// stall the event loop.  Without pthread support or with 0 threads,
+// every update is done synchronously by the caller.
+class DigestThreadPool {
+private:
+  size_t numThreads_;
+
+  // A pipe written by the workers when a stream for which
+  // DigestStream::requestNotification() was called becomes idle.
+  // DownloadEngine polls the read end.  Both are -1 without worker
+  // threads.
+  int notifyFd_[2];
+
+#ifdef HAVE_PTHREAD
+  pthread_mutex_t mutex_;
+  // Signaled when a stream is queued or the pool is stopped.
+  pthread_cond_t workCond_;
+  // Signaled when a stream has no more pending data.
+  pthread_cond_t doneCond_;
+  std::vector<pthread_t> threads_;
+  // Streams which have pending data and are not being processed.
+  std::deque<DigestStream*> queue_;
+  bool stop_;
+
+  static void* run(void* arg);
+
+  void work();
+
+  bool openNotifyPipe();
+#endif // HAVE_PTHREAD
+
+  static SharedHandle<DigestThreadPool> instance_;
+
+  // Appends data to the pending data of stream and schedules stream
+  // if it is idle.
+  void submit(DigestStream* stream, const unsigned char* data, size_t length);
+
+  // Blocks until all pending data of stream is hashed.
+  void wait(DigestStream* stream);
+
+  bool busy(const DigestStream* stream);
+
+  bool requestNotification(DigestStream* stream);
+
+  friend class DigestStream;
+
+  DigestThreadPool(const DigestThreadPool&);
+  DigestThreadPool& operator=(const DigestThreadPool&);
+public:
+  DigestThreadPool(size_t numThreads);
+
+  // Hashes the remaining queued data and joins all worker threads.
+  ~DigestThreadPool();
+
+  size_t getNumThreads() const
+  {
+    return numThreads_;
+  }
+
+  // Returns the descriptor which becomes readable when a stream
+  // requesting notification becomes idle, or -1 if there are no
+  // worker threads.
+  int getNotifyFd() const
+  {
+    return notifyFd_[0];
+  }
+
+  // Reads all pending notifications so that getNotifyFd() is no
+  // longer readable.
+  void clearNotification();
+
+  // Returns the pool used by Piece and the checksum validators.  It
+  // is null unless --hash-threads is given.
+  static const SharedHandle<DigestThreadPool>& getInstance()
+  {
+    return instance_;
+  }
+
+  static void setInstance(const SharedHandle<DigestThreadPool>& pool)
+  {
+    instance_ = pool;
+  }
+};
+
+// Feeds data to a MessageDigest through DigestThreadPool.  The data
+// is copied by update(), so the caller may reuse its buffer right
+// away.  The digest must not be touched until busy() returns false or
+// wait() returns.
+class DigestStream {
+private:
+  SharedHandle<MessageDigest> ctx_;
+  SharedHandle<DigestThreadPool> pool_;
+  // Data waiting to be hashed, guarded by the mutex of pool_.
+  std::vector<unsigned char> pending_;
+  // Data being hashed by a worker.  It is swapped with pending_, so
+  // that both buffers keep their capacity and update() does not
+  // allocate once they are large enough.
+  std::vector<unsigned char> working_;
+  // True while this stream is queued or being processed by a worker.
+  bool busy_;
+  // True if the pool must write to its notification pipe when this
+  // stream becomes idle.
+  bool notify_;
+
+  friend class DigestThreadPool;
+
+  DigestStream(const DigestStream&);
+  DigestStream& operator=(const DigestStream&);
+public:
+  DigestStream(const SharedHandle<MessageDigest>& ctx,
+               const SharedHandle<DigestThreadPool>& pool);
+
+  // Waits for pending data.
+  ~DigestStream();
+
+  void update(const unsigned char* data, size_t length);
+
+  // Blocks until all data given to update() is hashed.
+  void wait();
+
+  // Returns true if some data given to update() is not hashed yet.
+  // Never blocks.
+  bool busy() const;
+
+  // Makes the pool notify through DigestThreadPool::getNotifyFd()
+  // when all data given to update() so far is hashed.  Returns false
+  // if it already is, in which case no notification is made.
+  bool requestNotification();
+
+  const SharedHandle<MessageDigest>& getContext() const
+  {
+    return ctx_;
+  }
+
+  const SharedHandle<DigestThreadPool>& getPool() const
+  {
+    return pool_;
+  }
+};
+
+} // namespace aria2
+
+#endif // D_DIGEST_THREAD_POOL_H
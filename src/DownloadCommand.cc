@@ -62,9 +62,12 @@
 #include "SinkStreamFilter.h"
 #include "FileEntry.h"
 #include "SocketRecvBuffer.h"
+#include "Metrics.h"
 #ifdef ENABLE_MESSAGE_DIGEST
 # include "MessageDigest.h"
 # include "message_digest_helper.h"
+# include "DigestThreadPool.h"
+# include "Piece.h"
 #endif // ENABLE_MESSAGE_DIGEST
 #ifdef ENABLE_BITTORRENT
 # include "bittorrent_helper.h"
@@ -96,6 +99,11 @@ DownloadCommand::DownloadCommand
       if(MessageDigest::supports(algo)) {
         messageDigest_ = MessageDigest::create(algo);
         pieceHashValidationEnabled_ = true;
+        const SharedHandle<DigestThreadPool>& pool =
+          DigestThreadPool::getInstance();
+        if(pool && pool->getNumThreads() > 0) {
+          messageDigestStream_.reset(new DigestStream(messageDigest_, pool));
+        }
       }
     }
   }
@@ -112,11 +120,19 @@ DownloadCommand::DownloadCommand
 }
 
 DownloadCommand::~DownloadCommand() {
+#ifdef ENABLE_MESSAGE_DIGEST
+  getDownloadEngine()->deleteDigestCheck(this);
+#endif // ENABLE_MESSAGE_DIGEST
   peerStat_->downloadStop();
   getSegmentMan()->updateFastestPeerStat(peerStat_);
 }
 
 bool DownloadCommand::executeInternal() {
+#ifdef ENABLE_MESSAGE_DIGEST
+  if(hashPendingSegment_) {
+    return checkHashPendingSegment();
+  }
+#endif // ENABLE_MESSAGE_DIGEST
   if(getDownloadEngine()->getRequestGroupMan()->doesOverallDownloadSpeedExceed()
      || getRequestGroup()->doesDownloadSpeedExceed()) {
     getDownloadEngine()->addCommand(this);
@@ -174,6 +190,9 @@ bool DownloadCommand::executeInternal() {
     }
     getSocketRecvBuffer()->shiftBuffer(bufSize);
     peerStat_->updateDownloadLength(bufSize);
+    global::metrics.addReceivedBytes
+      (getRequest()->getProtocol() == "ftp" ?
+       Metrics::PROTO_FTP : Metrics::PROTO_HTTP, bufSize);
   }
   getSegmentMan()->updateDownloadSpeedFor(peerStat_);
   bool segmentPartComplete = false;
@@ -222,26 +241,43 @@ bool DownloadCommand::executeInternal() {
         const std::string& expectedPieceHash =
           getDownloadContext()->getPieceHash(segment->getIndex());
         if(pieceHashValidationEnabled_ && !expectedPieceHash.empty()) {
-          if(
+          bool segmentHash =
 #ifdef ENABLE_BITTORRENT
-             (!getPieceStorage()->isEndGame() ||
-              !getDownloadContext()->hasAttribute(bittorrent::BITTORRENT)) &&
+            (!getPieceStorage()->isEndGame() ||
+             !getDownloadContext()->hasAttribute(bittorrent::BITTORRENT)) &&
 #endif // ENABLE_BITTORRENT
-             segment->isHashCalculated()) {
+            segment->isHashCalculated();
+          SharedHandle<DigestStream> stream;
+          if(segmentHash) {
             A2_LOG_DEBUG(fmt("Hash is available! index=%lu",
                              static_cast<unsigned long>(segment->getIndex())));
-            validatePieceHash
-              (segment, expectedPieceHash, segment->getHashString());
+            stream = segment->getPiece()->getDigestStream();
           } else {
             messageDigest_->reset();
-            validatePieceHash
-              (segment, expectedPieceHash,
-               message_digest::hexDigest
-               (messageDigest_,
-                getPieceStorage()->getDiskAdaptor(),
-                segment->getPosition(),
-                segment->getLength()));
+            if(messageDigestStream_) {
+              message_digest::updateDigest
+                (messageDigestStream_, getPieceStorage()->getDiskAdaptor(),
+                 segment->getPosition(), segment->getLength());
+              stream = messageDigestStream_;
+            } else {
+              message_digest::updateDigest
+                (messageDigest_, getPieceStorage()->getDiskAdaptor(),
+                 segment->getPosition(), segment->getLength());
+            }
+          }
+          if(stream && getDownloadEngine()->addDigestCheck(stream, this)) {
+            // The socket is not read until the segment is validated
+            // in checkHashPendingSegment().
+            hashPendingSegment_ = segment;
+            hashPendingStream_ = stream;
+            disableReadCheckSocket();
+            getDownloadEngine()->addCommand(this);
+            return false;
           }
+          validatePieceHash
+            (segment, expectedPieceHash,
+             segmentHash ?
+             segment->getHashString() : messageDigest_->hexDigest());
         } else {
           getSegmentMan()->completeSegment(getCuid(), segment);
         }
@@ -349,6 +385,24 @@ bool DownloadCommand::prepareForNextSegment() {
 
 #ifdef ENABLE_MESSAGE_DIGEST
 
+bool DownloadCommand::checkHashPendingSegment()
+{
+  if(hashPendingStream_->busy()) {
+    // Woken up by something other than the hash.
+    getDownloadEngine()->addCommand(this);
+    return false;
+  }
+  SharedHandle<Segment> segment;
+  segment.swap(hashPendingSegment_);
+  bool segmentHash = hashPendingStream_.get() != messageDigestStream_.get();
+  hashPendingStream_.reset();
+  validatePieceHash
+    (segment, getDownloadContext()->getPieceHash(segment->getIndex()),
+     segmentHash ? segment->getHashString() : messageDigest_->hexDigest());
+  checkLowestDownloadSpeed();
+  return prepareForNextSegment();
+}
+
 void DownloadCommand::validatePieceHash(const SharedHandle<Segment>& segment,
                                         const std::string& expectedPieceHash,
                                         const std::string& actualPieceHash)
@@ -362,6 +416,7 @@ void DownloadCommand::validatePieceHash(const SharedHandle<Segment>& segment,
                     util::itos(segment->getPosition(), true).c_str(),
                     expectedPieceHash.c_str(),
                     actualPieceHash.c_str()));
+    global::metrics.increasePieceHashFailures();
     segment->clear();
     getSegmentMan()->cancelSegment(getCuid());
     throw DL_RETRY_EX
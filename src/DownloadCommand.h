@@ -45,6 +45,7 @@ class PeerStat;
 class StreamFilter;
 #ifdef ENABLE_MESSAGE_DIGEST
 class MessageDigest;
+class DigestStream;
 #endif // ENABLE_MESSAGE_DIGEST
 
 class DownloadCommand : public AbstractCommand {
@@ -59,12 +60,25 @@ private:
 
   SharedHandle<MessageDigest> messageDigest_;
 
-#endif // ENABLE_MESSAGE_DIGEST
+  // Feeds messageDigest_ on DigestThreadPool. Null if it is not
+  // available.
+  SharedHandle<DigestStream> messageDigestStream_;
+
+  // The completed segment whose hash is still calculated on
+  // DigestThreadPool, and the stream calculating it. The stream is
+  // either messageDigestStream_ or the one of the segment's piece.
+  SharedHandle<Segment> hashPendingSegment_;
+  SharedHandle<DigestStream> hashPendingStream_;
+
+  // Validates hashPendingSegment_ if its hash is calculated.
+  bool checkHashPendingSegment();
 
   void validatePieceHash(const SharedHandle<Segment>& segment,
                          const std::string& expectedPieceHash,
                          const std::string& actualPieceHash);
 
+#endif // ENABLE_MESSAGE_DIGEST
+
   void checkLowestDownloadSpeed() const;
 
   SharedHandle<StreamFilter> streamFilter_;
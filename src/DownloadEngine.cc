@@ -40,6 +40,7 @@
 #include <cerrno>
 #include <algorithm>
 #include <numeric>
+#include <typeinfo>
 
 #include "StatCalc.h"
 #include "RequestGroup.h"
@@ -65,8 +66,17 @@
 #include "BtProgressInfoFile.h"
 #include "DownloadContext.h"
 #include "fmt.h"
+#include "Metrics.h"
+#include "CommandProfiler.h"
+#ifdef ENABLE_MESSAGE_DIGEST
+# include "DigestThreadPool.h"
+#endif // ENABLE_MESSAGE_DIGEST
 #ifdef ENABLE_BITTORRENT
 # include "BtRegistry.h"
+# include "UDPTrackerClient.h"
+# include "DHKeyPool.h"
+# include "PendingHandshakeMan.h"
+# include "PieceHashIndex.h"
 #endif // ENABLE_BITTORRENT
 
 namespace aria2 {
@@ -89,11 +99,13 @@ volatile sig_atomic_t globalHaltRequested = 0;
 DownloadEngine::DownloadEngine(const SharedHandle<EventPoll>& eventPoll)
   : eventPoll_(eventPoll),
     haltRequested_(false),
+    forceHaltRequested_(false),
     noWait_(false),
     refreshInterval_(DEFAULT_REFRESH_INTERVAL),
     cookieStorage_(new CookieStorage()),
 #ifdef ENABLE_BITTORRENT
     btRegistry_(new BtRegistry()),
+    pendingHandshakeMan_(new PendingHandshakeMan()),
 #endif // ENABLE_BITTORRENT
 #ifdef HAVE_ARES_ADDR_NODE
     asyncDNSServers_(0),
@@ -117,9 +129,25 @@ void DownloadEngine::cleanQueue() {
   commands_.clear();
 }
 
+namespace {
+bool executeProfiled(Command* command, CommandProfiler* profiler)
+{
+  // command may be deleted by the caller after execute(), so take
+  // the values we need beforehand.
+  const char* typeName = typeid(*command).name();
+  cuid_t cuid = command->getCuid();
+  Timer start;
+  bool finished = command->execute();
+  profiler->commandExecuted
+    (typeName, cuid, Timer().getTimeInMicros()-start.getTimeInMicros());
+  return finished;
+}
+} // namespace
+
 namespace {
 void executeCommand(std::deque<Command*>& commands,
-                    Command::STATUS statusFilter)
+                    Command::STATUS statusFilter,
+                    CommandProfiler* profiler)
 {
   size_t max = commands.size();
   for(size_t i = 0; i < max; ++i) {
@@ -127,7 +155,7 @@ void executeCommand(std::deque<Command*>& commands,
     commands.pop_front();
     if(com->statusMatch(statusFilter)) {
       com->transitStatus();
-      if(com->execute()) {
+      if(profiler ? executeProfiled(com, profiler) : com->execute()) {
         delete com;
         com = 0;
       }
@@ -145,21 +173,34 @@ void DownloadEngine::run()
 {
   Timer cp;
   cp.reset(0);
+  CommandProfiler* profiler = commandProfiler_.get();
+  // Time at which the last waitData() call started.
+  Timer pollStart;
+  bool polled = false;
   while(!commands_.empty() || !routineCommands_.empty()) {
     global::wallclock.reset();
+    if(polled) {
+      global::metrics.observePollWait
+        (global::wallclock.getTimeInMicros()-pollStart.getTimeInMicros());
+      polled = false;
+    }
     calculateStatistics();
     if(cp.differenceInMillis(global::wallclock)+A2_DELTA_MILLIS >=
        refreshInterval_) {
       refreshInterval_ = DEFAULT_REFRESH_INTERVAL;
       cp = global::wallclock;
-      executeCommand(commands_, Command::STATUS_ALL);
+      executeCommand(commands_, Command::STATUS_ALL, profiler);
     } else {
-      executeCommand(commands_, Command::STATUS_ACTIVE);
+      executeCommand(commands_, Command::STATUS_ACTIVE, profiler);
     }
-    executeCommand(routineCommands_, Command::STATUS_ALL);
+    executeCommand(routineCommands_, Command::STATUS_ALL, profiler);
     afterEachIteration();
+    pollStart.reset();
+    global::metrics.observeLoopIteration
+      (pollStart.getTimeInMicros()-global::wallclock.getTimeInMicros());
     if(!commands_.empty()) {
       waitData();
+      polled = true;
     }
     noWait_ = false;
   }
@@ -177,6 +218,9 @@ void DownloadEngine::waitData()
     tv.tv_usec = qr.rem;
   }
   eventPoll_->poll(tv);
+#ifdef ENABLE_MESSAGE_DIGEST
+  processDigestChecks();
+#endif // ENABLE_MESSAGE_DIGEST
 }
 
 bool DownloadEngine::addSocketForReadCheck(const SocketHandle& socket,
@@ -219,11 +263,44 @@ void DownloadEngine::onEndOfRun()
   requestGroupMan_->removeStoppedGroup(this);
   requestGroupMan_->closeFile();
   requestGroupMan_->save();
+  A2_LOG_INFO(fmt("SocketPool: hit=%s, miss=%s, evicted=%s, timedout=%s,"
+                  " closedbypeer=%s",
+                  util::uitos(socketPool_.getNumHit()).c_str(),
+                  util::uitos(socketPool_.getNumMiss()).c_str(),
+                  util::uitos(socketPool_.getNumEvicted()).c_str(),
+                  util::uitos(socketPool_.getNumTimedOut()).c_str(),
+                  util::uitos(socketPool_.getNumClosedByPeer()).c_str()));
+#ifdef ENABLE_BITTORRENT
+  A2_LOG_INFO(fmt("PeerListen: accepted=%s, rejected=%s",
+                  util::uitos(pendingHandshakeMan_->getNumAccepted()).c_str(),
+                  util::uitos(pendingHandshakeMan_->getNumRejected()).c_str()));
+  if(dhKeyPool_) {
+    int64_t avgHandshakeTime = dhKeyPool_->getNumHandshake() == 0 ? 0 :
+      dhKeyPool_->getHandshakeTime()/
+      static_cast<int64_t>(dhKeyPool_->getNumHandshake());
+    A2_LOG_INFO(fmt("MSE: handshakes=%s, avg handshake time=%sms,"
+                    " DH key pool hit=%s, miss=%s",
+                    util::uitos(dhKeyPool_->getNumHandshake()).c_str(),
+                    util::itos(avgHandshakeTime).c_str(),
+                    util::uitos(dhKeyPool_->getNumHit()).c_str(),
+                    util::uitos(dhKeyPool_->getNumMiss()).c_str()));
+  }
+#endif // ENABLE_BITTORRENT
+  if(commandProfiler_) {
+    commandProfiler_->logStats();
+  }
 }
 
 void DownloadEngine::afterEachIteration()
 {
   requestGroupMan_->calculateStat();
+  if(lastSocketPoolScan_.difference(global::wallclock) >=
+     SOCKET_POOL_SCAN_INTERVAL) {
+    lastSocketPoolScan_ = global::wallclock;
+    socketPool_.removeStaleEntry(true);
+  } else {
+    socketPool_.removeStaleEntry(false);
+  }
   if(global::globalHaltRequested == 1) {
     A2_LOG_NOTICE(_("Shutdown sequence commencing..."
                     " Press Ctrl-C again for emergency shutdown."));
@@ -249,6 +326,7 @@ void DownloadEngine::requestHalt()
 void DownloadEngine::requestForceHalt()
 {
   haltRequested_ = true;
+  forceHaltRequested_ = true;
   requestGroupMan_->forceHalt();
 }
 
@@ -271,39 +349,107 @@ bool DownloadEngine::deleteNameResolverCheck
 }
 #endif // ENABLE_ASYNC_DNS
 
-void DownloadEngine::setNoWait(bool b)
+#ifdef ENABLE_MESSAGE_DIGEST
+namespace {
+class FindDigestCheck {
+private:
+  Command* command_;
+public:
+  FindDigestCheck(Command* command):command_(command) {}
+
+  bool operator()
+  (const std::pair<SharedHandle<DigestStream>, Command*>& check) const
+  {
+    return check.second == command_;
+  }
+};
+} // namespace
+
+bool DownloadEngine::addDigestCheck
+(const SharedHandle<DigestStream>& stream, Command* command)
 {
-  noWait_ = b;
+  for(std::vector<std::pair<SharedHandle<DigestStream>, Command*> >::
+        const_iterator i = digestChecks_.begin(), eoi = digestChecks_.end();
+      i != eoi; ++i) {
+    if((*i).first.get() == stream.get() && (*i).second == command) {
+      return true;
+    }
+  }
+  if(!stream->requestNotification()) {
+    return false;
+  }
+  // The command listens to the notification pipe once, however many
+  // streams it waits for.
+  if(std::find_if(digestChecks_.begin(), digestChecks_.end(),
+                  FindDigestCheck(command)) == digestChecks_.end()) {
+    eventPoll_->addEvents(stream->getPool()->getNotifyFd(), command,
+                          EventPoll::EVENT_READ);
+  }
+  digestChecks_.push_back(std::make_pair(stream, command));
+  return true;
 }
 
-void DownloadEngine::addRoutineCommand(Command* command)
+void DownloadEngine::deleteDigestCheck(Command* command)
 {
-  routineCommands_.push_back(command);
+  std::vector<std::pair<SharedHandle<DigestStream>, Command*> >::iterator i =
+    std::find_if(digestChecks_.begin(), digestChecks_.end(),
+                 FindDigestCheck(command));
+  if(i == digestChecks_.end()) {
+    return;
+  }
+  eventPoll_->deleteEvents((*i).first->getPool()->getNotifyFd(), command,
+                           EventPoll::EVENT_READ);
+  digestChecks_.erase(std::remove_if(digestChecks_.begin(),
+                                     digestChecks_.end(),
+                                     FindDigestCheck(command)),
+                      digestChecks_.end());
 }
 
-void DownloadEngine::poolSocket(const std::string& key,
-                                const SocketPoolEntry& entry)
+void DownloadEngine::processDigestChecks()
 {
-  A2_LOG_INFO(fmt("Pool socket for %s", key.c_str()));
-  std::multimap<std::string, SocketPoolEntry>::value_type p(key, entry);
-  socketPool_.insert(p);
-
-  if(lastSocketPoolScan_.difference(global::wallclock) >= 60) {
-    std::multimap<std::string, SocketPoolEntry> newPool;
-    A2_LOG_DEBUG("Scaning SocketPool and erasing timed out entry.");
-    lastSocketPoolScan_ = global::wallclock;
-    for(std::multimap<std::string, SocketPoolEntry>::iterator i =
-          socketPool_.begin(), eoi = socketPool_.end(); i != eoi; ++i) {
-      if(!(*i).second.isTimeout()) {
-        newPool.insert(*i);
-      }
+  if(digestChecks_.empty()) {
+    return;
+  }
+  // Copied because the stream may be deleted below.
+  SharedHandle<DigestThreadPool> pool = digestChecks_.front().first->getPool();
+  // Read notifications before checking the streams. A stream becoming
+  // idle after this writes a new notification, which wakes up the
+  // next poll.
+  pool->clearNotification();
+  std::vector<Command*> commands;
+  for(std::vector<std::pair<SharedHandle<DigestStream>, Command*> >::iterator
+        i = digestChecks_.begin(); i != digestChecks_.end();) {
+    if((*i).first->busy()) {
+      ++i;
+    } else {
+      (*i).second->setStatusActive();
+      commands.push_back((*i).second);
+      i = digestChecks_.erase(i);
+    }
+  }
+  std::sort(commands.begin(), commands.end());
+  commands.erase(std::unique(commands.begin(), commands.end()),
+                 commands.end());
+  for(std::vector<Command*>::const_iterator i = commands.begin(),
+        eoi = commands.end(); i != eoi; ++i) {
+    if(std::find_if(digestChecks_.begin(), digestChecks_.end(),
+                    FindDigestCheck(*i)) == digestChecks_.end()) {
+      eventPoll_->deleteEvents(pool->getNotifyFd(), *i,
+                               EventPoll::EVENT_READ);
     }
-    A2_LOG_DEBUG(fmt("%lu entries removed.",
-                     static_cast<unsigned long>
-                     (socketPool_.size()-newPool.size())));
-    socketPool_ = newPool;
   }
 }
+#endif // ENABLE_MESSAGE_DIGEST
+
+void DownloadEngine::setNoWait(bool b)
+{
+  noWait_ = b;
+}
+
+void DownloadEngine::addRoutineCommand(Command* command)
+{
+  routineCommands_.push_back(command);
+}
 
 namespace {
 std::string createSockPoolKey
@@ -339,8 +485,10 @@ void DownloadEngine::poolSocket
  const std::map<std::string, std::string>& options,
  time_t timeout)
 {
-  SocketPoolEntry e(sock, options, timeout);
-  poolSocket(createSockPoolKey(ipaddr, port, username, proxyhost, proxyport),e);
+  std::string key =
+    createSockPoolKey(ipaddr, port, username, proxyhost, proxyport);
+  A2_LOG_INFO(fmt("Pool socket for %s", key.c_str()));
+  socketPool_.add(key, sock, options, timeout);
 }
 
 void DownloadEngine::poolSocket
@@ -351,8 +499,8 @@ void DownloadEngine::poolSocket
  const SharedHandle<SocketCore>& sock,
  time_t timeout)
 {
-  SocketPoolEntry e(sock, timeout);
-  poolSocket(createSockPoolKey(ipaddr, port, A2STR::NIL,proxyhost,proxyport),e);
+  poolSocket(ipaddr, port, A2STR::NIL, proxyhost, proxyport, sock,
+             std::map<std::string, std::string>(), timeout);
 }
 
 void DownloadEngine::poolSocket(const SharedHandle<Request>& request,
@@ -394,39 +542,13 @@ void DownloadEngine::poolSocket
   }
 }
 
-std::multimap<std::string, DownloadEngine::SocketPoolEntry>::iterator
-DownloadEngine::findSocketPoolEntry(const std::string& key)
-{
-  std::pair<std::multimap<std::string, SocketPoolEntry>::iterator,
-    std::multimap<std::string, SocketPoolEntry>::iterator> range =
-    socketPool_.equal_range(key);
-  for(std::multimap<std::string, SocketPoolEntry>::iterator i =
-        range.first, eoi = range.second; i != eoi; ++i) {
-    const SocketPoolEntry& e = (*i).second;
-    // We assume that if socket is readable it means peer shutdowns
-    // connection and the socket will receive EOF. So skip it.
-    if(!e.isTimeout() && !e.getSocket()->isReadable(0)) {
-      A2_LOG_INFO(fmt("Found socket for %s", key.c_str()));
-      return i;
-    }
-  }
-  return socketPool_.end();
-}
-
 SharedHandle<SocketCore>
 DownloadEngine::popPooledSocket
 (const std::string& ipaddr, uint16_t port,
  const std::string& proxyhost, uint16_t proxyport)
 {
-  SharedHandle<SocketCore> s;
-  std::multimap<std::string, SocketPoolEntry>::iterator i =
-    findSocketPoolEntry
+  return socketPool_.pop
     (createSockPoolKey(ipaddr, port, A2STR::NIL, proxyhost, proxyport));
-  if(i != socketPool_.end()) {
-    s = (*i).second.getSocket();
-    socketPool_.erase(i);
-  }
-  return s;
 }
 
 SharedHandle<SocketCore>
@@ -436,16 +558,8 @@ DownloadEngine::popPooledSocket
  const std::string& username,
  const std::string& proxyhost, uint16_t proxyport)
 {
-  SharedHandle<SocketCore> s;
-  std::multimap<std::string, SocketPoolEntry>::iterator i =
-    findSocketPoolEntry
-    (createSockPoolKey(ipaddr, port, username, proxyhost, proxyport));
-  if(i != socketPool_.end()) {
-    s = (*i).second.getSocket();
-    options = (*i).second.getOptions();
-    socketPool_.erase(i);
-  }
-  return s;  
+  return socketPool_.pop
+    (options, createSockPoolKey(ipaddr, port, username, proxyhost, proxyport));
 }
 
 SharedHandle<SocketCore>
@@ -480,26 +594,6 @@ DownloadEngine::popPooledSocket
   return s;
 }
 
-DownloadEngine::SocketPoolEntry::SocketPoolEntry
-(const SharedHandle<SocketCore>& socket,
- const std::map<std::string, std::string>& options,
- time_t timeout):
-  socket_(socket),
-  options_(options),
-  timeout_(timeout) {}
-
-DownloadEngine::SocketPoolEntry::SocketPoolEntry
-(const SharedHandle<SocketCore>& socket, time_t timeout):
-  socket_(socket),
-  timeout_(timeout) {}
-
-DownloadEngine::SocketPoolEntry::~SocketPoolEntry() {}
-
-bool DownloadEngine::SocketPoolEntry::isTimeout() const
-{
-  return registeredTime_.difference(global::wallclock) >= timeout_;
-}
-
 cuid_t DownloadEngine::newCUID()
 {
   return cuidCounter_.newID();
@@ -535,6 +629,55 @@ void DownloadEngine::setAuthConfigFactory
   authConfigFactory_ = factory;
 }
 
+#ifdef ENABLE_BITTORRENT
+void DownloadEngine::setUDPTrackerClient
+(const SharedHandle<UDPTrackerClient>& client)
+{
+  udpTrackerClient_ = client;
+}
+
+void DownloadEngine::setDHKeyPool(const SharedHandle<DHKeyPool>& pool)
+{
+  dhKeyPool_ = pool;
+}
+
+void DownloadEngine::setPieceHashIndex
+(const SharedHandle<PieceHashIndex>& index)
+{
+  pieceHashIndex_ = index;
+}
+
+HttpTrackerCommand* DownloadEngine::findHttpTrackerCommand
+(const std::string& host, uint16_t port) const
+{
+  std::map<std::pair<std::string, uint16_t>,
+           HttpTrackerCommand*>::const_iterator i =
+    httpTrackerCommands_.find(std::make_pair(host, port));
+  if(i == httpTrackerCommands_.end()) {
+    return 0;
+  } else {
+    return (*i).second;
+  }
+}
+
+void DownloadEngine::addHttpTrackerCommand
+(const std::string& host, uint16_t port, HttpTrackerCommand* command)
+{
+  httpTrackerCommands_[std::make_pair(host, port)] = command;
+}
+
+void DownloadEngine::removeHttpTrackerCommand
+(const std::string& host, uint16_t port, HttpTrackerCommand* command)
+{
+  std::map<std::pair<std::string, uint16_t>,
+           HttpTrackerCommand*>::iterator i =
+    httpTrackerCommands_.find(std::make_pair(host, port));
+  if(i != httpTrackerCommands_.end() && (*i).second == command) {
+    httpTrackerCommands_.erase(i);
+  }
+}
+#endif // ENABLE_BITTORRENT
+
 void DownloadEngine::setRefreshInterval(int64_t interval)
 {
   refreshInterval_ = std::min(static_cast<int64_t>(999), interval);
@@ -556,6 +699,12 @@ void DownloadEngine::setRequestGroupMan
   requestGroupMan_ = rgman;
 }
 
+void DownloadEngine::setCommandProfiler
+(const SharedHandle<CommandProfiler>& profiler)
+{
+  commandProfiler_ = profiler;
+}
+
 void DownloadEngine::setFileAllocationMan
 (const SharedHandle<FileAllocationMan>& faman)
 {
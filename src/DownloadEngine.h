@@ -50,6 +50,7 @@
 #include "FileAllocationMan.h"
 #include "CheckIntegrityMan.h"
 #include "DNSCache.h"
+#include "SocketPool.h"
 #ifdef ENABLE_ASYNC_DNS
 # include "AsyncNameResolver.h"
 #endif // ENABLE_ASYNC_DNS
@@ -65,9 +66,18 @@ class AuthConfigFactory;
 class Request;
 class EventPoll;
 class Command;
+class CommandProfiler;
 #ifdef ENABLE_BITTORRENT
 class BtRegistry;
+class UDPTrackerClient;
+class HttpTrackerCommand;
+class DHKeyPool;
+class PendingHandshakeMan;
+class PieceHashIndex;
 #endif // ENABLE_BITTORRENT
+#ifdef ENABLE_MESSAGE_DIGEST
+class DigestStream;
+#endif // ENABLE_MESSAGE_DIGEST
 
 class DownloadEngine {
 private:
@@ -81,40 +91,9 @@ private:
 
   bool haltRequested_;
 
-  class SocketPoolEntry {
-  private:
-    SharedHandle<SocketCore> socket_;
+  bool forceHaltRequested_;
 
-    std::map<std::string, std::string> options_;
-
-    time_t timeout_;
-
-    Timer registeredTime_;
-  public:
-    SocketPoolEntry(const SharedHandle<SocketCore>& socket,
-                    const std::map<std::string, std::string>& option,
-                    time_t timeout);
-
-    SocketPoolEntry(const SharedHandle<SocketCore>& socket,
-                    time_t timeout);
-
-    ~SocketPoolEntry();
-
-    bool isTimeout() const;
-
-    const SharedHandle<SocketCore>& getSocket() const
-    {
-      return socket_;
-    }
-
-    const std::map<std::string, std::string>& getOptions() const
-    {
-      return options_;
-    }
-  };
-
-  // key = IP address:port, value = SocketPoolEntry
-  std::multimap<std::string, SocketPoolEntry> socketPool_;
+  SocketPool socketPool_;
  
   Timer lastSocketPoolScan_;
 
@@ -122,6 +101,10 @@ private:
 
   static const int64_t DEFAULT_REFRESH_INTERVAL = 1000;
 
+  // Interval in seconds to check whether pooled sockets are closed by
+  // remote endpoint.
+  static const time_t SOCKET_POOL_SCAN_INTERVAL = 10;
+
   // Milliseconds
   int64_t refreshInterval_;
 
@@ -131,6 +114,18 @@ private:
 
 #ifdef ENABLE_BITTORRENT
   SharedHandle<BtRegistry> btRegistry_;
+
+  SharedHandle<PendingHandshakeMan> pendingHandshakeMan_;
+
+  SharedHandle<UDPTrackerClient> udpTrackerClient_;
+
+  SharedHandle<DHKeyPool> dhKeyPool_;
+
+  SharedHandle<PieceHashIndex> pieceHashIndex_;
+
+  // Running HttpTrackerCommand for each HTTP tracker host and port.
+  std::map<std::pair<std::string, uint16_t>, HttpTrackerCommand*>
+  httpTrackerCommands_;
 #endif // ENABLE_BITTORRENT
 
   CUIDCounter cuidCounter_;
@@ -143,6 +138,16 @@ private:
 
   SharedHandle<AuthConfigFactory> authConfigFactory_;
 
+#ifdef ENABLE_MESSAGE_DIGEST
+  // Pairs of a DigestStream and the command waiting for it to become
+  // idle.
+  std::vector<std::pair<SharedHandle<DigestStream>, Command*> >
+  digestChecks_;
+
+  // Activates the commands whose DigestStream became idle.
+  void processDigestChecks();
+#endif // ENABLE_MESSAGE_DIGEST
+
   /**
    * Delegates to StatCalc
    */
@@ -152,15 +157,12 @@ private:
 
   void afterEachIteration();
   
-  void poolSocket(const std::string& key, const SocketPoolEntry& entry);
-
-  std::multimap<std::string, SocketPoolEntry>::iterator
-  findSocketPoolEntry(const std::string& key);
-
   std::deque<Command*> commands_;
   SharedHandle<RequestGroupMan> requestGroupMan_;
   SharedHandle<FileAllocationMan> fileAllocationMan_;
   SharedHandle<CheckIntegrityMan> checkIntegrityMan_;
+  // Null unless command profiling is enabled.
+  SharedHandle<CommandProfiler> commandProfiler_;
   Option* option_;
 public:  
   DownloadEngine(const SharedHandle<EventPoll>& eventPoll);
@@ -188,6 +190,17 @@ public:
                                Command* command);
 #endif // ENABLE_ASYNC_DNS
 
+#ifdef ENABLE_MESSAGE_DIGEST
+  // Makes command active when all data given to stream so far is
+  // hashed. Returns false if it already is, in which case command is
+  // not registered.
+  bool addDigestCheck(const SharedHandle<DigestStream>& stream,
+                      Command* command);
+
+  // Removes all checks registered by command.
+  void deleteDigestCheck(Command* command);
+#endif // ENABLE_MESSAGE_DIGEST
+
   void addCommand(const std::vector<Command*>& commands);
 
   void addCommand(Command* command);
@@ -213,6 +226,13 @@ public:
 
   void setCheckIntegrityMan(const SharedHandle<CheckIntegrityMan>& ciman);
 
+  const SharedHandle<CommandProfiler>& getCommandProfiler() const
+  {
+    return commandProfiler_;
+  }
+
+  void setCommandProfiler(const SharedHandle<CommandProfiler>& profiler);
+
   Option* getOption() const
   {
     return option_;
@@ -230,6 +250,11 @@ public:
     return haltRequested_;
   }
 
+  bool isForceHaltRequested() const
+  {
+    return forceHaltRequested_;
+  }
+
   void requestHalt();
 
   void requestForceHalt();
@@ -285,6 +310,11 @@ public:
    uint16_t port,
    const std::string& username);
 
+  SocketPool& getSocketPool()
+  {
+    return socketPool_;
+  }
+
   const SharedHandle<CookieStorage>& getCookieStorage() const
   {
     return cookieStorage_;
@@ -295,6 +325,43 @@ public:
   {
     return btRegistry_;
   }
+
+  const SharedHandle<PendingHandshakeMan>& getPendingHandshakeMan() const
+  {
+    return pendingHandshakeMan_;
+  }
+
+  const SharedHandle<UDPTrackerClient>& getUDPTrackerClient() const
+  {
+    return udpTrackerClient_;
+  }
+
+  void setUDPTrackerClient(const SharedHandle<UDPTrackerClient>& client);
+
+  const SharedHandle<DHKeyPool>& getDHKeyPool() const
+  {
+    return dhKeyPool_;
+  }
+
+  void setDHKeyPool(const SharedHandle<DHKeyPool>& pool);
+
+  const SharedHandle<PieceHashIndex>& getPieceHashIndex() const
+  {
+    return pieceHashIndex_;
+  }
+
+  void setPieceHashIndex(const SharedHandle<PieceHashIndex>& index);
+
+  // Returns HttpTrackerCommand for host:port, or 0 if it is not
+  // running.
+  HttpTrackerCommand* findHttpTrackerCommand
+  (const std::string& host, uint16_t port) const;
+
+  void addHttpTrackerCommand
+  (const std::string& host, uint16_t port, HttpTrackerCommand* command);
+
+  void removeHttpTrackerCommand
+  (const std::string& host, uint16_t port, HttpTrackerCommand* command);
 #endif // ENABLE_BITTORRENT
 
   cuid_t newCUID();
@@ -46,6 +46,9 @@
 #ifdef ENABLE_MESSAGE_DIGEST
 # include "CheckIntegrityDispatcherCommand.h"
 #endif // ENABLE_MESSAGE_DIGEST
+#ifdef ENABLE_BITTORRENT
+# include "PieceHashIndex.h"
+#endif // ENABLE_BITTORRENT
 #include "prefs.h"
 #include "FillRequestGroupCommand.h"
 #include "FileAllocationDispatcherCommand.h"
@@ -73,6 +76,7 @@
 #include "DlAbortEx.h"
 #include "FileAllocationEntry.h"
 #include "HttpListenCommand.h"
+#include "CommandProfiler.h"
 
 namespace aria2 {
 
@@ -131,17 +135,36 @@ DownloadEngineFactory::newDownloadEngine
           }
   DownloadEngineHandle e(new DownloadEngine(eventPoll));
   e->setOption(op);
+  if(op->getAsBool(PREF_PROFILE_COMMANDS) ||
+     op->getAsInt(PREF_SLOW_COMMAND_THRESHOLD) > 0) {
+    SharedHandle<CommandProfiler> profiler(new CommandProfiler());
+    profiler->setSlowThreshold
+      (static_cast<int64_t>(op->getAsInt(PREF_SLOW_COMMAND_THRESHOLD))*1000);
+    e->setCommandProfiler(profiler);
+  }
 
   RequestGroupManHandle
     requestGroupMan(new RequestGroupMan(requestGroups, MAX_CONCURRENT_DOWNLOADS,
                                         op));
   e->setRequestGroupMan(requestGroupMan);
-  e->setFileAllocationMan
-    (SharedHandle<FileAllocationMan>(new FileAllocationMan()));
+  {
+    SharedHandle<FileAllocationMan> faman(new FileAllocationMan());
+    faman->setMaxPicked(op->getAsInt(PREF_MAX_CONCURRENT_FILE_ALLOCATIONS));
+    faman->setMaxSpeed(op->getAsInt(PREF_FILE_ALLOCATION_SPEED_LIMIT));
+    e->setFileAllocationMan(faman);
+  }
 #ifdef ENABLE_MESSAGE_DIGEST
   e->setCheckIntegrityMan
     (SharedHandle<CheckIntegrityMan>(new CheckIntegrityMan()));
 #endif // ENABLE_MESSAGE_DIGEST
+#ifdef ENABLE_BITTORRENT
+  if(!op->blank(PREF_BT_PIECE_INDEX)) {
+    SharedHandle<PieceHashIndex> index
+      (new PieceHashIndex(op->get(PREF_BT_PIECE_INDEX)));
+    index->load();
+    e->setPieceHashIndex(index);
+  }
+#endif // ENABLE_BITTORRENT
   e->addRoutineCommand(new FillRequestGroupCommand(e->newCUID(), e.get()));
   e->addRoutineCommand(new FileAllocationDispatcherCommand
                        (e->newCUID(), e->getFileAllocationMan(), e.get()));
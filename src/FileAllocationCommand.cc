@@ -49,6 +49,7 @@
 #include "wallclock.h"
 #include "RequestGroupMan.h"
 #include "fmt.h"
+#include "Option.h"
 
 namespace aria2 {
 
@@ -63,16 +64,35 @@ FileAllocationCommand::~FileAllocationCommand() {}
 bool FileAllocationCommand::executeInternal()
 {
   if(getRequestGroup()->isHaltRequested()) {
-    getDownloadEngine()->getFileAllocationMan()->dropPickedEntry();
+    getDownloadEngine()->getFileAllocationMan()->dropPickedEntry
+      (fileAllocationEntry_);
     return true;
   }
+  const SharedHandle<FileAllocationMan>& faman =
+    getDownloadEngine()->getFileAllocationMan();
+  // falloc reserves the whole file in one call without writing data,
+  // so it is neither throttled nor counted against the speed limit.
+  bool throttle =
+    getRequestGroup()->getOption()->get(PREF_FILE_ALLOCATION) != V_FALLOC;
+  if(throttle && faman->isThrottled()) {
+    // Sleep until the next iteration which executes all commands.
+    setStatusInactive();
+    getDownloadEngine()->addCommand(this);
+    return false;
+  }
+  off_t length = fileAllocationEntry_->getCurrentLength();
   fileAllocationEntry_->allocateChunk();
+  if(throttle) {
+    faman->addAllocatedLength
+      (fileAllocationEntry_->getCurrentLength()-length);
+  }
   if(fileAllocationEntry_->finished()) {
     A2_LOG_DEBUG
       (fmt(MSG_ALLOCATION_COMPLETED,
            static_cast<long int>(timer_.difference(global::wallclock)),
            util::itos(getRequestGroup()->getTotalLength(), true).c_str()));
-    getDownloadEngine()->getFileAllocationMan()->dropPickedEntry();
+    getDownloadEngine()->getFileAllocationMan()->dropPickedEntry
+      (fileAllocationEntry_);
     
     std::vector<Command*>* commands = new std::vector<Command*>();
     auto_delete_container<std::vector<Command*> > commandsDel(commands);
@@ -89,7 +109,8 @@ bool FileAllocationCommand::executeInternal()
 
 bool FileAllocationCommand::handleException(Exception& e)
 {
-  getDownloadEngine()->getFileAllocationMan()->dropPickedEntry();
+  getDownloadEngine()->getFileAllocationMan()->dropPickedEntry
+    (fileAllocationEntry_);
   A2_LOG_ERROR_EX(fmt(MSG_FILE_ALLOCATION_FAILURE,
                       getCuid()),
                   e);
@@ -37,12 +37,43 @@
 
 #include "common.h"
 #include "SequentialPicker.h"
+#include "TimerA2.h"
 
 namespace aria2 {
 
 class FileAllocationEntry;
 
-typedef SequentialPicker<FileAllocationEntry> FileAllocationMan;
+// Queue of FileAllocationEntry. In addition to SequentialPicker, this
+// class limits the overall rate of file allocation shared by all
+// FileAllocationCommands.
+class FileAllocationMan : public SequentialPicker<FileAllocationEntry> {
+private:
+  // Bytes per second. 0 means unlimited.
+  unsigned int maxSpeed_;
+  // Bytes allocated since checkPoint_.
+  uint64_t allocatedLength_;
+  Timer checkPoint_;
+public:
+  FileAllocationMan();
+
+  ~FileAllocationMan();
+
+  // Returns true if the allocation in the current second reached
+  // maxSpeed_ and the caller should wait.
+  bool isThrottled();
+
+  void addAllocatedLength(uint64_t length);
+
+  void setMaxSpeed(unsigned int maxSpeed)
+  {
+    maxSpeed_ = maxSpeed;
+  }
+
+  unsigned int getMaxSpeed() const
+  {
+    return maxSpeed_;
+  }
+};
 
 } // namespace aria2
 
@@ -126,6 +126,21 @@ public:
 
   bool isIssued(const SharedHandle<Segment>& segment) const;
 
+  // Returns the number of requests whose response header has not been
+  // received yet.
+  size_t getOutstandingRequestCount() const
+  {
+    return outstandingHttpRequests_.size();
+  }
+
+  // Returns true if the pipeline has drained to half of
+  // maxPipelinedRequest or below and should be refilled with new
+  // requests.
+  bool pipelineRefillNeeded(unsigned int maxPipelinedRequest) const
+  {
+    return outstandingHttpRequests_.size()*2 <= maxPipelinedRequest;
+  }
+
   bool sendBufferIsEmpty() const;
 
   void sendPendingData();
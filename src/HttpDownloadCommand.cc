@@ -37,6 +37,7 @@
 #include "DownloadEngine.h"
 #include "Request.h"
 #include "HttpRequestCommand.h"
+#include "HttpResponseCommand.h"
 #include "HttpConnection.h"
 #include "HttpRequest.h"
 #include "Segment.h"
@@ -52,6 +53,8 @@
 #include "SinkStreamFilter.h"
 #include "util.h"
 #include "SocketRecvBuffer.h"
+#include "LogFactory.h"
+#include "fmt.h"
 
 namespace aria2 {
 
@@ -75,6 +78,24 @@ HttpDownloadCommand::~HttpDownloadCommand() {}
 bool HttpDownloadCommand::prepareForNextSegment() {
   bool downloadFinished = getRequestGroup()->downloadFinished();
   if(getRequest()->isPipeliningEnabled() && !downloadFinished) {
+    // While more than half of the pipeline is still in flight, read
+    // the next response directly instead of issuing a new request for
+    // every completed segment. When the pipeline drains to the half,
+    // HttpRequestCommand refills it in one go.
+    if(!httpConnection_->pipelineRefillNeeded
+       (getRequest()->getMaxPipelinedRequest())) {
+      A2_LOG_DEBUG(fmt("CUID#%lld - %lu requests in pipeline. Reading next"
+                       " response.",
+                       getCuid(),
+                       static_cast<unsigned long>
+                       (httpConnection_->getOutstandingRequestCount())));
+      Command* command =
+        new HttpResponseCommand(getCuid(), getRequest(), getFileEntry(),
+                                getRequestGroup(), httpConnection_,
+                                getDownloadEngine(), getSocket());
+      getDownloadEngine()->addCommand(command);
+      return true;
+    }
     HttpRequestCommand* command =
       new HttpRequestCommand(getCuid(), getRequest(), getFileEntry(),
                              getRequestGroup(), httpConnection_,
@@ -75,37 +75,60 @@ const char HttpHeader::DEFLATE[] = "deflate";
 HttpHeader::HttpHeader() {}
 HttpHeader::~HttpHeader() {}
 
+namespace {
+// Returns true if name equals lowerName, ignoring case. lowerName
+// must be in lowercase.
+bool fieldNameEquals(const std::string& lowerName, const std::string& name)
+{
+  if(lowerName.size() != name.size()) {
+    return false;
+  }
+  for(std::string::size_type i = 0, len = name.size(); i < len; ++i) {
+    char c = name[i];
+    if('A' <= c && c <= 'Z') {
+      c += 'a'-'A';
+    }
+    if(lowerName[i] != c) {
+      return false;
+    }
+  }
+  return true;
+}
+} // namespace
+
 void HttpHeader::put(const std::string& name, const std::string& value) {
-  std::multimap<std::string, std::string>::value_type vt
-    (util::toLower(name), value);
-  table_.insert(vt);
+  table_.push_back(std::make_pair(name, value));
+  util::lowercase(table_.back().first);
 }
 
 bool HttpHeader::defined(const std::string& name) const {
-  return table_.count(util::toLower(name)) >= 1;
+  for(std::vector<std::pair<std::string, std::string> >::const_iterator i =
+        table_.begin(), eoi = table_.end(); i != eoi; ++i) {
+    if(fieldNameEquals((*i).first, name)) {
+      return true;
+    }
+  }
+  return false;
 }
 
 const std::string& HttpHeader::getFirst(const std::string& name) const {
-  std::multimap<std::string, std::string>::const_iterator itr =
-    table_.find(util::toLower(name));
-  if(itr == table_.end()) {
-    return A2STR::NIL;
-  } else {
-    return (*itr).second;
+  for(std::vector<std::pair<std::string, std::string> >::const_iterator i =
+        table_.begin(), eoi = table_.end(); i != eoi; ++i) {
+    if(fieldNameEquals((*i).first, name)) {
+      return (*i).second;
+    }
   }
+  return A2STR::NIL;
 }
 
 std::vector<std::string> HttpHeader::get(const std::string& name) const
 {
   std::vector<std::string> v;
-  std::string n(util::toLower(name));
-  std::pair<std::multimap<std::string, std::string>::const_iterator,
-    std::multimap<std::string, std::string>::const_iterator> itrpair =
-    table_.equal_range(n);
-  std::multimap<std::string, std::string>::const_iterator first = itrpair.first;
-  while(first != itrpair.second) {
-    v.push_back((*first).second);
-    ++first;
+  for(std::vector<std::pair<std::string, std::string> >::const_iterator i =
+        table_.begin(), eoi = table_.end(); i != eoi; ++i) {
+    if(fieldNameEquals((*i).first, name)) {
+      v.push_back((*i).second);
+    }
   }
   return v;
 }
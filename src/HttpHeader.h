@@ -37,9 +37,9 @@
 
 #include "common.h"
 
-#include <map>
 #include <vector>
 #include <string>
+#include <utility>
 #include <iosfwd>
 
 #include "SharedHandle.h"
@@ -50,7 +50,10 @@ class Range;
 
 class HttpHeader {
 private:
-  std::multimap<std::string, std::string> table_;
+  // Header fields in the order they were received. Field names are
+  // stored in lowercase. A response usually has a dozen or so fields,
+  // so linear search is cheaper than a tree.
+  std::vector<std::pair<std::string, std::string> > table_;
 
   // HTTP status code, e.g. 200
   int statusCode_;
@@ -34,8 +34,8 @@
 /* copyright --> */
 #include "HttpHeaderProcessor.h"
 
-#include <sstream>
 #include <vector>
+#include <algorithm>
 
 #include "HttpHeader.h"
 #include "message.h"
@@ -48,7 +48,10 @@
 namespace aria2 {
 
 HttpHeaderProcessor::HttpHeaderProcessor():
-  limit_(21/*lines*/*8190/*per line*/) {}
+  limit_(21/*lines*/*8190/*per line*/),
+  scanPos_(0),
+  lineBegin_(0),
+  headerLength_(0) {}
 // The above values come from Apache's documentation
 // http://httpd.apache.org/docs/2.2/en/mod/core.html: See
 // LimitRequestFieldSize and LimitRequestLine directive.  Also the
@@ -60,13 +63,15 @@ HttpHeaderProcessor::~HttpHeaderProcessor() {}
 void HttpHeaderProcessor::update(const unsigned char* data, size_t length)
 {
   checkHeaderLimit(length);
-  buf_ += std::string(&data[0], &data[length]);
+  buf_.append(&data[0], &data[length]);
+  parse();
 }
 
 void HttpHeaderProcessor::update(const std::string& data)
 {
   checkHeaderLimit(data.size());
   buf_ += data;
+  parse();
 }
 
 void HttpHeaderProcessor::checkHeaderLimit(size_t incomingLength)
@@ -77,23 +82,38 @@ void HttpHeaderProcessor::checkHeaderLimit(size_t incomingLength)
   }
 }
 
-bool HttpHeaderProcessor::eoh() const
+void HttpHeaderProcessor::parse()
 {
-  if(buf_.find("\r\n\r\n") == std::string::npos &&
-     buf_.find("\n\n") == std::string::npos) {
-    return false;
-  } else {
-    return true;
+  if(headerLength_) {
+    return;
+  }
+  std::string::size_type lf;
+  while((lf = buf_.find('\n', scanPos_)) != std::string::npos) {
+    size_t lineEnd = lf;
+    if(lineEnd > lineBegin_ && buf_[lineEnd-1] == '\r') {
+      --lineEnd;
+    }
+    scanPos_ = lf+1;
+    if(lineEnd == lineBegin_) {
+      // Empty line terminates header.
+      headerLength_ = scanPos_;
+      return;
+    }
+    lines_.push_back(std::make_pair(lineBegin_, lineEnd));
+    lineBegin_ = scanPos_;
   }
+  scanPos_ = buf_.size();
+}
+
+bool HttpHeaderProcessor::eoh() const
+{
+  return headerLength_ > 0;
 }
 
 size_t HttpHeaderProcessor::getPutBackDataLength() const
 {
-  std::string::size_type delimpos = std::string::npos;
-  if((delimpos = buf_.find("\r\n\r\n")) != std::string::npos) {
-    return buf_.size()-(delimpos+4);
-  } else if((delimpos = buf_.find("\n\n")) != std::string::npos) {
-    return buf_.size()-(delimpos+2);
+  if(headerLength_) {
+    return buf_.size()-headerLength_;
   } else {
     return 0;
   }
@@ -102,27 +122,70 @@ size_t HttpHeaderProcessor::getPutBackDataLength() const
 void HttpHeaderProcessor::clear()
 {
   buf_.erase();
+  scanPos_ = 0;
+  lineBegin_ = 0;
+  headerLength_ = 0;
+  lines_.clear();
+}
+
+std::string HttpHeaderProcessor::getFirstLine() const
+{
+  if(lines_.empty()) {
+    return A2STR::NIL;
+  } else {
+    return buf_.substr(lines_[0].first, lines_[0].second-lines_[0].first);
+  }
+}
+
+void HttpHeaderProcessor::fillFields
+(const SharedHandle<HttpHeader>& httpHeader) const
+{
+  std::string name;
+  std::string value;
+  for(std::vector<std::pair<size_t, size_t> >::const_iterator i =
+        lines_.begin()+1, eoi = lines_.end(); i != eoi; ++i) {
+    std::string::const_iterator first = buf_.begin()+(*i).first;
+    std::string::const_iterator last = buf_.begin()+(*i).second;
+    if(*first == ' ' || *first == '\t') {
+      // Continuation of the previous field.
+      std::string cont = util::stripIter(first, last);
+      if(!name.empty() && !cont.empty()) {
+        value += " ";
+        value += cont;
+      }
+      continue;
+    }
+    if(!name.empty()) {
+      httpHeader->put(name, value);
+    }
+    std::string::const_iterator colon = std::find(first, last, ':');
+    if(colon == last) {
+      name = util::stripIter(first, last);
+      value.clear();
+    } else {
+      name = util::stripIter(first, colon);
+      value = util::stripIter(colon+1, last);
+    }
+  }
+  if(!name.empty()) {
+    httpHeader->put(name, value);
+  }
 }
 
 SharedHandle<HttpHeader> HttpHeaderProcessor::getHttpResponseHeader()
 {
-  std::string::size_type delimpos = std::string::npos;
-  if(((delimpos = buf_.find("\r\n")) == std::string::npos &&
-      (delimpos = buf_.find("\n")) == std::string::npos) ||
-     delimpos < 12) {
+  std::string firstLine = getFirstLine();
+  if(firstLine.size() < 12) {
     throw DL_RETRY_EX(EX_NO_STATUS_HEADER);
   }
   int32_t statusCode;
-  if(!util::parseIntNoThrow(statusCode, buf_.substr(9, 3))) {
+  if(!util::parseIntNoThrow(statusCode, firstLine.substr(9, 3))) {
     throw DL_RETRY_EX("Status code could not be parsed as integer.");
   }
   HttpHeaderHandle httpHeader(new HttpHeader());
-  httpHeader->setVersion(buf_.substr(0, 8));
+  httpHeader->setVersion(firstLine.substr(0, 8));
   httpHeader->setStatusCode(statusCode);
-  std::istringstream strm(buf_);
-  // TODO 1st line(HTTP/1.1 200...) is also send to HttpHeader, but it should
-  // not.
-  httpHeader->fill(strm);
+  fillFields(httpHeader);
   return httpHeader;
 }
 
@@ -131,35 +194,32 @@ SharedHandle<HttpHeader> HttpHeaderProcessor::getHttpRequestHeader()
   // The minimum case of the first line is:
   // GET / HTTP/1.x
   // At least 14bytes before \r\n or \n.
-  std::string::size_type delimpos = std::string::npos;
-  if(((delimpos = buf_.find("\r\n")) == std::string::npos &&
-      (delimpos = buf_.find("\n")) == std::string::npos) ||
-     delimpos < 14) {
+  std::string firstLine = getFirstLine();
+  if(firstLine.size() < 14) {
     throw DL_RETRY_EX(EX_NO_STATUS_HEADER);
   }
-  std::vector<std::string> firstLine;
-  util::split(buf_.substr(0, delimpos), std::back_inserter(firstLine)," ",true);
-  if(firstLine.size() != 3) {
+  std::vector<std::string> firstLineTokens;
+  util::split(firstLine, std::back_inserter(firstLineTokens), " ", true);
+  if(firstLineTokens.size() != 3) {
     throw DL_ABORT_EX2("Malformed HTTP request header.",
                        error_code::HTTP_PROTOCOL_ERROR);
   }
   SharedHandle<HttpHeader> httpHeader(new HttpHeader());
-  httpHeader->setMethod(firstLine[0]);
-  httpHeader->setRequestPath(firstLine[1]);
-  httpHeader->setVersion(firstLine[2]);
-  std::istringstream strm(buf_.substr(delimpos));
-  httpHeader->fill(strm);
+  httpHeader->setMethod(firstLineTokens[0]);
+  httpHeader->setRequestPath(firstLineTokens[1]);
+  httpHeader->setVersion(firstLineTokens[2]);
+  fillFields(httpHeader);
   return httpHeader;
 }
 
 std::string HttpHeaderProcessor::getHeaderString() const
 {
-  std::string::size_type delimpos = std::string::npos;
-  if((delimpos = buf_.find("\r\n\r\n")) == std::string::npos &&
-     (delimpos = buf_.find("\n\n")) == std::string::npos) {
+  if(headerLength_ == 0) {
     return buf_;
+  } else if(lines_.empty()) {
+    return A2STR::NIL;
   } else {
-    return buf_.substr(0, delimpos);
+    return buf_.substr(0, lines_.back().second);
   }
 }
 
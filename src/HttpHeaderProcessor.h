@@ -39,6 +39,7 @@
 #include "SharedHandle.h"
 #include <utility>
 #include <string>
+#include <vector>
 
 namespace aria2 {
 
@@ -48,9 +49,30 @@ class HttpHeaderProcessor {
 private:
   std::string buf_;
   size_t limit_;
+  // The position in buf_ where the next scan for end of line starts.
+  // Data before it is never scanned again.
+  size_t scanPos_;
+  // The position in buf_ where the current line starts.
+  size_t lineBegin_;
+  // The length of header including the terminating empty line. 0
+  // until end of header is reached.
+  size_t headerLength_;
+  // The beginning and end of each non-empty line, excluding line
+  // terminator.
+  std::vector<std::pair<size_t, size_t> > lines_;
 
   void checkHeaderLimit(size_t incomingLength);
 
+  // Scans data appended to buf_ since the last call, recording lines
+  // until end of header is reached.
+  void parse();
+
+  // Puts header fields in lines_, excluding the first line, to
+  // httpHeader.
+  void fillFields(const SharedHandle<HttpHeader>& httpHeader) const;
+
+  std::string getFirstLine() const;
+
 public:
   HttpHeaderProcessor();
 
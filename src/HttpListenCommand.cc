@@ -69,8 +69,12 @@ bool HttpListenCommand::execute()
     return true;
   }
   try {
-    if(serverSocket_->isReadable(0)) {
-      SharedHandle<SocketCore> socket(serverSocket_->acceptConnection());
+    // Accept all pending connections.
+    while(1) {
+      SharedHandle<SocketCore> socket(serverSocket_->tryAcceptConnection());
+      if(!socket) {
+        break;
+      }
       socket->setNonBlockingMode();
 
       std::pair<std::string, uint16_t> peerInfo;
@@ -56,6 +56,8 @@
 #include "RpcMethodFactory.h"
 #include "RpcRequest.h"
 #include "RpcResponse.h"
+#include "Metrics.h"
+#include "CommandProfiler.h"
 #ifdef ENABLE_XML_RPC
 # include "XmlRpcRequestProcessor.h"
 # include "XmlRpcRequestParserStateMachine.h"
@@ -270,6 +272,14 @@ bool HttpServerBodyCommand::execute()
             }
           }
           return true;
+        } else if(reqPath == "/metrics") {
+          std::string text = global::metrics.toText();
+          if(e_->getCommandProfiler()) {
+            text += e_->getCommandProfiler()->toText();
+          }
+          httpServer_->feedResponse(text, "text/plain; version=0.0.4");
+          addHttpServerResponseCommand();
+          return true;
         } else {
           return true;
         }
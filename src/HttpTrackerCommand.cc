@@ -0,0 +1,562 @@
+/* <!-- copyright */
+/*
+ * aria2 - The high speed download utility
+ *
+ * Copyright (C) 2011 Tatsuhiro Tsujikawa
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.  If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so.  If you
+ * do not wish to do so, delete this exception statement from your
+ * version.  If you delete this exception statement from all source
+ * files in the program, then also delete it here.
+ */
+/* copyright --> */
+#include "HttpTrackerCommand.h"
+
+#include <algorithm>
+
+#include "DownloadEngine.h"
+#include "HttpTrackerRequest.h"
+#include "HttpConnection.h"
+#include "HttpRequest.h"
+#include "HttpResponse.h"
+#include "HttpHeader.h"
+#include "SocketCore.h"
+#include "SocketRecvBuffer.h"
+#include "StreamFilter.h"
+#include "BinaryStream.h"
+#include "Segment.h"
+#include "Request.h"
+#include "NameResolver.h"
+#include "Option.h"
+#include "prefs.h"
+#include "util.h"
+#include "a2functional.h"
+#include "RecoverableException.h"
+#include "DlRetryEx.h"
+#include "DlAbortEx.h"
+#include "message.h"
+#include "Logger.h"
+#include "LogFactory.h"
+#include "A2STR.h"
+#include "wallclock.h"
+#include "fmt.h"
+#ifdef ENABLE_ASYNC_DNS
+#include "AsyncNameResolver.h"
+#endif // ENABLE_ASYNC_DNS
+
+namespace aria2 {
+
+namespace {
+// Appends the decoded response body to the string.
+class StringSinkStreamFilter:public StreamFilter {
+private:
+  std::string* buf_;
+  size_t bytesProcessed_;
+public:
+  StringSinkStreamFilter(std::string* buf)
+    : buf_(buf),
+      bytesProcessed_(0)
+  {}
+
+  virtual void init() {}
+
+  virtual ssize_t transform(const SharedHandle<BinaryStream>& out,
+                            const SharedHandle<Segment>& segment,
+                            const unsigned char* inbuf, size_t inlen)
+  {
+    buf_->append(&inbuf[0], &inbuf[inlen]);
+    bytesProcessed_ = inlen;
+    return inlen;
+  }
+
+  virtual bool finished()
+  {
+    return true;
+  }
+
+  virtual void release() {}
+
+  virtual const std::string& getName() const
+  {
+    static const std::string NAME("StringSinkStreamFilter");
+    return NAME;
+  }
+
+  virtual size_t getBytesProcessed() const
+  {
+    return bytesProcessed_;
+  }
+};
+} // namespace
+
+HttpTrackerCommand::HttpTrackerCommand
+(cuid_t cuid, DownloadEngine* e, const std::string& host, uint16_t port)
+  : Command(cuid),
+    e_(e),
+    host_(host),
+    port_(port),
+    state_(STA_CONNECT),
+    reused_(false),
+    persistent_(false),
+    lengthKnown_(false),
+    remaining_(0),
+    readCheck_(false),
+    writeCheck_(false)
+{
+  e_->addHttpTrackerCommand(host_, port_, this);
+}
+
+HttpTrackerCommand::~HttpTrackerCommand()
+{
+  closeConnection();
+  while(!requests_.empty()) {
+    completeRequest(HTTPT_ERR_SHUTDOWN);
+  }
+  e_->removeHttpTrackerCommand(host_, port_, this);
+}
+
+void HttpTrackerCommand::addRequest(const SharedHandle<HttpTrackerRequest>& req)
+{
+  req->state = HTTPT_STA_PENDING;
+  req->error = HTTPT_ERR_SUCCESS;
+  req->response.clear();
+  requests_.push_back(req);
+}
+
+bool HttpTrackerCommand::execute()
+{
+  if(e_->isForceHaltRequested()) {
+    return true;
+  }
+  while(!requests_.empty()) {
+    try {
+      if(!executeInternal()) {
+        if(checkPoint_.difference(global::wallclock) >=
+           requests_.front()->timeout) {
+          throw DL_RETRY_EX(EX_TIME_OUT);
+        }
+        e_->addCommand(this);
+        return false;
+      }
+    } catch(RecoverableException& ex) {
+      closeConnection();
+      if(reused_) {
+        // The persistent connection might have been closed by the
+        // tracker. Retry with new connection.
+        A2_LOG_INFO(fmt("CUID#%lld - Persistent connection to %s:%u failed."
+                        " Retrying with new connection.",
+                        getCuid(), host_.c_str(), port_));
+        reused_ = false;
+      } else {
+        A2_LOG_INFO_EX(fmt("CUID#%lld - Announce to %s:%u failed",
+                           getCuid(), host_.c_str(), port_), ex);
+        completeRequest(HTTPT_ERR_NETWORK);
+      }
+      state_ = STA_CONNECT;
+    }
+  }
+  if(socket_ && persistent_ && socketRecvBuffer_->bufferEmpty()) {
+    A2_LOG_DEBUG(fmt("CUID#%lld - Pooling connection to %s:%u",
+                     getCuid(), host_.c_str(), port_));
+    e_->poolSocket(addr_, port_, A2STR::NIL, 0, socket_);
+  }
+  return true;
+}
+
+bool HttpTrackerCommand::executeInternal()
+{
+  switch(state_) {
+  case STA_CONNECT:
+    checkPoint_ = global::wallclock;
+    return connect();
+#ifdef ENABLE_ASYNC_DNS
+  case STA_RESOLVING:
+    if(!asyncResolveHostname()) {
+      return false;
+    }
+    return connect();
+#endif // ENABLE_ASYNC_DNS
+  case STA_CONNECTING: {
+    if(!writeEventEnabled() && !errorEventEnabled() && !hupEventEnabled()) {
+      return false;
+    }
+    std::string error = socket_->getSocketError();
+    if(!error.empty()) {
+      e_->markBadIPAddress(host_, addr_, port_);
+      throw DL_RETRY_EX(fmt(MSG_NETWORK_PROBLEM, error.c_str()));
+    }
+    setWriteCheck(false);
+    state_ = STA_SEND;
+    return true;
+  }
+  case STA_SEND:
+    checkPoint_ = global::wallclock;
+    httpConnection_->sendRequest(requests_.front()->httpRequest);
+    state_ = STA_SENDING;
+    return true;
+  case STA_SENDING:
+    if(!httpConnection_->sendBufferIsEmpty()) {
+      httpConnection_->sendPendingData();
+      if(!httpConnection_->sendBufferIsEmpty()) {
+        setWriteCheck(true);
+        return false;
+      }
+    }
+    setWriteCheck(false);
+    setReadCheck(true);
+    state_ = STA_RECV_HEADER;
+    return true;
+  case STA_RECV_HEADER:
+    httpResponse_ = httpConnection_->receiveResponse();
+    if(!httpResponse_) {
+      return false;
+    }
+    checkPoint_ = global::wallclock;
+    // The connection is alive. Don't retry after this point.
+    reused_ = false;
+    receiveHeader();
+    return true;
+  case STA_RECV_BODY:
+    return receiveBody();
+  default:
+    // Unreachable
+    return false;
+  }
+}
+
+bool HttpTrackerCommand::connect()
+{
+  if(addr_.empty()) {
+    if(util::isNumericHost(host_)) {
+      addr_ = host_;
+    } else {
+      addr_ = e_->findCachedIPAddress(host_, port_);
+    }
+    if(addr_.empty()) {
+#ifdef ENABLE_ASYNC_DNS
+      if(e_->getOption()->getAsBool(PREF_ASYNC_DNS)) {
+        initAsyncNameResolver();
+        state_ = STA_RESOLVING;
+        return false;
+      }
+#endif // ENABLE_ASYNC_DNS
+      std::vector<std::string> addrs;
+      NameResolver res;
+      res.setSocktype(SOCK_STREAM);
+      if(e_->getOption()->getAsBool(PREF_DISABLE_IPV6)) {
+        res.setFamily(AF_INET);
+      }
+      res.resolve(addrs, host_);
+      cacheAddresses(addrs);
+    }
+  }
+  socket_ = e_->popPooledSocket(addr_, port_, A2STR::NIL, 0);
+  if(socket_) {
+    A2_LOG_DEBUG(fmt("CUID#%lld - Reusing pooled connection to %s:%u",
+                     getCuid(), host_.c_str(), port_));
+    reused_ = true;
+    state_ = STA_SEND;
+  } else {
+    A2_LOG_INFO(fmt(MSG_CONNECTING_TO_SERVER, getCuid(), addr_.c_str(),
+                    port_));
+    socket_.reset(new SocketCore());
+    socket_->establishConnection(addr_, port_);
+    socket_->setNonBlockingMode();
+    reused_ = false;
+    setWriteCheck(true);
+    state_ = STA_CONNECTING;
+  }
+  socketRecvBuffer_.reset(new SocketRecvBuffer(socket_));
+  httpConnection_.reset
+    (new HttpConnection(getCuid(), socket_, socketRecvBuffer_));
+  return state_ == STA_SEND;
+}
+
+void HttpTrackerCommand::cacheAddresses(const std::vector<std::string>& addrs)
+{
+  if(addrs.empty()) {
+    throw DL_ABORT_EX(fmt(MSG_NAME_RESOLUTION_FAILED, getCuid(),
+                          host_.c_str(), "no address"));
+  }
+  A2_LOG_INFO(fmt(MSG_NAME_RESOLUTION_COMPLETE,
+                  getCuid(),
+                  host_.c_str(),
+                  strjoin(addrs.begin(), addrs.end(), ", ").c_str()));
+  for(std::vector<std::string>::const_iterator i = addrs.begin(),
+        eoi = addrs.end(); i != eoi; ++i) {
+    e_->cacheIPAddress(host_, *i, port_);
+  }
+  addr_ = e_->findCachedIPAddress(host_, port_);
+  if(addr_.empty()) {
+    addr_ = addrs.front();
+  }
+}
+
+#ifdef ENABLE_ASYNC_DNS
+
+void HttpTrackerCommand::initAsyncNameResolver()
+{
+  int family;
+  if(e_->getOption()->getAsBool(PREF_ENABLE_ASYNC_DNS6)) {
+    family = AF_UNSPEC;
+  } else {
+    family = AF_INET;
+  }
+  asyncNameResolver_.reset
+    (new AsyncNameResolver(family
+#ifdef HAVE_ARES_ADDR_NODE
+                           ,
+                           e_->getAsyncDNSServers()
+#endif // HAVE_ARES_ADDR_NODE
+                           ));
+  A2_LOG_INFO(fmt(MSG_RESOLVING_HOSTNAME,
+                  getCuid(),
+                  host_.c_str()));
+  asyncNameResolver_->resolve(host_);
+  e_->addNameResolverCheck(asyncNameResolver_, this);
+}
+
+bool HttpTrackerCommand::asyncResolveHostname()
+{
+  switch(asyncNameResolver_->getStatus()) {
+  case AsyncNameResolver::STATUS_SUCCESS: {
+    std::vector<std::string> addrs =
+      asyncNameResolver_->getResolvedAddresses();
+    releaseAsyncNameResolver();
+    cacheAddresses(addrs);
+    return true;
+  }
+  case AsyncNameResolver::STATUS_ERROR: {
+    std::string error = asyncNameResolver_->getError();
+    releaseAsyncNameResolver();
+    throw DL_ABORT_EX(fmt(MSG_NAME_RESOLUTION_FAILED, getCuid(),
+                          host_.c_str(), error.c_str()));
+  }
+  default:
+    return false;
+  }
+}
+
+void HttpTrackerCommand::releaseAsyncNameResolver()
+{
+  if(asyncNameResolver_) {
+    e_->deleteNameResolverCheck(asyncNameResolver_, this);
+    asyncNameResolver_.reset();
+  }
+}
+
+#endif // ENABLE_ASYNC_DNS
+
+void HttpTrackerCommand::receiveHeader()
+{
+  const SharedHandle<HttpHeader>& header = httpResponse_->getHttpHeader();
+  transferEncodingFilter_ = httpResponse_->getTransferEncodingStreamFilter();
+  if(transferEncodingFilter_) {
+    transferEncodingFilter_->installDelegate
+      (SharedHandle<StreamFilter>
+       (new StringSinkStreamFilter(&requests_.front()->response)));
+    transferEncodingFilter_->init();
+    lengthKnown_ = false;
+  } else if(header->defined(HttpHeader::CONTENT_LENGTH)) {
+    lengthKnown_ = true;
+    remaining_ = header->getFirstAsULLInt(HttpHeader::CONTENT_LENGTH);
+  } else {
+    lengthKnown_ = false;
+  }
+  persistent_ = httpResponse_->supportsPersistentConnection() &&
+    (transferEncodingFilter_ || lengthKnown_);
+  if(httpResponse_->getStatusCode() == 200) {
+    state_ = STA_RECV_BODY;
+  } else if(httpResponse_->isRedirect()) {
+    redirect();
+  } else {
+    A2_LOG_INFO(fmt("CUID#%lld - Tracker %s:%u returned status %d",
+                    getCuid(), host_.c_str(), port_,
+                    httpResponse_->getStatusCode()));
+    completeRequest(HTTPT_ERR_HTTP);
+    closeConnection();
+    state_ = STA_CONNECT;
+  }
+}
+
+void HttpTrackerCommand::redirect()
+{
+  SharedHandle<HttpTrackerRequest> req = requests_.front();
+  SharedHandle<Request> request = req->httpRequest->getRequest();
+  if(request->getRedirectCount() >= Request::MAX_REDIRECT) {
+    A2_LOG_INFO(fmt("CUID#%lld - Too many redirects from tracker %s:%u",
+                    getCuid(), host_.c_str(), port_));
+    completeRequest(HTTPT_ERR_HTTP);
+    closeConnection();
+    state_ = STA_CONNECT;
+    return;
+  }
+  httpResponse_->processRedirect();
+  if(request->getProtocol() != Request::PROTO_HTTP) {
+    A2_LOG_INFO(fmt("CUID#%lld - Tracker redirect to %s is not supported",
+                    getCuid(), request->getCurrentUri().c_str()));
+    completeRequest(HTTPT_ERR_HTTP);
+    closeConnection();
+    state_ = STA_CONNECT;
+    return;
+  }
+  // The connection is kept only if the redirect response has no body
+  // to skip.
+  bool keepConnection = persistent_ && lengthKnown_ && remaining_ == 0;
+  requests_.pop_front();
+  transferEncodingFilter_.reset();
+  httpResponse_.reset();
+  if(request->getHost() == host_ && request->getPort() == port_) {
+    requests_.push_front(req);
+  } else {
+    HttpTrackerCommand* command =
+      e_->findHttpTrackerCommand(request->getHost(), request->getPort());
+    if(!command) {
+      command = new HttpTrackerCommand
+        (e_->newCUID(), e_, request->getHost(), request->getPort());
+      e_->addCommand(command);
+    }
+    command->addRequest(req);
+  }
+  if(keepConnection) {
+    setReadCheck(false);
+    reused_ = true;
+    state_ = STA_SEND;
+  } else {
+    closeConnection();
+    state_ = STA_CONNECT;
+  }
+}
+
+bool HttpTrackerCommand::receiveBody()
+{
+  std::string& response = requests_.front()->response;
+  bool done = lengthKnown_ && remaining_ == 0;
+  if(!done) {
+    if(socketRecvBuffer_->bufferEmpty()) {
+      if(socketRecvBuffer_->recv() == 0) {
+        if(socket_->wantRead() || socket_->wantWrite()) {
+          return false;
+        }
+        if(transferEncodingFilter_ || lengthKnown_) {
+          throw DL_RETRY_EX(EX_GOT_EOF);
+        }
+        // The end of response is indicated by EOF.
+        completeRequest(HTTPT_ERR_SUCCESS);
+        closeConnection();
+        state_ = STA_CONNECT;
+        return true;
+      }
+      checkPoint_ = global::wallclock;
+    }
+    const unsigned char* buf = socketRecvBuffer_->getBuffer();
+    size_t len = socketRecvBuffer_->getBufferLength();
+    size_t consumed;
+    if(transferEncodingFilter_) {
+      transferEncodingFilter_->transform
+        (SharedHandle<BinaryStream>(), SharedHandle<Segment>(), buf, len);
+      consumed = transferEncodingFilter_->getBytesProcessed();
+      done = transferEncodingFilter_->finished();
+    } else if(lengthKnown_) {
+      consumed = std::min(remaining_, static_cast<uint64_t>(len));
+      response.append(&buf[0], &buf[consumed]);
+      remaining_ -= consumed;
+      done = remaining_ == 0;
+    } else {
+      consumed = len;
+      response.append(&buf[0], &buf[len]);
+    }
+    socketRecvBuffer_->shiftBuffer(consumed);
+    if(response.size() > MAX_RESPONSE_LENGTH) {
+      throw DL_ABORT_EX(fmt("Tracker response from %s:%u is too large",
+                            host_.c_str(), port_));
+    }
+  }
+  if(done) {
+    completeRequest(HTTPT_ERR_SUCCESS);
+    if(persistent_) {
+      setReadCheck(false);
+      reused_ = true;
+      state_ = STA_SEND;
+    } else {
+      closeConnection();
+      state_ = STA_CONNECT;
+    }
+  }
+  return true;
+}
+
+void HttpTrackerCommand::completeRequest(int error)
+{
+  SharedHandle<HttpTrackerRequest> req = requests_.front();
+  requests_.pop_front();
+  req->state = HTTPT_STA_COMPLETE;
+  req->error = error;
+  transferEncodingFilter_.reset();
+  httpResponse_.reset();
+}
+
+void HttpTrackerCommand::closeConnection()
+{
+#ifdef ENABLE_ASYNC_DNS
+  releaseAsyncNameResolver();
+#endif // ENABLE_ASYNC_DNS
+  setReadCheck(false);
+  setWriteCheck(false);
+  socket_.reset();
+  socketRecvBuffer_.reset();
+  httpConnection_.reset();
+  httpResponse_.reset();
+  transferEncodingFilter_.reset();
+  persistent_ = false;
+}
+
+void HttpTrackerCommand::setReadCheck(bool f)
+{
+  if(f == readCheck_) {
+    return;
+  }
+  if(f) {
+    e_->addSocketForReadCheck(socket_, this);
+  } else {
+    e_->deleteSocketForReadCheck(socket_, this);
+  }
+  readCheck_ = f;
+}
+
+void HttpTrackerCommand::setWriteCheck(bool f)
+{
+  if(f == writeCheck_) {
+    return;
+  }
+  if(f) {
+    e_->addSocketForWriteCheck(socket_, this);
+  } else {
+    e_->deleteSocketForWriteCheck(socket_, this);
+  }
+  writeCheck_ = f;
+}
+
+} // namespace aria2
@@ -0,0 +1,154 @@
+/* <!-- copyright */
+/*
+ * aria2 - The high speed download utility
+ *
+ * Copyright (C) 2011 Tatsuhiro Tsujikawa
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.  If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so.  If you
+ * do not wish to do so, delete this exception statement from your
+ * version.  If you delete this exception statement from all source
+ * files in the program, then also delete it here.
+ */
+/* copyright --> */
+#ifndef D_HTTP_TRACKER_COMMAND_H
+#define D_HTTP_TRACKER_COMMAND_H
+
+#include "Command.h"
+
+#include <string>
+#include <deque>
+#include <vector>
+
+#include "SharedHandle.h"
+#include "TimerA2.h"
+
+namespace aria2 {
+
+class DownloadEngine;
+class SocketCore;
+class SocketRecvBuffer;
+class HttpConnection;
+class HttpResponse;
+class StreamFilter;
+struct HttpTrackerRequest;
+#ifdef ENABLE_ASYNC_DNS
+class AsyncNameResolver;
+#endif // ENABLE_ASYNC_DNS
+
+// Sends the announce requests of all torrents to one HTTP tracker
+// host:port through a single persistent connection, one request at
+// a time, and stores the response bodies in the requests. Redirects
+// are followed, and a request redirected to another host:port is
+// handed over to the HttpTrackerCommand for that host. Unlike the
+// normal HTTP download, this command does not need RequestGroup. The
+// connection is taken from and returned to the socket pool of
+// DownloadEngine. This command exits when no request is left.
+class HttpTrackerCommand:public Command {
+public:
+  HttpTrackerCommand
+  (cuid_t cuid, DownloadEngine* e, const std::string& host, uint16_t port);
+
+  virtual ~HttpTrackerCommand();
+
+  virtual bool execute();
+
+  void addRequest(const SharedHandle<HttpTrackerRequest>& req);
+private:
+  enum STATE {
+    STA_CONNECT,
+    STA_RESOLVING,
+    STA_CONNECTING,
+    STA_SEND,
+    STA_SENDING,
+    STA_RECV_HEADER,
+    STA_RECV_BODY
+  };
+
+  // Tracker responses larger than this are treated as error.
+  static const size_t MAX_RESPONSE_LENGTH = 1024*1024;
+
+  DownloadEngine* e_;
+  std::string host_;
+  uint16_t port_;
+  std::string addr_;
+  std::deque<SharedHandle<HttpTrackerRequest> > requests_;
+  STATE state_;
+  SharedHandle<SocketCore> socket_;
+  SharedHandle<SocketRecvBuffer> socketRecvBuffer_;
+  SharedHandle<HttpConnection> httpConnection_;
+  SharedHandle<HttpResponse> httpResponse_;
+  SharedHandle<StreamFilter> transferEncodingFilter_;
+#ifdef ENABLE_ASYNC_DNS
+  SharedHandle<AsyncNameResolver> asyncNameResolver_;
+#endif // ENABLE_ASYNC_DNS
+  // true if socket_ was used by the previous request or taken from
+  // the socket pool.
+  bool reused_;
+  // true if socket_ can be used after the current response.
+  bool persistent_;
+  // true if Content-Length is available.
+  bool lengthKnown_;
+  uint64_t remaining_;
+  bool readCheck_;
+  bool writeCheck_;
+  Timer checkPoint_;
+
+  // Returns true if the current request is completed and next one
+  // can be processed immediately.
+  bool executeInternal();
+
+  bool connect();
+
+  // Caches addrs for host_ and sets addr_.
+  void cacheAddresses(const std::vector<std::string>& addrs);
+
+#ifdef ENABLE_ASYNC_DNS
+  void initAsyncNameResolver();
+
+  // Returns true if the name resolution finished successfully.
+  bool asyncResolveHostname();
+
+  void releaseAsyncNameResolver();
+#endif // ENABLE_ASYNC_DNS
+
+  void receiveHeader();
+
+  // Follows the redirect in httpResponse_.
+  void redirect();
+
+  bool receiveBody();
+
+  void completeRequest(int error);
+
+  void closeConnection();
+
+  void setReadCheck(bool f);
+
+  void setWriteCheck(bool f);
+};
+
+} // namespace aria2
+
+#endif // D_HTTP_TRACKER_COMMAND_H
@@ -49,6 +49,10 @@
 #include "PieceStorage.h"
 #include "Option.h"
 #include "MSEHandshake.h"
+#include "DHKeyPool.h"
+#include "DHKeyExchange.h"
+#include "DHKeyPoolCommand.h"
+#include "wallclock.h"
 #include "ARC4Encryptor.h"
 #include "ARC4Decryptor.h"
 #include "RequestGroup.h"
@@ -102,7 +106,7 @@ bool InitiatorMSEHandshakeCommand::executeInternal() {
         return false;
       }
       setTimeout(getOption()->getAsInt(PREF_BT_TIMEOUT));
-      mseHandshake_->initEncryptionFacility(true);
+      initEncryptionFacility(true);
       mseHandshake_->sendPublicKey();
       sequence_ = INITIATOR_SEND_KEY_PENDING;
       break;
@@ -175,6 +179,7 @@ bool InitiatorMSEHandshakeCommand::executeInternal() {
            PeerInteractionCommand::INITIATOR_SEND_HANDSHAKE,
            peerConnection);
         getDownloadEngine()->addCommand(c);
+        addHandshakeTime();
         return true;
       } else {
         done = true;
@@ -267,4 +272,20 @@ const SharedHandle<Option>& InitiatorMSEHandshakeCommand::getOption() const
   return requestGroup_->getOption();
 }
 
+void InitiatorMSEHandshakeCommand::initEncryptionFacility(bool initiator)
+{
+  handshakeTimer_ = global::wallclock;
+  mseHandshake_->initEncryptionFacility
+    (initiator, DHKeyPoolCommand::getDHKeyPool(getDownloadEngine())->pop());
+}
+
+void InitiatorMSEHandshakeCommand::addHandshakeTime()
+{
+  const SharedHandle<DHKeyPool>& pool = getDownloadEngine()->getDHKeyPool();
+  if(pool) {
+    pool->addHandshakeTime
+      (handshakeTimer_.differenceInMillis(global::wallclock));
+  }
+}
+
 } // namespace aria2
@@ -68,6 +68,12 @@ private:
 
   Seq sequence_;
   MSEHandshake* mseHandshake_;
+  // Time when MSE handshake started.
+  Timer handshakeTimer_;
+
+  void initEncryptionFacility(bool initiator);
+
+  void addHandshakeTime();
 
   const SharedHandle<Option>& getOption() const;
 
@@ -40,6 +40,7 @@
 #include "message.h"
 #include "PieceStorage.h"
 #include "MessageDigest.h"
+#include "DigestThreadPool.h"
 #include "DiskAdaptor.h"
 #include "FileEntry.h"
 #include "BitfieldMan.h"
@@ -74,9 +75,10 @@ void IteratableChecksumValidator::validateChunk()
     size_t length = pieceStorage_->getDiskAdaptor()->readData(buffer_,
                                                               BUFSIZE,
                                                               currentOffset_);
-    ctx_->update(buffer_, length);
+    stream_->update(buffer_, length);
     currentOffset_ += length;
     if(finished()) {
+      stream_->wait();
       std::string actualChecksum = ctx_->hexDigest();
       if(dctx_->getChecksum() == actualChecksum) {
         pieceStorage_->markAllPiecesDone();
@@ -116,6 +118,7 @@ void IteratableChecksumValidator::init()
   pieceStorage_->getDiskAdaptor()->enableDirectIO();
   currentOffset_ = 0;
   ctx_ = MessageDigest::create(dctx_->getChecksumHashAlgo());
+  stream_.reset(new DigestStream(ctx_, DigestThreadPool::getInstance()));
 }
 
 } // namespace aria2
@@ -42,6 +42,7 @@ namespace aria2 {
 class DownloadContext;
 class PieceStorage;
 class MessageDigest;
+class DigestStream;
 
 class IteratableChecksumValidator:public IteratableValidator
 {
@@ -54,6 +55,10 @@ private:
 
   SharedHandle<MessageDigest> ctx_;
 
+  // Hashes the data read from disk, on DigestThreadPool if any, while
+  // the next chunk is read.
+  SharedHandle<DigestStream> stream_;
+
   unsigned char* buffer_;
 public:
   IteratableChecksumValidator(const SharedHandle<DownloadContext>& dctx,
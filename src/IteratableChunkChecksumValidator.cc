@@ -36,6 +36,7 @@
 
 #include <cstring>
 #include <cstdlib>
+#include <algorithm>
 
 #include "util.h"
 #include "message.h"
@@ -48,6 +49,7 @@
 #include "LogFactory.h"
 #include "Logger.h"
 #include "MessageDigest.h"
+#include "DigestThreadPool.h"
 #include "fmt.h"
 #include "DlAbortEx.h"
 
@@ -64,15 +66,19 @@ IteratableChunkChecksumValidator::IteratableChunkChecksumValidator
     bitfield_(new BitfieldMan(dctx_->getPieceLength(),
                               dctx_->getTotalLength())),
     currentIndex_(0),
-    buffer_(0)
+    buffer_(0),
+    batchImpl_(sha1::getBatchImpl()),
+    batchBuffer_(0)
 {}
 
 IteratableChunkChecksumValidator::~IteratableChunkChecksumValidator()
 {
 #ifdef HAVE_POSIX_MEMALIGN
   free(buffer_);
+  free(batchBuffer_);
 #else // !HAVE_POSIX_MEMALIGN
   delete [] buffer_;
+  delete [] batchBuffer_;
 #endif // !HAVE_POSIX_MEMALIGN
 }
 
@@ -80,35 +86,113 @@ IteratableChunkChecksumValidator::~IteratableChunkChecksumValidator()
 void IteratableChunkChecksumValidator::validateChunk()
 {
   if(!finished()) {
-    std::string actualChecksum;
-    try {
-      actualChecksum = calculateActualChecksum();
-      if(actualChecksum == dctx_->getPieceHashes()[currentIndex_]) {
-        bitfield_->setBit(currentIndex_);
-      } else {
-        A2_LOG_INFO(fmt(EX_INVALID_CHUNK_CHECKSUM,
-                        static_cast<unsigned long>(currentIndex_),
-                        util::itos(getCurrentOffset(), true).c_str(),
-                        dctx_->getPieceHashes()[currentIndex_].c_str(),
-                        actualChecksum.c_str()));
-        bitfield_->unsetBit(currentIndex_);
-      }
-    } catch(RecoverableException& ex) {
-      A2_LOG_DEBUG_EX(fmt("Caught exception while validating piece index=%lu."
-                          " Some part of file may be missing."
-                          " Continue operation.",
-                          static_cast<unsigned long>(currentIndex_)),
-                      ex);
-      bitfield_->unsetBit(currentIndex_);
+    size_t n = countBatchPieces();
+    if(n < 2 || !validateBatch(n)) {
+      validatePiece();
     }
-
-    ++currentIndex_;
     if(finished()) {
       pieceStorage_->setBitfield(bitfield_->getBitfield(), bitfield_->getBitfieldLength());
     }
   }
 }
 
+void IteratableChunkChecksumValidator::checkPiece
+(size_t index, const std::string& actualChecksum)
+{
+  if(actualChecksum == dctx_->getPieceHashes()[index]) {
+    bitfield_->setBit(index);
+  } else {
+    A2_LOG_INFO(fmt(EX_INVALID_CHUNK_CHECKSUM,
+                    static_cast<unsigned long>(index),
+                    util::itos((off_t)index*dctx_->getPieceLength(),
+                               true).c_str(),
+                    dctx_->getPieceHashes()[index].c_str(),
+                    actualChecksum.c_str()));
+    bitfield_->unsetBit(index);
+  }
+}
+
+void IteratableChunkChecksumValidator::validatePiece()
+{
+  std::string actualChecksum;
+  try {
+    actualChecksum = calculateActualChecksum();
+    checkPiece(currentIndex_, actualChecksum);
+  } catch(RecoverableException& ex) {
+    A2_LOG_DEBUG_EX(fmt("Caught exception while validating piece index=%lu."
+                        " Some part of file may be missing."
+                        " Continue operation.",
+                        static_cast<unsigned long>(currentIndex_)),
+                    ex);
+    bitfield_->unsetBit(currentIndex_);
+  }
+
+  ++currentIndex_;
+}
+
+size_t IteratableChunkChecksumValidator::countBatchPieces() const
+{
+  if(!batchBuffer_) {
+    return 0;
+  }
+  // Only pieces of full length can be hashed together.
+  size_t fullPieces = dctx_->getTotalLength()/dctx_->getPieceLength();
+  if(fullPieces <= currentIndex_) {
+    return 0;
+  }
+  return std::min(sha1::getLanes(batchImpl_), fullPieces-currentIndex_);
+}
+
+bool IteratableChunkChecksumValidator::validateBatch(size_t n)
+{
+  const SharedHandle<DiskAdaptor>& diskAdaptor =
+    pieceStorage_->getDiskAdaptor();
+  size_t pieceLength = dctx_->getPieceLength();
+  off_t offset = getCurrentOffset();
+  sha1::MultiContext ctx(n, batchImpl_);
+  const unsigned char* data[sha1::MAX_LANES];
+  try {
+    for(size_t done = 0; done < pieceLength;) {
+      size_t length = std::min(static_cast<size_t>(BUFSIZE), pieceLength-done);
+      for(size_t i = 0; i < n; ++i) {
+        unsigned char* buf = batchBuffer_+i*BUFSIZE;
+        off_t pieceOffset = offset+(off_t)i*pieceLength+done;
+        for(size_t r = 0; r < length;) {
+          size_t rlength = diskAdaptor->readData(buf+r, length-r,
+                                                 pieceOffset+r);
+          if(rlength == 0) {
+            throw DL_ABORT_EX
+              (fmt(EX_FILE_READ, dctx_->getBasePath().c_str(),
+                   "data is too short"));
+          }
+          r += rlength;
+        }
+        data[i] = buf;
+      }
+      ctx.update(data, length);
+      done += length;
+    }
+  } catch(RecoverableException& ex) {
+    A2_LOG_DEBUG_EX(fmt("Caught exception while validating pieces index=%lu"
+                        " to %lu. Validate them one by one.",
+                        static_cast<unsigned long>(currentIndex_),
+                        static_cast<unsigned long>(currentIndex_+n-1)),
+                    ex);
+    return false;
+  }
+  unsigned char md[sha1::MAX_LANES][sha1::DIGEST_LENGTH];
+  unsigned char* mds[sha1::MAX_LANES];
+  for(size_t i = 0; i < n; ++i) {
+    mds[i] = md[i];
+  }
+  ctx.digest(mds);
+  for(size_t i = 0; i < n; ++i) {
+    checkPiece(currentIndex_+i, util::toHex(md[i], sha1::DIGEST_LENGTH));
+  }
+  currentIndex_ += n;
+  return true;
+}
+
 std::string IteratableChunkChecksumValidator::calculateActualChecksum()
 {
   off_t offset = getCurrentOffset();
@@ -136,12 +220,36 @@ void IteratableChunkChecksumValidator::init()
     pieceStorage_->getDiskAdaptor()->enableDirectIO();
   }
   ctx_ = MessageDigest::create(dctx_->getPieceHashAlgo());
+  stream_.reset(new DigestStream(ctx_, DigestThreadPool::getInstance()));
+#ifdef HAVE_POSIX_MEMALIGN
+  free(batchBuffer_);
+#else // !HAVE_POSIX_MEMALIGN
+  delete [] batchBuffer_;
+#endif // !HAVE_POSIX_MEMALIGN
+  batchBuffer_ = 0;
+  // Pieces are hashed in batch only if the implementation has several
+  // lanes, and hashing is not offloaded to DigestThreadPool.  The piece
+  // length must keep the reads aligned for direct I/O.
+  if(dctx_->getPieceHashAlgo() == "sha-1" &&
+     sha1::getLanes(batchImpl_) > 1 &&
+     !DigestThreadPool::getInstance() &&
+     dctx_->getPieceLength()%ALIGNMENT == 0) {
+    size_t length = sha1::MAX_LANES*BUFSIZE;
+#ifdef HAVE_POSIX_MEMALIGN
+    batchBuffer_ = reinterpret_cast<unsigned char*>
+      (util::allocateAlignedMemory(ALIGNMENT, length));
+#else // !HAVE_POSIX_MEMALIGN
+    batchBuffer_ = new unsigned char[length];
+#endif // !HAVE_POSIX_MEMALIGN
+  }
   bitfield_->clearAllBit();
   currentIndex_ = 0;
 }
 
 std::string IteratableChunkChecksumValidator::digest(off_t offset, size_t length)
 {
+  // A previous call may have thrown before waiting.
+  stream_->wait();
   ctx_->reset();
   off_t curoffset = offset/ALIGNMENT*ALIGNMENT;
   off_t max = offset+length;
@@ -165,10 +273,11 @@ std::string IteratableChunkChecksumValidator::digest(off_t offset, size_t length
     } else {
       wlength = r-woffset;
     }
-    ctx_->update(buffer_+woffset, wlength);
+    stream_->update(buffer_+woffset, wlength);
     curoffset += r;
     woffset = 0;
   }
+  stream_->wait();
   return ctx_->hexDigest();
 }
 
@@ -39,12 +39,15 @@
 
 #include <string>
 
+#include "sha1.h"
+
 namespace aria2 {
 
 class DownloadContext;
 class PieceStorage;
 class BitfieldMan;
 class MessageDigest;
+class DigestStream;
 
 class IteratableChunkChecksumValidator:public IteratableValidator
 {
@@ -54,10 +57,33 @@ private:
   SharedHandle<BitfieldMan> bitfield_;
   size_t currentIndex_;
   SharedHandle<MessageDigest> ctx_;
+
+  // Hashes the data read from disk, on DigestThreadPool if any, while
+  // the next chunk is read.
+  SharedHandle<DigestStream> stream_;
   unsigned char* buffer_;
 
+  // Implementation used to hash several sha-1 pieces at once.
+  sha1::Impl batchImpl_;
+  // Holds sha1::MAX_LANES chunks of BUFSIZE bytes, one per piece, if
+  // pieces are hashed in batch.
+  unsigned char* batchBuffer_;
+
   std::string calculateActualChecksum();
 
+  // Sets the bit of piece index if actualChecksum matches its hash.
+  void checkPiece(size_t index, const std::string& actualChecksum);
+
+  void validatePiece();
+
+  // Returns the number of pieces from currentIndex_ which can be
+  // hashed together by batchImpl_, or 0 if batch is not used.
+  size_t countBatchPieces() const;
+
+  // Validates n pieces from currentIndex_ at once.  Returns false
+  // without advancing currentIndex_ if the pieces cannot be read.
+  bool validateBatch(size_t n);
+
   std::string digest(off_t offset, size_t length);
 
 public:
@@ -75,6 +101,12 @@ public:
   virtual off_t getCurrentOffset() const;
 
   virtual uint64_t getTotalLength() const;
+
+  // The default is sha1::getBatchImpl().  Takes effect on init().
+  void setBatchImpl(sha1::Impl impl)
+  {
+    batchImpl_ = impl;
+  }
 };
 
 typedef SharedHandle<IteratableChunkChecksumValidator> IteratableChunkChecksumValidatorHandle;
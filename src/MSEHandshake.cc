@@ -81,7 +81,6 @@ MSEHandshake::MSEHandshake
     rbufLength_(0),
     socketBuffer_(socket),
     negotiatedCryptoType_(CRYPTO_NONE),
-    dh_(0),
     initiator_(true),
     markerIndex_(0),
     padLength_(0),
@@ -92,7 +91,6 @@ MSEHandshake::MSEHandshake
 
 MSEHandshake::~MSEHandshake()
 {
-  delete dh_;
   delete [] ia_;
 }
 
@@ -114,12 +112,23 @@ MSEHandshake::HANDSHAKE_TYPE MSEHandshake::identifyHandshakeType()
   }
 }
 
+SharedHandle<DHKeyExchange> MSEHandshake::createDHKeyExchange()
+{
+  SharedHandle<DHKeyExchange> dh(new DHKeyExchange());
+  dh->init(PRIME, PRIME_BITS, GENERATOR, 160);
+  dh->generatePublicKey();
+  return dh;
+}
+
 void MSEHandshake::initEncryptionFacility(bool initiator)
 {
-  delete dh_;
-  dh_ = new DHKeyExchange();
-  dh_->init(PRIME, PRIME_BITS, GENERATOR, 160);
-  dh_->generatePublicKey();
+  initEncryptionFacility(initiator, createDHKeyExchange());
+}
+
+void MSEHandshake::initEncryptionFacility
+(bool initiator, const SharedHandle<DHKeyExchange>& dh)
+{
+  dh_ = dh;
   A2_LOG_DEBUG(fmt("CUID#%lld - DH initialized.", cuid_));
   initiator_ = initiator;
 }
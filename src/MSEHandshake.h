@@ -88,7 +88,7 @@ private:
   SocketBuffer socketBuffer_;
 
   CRYPTO_TYPE negotiatedCryptoType_;
-  DHKeyExchange* dh_;
+  SharedHandle<DHKeyExchange> dh_;
   SharedHandle<ARC4Encryptor> encryptor_;
   SharedHandle<ARC4Decryptor> decryptor_;
   unsigned char infoHash_[INFO_HASH_LENGTH];
@@ -132,6 +132,15 @@ public:
 
   void initEncryptionFacility(bool initiator);
 
+  // Uses dh, whose public key must be already generated, instead of
+  // generating new one.
+  void initEncryptionFacility
+  (bool initiator, const SharedHandle<DHKeyExchange>& dh);
+
+  // Creates DHKeyExchange initialized with the parameters used in MSE
+  // handshake. Its public key is generated.
+  static SharedHandle<DHKeyExchange> createDHKeyExchange();
+
   // Reads data from Socket. If EOF is reached, throws
   // RecoverableException.
   void read();
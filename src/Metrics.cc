@@ -0,0 +1,189 @@
+/* <!-- copyright */
+/*
+ * aria2 - The high speed download utility
+ *
+ * Copyright (C) 2011 Tatsuhiro Tsujikawa
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.  If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so.  If you
+ * do not wish to do so, delete this exception statement from your
+ * version.  If you delete this exception statement from all source
+ * files in the program, then also delete it here.
+ */
+/* copyright --> */
+#include "Metrics.h"
+
+#include <algorithm>
+
+#include "fmt.h"
+#include "util.h"
+#include "array_fun.h"
+
+namespace aria2 {
+
+namespace global {
+
+Metrics metrics;
+
+} // namespace global
+
+MetricHistogram::MetricHistogram(const int64_t* bounds, size_t len)
+  : bounds_(&bounds[0], &bounds[len]),
+    counts_(len+1),
+    sum_(0),
+    count_(0)
+{}
+
+void MetricHistogram::observe(int64_t micros)
+{
+  counts_[std::lower_bound(bounds_.begin(), bounds_.end(), micros)-
+          bounds_.begin()] += 1;
+  sum_ += micros;
+  ++count_;
+}
+
+namespace {
+const int64_t LOOP_ITERATION_BOUNDS[] = {
+  100, 500, 1000, 5000, 10000, 50000, 100000, 500000, 1000000
+};
+} // namespace
+
+namespace {
+const int64_t DISK_WRITE_BOUNDS[] = {
+  10, 50, 100, 500, 1000, 5000, 10000, 50000, 100000, 1000000
+};
+} // namespace
+
+Metrics::Metrics()
+  : streamConnections_(0),
+    peerConnections_(0),
+    dhtMessagesReceived_(0),
+    dhtMessagesSent_(0),
+    pieceHashFailures_(0),
+    loopIteration_(LOOP_ITERATION_BOUNDS, A2_ARRAY_LEN(LOOP_ITERATION_BOUNDS)),
+    pollWait_(LOOP_ITERATION_BOUNDS, A2_ARRAY_LEN(LOOP_ITERATION_BOUNDS)),
+    diskWrite_(DISK_WRITE_BOUNDS, A2_ARRAY_LEN(DISK_WRITE_BOUNDS))
+{
+  std::fill(&receivedBytes_[0], &receivedBytes_[PROTO_MAX], 0);
+  std::fill(&sentBytes_[0], &sentBytes_[PROTO_MAX], 0);
+}
+
+namespace {
+const char* PROTOCOL_NAMES[] = { "http", "ftp", "bittorrent" };
+} // namespace
+
+namespace {
+void writeHeader
+(std::string& out, const char* name, const char* type, const char* help)
+{
+  out += fmt("# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+} // namespace
+
+namespace {
+void writeCounter
+(std::string& out, const char* name, const char* help, uint64_t value)
+{
+  writeHeader(out, name, "counter", help);
+  out += fmt("%s %s\n", name, util::uitos(value).c_str());
+}
+} // namespace
+
+namespace {
+void writeProtocolCounter
+(std::string& out, const char* name, const char* help,
+ const uint64_t* values)
+{
+  writeHeader(out, name, "counter", help);
+  for(size_t i = 0; i < Metrics::PROTO_MAX; ++i) {
+    out += fmt("%s{protocol=\"%s\"} %s\n", name, PROTOCOL_NAMES[i],
+               util::uitos(values[i]).c_str());
+  }
+}
+} // namespace
+
+namespace {
+std::string microsToSeconds(int64_t micros)
+{
+  return fmt("%lld.%06lld",
+             static_cast<long long int>(micros/1000000),
+             static_cast<long long int>(micros%1000000));
+}
+} // namespace
+
+namespace {
+void writeHistogram
+(std::string& out, const char* name, const char* help,
+ const MetricHistogram& histogram)
+{
+  writeHeader(out, name, "histogram", help);
+  const std::vector<int64_t>& bounds = histogram.getBounds();
+  const std::vector<uint64_t>& counts = histogram.getCounts();
+  uint64_t cumulative = 0;
+  for(size_t i = 0; i < bounds.size(); ++i) {
+    cumulative += counts[i];
+    out += fmt("%s_bucket{le=\"%s\"} %s\n", name,
+               microsToSeconds(bounds[i]).c_str(),
+               util::uitos(cumulative).c_str());
+  }
+  out += fmt("%s_bucket{le=\"+Inf\"} %s\n", name,
+             util::uitos(histogram.getCount()).c_str());
+  out += fmt("%s_sum %s\n", name, microsToSeconds(histogram.getSum()).c_str());
+  out += fmt("%s_count %s\n", name,
+             util::uitos(histogram.getCount()).c_str());
+}
+} // namespace
+
+std::string Metrics::toText() const
+{
+  std::string out;
+  writeProtocolCounter(out, "aria2_received_bytes_total",
+                       "Payload bytes received.", receivedBytes_);
+  writeProtocolCounter(out, "aria2_sent_bytes_total",
+                       "Payload bytes sent.", sentBytes_);
+  writeHeader(out, "aria2_connections", "gauge",
+              "Open connections to servers and peers.");
+  out += fmt("aria2_connections{type=\"server\"} %s\n"
+             "aria2_connections{type=\"peer\"} %s\n",
+             util::itos(streamConnections_).c_str(),
+             util::itos(peerConnections_).c_str());
+  writeCounter(out, "aria2_dht_messages_received_total",
+               "DHT messages received.", dhtMessagesReceived_);
+  writeCounter(out, "aria2_dht_messages_sent_total",
+               "DHT messages sent.", dhtMessagesSent_);
+  writeCounter(out, "aria2_piece_hash_failures_total",
+               "Pieces discarded because of hash mismatch.",
+               pieceHashFailures_);
+  writeHistogram(out, "aria2_loop_iteration_seconds",
+                 "Time spent executing commands in one event loop"
+                 " iteration.", loopIteration_);
+  writeHistogram(out, "aria2_poll_wait_seconds",
+                 "Time spent waiting for events in one event loop"
+                 " iteration.", pollWait_);
+  writeHistogram(out, "aria2_disk_write_seconds",
+                 "Latency of writes to files.", diskWrite_);
+  return out;
+}
+
+} // namespace aria2
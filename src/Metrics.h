@@ -0,0 +1,200 @@
+/* <!-- copyright */
+/*
+ * aria2 - The high speed download utility
+ *
+ * Copyright (C) 2011 Tatsuhiro Tsujikawa
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.  If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so.  If you
+ * do not wish to do so, delete this exception statement from your
+ * version.  If you delete this exception statement from all source
+ * files in the program, then also delete it here.
+ */
+/* copyright --> */
+#ifndef D_METRICS_H
+#define D_METRICS_H
+
+#include "common.h"
+
+#include <string>
+#include <vector>
+
+namespace aria2 {
+
+// Histogram of durations in microseconds with fixed upper bounds.
+class MetricHistogram {
+private:
+  std::vector<int64_t> bounds_;
+  // counts_[i] is the number of observations which fall in
+  // (bounds_[i-1], bounds_[i]]. The last element counts the
+  // observations greater than bounds_.back().
+  std::vector<uint64_t> counts_;
+  int64_t sum_;
+  uint64_t count_;
+public:
+  // bounds must be sorted in ascending order.
+  MetricHistogram(const int64_t* bounds, size_t len);
+
+  void observe(int64_t micros);
+
+  const std::vector<int64_t>& getBounds() const
+  {
+    return bounds_;
+  }
+
+  const std::vector<uint64_t>& getCounts() const
+  {
+    return counts_;
+  }
+
+  int64_t getSum() const
+  {
+    return sum_;
+  }
+
+  uint64_t getCount() const
+  {
+    return count_;
+  }
+};
+
+// Counters and gauges exported by the /metrics endpoint of the RPC
+// server. They are updated where the events occur, so that rendering
+// them does not depend on the number of downloads.
+class Metrics {
+public:
+  enum PROTOCOL {
+    PROTO_HTTP,
+    PROTO_FTP,
+    PROTO_BITTORRENT,
+    PROTO_MAX
+  };
+private:
+  uint64_t receivedBytes_[PROTO_MAX];
+  uint64_t sentBytes_[PROTO_MAX];
+  int64_t streamConnections_;
+  int64_t peerConnections_;
+  uint64_t dhtMessagesReceived_;
+  uint64_t dhtMessagesSent_;
+  uint64_t pieceHashFailures_;
+  MetricHistogram loopIteration_;
+  MetricHistogram pollWait_;
+  MetricHistogram diskWrite_;
+public:
+  Metrics();
+
+  void addReceivedBytes(PROTOCOL proto, size_t bytes)
+  {
+    receivedBytes_[proto] += bytes;
+  }
+
+  uint64_t getReceivedBytes(PROTOCOL proto) const
+  {
+    return receivedBytes_[proto];
+  }
+
+  void addSentBytes(PROTOCOL proto, size_t bytes)
+  {
+    sentBytes_[proto] += bytes;
+  }
+
+  uint64_t getSentBytes(PROTOCOL proto) const
+  {
+    return sentBytes_[proto];
+  }
+
+  void increaseStreamConnections()
+  {
+    ++streamConnections_;
+  }
+
+  void decreaseStreamConnections()
+  {
+    --streamConnections_;
+  }
+
+  void increasePeerConnections()
+  {
+    ++peerConnections_;
+  }
+
+  void decreasePeerConnections()
+  {
+    --peerConnections_;
+  }
+
+  void increaseDhtMessagesReceived()
+  {
+    ++dhtMessagesReceived_;
+  }
+
+  void increaseDhtMessagesSent()
+  {
+    ++dhtMessagesSent_;
+  }
+
+  void increasePieceHashFailures()
+  {
+    ++pieceHashFailures_;
+  }
+
+  uint64_t getPieceHashFailures() const
+  {
+    return pieceHashFailures_;
+  }
+
+  // Records the time spent in one iteration of DownloadEngine::run(),
+  // excluding the time waiting for events.
+  void observeLoopIteration(int64_t micros)
+  {
+    loopIteration_.observe(micros);
+  }
+
+  // Records the time spent waiting for events in
+  // DownloadEngine::run().
+  void observePollWait(int64_t micros)
+  {
+    pollWait_.observe(micros);
+  }
+
+  void observeDiskWrite(int64_t micros)
+  {
+    diskWrite_.observe(micros);
+  }
+
+  // Returns metrics in Prometheus text exposition format version
+  // 0.0.4.
+  std::string toText() const;
+};
+
+namespace global {
+
+// metrics is defined in Metrics.cc
+extern Metrics metrics;
+
+} // namespace global
+
+} // namespace aria2
+
+#endif // D_METRICS_H
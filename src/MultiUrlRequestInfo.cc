@@ -59,6 +59,10 @@
 #include "TimeA2.h"
 #include "fmt.h"
 #include "SocketCore.h"
+#include "UriListParser.h"
+#ifdef ENABLE_MESSAGE_DIGEST
+# include "DigestThreadPool.h"
+#endif // ENABLE_MESSAGE_DIGEST
 #ifdef ENABLE_SSL
 # include "TLSContext.h"
 #endif // ENABLE_SSL
@@ -142,11 +146,13 @@ MultiUrlRequestInfo::MultiUrlRequestInfo
 (const std::vector<SharedHandle<RequestGroup> >& requestGroups,
  const SharedHandle<Option>& op,
  const SharedHandle<StatCalc>& statCalc,
- std::ostream& summaryOut)
+ std::ostream& summaryOut,
+ const SharedHandle<UriListParser>& uriListParser)
   : requestGroups_(requestGroups),
     option_(op),
     statCalc_(statCalc),
-    summaryOut_(summaryOut)
+    summaryOut_(summaryOut),
+    uriListParser_(uriListParser)
 {}
 
 MultiUrlRequestInfo::~MultiUrlRequestInfo() {}
@@ -163,9 +169,19 @@ void MultiUrlRequestInfo::printMessageForContinue()
 error_code::Value MultiUrlRequestInfo::execute()
 {
   error_code::Value returnValue = error_code::FINISHED;
+#ifdef ENABLE_MESSAGE_DIGEST
+  if(option_->getAsInt(PREF_HASH_THREADS) > 0) {
+    DigestThreadPool::setInstance
+      (SharedHandle<DigestThreadPool>
+       (new DigestThreadPool(option_->getAsInt(PREF_HASH_THREADS))));
+  }
+#endif // ENABLE_MESSAGE_DIGEST
   try {
     DownloadEngineHandle e =
       DownloadEngineFactory().newDownloadEngine(option_.get(), requestGroups_);
+    if(uriListParser_) {
+      e->getRequestGroupMan()->setUriListParser(uriListParser_);
+    }
 
     if(!option_->blank(PREF_LOAD_COOKIES)) {
       File cookieFile(option_->get(PREF_LOAD_COOKIES));
@@ -283,6 +299,10 @@ error_code::Value MultiUrlRequestInfo::execute()
     }
     A2_LOG_ERROR_EX(EX_EXCEPTION_CAUGHT, e);
   }
+#ifdef ENABLE_MESSAGE_DIGEST
+  // Pieces still hashing hold their own reference to the pool.
+  DigestThreadPool::setInstance(SharedHandle<DigestThreadPool>());
+#endif // ENABLE_MESSAGE_DIGEST
 #ifdef SIGHUP
   util::setGlobalSignalHandler(SIGHUP, SIG_DFL, 0);
 #endif // SIGHUP
@@ -48,6 +48,7 @@ namespace aria2 {
 class RequestGroup;
 class Option;
 class StatCalc;
+class UriListParser;
 
 class MultiUrlRequestInfo {
 private:
@@ -59,13 +60,17 @@ private:
 
   std::ostream& summaryOut_;
 
+  SharedHandle<UriListParser> uriListParser_;
+
   void printMessageForContinue();
 public:
   MultiUrlRequestInfo
   (const std::vector<SharedHandle<RequestGroup> >& requestGroups,
    const SharedHandle<Option>& op,
    const SharedHandle<StatCalc>& statCalc,
-   std::ostream& summaryOut);
+   std::ostream& summaryOut,
+   const SharedHandle<UriListParser>& uriListParser =
+   SharedHandle<UriListParser>());
   
   virtual ~MultiUrlRequestInfo();
 
@@ -53,6 +53,8 @@ public:
 
   virtual void save() {}
 
+  virtual bool isDirty() { return false; }
+
   virtual void load() {}
 
   virtual void removeFile() {}
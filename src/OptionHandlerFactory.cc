@@ -119,6 +119,15 @@ OptionHandlers OptionHandlerFactory::createOptionHandlers()
     op->addTag(TAG_ADVANCED);
     handlers.push_back(op);
   }
+  {
+    SharedHandle<OptionHandler> op(new BooleanOptionHandler
+                                   (PREF_AUTO_SAVE_IN_PLACE,
+                                    TEXT_AUTO_SAVE_IN_PLACE,
+                                    A2_V_FALSE,
+                                    OptionHandler::OPT_ARG));
+    op->addTag(TAG_ADVANCED);
+    handlers.push_back(op);
+  }
 #ifdef ENABLE_MESSAGE_DIGEST
   {
     SharedHandle<OptionHandler> op(new BooleanOptionHandler
@@ -175,6 +184,15 @@ OptionHandlers OptionHandlerFactory::createOptionHandlers()
     op->addTag(TAG_ADVANCED);
     handlers.push_back(op);
   }
+  {
+    SharedHandle<OptionHandler> op(new BooleanOptionHandler
+                                   (PREF_DEFERRED_INPUT,
+                                    TEXT_DEFERRED_INPUT,
+                                    A2_V_FALSE,
+                                    OptionHandler::OPT_ARG));
+    op->addTag(TAG_ADVANCED);
+    handlers.push_back(op);
+  }
   {
     SharedHandle<OptionHandler> op(new DefaultOptionHandler
                                    (PREF_DIR,
@@ -297,6 +315,16 @@ OptionHandlers OptionHandlerFactory::createOptionHandlers()
     op->addTag(TAG_FILE);
     handlers.push_back(op);
   }
+  {
+    SharedHandle<OptionHandler> op(new UnitNumberOptionHandler
+                                   (PREF_FILE_ALLOCATION_SPEED_LIMIT,
+                                    TEXT_FILE_ALLOCATION_SPEED_LIMIT,
+                                    "0",
+                                    0));
+    op->addTag(TAG_ADVANCED);
+    op->addTag(TAG_FILE);
+    handlers.push_back(op);
+  }
   {
     SharedHandle<OptionHandler> op(new BooleanOptionHandler
                                    (PREF_FORCE_SEQUENTIAL,
@@ -307,6 +335,17 @@ OptionHandlers OptionHandlerFactory::createOptionHandlers()
     op->addTag(TAG_BASIC);
     handlers.push_back(op);
   }
+#ifdef ENABLE_MESSAGE_DIGEST
+  {
+    SharedHandle<OptionHandler> op(new NumberOptionHandler
+                                   (PREF_HASH_THREADS,
+                                    TEXT_HASH_THREADS,
+                                    "0",
+                                    0, 64));
+    op->addTag(TAG_ADVANCED);
+    handlers.push_back(op);
+  }
+#endif // ENABLE_MESSAGE_DIGEST
   {
     SharedHandle<OptionHandler> op(new BooleanOptionHandler
                                    (PREF_HUMAN_READABLE,
@@ -369,6 +408,16 @@ OptionHandlers OptionHandlerFactory::createOptionHandlers()
     op->addTag(TAG_BASIC);
     handlers.push_back(op);
   }
+  {
+    SharedHandle<OptionHandler> op(new NumberOptionHandler
+                                   (PREF_MAX_CONCURRENT_FILE_ALLOCATIONS,
+                                    TEXT_MAX_CONCURRENT_FILE_ALLOCATIONS,
+                                    "1",
+                                    1, -1));
+    op->addTag(TAG_ADVANCED);
+    op->addTag(TAG_FILE);
+    handlers.push_back(op);
+  }
   {
     SharedHandle<OptionHandler> op(new NumberOptionHandler
                                    (PREF_MAX_CONNECTION_PER_SERVER,
@@ -514,6 +563,15 @@ OptionHandlers OptionHandlerFactory::createOptionHandlers()
     op->addTag(TAG_ADVANCED);
     handlers.push_back(op);
   }
+  {
+    SharedHandle<OptionHandler> op(new BooleanOptionHandler
+                                   (PREF_PROFILE_COMMANDS,
+                                    TEXT_PROFILE_COMMANDS,
+                                    A2_V_FALSE,
+                                    OptionHandler::OPT_ARG));
+    op->addTag(TAG_ADVANCED);
+    handlers.push_back(op);
+  }
   {
     SharedHandle<OptionHandler> op(new BooleanOptionHandler
                                    (PREF_QUIET,
@@ -569,6 +627,15 @@ OptionHandlers OptionHandlerFactory::createOptionHandlers()
     op->addTag(TAG_ADVANCED);
     handlers.push_back(op);
   }
+  {
+    SharedHandle<OptionHandler> op(new NumberOptionHandler
+                                   (PREF_SLOW_COMMAND_THRESHOLD,
+                                    TEXT_SLOW_COMMAND_THRESHOLD,
+                                    "0",
+                                    0, INT32_MAX));
+    op->addTag(TAG_ADVANCED);
+    handlers.push_back(op);
+  }
   {
     SharedHandle<OptionHandler> op(new NumberOptionHandler
                                    (PREF_STOP,
@@ -1365,6 +1432,15 @@ OptionHandlers OptionHandlerFactory::createOptionHandlers()
     op->addTag(TAG_BITTORRENT);
     handlers.push_back(op);
   }
+  {
+    SharedHandle<OptionHandler> op(new DefaultOptionHandler
+                                   (PREF_BT_PIECE_INDEX,
+                                    TEXT_BT_PIECE_INDEX,
+                                    NO_DEFAULT_VALUE,
+                                    PATH_TO_FILE));
+    op->addTag(TAG_BITTORRENT);
+    handlers.push_back(op);
+  }
   {
     SharedHandle<OptionHandler> op(new PrioritizePieceOptionHandler
                                    (PREF_BT_PRIORITIZE_PIECE,
@@ -1372,6 +1448,24 @@ OptionHandlers OptionHandlerFactory::createOptionHandlers()
     op->addTag(TAG_BITTORRENT);
     handlers.push_back(op);
   }
+  {
+    SharedHandle<OptionHandler> op(new UnitNumberOptionHandler
+                                   (PREF_BT_STREAM_POSITION,
+                                    TEXT_BT_STREAM_POSITION,
+                                    "0",
+                                    0));
+    op->addTag(TAG_BITTORRENT);
+    handlers.push_back(op);
+  }
+  {
+    SharedHandle<OptionHandler> op(new UnitNumberOptionHandler
+                                   (PREF_BT_STREAM_WINDOW,
+                                    TEXT_BT_STREAM_WINDOW,
+                                    "0",
+                                    0));
+    op->addTag(TAG_BITTORRENT);
+    handlers.push_back(op);
+  }
   {
     SharedHandle<OptionHandler> op(new UnitNumberOptionHandler
                                    (PREF_BT_REQUEST_PEER_SPEED_LIMIT,
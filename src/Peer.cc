@@ -229,6 +229,18 @@ unsigned int Peer::calculateDownloadSpeed()
   return res_->getPeerStat().calculateDownloadSpeed();
 }
 
+void Peer::updateBlockRtt(int64_t rtt)
+{
+  assert(res_);
+  res_->getPeerStat().updateBlockRtt(rtt);
+}
+
+int64_t Peer::getMinBlockRtt() const
+{
+  assert(res_);
+  return res_->getPeerStat().getMinBlockRtt();
+}
+
 uint64_t Peer::getSessionUploadLength() const
 {
   assert(res_);
@@ -417,4 +429,11 @@ size_t Peer::countOutstandingUpload() const
   return res_->countOutstandingUpload();
 }
 
+bool Peer::cancelOutstandingRequest
+(size_t index, uint32_t begin, size_t length)
+{
+  assert(res_);
+  return res_->cancelOutstandingRequest(index, begin, length);
+}
+
 } // namespace aria2
@@ -231,6 +231,17 @@ public:
    */
   unsigned int calculateDownloadSpeed();
 
+  /**
+   * Feeds a block round trip time sample in milliseconds.
+   */
+  void updateBlockRtt(int64_t rtt);
+
+  /**
+   * Returns the lowest block round trip time in milliseconds, or 0 if
+   * it has not been measured yet.
+   */
+  int64_t getMinBlockRtt() const;
+
   /**
    * Returns the number of bytes uploaded to the remote host.
    */
@@ -325,6 +336,11 @@ public:
   void setBtMessageDispatcher(BtMessageDispatcher* dpt);
 
   size_t countOutstandingUpload() const;
+
+  // Cancels the outstanding request to this peer for the block which
+  // has been received from another peer and sends the cancel message
+  // right away.  Returns true if the request was found.
+  bool cancelOutstandingRequest(size_t index, uint32_t begin, size_t length);
 };
 
 template<typename InputIterator>
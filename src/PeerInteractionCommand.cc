@@ -35,6 +35,7 @@
 #include "PeerInteractionCommand.h"
 
 #include <algorithm>
+#include <vector>
 
 #include "DownloadEngine.h"
 #include "PeerInitiateConnectionCommand.h"
@@ -75,6 +76,7 @@
 #include "bittorrent_helper.h"
 #include "UTMetadataRequestFactory.h"
 #include "UTMetadataRequestTracker.h"
+#include "DigestThreadPool.h"
 
 namespace aria2 {
 
@@ -267,6 +269,7 @@ PeerInteractionCommand::PeerInteractionCommand
 }
 
 PeerInteractionCommand::~PeerInteractionCommand() {
+  getDownloadEngine()->deleteDigestCheck(this);
   if(getPeer()->getCompletedLength() > 0) {
     pieceStorage_->subtractPieceStats(getPeer()->getBitfield(),
                                       getPeer()->getBitfieldLength());
@@ -330,6 +333,19 @@ bool PeerInteractionCommand::executeInternal() {
       if(btInteractive_->countReceivedMessageInIteration() > 0) {
         updateKeepAlive();
       }
+      {
+        // Wake up when the hash of a completed piece is calculated,
+        // so that it is verified without waiting for socket events.
+        std::vector<SharedHandle<DigestStream> > streams;
+        btInteractive_->getHashPendingStreams(streams);
+        for(std::vector<SharedHandle<DigestStream> >::const_iterator i =
+              streams.begin(), eoi = streams.end(); i != eoi; ++i) {
+          if(!getDownloadEngine()->addDigestCheck(*i, this)) {
+            // Already calculated. Verify it in the next iteration.
+            setStatusActive();
+          }
+        }
+      }
       if((getPeer()->amInterested() && !getPeer()->peerChoking()) ||
          btInteractive_->countOutstandingRequest() ||
          (getPeer()->peerInterested() && !getPeer()->amChoking())) {
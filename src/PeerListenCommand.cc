@@ -49,6 +49,7 @@
 #include "SimpleRandomizer.h"
 #include "util.h"
 #include "fmt.h"
+#include "PendingHandshakeMan.h"
 
 namespace aria2 {
 
@@ -72,11 +73,17 @@ PeerListenCommand::PeerListenCommand
 
 PeerListenCommand::~PeerListenCommand()
 {
+  if(socket_) {
+    e_->deleteSocketForReadCheck(socket_, this);
+  }
   --numInstance_;
 }
 
 bool PeerListenCommand::bindPort(uint16_t& port, IntSequence& seq)
 {
+  if(socket_) {
+    e_->deleteSocketForReadCheck(socket_, this);
+  }
   socket_.reset(new SocketCore());
 
   std::vector<int32_t> randPorts = seq.flush();
@@ -93,6 +100,7 @@ bool PeerListenCommand::bindPort(uint16_t& port, IntSequence& seq)
       socket_->bind(A2STR::NIL, port, family_);
       socket_->beginListen();
       socket_->setNonBlockingMode();
+      e_->addSocketForReadCheck(socket_, this);
       A2_LOG_NOTICE(fmt("IPv%d BitTorrent: listening to port %d",
                         family_ == AF_INET?4:6, port));
       return true;
@@ -121,12 +129,25 @@ bool PeerListenCommand::execute() {
   if(e_->isHaltRequested() || e_->getRequestGroupMan()->downloadFinished()) {
     return true;
   }
-  for(int i = 0; i < 3 && socket_->isReadable(0); ++i) {
+  // Accept all pending connections so that the listen backlog does
+  // not overflow under connection bursts.
+  const SharedHandle<PendingHandshakeMan>& pendingHandshakeMan =
+    e_->getPendingHandshakeMan();
+  while(1) {
     SocketHandle peerSocket;
     try {
-      peerSocket.reset(socket_->acceptConnection());
+      peerSocket.reset(socket_->tryAcceptConnection());
+      if(!peerSocket) {
+        break;
+      }
       std::pair<std::string, uint16_t> peerInfo;
       peerSocket->getPeerInfo(peerInfo);
+      if(!pendingHandshakeMan->admit(peerInfo.first)) {
+        A2_LOG_DEBUG(fmt("Rejected the connection from %s:%u."
+                         " Too many pending handshakes.",
+                         peerInfo.first.c_str(), peerInfo.second));
+        continue;
+      }
 
       peerSocket->setNonBlockingMode();
 
@@ -144,6 +165,7 @@ bool PeerListenCommand::execute() {
       A2_LOG_DEBUG_EX(fmt(MSG_ACCEPT_FAILURE,
                           getCuid()),
                       ex);
+      break;
     }
   }
   e_->addCommand(this);
@@ -57,6 +57,7 @@
 #include "Option.h"
 #include "RequestGroupMan.h"
 #include "fmt.h"
+#include "PendingHandshakeMan.h"
 #include "RequestGroup.h"
 
 namespace aria2 {
@@ -78,9 +79,14 @@ PeerReceiveHandshakeCommand::PeerReceiveHandshakeCommand
   } else {
     peerConnection_.reset(new PeerConnection(cuid, getPeer(), getSocket()));
   }
+  e->getPendingHandshakeMan()->add(getPeer()->getIPAddress());
 }
 
-PeerReceiveHandshakeCommand::~PeerReceiveHandshakeCommand() {}
+PeerReceiveHandshakeCommand::~PeerReceiveHandshakeCommand()
+{
+  getDownloadEngine()->getPendingHandshakeMan()->remove
+    (getPeer()->getIPAddress());
+}
 
 bool PeerReceiveHandshakeCommand::exitBeforeExecute()
 {
@@ -275,6 +275,19 @@ size_t PeerSessionResource::countOutstandingUpload() const
   return dispatcher_->countOutstandingUpload();
 }
 
+bool PeerSessionResource::cancelOutstandingRequest
+(size_t index, uint32_t begin, size_t length)
+{
+  // dispatcher_ is not set until PeerInteractionCommand is created.
+  if(dispatcher_ &&
+     dispatcher_->doCancelOutstandingRequestAction(index, begin, length)) {
+    dispatcher_->sendMessages();
+    return true;
+  } else {
+    return false;
+  }
+}
+
 void PeerSessionResource::reconfigure(size_t pieceLength, uint64_t totalLenth)
 {
   delete bitfieldMan_;
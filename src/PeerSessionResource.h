@@ -210,6 +210,11 @@ public:
     return peerStat_;
   }
 
+  const PeerStat& getPeerStat() const
+  {
+    return peerStat_;
+  }
+
   uint64_t uploadLength() const;
 
   void updateUploadLength(size_t bytes);
@@ -233,6 +238,8 @@ public:
   void setBtMessageDispatcher(BtMessageDispatcher* dpt);
 
   size_t countOutstandingUpload() const;
+
+  bool cancelOutstandingRequest(size_t index, uint32_t begin, size_t length);
 };
 
 } // namespace aria2
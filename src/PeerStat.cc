@@ -33,6 +33,9 @@
  */
 /* copyright --> */
 #include "PeerStat.h"
+
+#include <algorithm>
+
 #include "SharedHandle.h"
 #include "wallclock.h"
 
@@ -48,7 +51,8 @@ PeerStat::PeerStat
     avgDownloadSpeed_(0),
     avgUploadSpeed_(0),
     sessionDownloadLength_(0),
-    sessionUploadLength_(0)
+    sessionUploadLength_(0),
+    minBlockRtt_(0)
 {}
 
 PeerStat::PeerStat(cuid_t cuid)
@@ -57,7 +61,8 @@ PeerStat::PeerStat(cuid_t cuid)
     avgDownloadSpeed_(0),
     avgUploadSpeed_(0),
     sessionDownloadLength_(0),
-    sessionUploadLength_(0)
+    sessionUploadLength_(0),
+    minBlockRtt_(0)
 {}
 
 PeerStat::~PeerStat() {}
@@ -99,6 +104,15 @@ void PeerStat::updateUploadLength(size_t bytes)
   sessionUploadLength_ += bytes;
 }
 
+void PeerStat::updateBlockRtt(int64_t rtt)
+{
+  // Avoid 0, which means no sample.
+  rtt = std::max(rtt, (int64_t)1);
+  if(minBlockRtt_ == 0 || rtt < minBlockRtt_) {
+    minBlockRtt_ = rtt;
+  }
+}
+
 unsigned int PeerStat::getMaxDownloadSpeed() const
 {
   return downloadSpeed_.getMaxSpeed();
@@ -115,6 +129,7 @@ void PeerStat::reset()
   uploadSpeed_.reset();
   downloadStartTime_ = global::wallclock;
   status_ = PeerStat::IDLE;
+  minBlockRtt_ = 0;
 }
 
 void PeerStat::downloadStart()
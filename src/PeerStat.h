@@ -63,6 +63,9 @@ private:
   unsigned int avgUploadSpeed_;
   uint64_t sessionDownloadLength_;
   uint64_t sessionUploadLength_;
+  // The lowest block round trip time seen in milliseconds. 0 means no
+  // sample has been taken yet.
+  int64_t minBlockRtt_;
 public:
   PeerStat
   (cuid_t cuid, const std::string& hostname, const::std::string& protocol);
@@ -90,6 +93,17 @@ public:
 
   void updateUploadLength(size_t bytes);
 
+  // Feeds a new block round trip time sample in milliseconds.
+  void updateBlockRtt(int64_t rtt);
+
+  // Returns the lowest block round trip time seen.  Samples taken
+  // while the peer is busy sending earlier blocks are inflated by the
+  // queueing delay, so the minimum is used as the path latency.
+  int64_t getMinBlockRtt() const
+  {
+    return minBlockRtt_;
+  }
+
   unsigned int getMaxDownloadSpeed() const;
 
   unsigned int getMaxUploadSpeed() const;
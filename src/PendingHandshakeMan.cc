@@ -0,0 +1,94 @@
+/* <!-- copyright */
+/*
+ * aria2 - The high speed download utility
+ *
+ * Copyright (C) 2011 Tatsuhiro Tsujikawa
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.  If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so.  If you
+ * do not wish to do so, delete this exception statement from your
+ * version.  If you delete this exception statement from all source
+ * files in the program, then also delete it here.
+ */
+/* copyright --> */
+#include "PendingHandshakeMan.h"
+
+namespace aria2 {
+
+const size_t PendingHandshakeMan::DEFAULT_MAX_PENDING;
+
+const size_t PendingHandshakeMan::DEFAULT_MAX_PENDING_PER_HOST;
+
+PendingHandshakeMan::PendingHandshakeMan
+(size_t maxPending, size_t maxPendingPerHost)
+  : numPending_(0),
+    maxPending_(maxPending),
+    maxPendingPerHost_(maxPendingPerHost),
+    numAccepted_(0),
+    numRejected_(0)
+{}
+
+PendingHandshakeMan::~PendingHandshakeMan() {}
+
+bool PendingHandshakeMan::admit(const std::string& ipaddr)
+{
+  if(numPending_ >= maxPending_ ||
+     countPending(ipaddr) >= maxPendingPerHost_) {
+    ++numRejected_;
+    return false;
+  } else {
+    ++numAccepted_;
+    return true;
+  }
+}
+
+void PendingHandshakeMan::add(const std::string& ipaddr)
+{
+  ++hosts_[ipaddr];
+  ++numPending_;
+}
+
+void PendingHandshakeMan::remove(const std::string& ipaddr)
+{
+  std::map<std::string, size_t>::iterator i = hosts_.find(ipaddr);
+  if(i == hosts_.end()) {
+    return;
+  }
+  if(--(*i).second == 0) {
+    hosts_.erase(i);
+  }
+  --numPending_;
+}
+
+size_t PendingHandshakeMan::countPending(const std::string& ipaddr) const
+{
+  std::map<std::string, size_t>::const_iterator i = hosts_.find(ipaddr);
+  if(i == hosts_.end()) {
+    return 0;
+  } else {
+    return (*i).second;
+  }
+}
+
+} // namespace aria2
@@ -0,0 +1,98 @@
+/* <!-- copyright */
+/*
+ * aria2 - The high speed download utility
+ *
+ * Copyright (C) 2011 Tatsuhiro Tsujikawa
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.  If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so.  If you
+ * do not wish to do so, delete this exception statement from your
+ * version.  If you delete this exception statement from all source
+ * files in the program, then also delete it here.
+ */
+/* copyright --> */
+#ifndef D_PENDING_HANDSHAKE_MAN_H
+#define D_PENDING_HANDSHAKE_MAN_H
+
+#include "common.h"
+
+#include <string>
+#include <map>
+
+namespace aria2 {
+
+// Keeps track of incoming BitTorrent connections which are accepted
+// but not yet handshaken, and decides whether a new connection can be
+// admitted.
+class PendingHandshakeMan {
+private:
+  std::map<std::string, size_t> hosts_;
+  size_t numPending_;
+  size_t maxPending_;
+  size_t maxPendingPerHost_;
+  uint64_t numAccepted_;
+  uint64_t numRejected_;
+public:
+  PendingHandshakeMan(size_t maxPending = DEFAULT_MAX_PENDING,
+                      size_t maxPendingPerHost =
+                      DEFAULT_MAX_PENDING_PER_HOST);
+
+  ~PendingHandshakeMan();
+
+  // Returns true if a connection from ipaddr can be admitted under
+  // the limits, and counts it as accepted. Otherwise returns false
+  // and counts it as rejected.
+  bool admit(const std::string& ipaddr);
+
+  // Registers pending handshake with ipaddr.
+  void add(const std::string& ipaddr);
+
+  // Unregisters pending handshake with ipaddr.
+  void remove(const std::string& ipaddr);
+
+  size_t countPending() const
+  {
+    return numPending_;
+  }
+
+  size_t countPending(const std::string& ipaddr) const;
+
+  uint64_t getNumAccepted() const
+  {
+    return numAccepted_;
+  }
+
+  uint64_t getNumRejected() const
+  {
+    return numRejected_;
+  }
+
+  static const size_t DEFAULT_MAX_PENDING = 256;
+
+  static const size_t DEFAULT_MAX_PENDING_PER_HOST = 4;
+};
+
+} // namespace aria2
+
+#endif // D_PENDING_HANDSHAKE_MAN_H
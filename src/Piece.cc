@@ -40,13 +40,15 @@
 #include "a2functional.h"
 #ifdef ENABLE_MESSAGE_DIGEST
 # include "MessageDigest.h"
+# include "message_digest_helper.h"
+# include "DigestThreadPool.h"
 #endif // ENABLE_MESSAGE_DIGEST
 
 namespace aria2 {
 
 Piece::Piece():index_(0), length_(0), blockLength_(BLOCK_LENGTH), bitfield_(0)
 #ifdef ENABLE_MESSAGE_DIGEST
-              , nextBegin_(0)
+              , nextBegin_(0), hashBufferLength_(0)
 #endif // ENABLE_MESSAGE_DIGEST
 {}
 
@@ -54,12 +56,16 @@ Piece::Piece(size_t index, size_t length, size_t blockLength):
   index_(index), length_(length), blockLength_(blockLength),
   bitfield_(new BitfieldMan(blockLength_, length))
 #ifdef ENABLE_MESSAGE_DIGEST
-                                                             , nextBegin_(0)
+                                                             , nextBegin_(0),
+  hashBufferLength_(0)
 #endif // ENABLE_MESSAGE_DIGEST
 {}
 
 Piece::~Piece()
 {
+#ifdef ENABLE_MESSAGE_DIGEST
+  clearHashBuffer();
+#endif // ENABLE_MESSAGE_DIGEST
   delete bitfield_;
 }
 
@@ -169,9 +175,36 @@ std::string Piece::toString() const {
                    ", length=", util::itos(length_));
 }
 
+void Piece::addBlockRequest(size_t blockIndex)
+{
+  if(blockRequests_.empty()) {
+    blockRequests_.resize(countBlock());
+  }
+  if(blockIndex < blockRequests_.size()) {
+    ++blockRequests_[blockIndex];
+  }
+}
+
+void Piece::removeBlockRequest(size_t blockIndex)
+{
+  if(blockIndex < blockRequests_.size() && blockRequests_[blockIndex] > 0) {
+    --blockRequests_[blockIndex];
+  }
+}
+
+size_t Piece::countBlockRequest(size_t blockIndex) const
+{
+  if(blockIndex < blockRequests_.size()) {
+    return blockRequests_[blockIndex];
+  } else {
+    return 0;
+  }
+}
+
 void Piece::reconfigure(size_t length)
 {
   delete bitfield_;
+  blockRequests_.clear();
   length_ = length;
   bitfield_ = new BitfieldMan(blockLength_, length_);
 }
@@ -193,6 +226,44 @@ void Piece::setHashAlgo(const std::string& algo)
   hashAlgo_ = algo;
 }
 
+size_t Piece::totalHashBufferLength_ = 0;
+
+void Piece::clearHashBuffer()
+{
+  totalHashBufferLength_ -= hashBufferLength_;
+  hashBuffer_.clear();
+  hashBufferLength_ = 0;
+}
+
+void Piece::initDigest()
+{
+  if(!mdctx_) {
+    mdctx_ = MessageDigest::create(hashAlgo_);
+    const SharedHandle<DigestThreadPool>& pool =
+      DigestThreadPool::getInstance();
+    if(pool && pool->getNumThreads() > 0) {
+      digestStream_.reset(new DigestStream(mdctx_, pool));
+    }
+  }
+}
+
+void Piece::updateDigest(const unsigned char* data, size_t length)
+{
+  initDigest();
+  if(digestStream_) {
+    digestStream_->update(data, length);
+  } else {
+    mdctx_->update(data, length);
+  }
+}
+
+void Piece::waitDigest()
+{
+  if(digestStream_) {
+    digestStream_->wait();
+  }
+}
+
 bool Piece::updateHash
 (uint32_t begin, const unsigned char* data, size_t dataLength)
 {
@@ -200,27 +271,67 @@ bool Piece::updateHash
     return false;
   }
   if(begin == nextBegin_ && nextBegin_+dataLength <= length_) {
-    if(!mdctx_) {
-      mdctx_ = MessageDigest::create(hashAlgo_);
-    }
-    mdctx_->update(data, dataLength);
+    updateDigest(data, dataLength);
     nextBegin_ += dataLength;
+    std::map<uint32_t, std::string>::iterator i = hashBuffer_.begin();
+    while(i != hashBuffer_.end() && (*i).first <= nextBegin_) {
+      if((*i).first == nextBegin_) {
+        updateDigest(reinterpret_cast<const unsigned char*>
+                     ((*i).second.data()), (*i).second.size());
+        nextBegin_ += (*i).second.size();
+      }
+      hashBufferLength_ -= (*i).second.size();
+      totalHashBufferLength_ -= (*i).second.size();
+      hashBuffer_.erase(i++);
+    }
+    return true;
+  } else if(begin > nextBegin_ && begin+dataLength <= length_ &&
+            hashBufferLength_+dataLength <= MAX_HASH_BUFFER_LENGTH &&
+            totalHashBufferLength_+dataLength <=
+            MAX_TOTAL_HASH_BUFFER_LENGTH &&
+            hashBuffer_.find(begin) == hashBuffer_.end()) {
+    hashBuffer_.insert
+      (std::make_pair(begin, std::string(&data[0], &data[dataLength])));
+    hashBufferLength_ += dataLength;
+    totalHashBufferLength_ += dataLength;
     return true;
   } else {
     return false;
   }
 }
 
+size_t Piece::updateHashWithRead
+(const SharedHandle<BinaryStream>& bs, off_t offset)
+{
+  initDigest();
+  size_t readLength = length_-nextBegin_;
+  if(digestStream_) {
+    message_digest::updateDigest
+      (digestStream_, bs, offset+nextBegin_, readLength);
+  } else {
+    message_digest::updateDigest(mdctx_, bs, offset+nextBegin_, readLength);
+  }
+  nextBegin_ = length_;
+  clearHashBuffer();
+  return readLength;
+}
+
 bool Piece::isHashCalculated() const
 {
   return mdctx_ && nextBegin_ == length_;
 }
 
+bool Piece::isHashPending() const
+{
+  return digestStream_ && digestStream_->busy();
+}
+
 std::string Piece::getHashString()
 {
   if(!mdctx_) {
     return A2STR::NIL;
   } else {
+    waitDigest();
     std::string hash = mdctx_->hexDigest();
     destroyHashContext();
     return hash;
@@ -229,8 +340,10 @@ std::string Piece::getHashString()
 
 void Piece::destroyHashContext()
 {
+  digestStream_.reset();
   mdctx_.reset();
   nextBegin_ = 0;
+  clearHashBuffer();
 }
 
 #endif // ENABLE_MESSAGE_DIGEST
@@ -40,6 +40,7 @@
 #include <stdint.h>
 #include <vector>
 #include <string>
+#include <map>
 
 #include "SharedHandle.h"
 
@@ -50,6 +51,8 @@ class BitfieldMan;
 #ifdef ENABLE_MESSAGE_DIGEST
 
 class MessageDigest;
+class BinaryStream;
+class DigestStream;
 
 #endif // ENABLE_MESSAGE_DIGEST
 
@@ -59,6 +62,9 @@ private:
   size_t length_;
   size_t blockLength_;
   BitfieldMan* bitfield_;
+  // The number of outstanding requests for each block, counted over
+  // all peers.  Allocated on first use.
+  std::vector<size_t> blockRequests_;
 
 #ifdef ENABLE_MESSAGE_DIGEST
 
@@ -68,6 +74,35 @@ private:
 
   SharedHandle<MessageDigest> mdctx_;
 
+  // Hashes data on DigestThreadPool when it is available. While this
+  // is non-null, mdctx_ must only be accessed after waiting on it.
+  SharedHandle<DigestStream> digestStream_;
+
+  // Blocks received ahead of nextBegin_, keyed by their offset in
+  // this piece. They are fed to mdctx_ when the gap before them is
+  // filled.
+  std::map<uint32_t, std::string> hashBuffer_;
+
+  size_t hashBufferLength_;
+
+  // The number of bytes held in hashBuffer_ of all Piece objects.
+  static size_t totalHashBufferLength_;
+
+#endif // ENABLE_MESSAGE_DIGEST
+
+#ifdef ENABLE_MESSAGE_DIGEST
+
+  void clearHashBuffer();
+
+  // Creates mdctx_, and digestStream_ if DigestThreadPool is
+  // available.
+  void initDigest();
+
+  void updateDigest(const unsigned char* data, size_t length);
+
+  // Waits until all data given to updateDigest() is hashed.
+  void waitDigest();
+
 #endif // ENABLE_MESSAGE_DIGEST
 
   Piece(const Piece& piece);
@@ -77,6 +112,17 @@ public:
 
   static const size_t BLOCK_LENGTH  = 16*1024;
 
+#ifdef ENABLE_MESSAGE_DIGEST
+
+  // The maximum number of bytes held in hashBuffer_.
+  static const size_t MAX_HASH_BUFFER_LENGTH = 256*1024;
+
+  // The maximum number of bytes held in hashBuffer_ of all Piece
+  // objects.
+  static const size_t MAX_TOTAL_HASH_BUFFER_LENGTH = 16*1024*1024;
+
+#endif // ENABLE_MESSAGE_DIGEST
+
   Piece();
 
   Piece(size_t index, size_t length, size_t blockLength = BLOCK_LENGTH);
@@ -148,6 +194,15 @@ public:
 
   bool isBlockUsed(size_t index) const;
 
+  // Increments the number of outstanding requests for the block.
+  void addBlockRequest(size_t blockIndex);
+
+  // Decrements the number of outstanding requests for the block.
+  void removeBlockRequest(size_t blockIndex);
+
+  // Returns the number of outstanding requests for the block.
+  size_t countBlockRequest(size_t blockIndex) const;
+
   // Calculates completed length
   size_t getCompletedLength();
 
@@ -155,13 +210,56 @@ public:
 
   void setHashAlgo(const std::string& algo);
 
-  // Updates hash value. This function compares begin and private variable
-  // nextBegin_ and only when they are equal, hash is updated eating data and
-  // returns true. Otherwise returns false.
+  // Updates hash value. This function compares begin and private
+  // variable nextBegin_ and if they are equal, hash is updated eating
+  // data and then the buffered blocks which follow it. If begin is
+  // larger than nextBegin_, data is copied into the buffer, unless it
+  // would exceed MAX_HASH_BUFFER_LENGTH bytes in this piece or
+  // MAX_TOTAL_HASH_BUFFER_LENGTH bytes in all pieces. Returns true if
+  // data is hashed or buffered. Otherwise returns false.
   bool updateHash(uint32_t begin, const unsigned char* data, size_t dataLength);
 
+  // Feeds the data which is not hashed by updateHash() yet to hash,
+  // reading it from bs. offset is the position of this piece in
+  // bs. Returns the number of bytes read. This function does not
+  // wait for DigestThreadPool to hash the data.
+  size_t updateHashWithRead
+  (const SharedHandle<BinaryStream>& bs, off_t offset);
+
   bool isHashCalculated() const;
 
+  // Returns true if data fed to hash is still being hashed on
+  // DigestThreadPool. getHashString() blocks until it is done.
+  bool isHashPending() const;
+
+  // Returns the stream hashing data of this piece on
+  // DigestThreadPool, or null if hashing is done in the calling
+  // thread.
+  const SharedHandle<DigestStream>& getDigestStream() const
+  {
+    return digestStream_;
+  }
+
+  // Returns the number of bytes from the beginning of this piece fed
+  // to hash so far.
+  size_t getHashedLength() const
+  {
+    return nextBegin_;
+  }
+
+  // Returns the number of bytes buffered by updateHash().
+  size_t getHashBufferLength() const
+  {
+    return hashBufferLength_;
+  }
+
+  // Returns the number of bytes buffered by updateHash() in all
+  // Piece objects.
+  static size_t getTotalHashBufferLength()
+  {
+    return totalHashBufferLength_;
+  }
+
   // Returns hash value in ASCII hexadecimal form, which is calculated
   // by updateHash().  Please note that this function returns hash
   // value only once. Second invocation without updateHash() returns
@@ -0,0 +1,293 @@
+/* <!-- copyright */
+/*
+ * aria2 - The high speed download utility
+ *
+ * Copyright (C) 2011 Tatsuhiro Tsujikawa
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.  If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so.  If you
+ * do not wish to do so, delete this exception statement from your
+ * version.  If you delete this exception statement from all source
+ * files in the program, then also delete it here.
+ */
+/* copyright --> */
+#include "PieceHashIndex.h"
+
+#include <fstream>
+
+#include "DownloadContext.h"
+#include "FileEntry.h"
+#include "File.h"
+#include "util.h"
+#include "bitfield.h"
+#include "LogFactory.h"
+#include "Logger.h"
+#include "fmt.h"
+
+namespace aria2 {
+
+PieceHashIndex::PieceHashIndex(const std::string& filename)
+  : filename_(filename),
+    numObsoleteLines_(0)
+{}
+
+PieceHashIndex::~PieceHashIndex() {}
+
+std::string PieceHashIndex::makeKey
+(const std::string& hashType, const std::string& hash)
+{
+  std::string key = hashType;
+  key += " ";
+  key += hash;
+  return key;
+}
+
+bool PieceHashIndex::load()
+{
+  if(!File(filename_).exists()) {
+    return true;
+  }
+  std::ifstream in(filename_.c_str(), std::ios::binary);
+  if(!in) {
+    A2_LOG_ERROR(fmt("Failed to open piece index %s", filename_.c_str()));
+    return false;
+  }
+  bool ok = load(in);
+  in.close();
+  A2_LOG_INFO(fmt("Loaded %lu pieces from piece index %s",
+                  static_cast<unsigned long>(locations_.size()),
+                  filename_.c_str()));
+  if(ok && numObsoleteLines_ > 0) {
+    A2_LOG_INFO(fmt("Removing %lu obsolete lines from piece index %s",
+                    static_cast<unsigned long>(numObsoleteLines_),
+                    filename_.c_str()));
+    if(save()) {
+      numObsoleteLines_ = 0;
+    }
+  }
+  return ok;
+}
+
+bool PieceHashIndex::load(std::istream& in)
+{
+  std::string line;
+  while(getline(in, line)) {
+    // PATH may contain spaces, so split off the first 4 fields only.
+    std::string fields[4];
+    std::string::size_type p = 0;
+    size_t i = 0;
+    for(; i < 4; ++i) {
+      std::string::size_type q = line.find(' ', p);
+      if(q == std::string::npos) {
+        fields[i] = line.substr(p);
+        p = line.size();
+        ++i;
+        break;
+      }
+      fields[i] = line.substr(p, q-p);
+      p = q+1;
+    }
+    if(i == 3 && p == line.size() && fields[2] == "-") {
+      // Removal line
+      numObsoleteLines_ += 1+locations_.erase(makeKey(fields[0], fields[1]));
+      continue;
+    }
+    int64_t offset;
+    uint32_t length;
+    if(i < 4 || p >= line.size() ||
+       !util::parseLLIntNoThrow(offset, fields[2]) || offset < 0 ||
+       !util::parseUIntNoThrow(length, fields[3]) || length == 0) {
+      ++numObsoleteLines_;
+      continue;
+    }
+    if(find(fields[0], fields[1])) {
+      // This line overrides an earlier line.
+      ++numObsoleteLines_;
+    }
+    add(fields[0], fields[1], Location(line.substr(p), offset, length));
+  }
+  return !in.bad();
+}
+
+bool PieceHashIndex::save()
+{
+  std::string tempfile = filename_;
+  tempfile += "__temp";
+  {
+    std::ofstream out(tempfile.c_str(), std::ios::binary);
+    if(!out || !save(out)) {
+      A2_LOG_ERROR(fmt("Failed to write piece index %s", filename_.c_str()));
+      return false;
+    }
+  }
+  if(File(tempfile).renameTo(filename_)) {
+    return true;
+  } else {
+    A2_LOG_ERROR(fmt("Failed to write piece index %s", filename_.c_str()));
+    return false;
+  }
+}
+
+namespace {
+void writeLocation
+(std::ostream& out, const std::string& hashType, const std::string& hash,
+ const PieceHashIndex::Location& location)
+{
+  out << hashType << " " << hash << " "
+      << location.offset << " " << location.length << " "
+      << location.path << "\n";
+}
+} // namespace
+
+bool PieceHashIndex::save(std::ostream& out) const
+{
+  for(std::map<std::string, Location>::const_iterator i = locations_.begin(),
+        eoi = locations_.end(); i != eoi; ++i) {
+    // The key is HASH_TYPE and HEX_DIGEST joined with ' '.
+    out << (*i).first << " "
+        << (*i).second.offset << " " << (*i).second.length << " "
+        << (*i).second.path << "\n";
+  }
+  out.flush();
+  return !out.bad();
+}
+
+namespace {
+std::string makeAbsolutePath(const std::string& path)
+{
+  if(!path.empty() && path[0] == '/') {
+    return path;
+  } else {
+    return util::applyDir(File::getCurrentDir(), path);
+  }
+}
+} // namespace
+
+size_t PieceHashIndex::addDownload
+(const SharedHandle<DownloadContext>& dctx, const unsigned char* bitfield)
+{
+  std::ofstream out(filename_.c_str(), std::ios::app|std::ios::binary);
+  if(!out) {
+    A2_LOG_ERROR(fmt("Failed to open piece index %s", filename_.c_str()));
+    return 0;
+  }
+  size_t count = addDownload(dctx, bitfield, out);
+  out.flush();
+  if(out.bad()) {
+    A2_LOG_ERROR(fmt("Failed to write piece index %s", filename_.c_str()));
+  } else if(count > 0) {
+    A2_LOG_INFO(fmt("Added %lu pieces of %s to piece index %s",
+                    static_cast<unsigned long>(count),
+                    dctx->getBasePath().c_str(), filename_.c_str()));
+  }
+  return count;
+}
+
+size_t PieceHashIndex::addDownload
+(const SharedHandle<DownloadContext>& dctx, const unsigned char* bitfield,
+ std::ostream& out)
+{
+  const std::string& hashType = dctx->getPieceHashAlgo();
+  const std::vector<std::string>& hashes = dctx->getPieceHashes();
+  if(hashType.empty() || hashes.empty()) {
+    return 0;
+  }
+  size_t count = 0;
+  for(size_t index = 0; index < hashes.size(); ++index) {
+    if(!bitfield::test(bitfield, hashes.size(), index)) {
+      continue;
+    }
+    off_t offset = (off_t)index*dctx->getPieceLength();
+    size_t length = std::min(static_cast<uint64_t>(dctx->getPieceLength()),
+                             dctx->getTotalLength()-offset);
+    SharedHandle<FileEntry> entry = dctx->findFileEntryByOffset(offset);
+    if(!entry ||
+       entry->getOffset()+entry->getLength() < (uint64_t)offset+length) {
+      // Pieces spanning several files cannot be copied by one read.
+      continue;
+    }
+    Location location(makeAbsolutePath(entry->getPath()),
+                      offset-entry->getOffset(), length);
+    if(add(hashType, hashes[index], location)) {
+      writeLocation(out, hashType, hashes[index], location);
+      ++count;
+    }
+  }
+  return count;
+}
+
+bool PieceHashIndex::add
+(const std::string& hashType, const std::string& hash,
+ const Location& location)
+{
+  std::string key = makeKey(hashType, hash);
+  std::map<std::string, Location>::iterator i = locations_.find(key);
+  if(i == locations_.end()) {
+    locations_.insert(std::make_pair(key, location));
+    return true;
+  } else if((*i).second == location) {
+    return false;
+  } else {
+    (*i).second = location;
+    return true;
+  }
+}
+
+const PieceHashIndex::Location* PieceHashIndex::find
+(const std::string& hashType, const std::string& hash) const
+{
+  std::map<std::string, Location>::const_iterator i =
+    locations_.find(makeKey(hashType, hash));
+  if(i == locations_.end()) {
+    return 0;
+  } else {
+    return &(*i).second;
+  }
+}
+
+void PieceHashIndex::remove
+(const std::string& hashType, const std::string& hash)
+{
+  std::ofstream out(filename_.c_str(), std::ios::app|std::ios::binary);
+  if(!out) {
+    A2_LOG_ERROR(fmt("Failed to open piece index %s", filename_.c_str()));
+    locations_.erase(makeKey(hashType, hash));
+    return;
+  }
+  remove(hashType, hash, out);
+  out.flush();
+  if(out.bad()) {
+    A2_LOG_ERROR(fmt("Failed to write piece index %s", filename_.c_str()));
+  }
+}
+
+void PieceHashIndex::remove
+(const std::string& hashType, const std::string& hash, std::ostream& out)
+{
+  if(locations_.erase(makeKey(hashType, hash))) {
+    out << hashType << " " << hash << " -\n";
+  }
+}
+
+} // namespace aria2
@@ -0,0 +1,156 @@
+/* <!-- copyright */
+/*
+ * aria2 - The high speed download utility
+ *
+ * Copyright (C) 2011 Tatsuhiro Tsujikawa
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.  If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so.  If you
+ * do not wish to do so, delete this exception statement from your
+ * version.  If you delete this exception statement from all source
+ * files in the program, then also delete it here.
+ */
+/* copyright --> */
+#ifndef D_PIECE_HASH_INDEX_H
+#define D_PIECE_HASH_INDEX_H
+
+#include "common.h"
+
+#include <string>
+#include <map>
+#include <iosfwd>
+
+#include "SharedHandle.h"
+
+namespace aria2 {
+
+class DownloadContext;
+
+// Index of piece hashes of completed downloads, pointing to the local
+// file which holds each piece.  A download consults it before
+// fetching a piece from peers, so that pieces shared with other
+// torrents are copied from disk.  The index is kept in a text file,
+// one piece per line:
+//
+//   HASH_TYPE HEX_DIGEST OFFSET LENGTH PATH
+//
+// Lines are only appended while aria2 runs.  A later line for the
+// same piece hash overrides an earlier one, and the line
+//
+//   HASH_TYPE HEX_DIGEST -
+//
+// removes the piece hash.  load() rewrites the file without the lines
+// which no longer take effect, so that the file does not grow without
+// bound.
+class PieceHashIndex {
+public:
+  struct Location {
+    std::string path;
+    off_t offset;
+    size_t length;
+
+    Location():offset(0), length(0) {}
+
+    Location(const std::string& path, off_t offset, size_t length):
+      path(path), offset(offset), length(length) {}
+
+    bool operator==(const Location& location) const
+    {
+      return path == location.path && offset == location.offset &&
+        length == location.length;
+    }
+  };
+private:
+  std::string filename_;
+
+  // Keyed by hash type and hex digest joined with ' '.
+  std::map<std::string, Location> locations_;
+
+  // The number of lines read by load() which no longer take effect:
+  // overridden or removed entries, removal lines and malformed lines.
+  size_t numObsoleteLines_;
+
+  static std::string makeKey
+  (const std::string& hashType, const std::string& hash);
+public:
+  PieceHashIndex(const std::string& filename);
+
+  ~PieceHashIndex();
+
+  const std::string& getFilename() const
+  {
+    return filename_;
+  }
+
+  // Reads the index file and rewrites it if it has obsolete lines.
+  // Returns true if the file does not exist yet.
+  bool load();
+
+  bool load(std::istream& in);
+
+  // Rewrites the index file with the current entries only.
+  bool save();
+
+  bool save(std::ostream& out) const;
+
+  // Indexes the pieces of dctx which are set in bitfield and lie
+  // within one file, and appends the entries not indexed yet to the
+  // index file.  Returns the number of appended entries.
+  size_t addDownload
+  (const SharedHandle<DownloadContext>& dctx, const unsigned char* bitfield);
+
+  size_t addDownload
+  (const SharedHandle<DownloadContext>& dctx, const unsigned char* bitfield,
+   std::ostream& out);
+
+  // Returns true if location was not indexed for the piece hash.
+  bool add(const std::string& hashType, const std::string& hash,
+           const Location& location);
+
+  // Returns the location of the piece hash, or 0 if not indexed.
+  const Location* find
+  (const std::string& hashType, const std::string& hash) const;
+
+  // Forgets the location of the piece hash, for example because the
+  // data there no longer matches the hash, and appends the removal to
+  // the index file.
+  void remove(const std::string& hashType, const std::string& hash);
+
+  void remove
+  (const std::string& hashType, const std::string& hash, std::ostream& out);
+
+  size_t countPieces() const
+  {
+    return locations_.size();
+  }
+
+  size_t getNumObsoleteLines() const
+  {
+    return numObsoleteLines_;
+  }
+};
+
+} // namespace aria2
+
+#endif // D_PIECE_HASH_INDEX_H
@@ -0,0 +1,238 @@
+/* <!-- copyright */
+/*
+ * aria2 - The high speed download utility
+ *
+ * Copyright (C) 2011 Tatsuhiro Tsujikawa
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.  If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so.  If you
+ * do not wish to do so, delete this exception statement from your
+ * version.  If you delete this exception statement from all source
+ * files in the program, then also delete it here.
+ */
+/* copyright --> */
+#include "PieceIndexCommand.h"
+
+#include <algorithm>
+
+#include "DownloadEngine.h"
+#include "RequestGroup.h"
+#include "DownloadContext.h"
+#include "FileEntry.h"
+#include "PieceStorage.h"
+#include "Piece.h"
+#include "DiskAdaptor.h"
+#include "DefaultDiskWriter.h"
+#include "BtRuntime.h"
+#include "PieceHashIndex.h"
+#include "MessageDigest.h"
+#include "RecoverableException.h"
+#include "LogFactory.h"
+#include "Logger.h"
+#include "fmt.h"
+
+namespace aria2 {
+
+namespace {
+// The amount of data copied in one execute() call.
+const uint64_t MAX_COPY_LENGTH = 4*1024*1024;
+} // namespace
+
+PieceIndexCommand::PieceIndexCommand
+(cuid_t cuid,
+ RequestGroup* requestGroup,
+ DownloadEngine* e,
+ const SharedHandle<PieceHashIndex>& index)
+  : Command(cuid),
+    requestGroup_(requestGroup),
+    e_(e),
+    downloadContext_(requestGroup->getDownloadContext()),
+    index_(index),
+    buffer_(0),
+    nextIndex_(0),
+    numCopied_(0)
+{
+  setStatusRealtime();
+  requestGroup_->increaseNumCommand();
+}
+
+PieceIndexCommand::~PieceIndexCommand()
+{
+  requestGroup_->decreaseNumCommand();
+  delete [] buffer_;
+}
+
+bool PieceIndexCommand::execute()
+{
+  // Check this first, so that a download which is seeding from the
+  // start is indexed even if it stops right away.
+  if(pieceStorage_->downloadFinished()) {
+    index_->addDownload(downloadContext_, pieceStorage_->getBitfield());
+    return true;
+  }
+  if(btRuntime_->isHalt() || requestGroup_->isHaltRequested()) {
+    return true;
+  }
+  if(nextIndex_ < downloadContext_->getNumPieces()) {
+    copyPieces();
+    e_->setNoWait(true);
+  }
+  e_->addCommand(this);
+  return false;
+}
+
+void PieceIndexCommand::copyPieces()
+{
+  const size_t numPieces = downloadContext_->getNumPieces();
+  if(!buffer_) {
+    buffer_ = new unsigned char[downloadContext_->getPieceLength()];
+    ctx_ = MessageDigest::create(downloadContext_->getPieceHashAlgo());
+  }
+  uint64_t length = 0;
+  for(; nextIndex_ < numPieces && length < MAX_COPY_LENGTH; ++nextIndex_) {
+    if(pieceStorage_->hasPiece(nextIndex_) ||
+       pieceStorage_->isPieceUsed(nextIndex_)) {
+      continue;
+    }
+    try {
+      if(copyPiece(nextIndex_)) {
+        length += downloadContext_->getPieceLength();
+      }
+    } catch(RecoverableException& ex) {
+      A2_LOG_ERROR_EX(fmt("CUID#%lld - Failed to write piece#%lu",
+                          getCuid(), static_cast<unsigned long>(nextIndex_)),
+                      ex);
+      // Leave the rest to peers.
+      nextIndex_ = numPieces;
+      break;
+    }
+  }
+  if(nextIndex_ == numPieces) {
+    if(source_) {
+      source_->closeFile();
+      source_.reset();
+    }
+    delete [] buffer_;
+    buffer_ = 0;
+    if(numCopied_ > 0) {
+      A2_LOG_NOTICE(fmt("Copied %lu pieces of %s from local files.",
+                        static_cast<unsigned long>(numCopied_),
+                        downloadContext_->getBasePath().c_str()));
+    }
+  }
+}
+
+bool PieceIndexCommand::copyPiece(size_t index)
+{
+  const std::string& hashType = downloadContext_->getPieceHashAlgo();
+  const std::string& hash = downloadContext_->getPieceHash(index);
+  const PieceHashIndex::Location* location = index_->find(hashType, hash);
+  if(!location) {
+    return false;
+  }
+  off_t offset = (off_t)index*downloadContext_->getPieceLength();
+  size_t length =
+    std::min(static_cast<uint64_t>(downloadContext_->getPieceLength()),
+             downloadContext_->getTotalLength()-offset);
+  if(pieceStorage_->isSelectiveDownloadingMode()) {
+    SharedHandle<FileEntry> entry =
+      downloadContext_->findFileEntryByOffset(offset);
+    if(!entry || !entry->isRequested() ||
+       entry->getOffset()+entry->getLength() < (uint64_t)offset+length) {
+      return false;
+    }
+  }
+  SharedHandle<Piece> piece = pieceStorage_->getMissingPiece(index);
+  if(!piece) {
+    return false;
+  }
+  std::string path = location->path;
+  bool match = false;
+  if(location->length == length) {
+    try {
+      if(readSource(path, location->offset, length)) {
+        ctx_->reset();
+        ctx_->update(buffer_, length);
+        match = ctx_->hexDigest() == hash;
+      }
+    } catch(RecoverableException& ex) {
+      A2_LOG_INFO_EX(fmt("CUID#%lld - Failed to read %s",
+                         getCuid(), path.c_str()), ex);
+    }
+  }
+  if(!match) {
+    A2_LOG_INFO(fmt("CUID#%lld - Piece index entry for piece#%lu is stale,"
+                    " path=%s",
+                    getCuid(), static_cast<unsigned long>(index),
+                    path.c_str()));
+    pieceStorage_->cancelPiece(piece);
+    index_->remove(hashType, hash);
+    return true;
+  }
+  try {
+    pieceStorage_->getDiskAdaptor()->writeData(buffer_, length, offset);
+  } catch(RecoverableException& ex) {
+    pieceStorage_->cancelPiece(piece);
+    throw;
+  }
+  piece->setAllBlock();
+  pieceStorage_->completePiece(piece);
+  pieceStorage_->advertisePiece(getCuid(), index);
+  ++numCopied_;
+  A2_LOG_INFO(fmt("CUID#%lld - Copied piece#%lu from %s",
+                  getCuid(), static_cast<unsigned long>(index),
+                  path.c_str()));
+  return true;
+}
+
+bool PieceIndexCommand::readSource
+(const std::string& path, off_t offset, size_t length)
+{
+  if(!source_ || sourcePath_ != path) {
+    if(source_) {
+      source_->closeFile();
+      source_.reset();
+    }
+    SharedHandle<DiskWriter> writer(new DefaultDiskWriter(path));
+    writer->enableReadOnly();
+    writer->openExistingFile();
+    source_ = writer;
+    sourcePath_ = path;
+  }
+  return source_->readData(buffer_, length, offset) ==
+    static_cast<ssize_t>(length);
+}
+
+void PieceIndexCommand::setPieceStorage
+(const SharedHandle<PieceStorage>& pieceStorage)
+{
+  pieceStorage_ = pieceStorage;
+}
+
+void PieceIndexCommand::setBtRuntime(const SharedHandle<BtRuntime>& btRuntime)
+{
+  btRuntime_ = btRuntime;
+}
+
+} // namespace aria2
@@ -0,0 +1,102 @@
+/* <!-- copyright */
+/*
+ * aria2 - The high speed download utility
+ *
+ * Copyright (C) 2011 Tatsuhiro Tsujikawa
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.  If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so.  If you
+ * do not wish to do so, delete this exception statement from your
+ * version.  If you delete this exception statement from all source
+ * files in the program, then also delete it here.
+ */
+/* copyright --> */
+#ifndef D_PIECE_INDEX_COMMAND_H
+#define D_PIECE_INDEX_COMMAND_H
+
+#include "Command.h"
+
+#include <string>
+
+#include "SharedHandle.h"
+
+namespace aria2 {
+
+class RequestGroup;
+class DownloadEngine;
+class DownloadContext;
+class PieceStorage;
+class BtRuntime;
+class PieceHashIndex;
+class DiskWriter;
+class MessageDigest;
+
+// Copies the pieces found in PieceHashIndex from local files while
+// the rest of the download comes from peers.  When the download
+// completes, its pieces are added to the index.
+class PieceIndexCommand : public Command {
+private:
+  RequestGroup* requestGroup_;
+  DownloadEngine* e_;
+  SharedHandle<DownloadContext> downloadContext_;
+  SharedHandle<PieceStorage> pieceStorage_;
+  SharedHandle<BtRuntime> btRuntime_;
+  SharedHandle<PieceHashIndex> index_;
+  SharedHandle<MessageDigest> ctx_;
+  // The last opened local file and its path.
+  SharedHandle<DiskWriter> source_;
+  std::string sourcePath_;
+  unsigned char* buffer_;
+  size_t nextIndex_;
+  size_t numCopied_;
+
+  // Copies pieces from local files, at most about MAX_COPY_LENGTH
+  // bytes per call.
+  void copyPieces();
+
+  // Copies piece index if it is in the index and the local data
+  // matches its hash.  Returns true if the local data was read.
+  // Throws exception if writing the piece failed.
+  bool copyPiece(size_t index);
+
+  bool readSource
+  (const std::string& path, off_t offset, size_t length);
+public:
+  PieceIndexCommand(cuid_t cuid,
+                    RequestGroup* requestGroup,
+                    DownloadEngine* e,
+                    const SharedHandle<PieceHashIndex>& index);
+
+  virtual ~PieceIndexCommand();
+
+  virtual bool execute();
+
+  void setPieceStorage(const SharedHandle<PieceStorage>& pieceStorage);
+
+  void setBtRuntime(const SharedHandle<BtRuntime>& btRuntime);
+};
+
+} // namespace aria2
+
+#endif // D_PIECE_INDEX_COMMAND_H
@@ -215,6 +215,25 @@ public:
 
   virtual void enterEndGame() = 0;
 
+  // Returns true if pieces in the window ahead of the playback
+  // position are downloaded first. Like in end game, their blocks
+  // may be requested from more than one peer.
+  virtual bool isStreamingMode() = 0;
+
+  // Adds the length of data which was downloaded but thrown away,
+  // because the block had already been received from another peer or
+  // was not requested at all.
+  virtual void addWastedLength(size_t length) = 0;
+
+  virtual uint64_t getWastedLength() = 0;
+
+  // Records that length bytes of a completed piece were read back
+  // from disk to calculate its hash.
+  virtual void addHashReread(size_t length) = 0;
+
+  // Returns the number of times addHashReread() was called.
+  virtual size_t getNumHashReread() = 0;
+
   // TODO We can remove this.
   virtual void setEndGamePieceNum(size_t num) = 0;
 
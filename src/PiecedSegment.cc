@@ -94,6 +94,13 @@ void PiecedSegment::updateWrittenLength(size_t bytes)
 bool PiecedSegment::updateHash(uint32_t begin,
                                const unsigned char* data, size_t dataLength)
 {
+  // Segment data arrives in order, so nothing fills a gap before
+  // begin, e.g. the part written before the download was resumed.
+  // Buffering data behind it would be wasted because the piece is
+  // read back to compute its hash anyway.
+  if(begin != piece_->getHashedLength()) {
+    return false;
+  }
   return piece_->updateHash(begin, data, dataLength);
 }
 
@@ -45,12 +45,17 @@
 #include "prefs.h"
 #include "Option.h"
 #include "MSEHandshake.h"
+#include "DHKeyPool.h"
+#include "DHKeyExchange.h"
+#include "DHKeyPoolCommand.h"
+#include "wallclock.h"
 #include "ARC4Encryptor.h"
 #include "ARC4Decryptor.h"
 #include "RequestGroupMan.h"
 #include "BtRegistry.h"
 #include "DownloadContext.h"
 #include "array_fun.h"
+#include "PendingHandshakeMan.h"
 
 namespace aria2 {
 
@@ -66,10 +71,13 @@ ReceiverMSEHandshakeCommand::ReceiverMSEHandshakeCommand
 {
   setTimeout(e->getOption()->getAsInt(PREF_PEER_CONNECTION_TIMEOUT));
   mseHandshake_->setWantRead(true);
+  e->getPendingHandshakeMan()->add(getPeer()->getIPAddress());
 }
 
 ReceiverMSEHandshakeCommand::~ReceiverMSEHandshakeCommand()
 {
+  getDownloadEngine()->getPendingHandshakeMan()->remove
+    (getPeer()->getIPAddress());
   delete mseHandshake_;
 }
 
@@ -95,7 +103,7 @@ bool ReceiverMSEHandshakeCommand::executeInternal()
         done = true;
         break;
       case MSEHandshake::HANDSHAKE_ENCRYPTED:
-        mseHandshake_->initEncryptionFacility(false);
+        initEncryptionFacility(false);
         sequence_ = RECEIVER_WAIT_KEY;
         break;
       case MSEHandshake::HANDSHAKE_LEGACY: {
@@ -184,6 +192,7 @@ bool ReceiverMSEHandshakeCommand::executeInternal()
     case RECEIVER_SEND_STEP2_PENDING:
       if(mseHandshake_->send()) {
         createCommand();
+        addHandshakeTime();
         return true;
       } else {
         done = true;
@@ -226,4 +235,20 @@ void ReceiverMSEHandshakeCommand::createCommand()
   getDownloadEngine()->addCommand(c);
 }
 
+void ReceiverMSEHandshakeCommand::initEncryptionFacility(bool initiator)
+{
+  handshakeTimer_ = global::wallclock;
+  mseHandshake_->initEncryptionFacility
+    (initiator, DHKeyPoolCommand::getDHKeyPool(getDownloadEngine())->pop());
+}
+
+void ReceiverMSEHandshakeCommand::addHandshakeTime()
+{
+  const SharedHandle<DHKeyPool>& pool = getDownloadEngine()->getDHKeyPool();
+  if(pool) {
+    pool->addHandshakeTime
+      (handshakeTimer_.differenceInMillis(global::wallclock));
+  }
+}
+
 } // namespace aria2
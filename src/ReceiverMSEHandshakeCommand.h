@@ -61,6 +61,12 @@ private:
   Seq sequence_;
 
   MSEHandshake* mseHandshake_;
+  // Time when MSE handshake started.
+  Timer handshakeTimer_;
+
+  void initEncryptionFacility(bool initiator);
+
+  void addHandshakeTime();
 
   void createCommand();
 protected:
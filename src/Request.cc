@@ -137,12 +137,16 @@ bool Request::redirectUri(const std::string& uri) {
   if(uri.find("://") == std::string::npos) {
     // rfc2616 requires absolute URI should be provided by Location header
     // field, but some servers don't obey this rule.
+    // Keep the authority of the current URI, which includes the port.
+    std::string authority =
+      currentUri_.substr(0, currentUri_.find_first_of
+                         ("/?", protocol_.size()+3));
     if(util::startsWith(uri, "/")) {
       // abosulute path
-      redirectedUri = strconcat(protocol_, "://", host_, uri);
+      redirectedUri = strconcat(authority, uri);
     } else {
       // relative path
-      redirectedUri = strconcat(protocol_, "://", host_, dir_, "/", uri);
+      redirectedUri = strconcat(authority, dir_, "/", uri);
     }
   } else {
     redirectedUri = uri;
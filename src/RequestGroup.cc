@@ -78,6 +78,7 @@
 #include "SimpleRandomizer.h"
 #include "Segment.h"
 #include "SocketRecvBuffer.h"
+#include "Metrics.h"
 #ifdef ENABLE_MESSAGE_DIGEST
 # include "CheckIntegrityCommand.h"
 # include "ChecksumCheckIntegrityEntry.h"
@@ -112,6 +113,7 @@
 # include "DHTEntryPointNameResolveCommand.h"
 # include "LongestSequencePieceSelector.h"
 # include "PriorityPieceSelector.h"
+# include "StreamPieceSelector.h"
 # include "bittorrent_helper.h"
 #endif // ENABLE_BITTORRENT
 #ifdef ENABLE_METALINK
@@ -621,6 +623,12 @@ void RequestGroup::initPieceStorage()
           ps->setPieceSelector(priSelector);
         }
       }
+      // StreamPieceSelector is used even if --bt-stream-window is 0,
+      // because the window can be changed by aria2.changeOption.
+      SharedHandle<StreamPieceSelector> streamSelector
+        (new StreamPieceSelector(ps->getPieceSelector(), option_.get(),
+                                 downloadContext_->getPieceLength()));
+      ps->setStreamPieceSelector(streamSelector);
     }
 #else // !ENABLE_BITTORRENT
     DefaultPieceStorage* ps =
@@ -940,11 +948,13 @@ void RequestGroup::decreaseStreamCommand()
 void RequestGroup::increaseStreamConnection()
 {
   ++numStreamConnection_;
+  global::metrics.increaseStreamConnections();
 }
 
 void RequestGroup::decreaseStreamConnection()
 {
   --numStreamConnection_;
+  global::metrics.decreaseStreamConnections();
 }
 
 unsigned int RequestGroup::getNumConnection() const
@@ -1296,6 +1306,13 @@ void RequestGroup::saveControlFile() const
   }
 }
 
+void RequestGroup::saveControlFileIfDirty() const
+{
+  if(saveControlFile_ && progressInfoFile_->isDirty()) {
+    progressInfoFile_->save();
+  }
+}
+
 void RequestGroup::removeControlFile() const
 {
   progressInfoFile_->removeFile();
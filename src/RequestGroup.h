@@ -493,6 +493,10 @@ public:
 
   void saveControlFile() const;
 
+  // Saves control file only if the download progress has changed
+  // since the last save.
+  void saveControlFileIfDirty() const;
+
   void removeControlFile() const;
 
   void enableSaveControlFile() { saveControlFile_ = true; }
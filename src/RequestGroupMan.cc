@@ -43,6 +43,7 @@
 #include <numeric>
 #include <algorithm>
 #include <utility>
+#include <cassert>
 
 #include "BtProgressInfoFile.h"
 #include "RecoverableException.h"
@@ -75,9 +76,34 @@
 #include "uri.h"
 #include "Triplet.h"
 #include "Signature.h"
+#include "UriListParser.h"
+#include "download_helper.h"
+#include "SimpleRandomizer.h"
 
 namespace aria2 {
 
+namespace {
+template<typename InputIterator>
+void addIndex(std::map<a2_gid_t, SharedHandle<RequestGroup> >& index,
+              InputIterator first, InputIterator last)
+{
+  for(; first != last; ++first) {
+    index[(*first)->getGID()] = *first;
+  }
+}
+} // namespace
+
+namespace {
+template<typename InputIterator>
+void removeIndex(std::map<a2_gid_t, SharedHandle<RequestGroup> >& index,
+                 InputIterator first, InputIterator last)
+{
+  for(; first != last; ++first) {
+    index.erase((*first)->getGID());
+  }
+}
+} // namespace
+
 RequestGroupMan::RequestGroupMan
 (const std::vector<SharedHandle<RequestGroup> >& requestGroups,
  unsigned int maxSimultaneousDownloads,
@@ -94,23 +120,44 @@ RequestGroupMan::RequestGroupMan
     queueCheck_(true),
     removedErrorResult_(0),
     removedLastErrorResult_(error_code::FINISHED),
-    maxDownloadResult_(option->getAsInt(PREF_MAX_DOWNLOAD_RESULT))
-{}
+    maxDownloadResult_(option->getAsInt(PREF_MAX_DOWNLOAD_RESULT)),
+    version_(0),
+    epoch_(SimpleRandomizer::getInstance()->getRandomNumber()),
+    changeLogStart_(0),
+    saveCursor_(0)
+{
+  addIndex(reservedGroupIndex_, requestGroups.begin(), requestGroups.end());
+  markChanged(requestGroups.begin(), requestGroups.end());
+}
 
 RequestGroupMan::~RequestGroupMan() {}
 
+void RequestGroupMan::recordChange(a2_gid_t gid, ChangeType type)
+{
+  Change change;
+  change.version = ++version_;
+  change.gid = gid;
+  change.type = type;
+  changes_.push_back(change);
+  if(changes_.size() > MAX_CHANGE_LOG) {
+    changeLogStart_ = changes_.front().version;
+    changes_.pop_front();
+  }
+}
+
 bool RequestGroupMan::downloadFinished()
 {
   if(rpc_) {
     return false;
   }
-  return requestGroups_.empty() && reservedGroups_.empty();
+  return requestGroups_.empty() && reservedGroups_.empty() && !uriListParser_;
 }
 
 void RequestGroupMan::addRequestGroup
 (const SharedHandle<RequestGroup>& group)
 {
   requestGroups_.push_back(group);
+  requestGroupIndex_[group->getGID()] = group;
 }
 
 void RequestGroupMan::addReservedGroup
@@ -120,6 +167,8 @@ void RequestGroupMan::addReservedGroup
     requestQueueCheck();
   }
   reservedGroups_.insert(reservedGroups_.end(), groups.begin(), groups.end());
+  addIndex(reservedGroupIndex_, groups.begin(), groups.end());
+  markChanged(groups.begin(), groups.end());
 }
 
 void RequestGroupMan::addReservedGroup
@@ -129,6 +178,8 @@ void RequestGroupMan::addReservedGroup
     requestQueueCheck();
   }
   reservedGroups_.push_back(group);
+  reservedGroupIndex_[group->getGID()] = group;
+  markChanged(group);
 }
 
 void RequestGroupMan::insertReservedGroup
@@ -137,9 +188,15 @@ void RequestGroupMan::insertReservedGroup
   if(reservedGroups_.empty()) {
     requestQueueCheck();
   }
+  bool atEnd = pos >= reservedGroups_.size();
   reservedGroups_.insert
     (reservedGroups_.begin()+std::min(reservedGroups_.size(), pos),
      groups.begin(), groups.end());
+  addIndex(reservedGroupIndex_, groups.begin(), groups.end());
+  markChanged(groups.begin(), groups.end());
+  if(!atEnd && !groups.empty()) {
+    recordChange(groups.front()->getGID(), CHANGE_ORDER);
+  }
 }
 
 void RequestGroupMan::insertReservedGroup
@@ -148,8 +205,14 @@ void RequestGroupMan::insertReservedGroup
   if(reservedGroups_.empty()) {
     requestQueueCheck();
   }
+  bool atEnd = pos >= reservedGroups_.size();
   reservedGroups_.insert
     (reservedGroups_.begin()+std::min(reservedGroups_.size(), pos), group);
+  reservedGroupIndex_[group->getGID()] = group;
+  markChanged(group);
+  if(!atEnd) {
+    recordChange(group->getGID(), CHANGE_ORDER);
+  }
 }
 
 size_t RequestGroupMan::countRequestGroup() const
@@ -179,35 +242,40 @@ Iterator findByGID(Iterator first, Iterator last, a2_gid_t gid)
 }
 } // namespace
 
-SharedHandle<RequestGroup>
-RequestGroupMan::findRequestGroup(a2_gid_t gid) const
+namespace {
+template<typename T>
+SharedHandle<T> findIndex
+(const std::map<a2_gid_t, SharedHandle<T> >& index, a2_gid_t gid)
 {
-  std::deque<SharedHandle<RequestGroup> >::const_iterator i =
-    findByGID(requestGroups_.begin(), requestGroups_.end(), gid);
-  if(i == requestGroups_.end()) {
-    return SharedHandle<RequestGroup>();
+  typename std::map<a2_gid_t, SharedHandle<T> >::const_iterator i =
+    index.find(gid);
+  if(i == index.end()) {
+    return SharedHandle<T>();
   } else {
-    return *i;
+    return (*i).second;
   }
 }
+} // namespace
+
+SharedHandle<RequestGroup>
+RequestGroupMan::findRequestGroup(a2_gid_t gid) const
+{
+  return findIndex(requestGroupIndex_, gid);
+}
 
 SharedHandle<RequestGroup>
 RequestGroupMan::findReservedGroup(a2_gid_t gid) const
 {
-  std::deque<SharedHandle<RequestGroup> >::const_iterator i =
-    findByGID(reservedGroups_.begin(), reservedGroups_.end(), gid);
-  if(i == reservedGroups_.end()) {
-    return SharedHandle<RequestGroup>();
-  } else {
-    return *i;
-  }
+  return findIndex(reservedGroupIndex_, gid);
 }
 
 size_t RequestGroupMan::changeReservedGroupPosition
 (a2_gid_t gid, int pos, HOW how)
 {
-  std::deque<SharedHandle<RequestGroup> >::iterator i =
-    findByGID(reservedGroups_.begin(), reservedGroups_.end(), gid);
+  std::deque<SharedHandle<RequestGroup> >::iterator i = reservedGroups_.end();
+  if(reservedGroupIndex_.count(gid)) {
+    i = findByGID(reservedGroups_.begin(), reservedGroups_.end(), gid);
+  }
   if(i == reservedGroups_.end()) {
     throw DL_ABORT_EX
       (fmt("GID#%s not found in the waiting queue.",
@@ -244,19 +312,21 @@ size_t RequestGroupMan::changeReservedGroupPosition
   } else {
     std::rotate(reservedGroups_.begin()+pos, i, i+1);
   }
+  recordChange(gid, CHANGE_ORDER);
   return pos;
 }
 
 bool RequestGroupMan::removeReservedGroup(a2_gid_t gid)
 {
-  std::deque<SharedHandle<RequestGroup> >::iterator i =
-    findByGID(reservedGroups_.begin(), reservedGroups_.end(), gid);
-  if(i == reservedGroups_.end()) {
+  if(!reservedGroupIndex_.erase(gid)) {
     return false;
-  } else {
-    reservedGroups_.erase(i);
-    return true;
   }
+  std::deque<SharedHandle<RequestGroup> >::iterator i =
+    findByGID(reservedGroups_.begin(), reservedGroups_.end(), gid);
+  assert(i != reservedGroups_.end());
+  reservedGroups_.erase(i);
+  recordChange(gid, CHANGE_REMOVED);
+  return true;
 }
 
 namespace {
@@ -284,7 +354,6 @@ class ProcessStoppedRequestGroup {
 private:
   DownloadEngine* e_;
   std::deque<SharedHandle<DownloadResult> >& downloadResults_;
-  std::deque<SharedHandle<RequestGroup> >& reservedGroups_;
   Logger* logger_;
 
   void saveSignature(const SharedHandle<RequestGroup>& group)
@@ -305,11 +374,9 @@ private:
 public:
   ProcessStoppedRequestGroup
   (DownloadEngine* e,
-   std::deque<SharedHandle<DownloadResult> >& downloadResults,
-   std::deque<SharedHandle<RequestGroup> >& reservedGroups)
+   std::deque<SharedHandle<DownloadResult> >& downloadResults)
     : e_(e),
-      downloadResults_(downloadResults),
-      reservedGroups_(reservedGroups)
+      downloadResults_(downloadResults)
   {}
 
   void operator()(const SharedHandle<RequestGroup>& group)
@@ -358,7 +425,7 @@ public:
         A2_LOG_ERROR_EX(EX_EXCEPTION_CAUGHT, ex);
       }
       if(group->isPauseRequested()) {
-        reservedGroups_.push_front(group);
+        e_->getRequestGroupMan()->insertReservedGroup(0, group);
         group->releaseRuntimeResource(e_);
         group->setForceHaltRequested(false);
         util::executeHookByOptName
@@ -443,12 +510,13 @@ void RequestGroupMan::removeStoppedGroup(DownloadEngine* e)
 
   std::for_each(requestGroups_.begin(), requestGroups_.end(),
                 ProcessStoppedRequestGroup
-                (e, downloadResults_, reservedGroups_));
+                (e, downloadResults_));
   std::deque<SharedHandle<RequestGroup> >::iterator i =
     std::remove_if(requestGroups_.begin(),
                    requestGroups_.end(),
                    FindStoppedRequestGroup());
   if(i != requestGroups_.end()) {
+    removeIndex(requestGroupIndex_, i, requestGroups_.end());
     requestGroups_.erase(i, requestGroups_.end());
   }
 
@@ -485,6 +553,16 @@ void createInitialCommand(const SharedHandle<RequestGroup>& requestGroup,
 }
 } // namespace
 
+void RequestGroupMan::restoreReservedGroups
+(const std::vector<SharedHandle<RequestGroup> >& groups)
+{
+  if(!groups.empty()) {
+    reservedGroups_.insert(reservedGroups_.begin(),
+                           groups.begin(), groups.end());
+    addIndex(reservedGroupIndex_, groups.begin(), groups.end());
+  }
+}
+
 void RequestGroupMan::fillRequestGroupFromReserver(DownloadEngine* e)
 {
   removeStoppedGroup(e);
@@ -494,9 +572,34 @@ void RequestGroupMan::fillRequestGroupFromReserver(DownloadEngine* e)
   std::vector<SharedHandle<RequestGroup> > temp;
   unsigned int count = 0;
   size_t num = maxSimultaneousDownloads_-requestGroups_.size();
-  while(count < num && !reservedGroups_.empty()) {
+  while(count < num && (uriListParser_ || !reservedGroups_.empty())) {
+    if(uriListParser_ && reservedGroups_.empty()) {
+      std::vector<SharedHandle<RequestGroup> > groups;
+      bool ok;
+      try {
+        ok = createRequestGroupFromUriListParser(groups, option_,
+                                                 uriListParser_.get());
+      } catch(...) {
+        // Put back paused and dependency-blocked groups held in temp,
+        // or they would be lost.
+        restoreReservedGroups(temp);
+        throw;
+      }
+      if(ok) {
+        reservedGroups_.insert(reservedGroups_.end(),
+                               groups.begin(), groups.end());
+        addIndex(reservedGroupIndex_, groups.begin(), groups.end());
+        markChanged(groups.begin(), groups.end());
+      } else {
+        uriListParser_.reset();
+        if(reservedGroups_.empty()) {
+          break;
+        }
+      }
+    }
     SharedHandle<RequestGroup> groupToAdd = reservedGroups_.front();
     reservedGroups_.pop_front();
+    reservedGroupIndex_.erase(groupToAdd->getGID());
     std::vector<Command*> commands;
     try {
       if(groupToAdd->isPauseRequested()||!groupToAdd->isDependencyResolved()) {
@@ -513,6 +616,8 @@ void RequestGroupMan::fillRequestGroupFromReserver(DownloadEngine* e)
         requestQueueCheck();
       }
       requestGroups_.push_back(groupToAdd);
+      requestGroupIndex_[groupToAdd->getGID()] = groupToAdd;
+      recordChange(groupToAdd->getGID(), CHANGE_REMOVED);
       ++count;
       e->addCommand(commands);
       commands.clear();
@@ -526,14 +631,14 @@ void RequestGroupMan::fillRequestGroupFromReserver(DownloadEngine* e)
       // We add groupToAdd to e in order to it is processed in
       // removeStoppedGroup().
       requestGroups_.push_back(groupToAdd);
+      requestGroupIndex_[groupToAdd->getGID()] = groupToAdd;
+      recordChange(groupToAdd->getGID(), CHANGE_REMOVED);
       requestQueueCheck();
     }
     util::executeHookByOptName
       (groupToAdd, e->getOption(), PREF_ON_DOWNLOAD_START);
   }
-  if(!temp.empty()) {
-    reservedGroups_.insert(reservedGroups_.begin(), temp.begin(), temp.end());
-  }
+  restoreReservedGroups(temp);
   if(count > 0) {
     e->setNoWait(true);
     e->setRefreshInterval(0);
@@ -541,20 +646,42 @@ void RequestGroupMan::fillRequestGroupFromReserver(DownloadEngine* e)
   }
 }
 
+void RequestGroupMan::setUriListParser
+(const SharedHandle<UriListParser>& uriListParser)
+{
+  uriListParser_ = uriListParser;
+}
+
+namespace {
+void saveRequestGroup(const SharedHandle<RequestGroup>& group)
+{
+  if(group->allDownloadFinished() &&
+     !group->getDownloadContext()->isChecksumVerificationNeeded()) {
+    group->removeControlFile();
+  } else {
+    try {
+      group->saveControlFileIfDirty();
+    } catch(RecoverableException& e) {
+      A2_LOG_ERROR_EX(EX_EXCEPTION_CAUGHT, e);
+    }
+  }
+}
+} // namespace
+
 void RequestGroupMan::save()
 {
-  for(std::deque<SharedHandle<RequestGroup> >::const_iterator itr =
-        requestGroups_.begin(), eoi = requestGroups_.end(); itr != eoi; ++itr) {
-    if((*itr)->allDownloadFinished() && 
-       !(*itr)->getDownloadContext()->isChecksumVerificationNeeded()) {
-      (*itr)->removeControlFile();
-    } else {
-      try {
-        (*itr)->saveControlFile();
-      } catch(RecoverableException& e) {
-        A2_LOG_ERROR_EX(EX_EXCEPTION_CAUGHT, e);
-      }
+  std::for_each(requestGroups_.begin(), requestGroups_.end(),
+                saveRequestGroup);
+}
+
+void RequestGroupMan::saveNext(size_t num)
+{
+  num = std::min(num, requestGroups_.size());
+  for(size_t i = 0; i < num; ++i) {
+    if(saveCursor_ >= requestGroups_.size()) {
+      saveCursor_ = 0;
     }
+    saveRequestGroup(requestGroups_[saveCursor_++]);
   }
 }
 
@@ -739,21 +866,19 @@ TransferStat RequestGroupMan::calculateStat()
 SharedHandle<DownloadResult>
 RequestGroupMan::findDownloadResult(a2_gid_t gid) const
 {
-  for(std::deque<SharedHandle<DownloadResult> >::const_iterator i =
-        downloadResults_.begin(), eoi = downloadResults_.end(); i != eoi; ++i) {
-    if((*i)->gid == gid) {
-      return *i;
-    }
-  }
-  return SharedHandle<DownloadResult>();
+  return findIndex(downloadResultIndex_, gid);
 }
 
 bool RequestGroupMan::removeDownloadResult(a2_gid_t gid)
 {
+  if(!downloadResultIndex_.erase(gid)) {
+    return false;
+  }
   for(std::deque<SharedHandle<DownloadResult> >::iterator i =
         downloadResults_.begin(), eoi = downloadResults_.end(); i != eoi; ++i) {
     if((*i)->gid == gid) {
       downloadResults_.erase(i);
+      recordChange(gid, CHANGE_REMOVED);
       return true;
     }
   }
@@ -771,8 +896,10 @@ void RequestGroupMan::addDownloadResult(const SharedHandle<DownloadResult>& dr)
           removedLastErrorResult_ = (*i)->result;
           ++removedErrorResult_;
         }
+        recordChange((*i)->gid, CHANGE_REMOVED);
       }
       downloadResults_.clear();
+      downloadResultIndex_.clear();
     }
     if(dr->belongsTo == 0 && dr->result != error_code::FINISHED) {
       removedLastErrorResult_ = dr->result;
@@ -789,16 +916,26 @@ void RequestGroupMan::addDownloadResult(const SharedHandle<DownloadResult>& dr)
           removedLastErrorResult_ = (*i)->result;
           ++removedErrorResult_;
         }
+        downloadResultIndex_.erase((*i)->gid);
+        recordChange((*i)->gid, CHANGE_REMOVED);
       }        
       downloadResults_.erase(downloadResults_.begin(), last);
     }
     downloadResults_.push_back(dr);
+    downloadResultIndex_[dr->gid] = dr;
+    recordChange(dr->gid, CHANGE_STOPPED);
   }
 }
 
 void RequestGroupMan::purgeDownloadResult()
 {
+  for(std::deque<SharedHandle<DownloadResult> >::const_iterator i =
+        downloadResults_.begin(), eoi = downloadResults_.end(); i != eoi;
+      ++i) {
+    recordChange((*i)->gid, CHANGE_REMOVED);
+  }
   downloadResults_.clear();
+  downloadResultIndex_.clear();
 }
 
 SharedHandle<ServerStat>
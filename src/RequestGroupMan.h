@@ -39,6 +39,7 @@
 
 #include <string>
 #include <deque>
+#include <map>
 #include <iosfwd>
 #include <vector>
 
@@ -55,12 +56,39 @@ struct DownloadResult;
 class ServerStatMan;
 class ServerStat;
 class Option;
+class UriListParser;
 
 class RequestGroupMan {
+public:
+  enum ChangeType {
+    // A download is added to or changed in reservedGroups_.
+    CHANGE_WAITING,
+    // A download result is added to downloadResults_.
+    CHANGE_STOPPED,
+    // A download is removed from reservedGroups_ or downloadResults_.
+    CHANGE_REMOVED,
+    // The order of reservedGroups_ is changed by moving or inserting
+    // a download.
+    CHANGE_ORDER
+  };
+
+  struct Change {
+    int64_t version;
+    a2_gid_t gid;
+    ChangeType type;
+  };
 private:
   std::deque<SharedHandle<RequestGroup> > requestGroups_;
   std::deque<SharedHandle<RequestGroup> > reservedGroups_;
   std::deque<SharedHandle<DownloadResult> > downloadResults_;
+  // Indexes of requestGroups_, reservedGroups_ and downloadResults_
+  // keyed by GID. They are updated along with the corresponding
+  // queues, so that findRequestGroup(), findReservedGroup() and
+  // findDownloadResult() do not have to scan the queues, which may
+  // contain tens of thousands entries when RPC is used.
+  std::map<a2_gid_t, SharedHandle<RequestGroup> > requestGroupIndex_;
+  std::map<a2_gid_t, SharedHandle<RequestGroup> > reservedGroupIndex_;
+  std::map<a2_gid_t, SharedHandle<DownloadResult> > downloadResultIndex_;
   unsigned int maxSimultaneousDownloads_;
 
   const Option* option_;
@@ -85,12 +113,54 @@ private:
 
   size_t maxDownloadResult_;
 
+  // UriListParser for deferred input.
+  SharedHandle<UriListParser> uriListParser_;
+
+  // Incremented whenever reservedGroups_ or downloadResults_ is
+  // modified. Each increment is recorded in changes_.
+  int64_t version_;
+
+  // Random number identifying this instance. version_ starts from 0
+  // in every process, so a version is only meaningful together with
+  // the epoch it was issued in.
+  int64_t epoch_;
+
+  // Log of the latest changes. The version of changes_[i] is
+  // changeLogStart_+1+i.
+  std::deque<Change> changes_;
+
+  // The version up to which the changes have been dropped from
+  // changes_.
+  int64_t changeLogStart_;
+
+  // The maximum number of entries in changes_.
+  static const size_t MAX_CHANGE_LOG = 4096;
+
+  // Index of the next RequestGroup in requestGroups_ to be saved by
+  // saveNext().
+  size_t saveCursor_;
+
   std::string
   formatDownloadResult(const std::string& status,
                        const SharedHandle<DownloadResult>& downloadResult) const;
 
   void configureRequestGroup
   (const SharedHandle<RequestGroup>& requestGroup) const;
+
+  // Inserts groups at the front of reservedGroups_.
+  void restoreReservedGroups
+  (const std::vector<SharedHandle<RequestGroup> >& groups);
+
+  // Increments version_ and records the change in changes_.
+  void recordChange(a2_gid_t gid, ChangeType type);
+
+  template<typename InputIterator>
+  void markChanged(InputIterator first, InputIterator last)
+  {
+    for(; first != last; ++first) {
+      markChanged(*first);
+    }
+  }
 public:
   RequestGroupMan(const std::vector<SharedHandle<RequestGroup> >& requestGroups,
                   unsigned int maxSimultaneousDownloads,
@@ -100,8 +170,15 @@ public:
 
   bool downloadFinished();
 
+  // Saves control files of all RequestGroups whose progress has
+  // changed since the last save.
   void save();
 
+  // Saves control files of at most num RequestGroups, starting from
+  // where the previous call left off. This is used to spread the
+  // saves across auto save interval.
+  void saveNext(size_t num);
+
   void closeFile();
   
   void halt();
@@ -291,6 +368,56 @@ public:
 
   // Returns currently used hosts and its use count.
   void getUsedHosts(std::vector<std::pair<size_t, std::string> >& usedHosts);
+
+  // Returns the version number of reservedGroups_ and
+  // downloadResults_. The returned value is increased whenever an
+  // item is added, removed, moved or changed in these queues.
+  int64_t getVersion() const
+  {
+    return version_;
+  }
+
+  // Returns the epoch of the versions returned by getVersion(). It
+  // differs between instances, for example before and after restart.
+  int64_t getEpoch() const
+  {
+    return epoch_;
+  }
+
+  // Tells that group is changed. Call this function when the
+  // information of a RequestGroup in reservedGroups_ is changed
+  // outside of this object. Nothing is recorded if group is not in
+  // reservedGroups_, for example if it is active.
+  void markChanged(const SharedHandle<RequestGroup>& group)
+  {
+    if(reservedGroupIndex_.count(group->getGID())) {
+      recordChange(group->getGID(), CHANGE_WAITING);
+    }
+  }
+
+  // Returns true if all changes made after version are still in the
+  // change log.
+  bool changeLogAvailable(int64_t version) const
+  {
+    return changeLogStart_ <= version && version <= version_;
+  }
+
+  // Returns the iterator to the first change made after version.
+  // changeLogAvailable(version) must be true.
+  std::deque<Change>::const_iterator getChangesSince(int64_t version) const
+  {
+    return changes_.begin()+(version-changeLogStart_);
+  }
+
+  std::deque<Change>::const_iterator getChangesEnd() const
+  {
+    return changes_.end();
+  }
+
+  // Sets UriListParser for deferred input. RequestGroups are created
+  // from uriListParser only when reserved queue becomes empty in
+  // fillRequestGroupFromReserver().
+  void setUriListParser(const SharedHandle<UriListParser>& uriListParser);
 };
 
 typedef SharedHandle<RequestGroupMan> RequestGroupManHandle;
@@ -121,6 +121,11 @@ public:
 
   bool isTimeout(time_t timeoutSec) const;
 
+  const Timer& getDispatchedTime() const
+  {
+    return dispatchedTime_;
+  }
+
   size_t getIndex() const { return index_; }
   void setIndex(size_t index) { index_ = index; }
 
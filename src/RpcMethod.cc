@@ -155,6 +155,8 @@ const std::set<std::string>& listChangeableOptions()
   static const std::string OPTIONS[] = {
     PREF_BT_MAX_PEERS,
     PREF_BT_REQUEST_PEER_SPEED_LIMIT,
+    PREF_BT_STREAM_POSITION,
+    PREF_BT_STREAM_WINDOW,
     PREF_MAX_DOWNLOAD_LIMIT,
     PREF_MAX_UPLOAD_LIMIT
   };
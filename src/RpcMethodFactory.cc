@@ -93,6 +93,8 @@ RpcMethodFactory::create(const std::string& methodName)
     return SharedHandle<RpcMethod>(new TellWaitingRpcMethod());
   } else if(methodName == TellStoppedRpcMethod::getMethodName()) {
     return SharedHandle<RpcMethod>(new TellStoppedRpcMethod());
+  } else if(methodName == TellChangedRpcMethod::getMethodName()) {
+    return SharedHandle<RpcMethod>(new TellChangedRpcMethod());
   } else if(methodName == GetOptionRpcMethod::getMethodName()) {
     return SharedHandle<RpcMethod>(new GetOptionRpcMethod());
   } else if(methodName == ChangeUriRpcMethod::getMethodName()) {
@@ -36,6 +36,7 @@
 
 #include <cassert>
 #include <algorithm>
+#include <set>
 
 #include "Logger.h"
 #include "LogFactory.h"
@@ -138,6 +139,12 @@ const std::string KEY_COMMENT = "comment";
 const std::string KEY_CREATION_DATE = "creationDate";
 const std::string KEY_MODE = "mode";
 const std::string KEY_SERVERS = "servers";
+const std::string KEY_WAITING = "waiting";
+const std::string KEY_WAITING_GIDS = "waitingGids";
+const std::string KEY_STOPPED = "stopped";
+const std::string KEY_REMOVED_GIDS = "removedGids";
+const std::string KEY_FULL = "full";
+const std::string KEY_EPOCH = "epoch";
 } // namespace
 
 namespace {
@@ -453,6 +460,9 @@ SharedHandle<ValueBase> pauseDownload
     group = e->getRequestGroupMan()->findReservedGroup(gid);
   }
   if(group && pauseRequestGroup(group, reserved, forcePause)) {
+    if(reserved) {
+      e->getRequestGroupMan()->markChanged(group);
+    }
     e->setRefreshInterval(0);
     return createGIDResponse(gid);
   } else {
@@ -478,10 +488,13 @@ SharedHandle<ValueBase> ForcePauseRpcMethod::process
 namespace {
 template<typename InputIterator>
 void pauseRequestGroups
-(InputIterator first, InputIterator last, bool reserved, bool forcePause)
+(InputIterator first, InputIterator last, bool reserved, bool forcePause,
+ RequestGroupMan* rgman)
 {
   for(; first != last; ++first) {
-    pauseRequestGroup(*first, reserved, forcePause);
+    if(pauseRequestGroup(*first, reserved, forcePause) && reserved) {
+      rgman->markChanged(*first);
+    }
   }
 }
 } // namespace
@@ -492,11 +505,12 @@ SharedHandle<ValueBase> pauseAllDownloads
 {
   const std::deque<SharedHandle<RequestGroup> >& groups =
     e->getRequestGroupMan()->getRequestGroups();
-  pauseRequestGroups(groups.begin(), groups.end(), false, forcePause);
+  pauseRequestGroups(groups.begin(), groups.end(), false, forcePause,
+                     e->getRequestGroupMan().get());
   const std::deque<SharedHandle<RequestGroup> >& reservedGroups =
     e->getRequestGroupMan()->getReservedGroups();
   pauseRequestGroups(reservedGroups.begin(), reservedGroups.end(),
-                     true, forcePause);
+                     true, forcePause, e->getRequestGroupMan().get());
   return VLB_OK;
 }
 } // namespace
@@ -525,6 +539,7 @@ SharedHandle<ValueBase> UnpauseRpcMethod::process
            util::itos(gid).c_str()));
   } else {
     group->setPauseRequested(false);
+    e->getRequestGroupMan()->markChanged(group);
     e->getRequestGroupMan()->requestQueueCheck();    
   }
   return createGIDResponse(gid);
@@ -535,9 +550,13 @@ SharedHandle<ValueBase> UnpauseAllRpcMethod::process
 {
   const std::deque<SharedHandle<RequestGroup> >& groups =
     e->getRequestGroupMan()->getReservedGroups();
-  std::for_each(groups.begin(), groups.end(),
-                std::bind2nd(mem_fun_sh(&RequestGroup::setPauseRequested),
-                             false));
+  for(std::deque<SharedHandle<RequestGroup> >::const_iterator i =
+        groups.begin(), eoi = groups.end(); i != eoi; ++i) {
+    if((*i)->isPauseRequested()) {
+      (*i)->setPauseRequested(false);
+      e->getRequestGroupMan()->markChanged(*i);
+    }
+  }
   e->getRequestGroupMan()->requestQueueCheck();    
   return VLB_OK;
 }
@@ -1008,20 +1027,31 @@ TellWaitingRpcMethod::getItems(DownloadEngine* e) const
   return e->getRequestGroupMan()->getReservedGroups();
 }
 
-void TellWaitingRpcMethod::createEntry
+namespace {
+void gatherWaitingDownload
 (const SharedHandle<Dict>& entryDict,
- const SharedHandle<RequestGroup>& item,
+ const SharedHandle<RequestGroup>& group,
  DownloadEngine* e,
- const std::vector<std::string>& keys) const
+ const std::vector<std::string>& keys)
 {
   if(requested_key(keys, KEY_STATUS)) {
-    if(item->isPauseRequested()) {
+    if(group->isPauseRequested()) {
       entryDict->put(KEY_STATUS, VLB_PAUSED);
     } else {
       entryDict->put(KEY_STATUS, VLB_WAITING);
     }
   }
-  gatherProgress(entryDict, item, e, keys);
+  gatherProgress(entryDict, group, e, keys);
+}
+} // namespace
+
+void TellWaitingRpcMethod::createEntry
+(const SharedHandle<Dict>& entryDict,
+ const SharedHandle<RequestGroup>& item,
+ DownloadEngine* e,
+ const std::vector<std::string>& keys) const
+{
+  gatherWaitingDownload(entryDict, item, e, keys);
 }
 
 const std::deque<SharedHandle<DownloadResult> >&
@@ -1039,6 +1069,113 @@ void TellStoppedRpcMethod::createEntry
   gatherStoppedDownload(entryDict, item, keys);
 }
 
+SharedHandle<ValueBase> TellChangedRpcMethod::process
+(const RpcRequest& req, DownloadEngine* e)
+{
+  const Integer* versionParam = req.getIntegerParam(0);
+  if(!versionParam) {
+    throw DL_ABORT_EX("Invalid argument. Specify version in integer.");
+  }
+  const Integer* epochParam = req.getIntegerParam(1);
+  const List* keysParam = req.getListParam(2);
+  std::vector<std::string> keys;
+  toStringList(std::back_inserter(keys), keysParam);
+  const SharedHandle<RequestGroupMan>& rgman = e->getRequestGroupMan();
+  int64_t version = versionParam->i();
+  // Versions start from 0 in every instance, so a version issued
+  // before restart is only recognized by its epoch.
+  bool sameEpoch = epochParam && epochParam->i() == rgman->getEpoch();
+  SharedHandle<Dict> res = Dict::g();
+  res->put(KEY_VERSION, Integer::g(rgman->getVersion()));
+  res->put(KEY_EPOCH, Integer::g(rgman->getEpoch()));
+  if(sameEpoch && version == rgman->getVersion()) {
+    return res;
+  }
+  SharedHandle<List> waiting = List::g();
+  SharedHandle<List> stopped = List::g();
+  if(version == 0 || !sameEpoch || !rgman->changeLogAvailable(version)) {
+    // The client has no view, or its version is unknown to us, for
+    // example after restart. Send everything.
+    const std::deque<SharedHandle<RequestGroup> >& groups =
+      rgman->getReservedGroups();
+    for(std::deque<SharedHandle<RequestGroup> >::const_iterator i =
+          groups.begin(), eoi = groups.end(); i != eoi; ++i) {
+      SharedHandle<Dict> entryDict = Dict::g();
+      gatherWaitingDownload(entryDict, *i, e, keys);
+      waiting->append(entryDict);
+    }
+    const std::deque<SharedHandle<DownloadResult> >& results =
+      rgman->getDownloadResults();
+    for(std::deque<SharedHandle<DownloadResult> >::const_iterator i =
+          results.begin(), eoi = results.end(); i != eoi; ++i) {
+      SharedHandle<Dict> entryDict = Dict::g();
+      gatherStoppedDownload(entryDict, *i, keys);
+      stopped->append(entryDict);
+    }
+    res->put(KEY_FULL, VLB_TRUE);
+    res->put(KEY_WAITING, waiting);
+    res->put(KEY_STOPPED, stopped);
+    return res;
+  }
+  // Walk the change log backwards, so that only the last change of
+  // each download is taken.
+  std::vector<std::pair<a2_gid_t, RequestGroupMan::ChangeType> > changes;
+  std::set<a2_gid_t> seen;
+  bool orderChanged = false;
+  std::deque<RequestGroupMan::Change>::const_iterator first =
+    rgman->getChangesSince(version);
+  for(std::deque<RequestGroupMan::Change>::const_iterator i =
+        rgman->getChangesEnd(); i != first;) {
+    --i;
+    if((*i).type == RequestGroupMan::CHANGE_ORDER) {
+      orderChanged = true;
+    } else if(seen.insert((*i).gid).second) {
+      changes.push_back(std::make_pair((*i).gid, (*i).type));
+    }
+  }
+  SharedHandle<List> removedGids = List::g();
+  for(std::vector<std::pair<a2_gid_t, RequestGroupMan::ChangeType> >::
+        const_reverse_iterator i = changes.rbegin(), eoi = changes.rend();
+      i != eoi; ++i) {
+    // A download which has left the queue since its last change is
+    // reported as removed.
+    if((*i).second == RequestGroupMan::CHANGE_WAITING) {
+      SharedHandle<RequestGroup> group =
+        rgman->findReservedGroup((*i).first);
+      if(group) {
+        SharedHandle<Dict> entryDict = Dict::g();
+        gatherWaitingDownload(entryDict, group, e, keys);
+        waiting->append(entryDict);
+        continue;
+      }
+    } else if((*i).second == RequestGroupMan::CHANGE_STOPPED) {
+      SharedHandle<DownloadResult> result =
+        rgman->findDownloadResult((*i).first);
+      if(result) {
+        SharedHandle<Dict> entryDict = Dict::g();
+        gatherStoppedDownload(entryDict, result, keys);
+        stopped->append(entryDict);
+        continue;
+      }
+    }
+    removedGids->append(util::itos((*i).first));
+  }
+  res->put(KEY_WAITING, waiting);
+  res->put(KEY_STOPPED, stopped);
+  res->put(KEY_REMOVED_GIDS, removedGids);
+  if(orderChanged) {
+    const std::deque<SharedHandle<RequestGroup> >& groups =
+      rgman->getReservedGroups();
+    SharedHandle<List> waitingGids = List::g();
+    for(std::deque<SharedHandle<RequestGroup> >::const_iterator i =
+          groups.begin(), eoi = groups.end(); i != eoi; ++i) {
+      waitingGids->append(util::itos((*i)->getGID()));
+    }
+    res->put(KEY_WAITING_GIDS, waitingGids);
+  }
+  return res;
+}
+
 SharedHandle<ValueBase> PurgeDownloadResultRpcMethod::process
 (const RpcRequest& req, DownloadEngine* e)
 {
@@ -1090,6 +1227,7 @@ SharedHandle<ValueBase> ChangeOptionRpcMethod::process
       }
     }
 #endif // ENABLE_BITTORRENT
+    e->getRequestGroupMan()->markChanged(group);
   }
   return VLB_OK;
 }
@@ -1333,6 +1471,9 @@ SharedHandle<ValueBase> ChangeUriRpcMethod::process
     e->addCommand(commands);
     group->getSegmentMan()->recognizeSegmentFor(s);
   }
+  if(delcount || addcount) {
+    e->getRequestGroupMan()->markChanged(group);
+  }
   SharedHandle<List> res = List::g();
   res->append(Integer::g(delcount));
   res->append(Integer::g(addcount));
@@ -422,6 +422,21 @@ public:
   }
 };
 
+// Returns waiting and stopped downloads which have been changed
+// since the version given by client. See
+// RequestGroupMan::getVersion().
+class TellChangedRpcMethod:public RpcMethod {
+protected:
+  virtual SharedHandle<ValueBase> process
+  (const RpcRequest& req, DownloadEngine* e);
+public:
+  static const std::string& getMethodName()
+  {
+    static std::string methodName = "aria2.tellChanged";
+    return methodName;
+  }
+};
+
 class ChangeOptionRpcMethod:public RpcMethod {
 protected:
   virtual SharedHandle<ValueBase> process
@@ -38,6 +38,7 @@
 #include "common.h"
 
 #include <deque>
+#include <algorithm>
 
 #include "SharedHandle.h"
 
@@ -47,21 +48,48 @@ template<typename T>
 class SequentialPicker {
 private:
   std::deque<SharedHandle<T> > entries_;
-  SharedHandle<T> pickedEntry_;
+  std::deque<SharedHandle<T> > pickedEntries_;
+  // The maximum number of entries which can be picked at the same
+  // time.
+  size_t maxPicked_;
 public:
+  SequentialPicker():maxPicked_(1) {}
+
   bool isPicked() const
   {
-    return pickedEntry_;
+    return !pickedEntries_.empty();
   }
 
+  // Returns the entry picked first among the entries currently
+  // picked.
   SharedHandle<T> getPickedEntry() const
   {
-    return pickedEntry_;
+    if(pickedEntries_.empty()) {
+      return SharedHandle<T>();
+    } else {
+      return pickedEntries_.front();
+    }
+  }
+
+  const std::deque<SharedHandle<T> >& getPickedEntries() const
+  {
+    return pickedEntries_;
   }
 
-  void dropPickedEntry()
+  size_t countPickedEntry() const
   {
-    pickedEntry_.reset();
+    return pickedEntries_.size();
+  }
+
+  void dropPickedEntry(const SharedHandle<T>& entry)
+  {
+    for(typename std::deque<SharedHandle<T> >::iterator i =
+          pickedEntries_.begin(), eoi = pickedEntries_.end(); i != eoi; ++i) {
+      if((*i).get() == entry.get()) {
+        pickedEntries_.erase(i);
+        break;
+      }
+    }
   }
 
   bool hasNext() const
@@ -69,17 +97,34 @@ public:
     return !entries_.empty();
   }
 
+  // Returns true if there is an entry in the queue and the number of
+  // picked entries is less than the limit.
+  bool canPickNext() const
+  {
+    return hasNext() && pickedEntries_.size() < maxPicked_;
+  }
+
   SharedHandle<T> pickNext()
   {
     SharedHandle<T> r;
     if(hasNext()) {
       r = entries_.front();
       entries_.pop_front();
-      pickedEntry_ = r;
+      pickedEntries_.push_back(r);
     }
     return r;
   }
 
+  void setMaxPicked(size_t maxPicked)
+  {
+    maxPicked_ = maxPicked;
+  }
+
+  size_t getMaxPicked() const
+  {
+    return maxPicked_;
+  }
+
   void pushEntry(const SharedHandle<T>& entry)
   {
     entries_.push_back(entry);
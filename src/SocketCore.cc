@@ -349,6 +349,24 @@ SocketCore* SocketCore::acceptConnection() const
   return new SocketCore(fd, sockType_);
 }
 
+SocketCore* SocketCore::tryAcceptConnection() const
+{
+  struct sockaddr_storage sockaddr;
+  socklen_t len = sizeof(sockaddr);
+  sock_t fd;
+  while((fd = accept(sockfd_, reinterpret_cast<struct sockaddr*>(&sockaddr),
+                     &len)) == (sock_t) -1 &&
+        SOCKET_ERRNO == A2_EINTR);
+  int errNum = SOCKET_ERRNO;
+  if(fd == (sock_t) -1) {
+    if(A2_WOULDBLOCK(errNum)) {
+      return 0;
+    }
+    throw DL_ABORT_EX(fmt(EX_SOCKET_ACCEPT, errorMsg(errNum).c_str()));
+  }
+  return new SocketCore(fd, sockType_);
+}
+
 void SocketCore::getAddrInfo(std::pair<std::string, uint16_t>& addrinfo) const
 {
   struct sockaddr_storage sockaddr;
@@ -180,6 +180,12 @@ public:
    */
   SocketCore* acceptConnection() const;
 
+  /**
+   * Same as acceptConnection() but returns 0 if there is no pending
+   * connection. Use this for the socket in non-blocking mode.
+   */
+  SocketCore* tryAcceptConnection() const;
+
   /**
    * Connects to the server named host and the destination port is port.
    * This method makes socket non-blocking mode.
@@ -0,0 +1,195 @@
+/* <!-- copyright */
+/*
+ * aria2 - The high speed download utility
+ *
+ * Copyright (C) 2011 Tatsuhiro Tsujikawa
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.  If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so.  If you
+ * do not wish to do so, delete this exception statement from your
+ * version.  If you delete this exception statement from all source
+ * files in the program, then also delete it here.
+ */
+/* copyright --> */
+#include "SocketPool.h"
+#include "SocketCore.h"
+#include "LogFactory.h"
+#include "Logger.h"
+#include "wallclock.h"
+#include "RecoverableException.h"
+#include "fmt.h"
+
+namespace aria2 {
+
+SocketPool::Entry::Entry
+(const SharedHandle<SocketCore>& socket,
+ const std::map<std::string, std::string>& options)
+  : socket_(socket),
+    options_(options)
+{}
+
+SocketPool::Entry::~Entry() {}
+
+SocketPool::SocketPool(size_t maxSize, size_t maxSizePerKey)
+  : maxSize_(maxSize),
+    maxSizePerKey_(maxSizePerKey),
+    numHit_(0),
+    numMiss_(0),
+    numEvicted_(0),
+    numTimedOut_(0),
+    numClosedByPeer_(0)
+{}
+
+SocketPool::~SocketPool() {}
+
+void SocketPool::erase(EntryList::iterator itr)
+{
+  keyIndex_.erase((*itr).getKeyItr());
+  deadlineIndex_.erase((*itr).getDeadlineItr());
+  entries_.erase(itr);
+}
+
+void SocketPool::add
+(const std::string& key,
+ const SharedHandle<SocketCore>& socket,
+ const std::map<std::string, std::string>& options,
+ time_t timeout)
+{
+  if(maxSize_ == 0 || maxSizePerKey_ == 0) {
+    return;
+  }
+  if(keyIndex_.count(key) >= maxSizePerKey_) {
+    // The entries with same key are stored in insertion order, so
+    // the first one is the oldest.
+    A2_LOG_DEBUG(fmt("SocketPool: per-key limit reached for %s."
+                     " Evicting oldest entry.", key.c_str()));
+    erase((*keyIndex_.find(key)).second);
+    ++numEvicted_;
+  }
+  if(entries_.size() >= maxSize_) {
+    A2_LOG_DEBUG("SocketPool: pool is full. Evicting oldest entry.");
+    erase(entries_.begin());
+    ++numEvicted_;
+  }
+  EntryList::iterator itr =
+    entries_.insert(entries_.end(), Entry(socket, options));
+  Timer deadline = global::wallclock;
+  deadline.advance(timeout);
+  (*itr).setKeyItr
+    (keyIndex_.insert(keyIndex_.upper_bound(key), std::make_pair(key, itr)));
+  (*itr).setDeadlineItr
+    (deadlineIndex_.insert(deadlineIndex_.upper_bound(deadline),
+                           std::make_pair(deadline, itr)));
+}
+
+SocketPool::KeyIndex::iterator SocketPool::find(const std::string& key)
+{
+  // Search from the most recently pooled one: it is least likely to
+  // be closed by the remote endpoint.
+  while(1) {
+    KeyIndex::iterator i = keyIndex_.upper_bound(key);
+    if(i == keyIndex_.begin() || (*--i).first != key) {
+      break;
+    }
+    EntryList::iterator entryItr = (*i).second;
+    bool usable = false;
+    if(global::wallclock < (*(*entryItr).getDeadlineItr()).first) {
+      // We assume that if socket is readable it means peer shutdowns
+      // connection and the socket will receive EOF. So skip it.
+      try {
+        usable = !(*entryItr).getSocket()->isReadable(0);
+      } catch(RecoverableException& e) {
+        // Unusable socket
+      }
+    }
+    if(usable) {
+      return i;
+    }
+    // The entry is no longer usable, so drop it now.
+    erase(entryItr);
+  }
+  return keyIndex_.end();
+}
+
+SharedHandle<SocketCore> SocketPool::pop
+(std::map<std::string, std::string>& options, const std::string& key)
+{
+  SharedHandle<SocketCore> s;
+  KeyIndex::iterator i = find(key);
+  if(i == keyIndex_.end()) {
+    ++numMiss_;
+  } else {
+    A2_LOG_INFO(fmt("Found socket for %s", key.c_str()));
+    ++numHit_;
+    EntryList::iterator entryItr = (*i).second;
+    s = (*entryItr).getSocket();
+    options = (*entryItr).getOptions();
+    erase(entryItr);
+  }
+  return s;
+}
+
+SharedHandle<SocketCore> SocketPool::pop(const std::string& key)
+{
+  std::map<std::string, std::string> options;
+  return pop(options, key);
+}
+
+void SocketPool::removeStaleEntry(bool checkClosed)
+{
+  size_t numTimedOut = 0;
+  while(!deadlineIndex_.empty() &&
+        !(global::wallclock < (*deadlineIndex_.begin()).first)) {
+    erase((*deadlineIndex_.begin()).second);
+    ++numTimedOut;
+  }
+  numTimedOut_ += numTimedOut;
+  size_t numClosed = 0;
+  if(checkClosed) {
+    for(EntryList::iterator i = entries_.begin(), eoi = entries_.end();
+        i != eoi;) {
+      bool closed;
+      try {
+        closed = (*i).getSocket()->isReadable(0);
+      } catch(RecoverableException& e) {
+        closed = true;
+      }
+      if(closed) {
+        erase(i++);
+        ++numClosed;
+      } else {
+        ++i;
+      }
+    }
+    numClosedByPeer_ += numClosed;
+  }
+  if(numTimedOut > 0 || numClosed > 0) {
+    A2_LOG_DEBUG(fmt("SocketPool: %lu timed out entries and %lu closed"
+                     " entries removed.",
+                     static_cast<unsigned long>(numTimedOut),
+                     static_cast<unsigned long>(numClosed)));
+  }
+}
+
+} // namespace aria2
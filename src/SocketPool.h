@@ -0,0 +1,229 @@
+/* <!-- copyright */
+/*
+ * aria2 - The high speed download utility
+ *
+ * Copyright (C) 2011 Tatsuhiro Tsujikawa
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.  If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so.  If you
+ * do not wish to do so, delete this exception statement from your
+ * version.  If you delete this exception statement from all source
+ * files in the program, then also delete it here.
+ */
+/* copyright --> */
+#ifndef D_SOCKET_POOL_H
+#define D_SOCKET_POOL_H
+
+#include "common.h"
+
+#include <string>
+#include <map>
+#include <list>
+
+#include "SharedHandle.h"
+#include "TimerA2.h"
+
+namespace aria2 {
+
+class SocketCore;
+
+// Pool of idle connections which can be reused by later
+// requests. Entries are keyed by string (typically
+// [username@]host:port[/proxyhost:proxyport]). The number of entries
+// is capped globally and per key. If the cap is reached, the least
+// recently pooled entry is evicted. Each entry has a deadline and
+// removeStaleEntry() drops entries whose deadline has passed in
+// O(1) per check, without scanning whole pool.
+class SocketPool {
+private:
+  class Entry;
+
+  typedef std::list<Entry> EntryList;
+  typedef std::multimap<std::string, EntryList::iterator> KeyIndex;
+  typedef std::multimap<Timer, EntryList::iterator> DeadlineIndex;
+
+  class Entry {
+  private:
+    SharedHandle<SocketCore> socket_;
+
+    std::map<std::string, std::string> options_;
+
+    KeyIndex::iterator keyItr_;
+
+    DeadlineIndex::iterator deadlineItr_;
+  public:
+    Entry(const SharedHandle<SocketCore>& socket,
+          const std::map<std::string, std::string>& options);
+
+    ~Entry();
+
+    const SharedHandle<SocketCore>& getSocket() const
+    {
+      return socket_;
+    }
+
+    const std::map<std::string, std::string>& getOptions() const
+    {
+      return options_;
+    }
+
+    KeyIndex::iterator getKeyItr() const
+    {
+      return keyItr_;
+    }
+
+    void setKeyItr(KeyIndex::iterator itr)
+    {
+      keyItr_ = itr;
+    }
+
+    DeadlineIndex::iterator getDeadlineItr() const
+    {
+      return deadlineItr_;
+    }
+
+    void setDeadlineItr(DeadlineIndex::iterator itr)
+    {
+      deadlineItr_ = itr;
+    }
+  };
+
+  // Entries in the order they were pooled. The front is the least
+  // recently pooled one.
+  EntryList entries_;
+
+  KeyIndex keyIndex_;
+
+  DeadlineIndex deadlineIndex_;
+
+  size_t maxSize_;
+
+  size_t maxSizePerKey_;
+
+  // Statistics
+  uint64_t numHit_;
+
+  uint64_t numMiss_;
+
+  uint64_t numEvicted_;
+
+  uint64_t numTimedOut_;
+
+  uint64_t numClosedByPeer_;
+
+  void erase(EntryList::iterator itr);
+
+  KeyIndex::iterator find(const std::string& key);
+public:
+  static const size_t DEFAULT_MAX_SIZE = 1024;
+
+  static const size_t DEFAULT_MAX_SIZE_PER_KEY = 16;
+
+  SocketPool(size_t maxSize = DEFAULT_MAX_SIZE,
+             size_t maxSizePerKey = DEFAULT_MAX_SIZE_PER_KEY);
+
+  ~SocketPool();
+
+  // Pools socket with key. The socket is removed from the pool after
+  // timeout seconds.  If the number of entries for key reaches
+  // maxSizePerKey, the oldest entry for key is evicted. If the
+  // number of all entries reaches maxSize, the oldest entry in the
+  // pool is evicted.
+  void add(const std::string& key,
+           const SharedHandle<SocketCore>& socket,
+           const std::map<std::string, std::string>& options,
+           time_t timeout);
+
+  // Removes the most recently pooled usable socket for key from the
+  // pool and returns it. options of the entry are assigned to
+  // options.  If no such socket is found, returns null SharedHandle.
+  SharedHandle<SocketCore> pop(std::map<std::string, std::string>& options,
+                               const std::string& key);
+
+  SharedHandle<SocketCore> pop(const std::string& key);
+
+  // Removes timed out entries. If checkClosed is true, entries whose
+  // socket is readable are also removed because we assume that the
+  // remote endpoint has closed the connection.
+  void removeStaleEntry(bool checkClosed);
+
+  size_t size() const
+  {
+    return entries_.size();
+  }
+
+  size_t count(const std::string& key) const
+  {
+    return keyIndex_.count(key);
+  }
+
+  void setMaxSize(size_t maxSize)
+  {
+    maxSize_ = maxSize;
+  }
+
+  size_t getMaxSize() const
+  {
+    return maxSize_;
+  }
+
+  void setMaxSizePerKey(size_t maxSizePerKey)
+  {
+    maxSizePerKey_ = maxSizePerKey;
+  }
+
+  size_t getMaxSizePerKey() const
+  {
+    return maxSizePerKey_;
+  }
+
+  uint64_t getNumHit() const
+  {
+    return numHit_;
+  }
+
+  uint64_t getNumMiss() const
+  {
+    return numMiss_;
+  }
+
+  uint64_t getNumEvicted() const
+  {
+    return numEvicted_;
+  }
+
+  uint64_t getNumTimedOut() const
+  {
+    return numTimedOut_;
+  }
+
+  uint64_t getNumClosedByPeer() const
+  {
+    return numClosedByPeer_;
+  }
+};
+
+} // namespace aria2
+
+#endif // D_SOCKET_POOL_H
@@ -0,0 +1,85 @@
+/* <!-- copyright */
+/*
+ * aria2 - The high speed download utility
+ *
+ * Copyright (C) 2011 Tatsuhiro Tsujikawa
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.  If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so.  If you
+ * do not wish to do so, delete this exception statement from your
+ * version.  If you delete this exception statement from all source
+ * files in the program, then also delete it here.
+ */
+/* copyright --> */
+#include "StreamPieceSelector.h"
+
+#include <algorithm>
+
+#include "bitfield.h"
+#include "Option.h"
+#include "prefs.h"
+
+namespace aria2 {
+
+StreamPieceSelector::StreamPieceSelector
+(const SharedHandle<PieceSelector>& selector,
+ const Option* option,
+ size_t pieceLength):
+  selector_(selector),
+  option_(option),
+  pieceLength_(pieceLength) {}
+
+bool StreamPieceSelector::select
+(size_t& index, const unsigned char* bitfield, size_t nbits) const
+{
+  size_t first, last;
+  if(getWindow(first, last, nbits)) {
+    for(size_t i = first; i < last; ++i) {
+      if(bitfield::test(bitfield, nbits, i)) {
+        index = i;
+        return true;
+      }
+    }
+  }
+  return selector_->select(index, bitfield, nbits);
+}
+
+bool StreamPieceSelector::getWindow
+(size_t& first, size_t& last, size_t nbits) const
+{
+  int64_t window = option_->getAsLLInt(PREF_BT_STREAM_WINDOW);
+  if(window <= 0 || pieceLength_ == 0) {
+    return false;
+  }
+  int64_t position = option_->getAsLLInt(PREF_BT_STREAM_POSITION);
+  if(position < 0) {
+    position = 0;
+  }
+  uint64_t lastIndex = (position+window+pieceLength_-1)/pieceLength_;
+  first = position/pieceLength_;
+  last = std::min(lastIndex, static_cast<uint64_t>(nbits));
+  return first < last;
+}
+
+} // namespace aria2
@@ -0,0 +1,73 @@
+/* <!-- copyright */
+/*
+ * aria2 - The high speed download utility
+ *
+ * Copyright (C) 2011 Tatsuhiro Tsujikawa
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.  If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so.  If you
+ * do not wish to do so, delete this exception statement from your
+ * version.  If you delete this exception statement from all source
+ * files in the program, then also delete it here.
+ */
+/* copyright --> */
+#ifndef D_STREAM_PIECE_SELECTOR_H
+#define D_STREAM_PIECE_SELECTOR_H
+
+#include "PieceSelector.h"
+#include "SharedHandle.h"
+
+namespace aria2 {
+
+class Option;
+
+// Selects pieces in the window ahead of the playback position in
+// order. The position and the size of the window are read from
+// PREF_BT_STREAM_POSITION and PREF_BT_STREAM_WINDOW each time, so
+// that they can be changed while downloading. If no piece in the
+// window can be selected, the selection is delegated to selector_.
+class StreamPieceSelector:public PieceSelector {
+private:
+  SharedHandle<PieceSelector> selector_;
+
+  const Option* option_;
+
+  size_t pieceLength_;
+public:
+  StreamPieceSelector(const SharedHandle<PieceSelector>& selector,
+                      const Option* option,
+                      size_t pieceLength);
+
+  virtual bool select
+  (size_t& index, const unsigned char* bitfield, size_t nbits) const;
+
+  // Stores the range of piece index in the window to [first,
+  // last). nbits is the number of pieces. Returns false if the window
+  // is empty.
+  bool getWindow(size_t& first, size_t& last, size_t nbits) const;
+};
+
+} // namespace aria2
+
+#endif // D_STREAM_PIECE_SELECTOR_H
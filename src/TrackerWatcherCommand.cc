@@ -63,6 +63,17 @@
 #include "a2functional.h"
 #include "util.h"
 #include "fmt.h"
+#include "uri.h"
+#include "NameResolver.h"
+#include "UDPTrackerRequest.h"
+#include "UDPTrackerClient.h"
+#include "UDPTrackerCommand.h"
+#include "HttpTrackerRequest.h"
+#include "HttpTrackerCommand.h"
+#include "HttpRequest.h"
+#ifdef ENABLE_ASYNC_DNS
+#include "AsyncNameResolver.h"
+#endif // ENABLE_ASYNC_DNS
 
 namespace aria2 {
 
@@ -70,19 +81,24 @@ TrackerWatcherCommand::TrackerWatcherCommand
 (cuid_t cuid, RequestGroup* requestGroup, DownloadEngine* e)
   : Command(cuid),
     requestGroup_(requestGroup),
-    e_(e)
+    e_(e),
+    udpTrackerPort_(0)
 {
   requestGroup_->increaseNumCommand();
 }
 
 TrackerWatcherCommand::~TrackerWatcherCommand()
 {
+#ifdef ENABLE_ASYNC_DNS
+  releaseAsyncNameResolver();
+#endif // ENABLE_ASYNC_DNS
   requestGroup_->decreaseNumCommand();
 }
 
 bool TrackerWatcherCommand::execute() {
   if(requestGroup_->isForceHaltRequested()) {
     if(!trackerRequestGroup_) {
+      // Pending UDP tracker request, if any, is abandoned.
       return true;
     } else if(trackerRequestGroup_->getNumCommand() == 0 ||
               trackerRequestGroup_->downloadFinished()) {
@@ -98,7 +114,22 @@ bool TrackerWatcherCommand::execute() {
     A2_LOG_DEBUG("no more announce");
     return true;
   }
-  if(!trackerRequestGroup_) {
+#ifdef ENABLE_ASYNC_DNS
+  if(asyncNameResolver_) {
+    processUDPTrackerNameResolution();
+  } else
+#endif // ENABLE_ASYNC_DNS
+  if(udpTrackerRequest_) {
+    if(udpTrackerRequest_->state == UDPT_STA_COMPLETE) {
+      processUDPTrackerResponse();
+      udpTrackerRequest_.reset();
+    }
+  } else if(httpTrackerRequest_) {
+    if(httpTrackerRequest_->state == HTTPT_STA_COMPLETE) {
+      processHttpTrackerResponse();
+      httpTrackerRequest_.reset();
+    }
+  } else if(!trackerRequestGroup_) {
     trackerRequestGroup_ = createAnnounce();
     if(trackerRequestGroup_) {
       try {
@@ -139,6 +170,44 @@ bool TrackerWatcherCommand::execute() {
   return false;
 }
 
+void TrackerWatcherCommand::processUDPTrackerResponse()
+{
+  if(udpTrackerRequest_->error == UDPT_ERR_SUCCESS) {
+    btAnnounce_->processUDPTrackerResponse(udpTrackerRequest_);
+    addConnection();
+    btAnnounce_->announceSuccess();
+    btAnnounce_->resetAnnounce();
+  } else {
+    A2_LOG_INFO(fmt("CUID#%lld - UDP tracker announce to %s:%u failed."
+                    " error=%d",
+                    getCuid(), udpTrackerRequest_->remoteAddr.c_str(),
+                    udpTrackerRequest_->remotePort,
+                    udpTrackerRequest_->error));
+    btAnnounce_->announceFailure();
+    if(btAnnounce_->isAllAnnounceFailed()) {
+      btAnnounce_->resetAnnounce();
+    }
+  }
+}
+
+void TrackerWatcherCommand::processHttpTrackerResponse()
+{
+  if(httpTrackerRequest_->error == HTTPT_ERR_SUCCESS) {
+    try {
+      processTrackerResponse(httpTrackerRequest_->response);
+      btAnnounce_->announceSuccess();
+      btAnnounce_->resetAnnounce();
+      return;
+    } catch(RecoverableException& ex) {
+      A2_LOG_ERROR_EX(EX_EXCEPTION_CAUGHT, ex);
+    }
+  }
+  btAnnounce_->announceFailure();
+  if(btAnnounce_->isAllAnnounceFailed()) {
+    btAnnounce_->resetAnnounce();
+  }
+}
+
 std::string TrackerWatcherCommand::getTrackerResponse
 (const SharedHandle<RequestGroup>& requestGroup)
 {
@@ -163,6 +232,11 @@ void TrackerWatcherCommand::processTrackerResponse
   btAnnounce_->processAnnounceResponse
     (reinterpret_cast<const unsigned char*>(trackerResponse.c_str()),
      trackerResponse.size());
+  addConnection();
+}
+
+void TrackerWatcherCommand::addConnection()
+{
   while(!btRuntime_->isHalt() && btRuntime_->lessThanMinPeers()) {
     SharedHandle<Peer> peer = peerStorage_->getUnusedPeer();
     if(!peer) {
@@ -181,15 +255,223 @@ void TrackerWatcherCommand::processTrackerResponse
   }
 }
 
+namespace {
+// Parses UDP tracker URI udp://host:port/... and stores host and port.
+// Returns false if uri is not UDP tracker URI.
+bool parseUDPTrackerUri
+(std::string& host, uint16_t& port, const std::string& uri)
+{
+  static const std::string UDP_SCHEME("udp://");
+  if(!util::startsWith(uri, UDP_SCHEME)) {
+    return false;
+  }
+  std::string::const_iterator first = uri.begin()+UDP_SCHEME.size();
+  std::string::const_iterator last = first;
+  for(; last != uri.end() && *last != '/' && *last != '?'; ++last);
+  std::string::const_iterator sep = last;
+  for(; sep != first && *(sep-1) != ':'; --sep);
+  if(sep == first || sep == last) {
+    return false;
+  }
+  uint32_t tempPort;
+  if(!util::parseUIntNoThrow(tempPort, std::string(sep, last)) ||
+     tempPort == 0 || 65535 < tempPort) {
+    return false;
+  }
+  host.assign(first, sep-1);
+  port = tempPort;
+  return !host.empty();
+}
+} // namespace
+
 SharedHandle<RequestGroup> TrackerWatcherCommand::createAnnounce() {
   SharedHandle<RequestGroup> rg;
   if(btAnnounce_->isAnnounceReady()) {
-    rg = createRequestGroup(btAnnounce_->getAnnounceUrl());
+    std::string uri = btAnnounce_->getAnnounceUrl();
+    std::string host;
+    uint16_t port;
+    if(parseUDPTrackerUri(host, port, uri)) {
+      udpTrackerRequest_ = createUDPAnnRequest(host, port);
+    } else {
+      httpTrackerRequest_ = createHttpAnnRequest(uri);
+      if(!httpTrackerRequest_) {
+        rg = createRequestGroup(uri);
+      }
+    }
     btAnnounce_->announceStart(); // inside it, trackers++.
   }
   return rg;
 }
 
+SharedHandle<UDPTrackerRequest> TrackerWatcherCommand::createUDPAnnRequest
+(const std::string& host, uint16_t port)
+{
+  std::string addr;
+  if(host.find(':') != std::string::npos ||
+     util::startsWith(host, "[")) {
+    A2_LOG_INFO(fmt("CUID#%lld - UDP tracker %s is not supported because"
+                    " UDP trackers are only reached over IPv4",
+                    getCuid(), host.c_str()));
+    return sendUDPAnnRequest(host, addr, port);
+  }
+  if(util::isNumericHost(host)) {
+    addr = host;
+  } else {
+    addr = e_->findCachedIPAddress(host, port);
+  }
+  if(addr.empty()) {
+#ifdef ENABLE_ASYNC_DNS
+    if(getOption()->getAsBool(PREF_ASYNC_DNS)) {
+      asyncNameResolver_.reset
+        (new AsyncNameResolver(AF_INET
+#ifdef HAVE_ARES_ADDR_NODE
+                               ,
+                               e_->getAsyncDNSServers()
+#endif // HAVE_ARES_ADDR_NODE
+                               ));
+      A2_LOG_INFO(fmt(MSG_RESOLVING_HOSTNAME,
+                      getCuid(),
+                      host.c_str()));
+      asyncNameResolver_->resolve(host);
+      e_->addNameResolverCheck(asyncNameResolver_, this);
+      udpTrackerHost_ = host;
+      udpTrackerPort_ = port;
+      return SharedHandle<UDPTrackerRequest>();
+    }
+#endif // ENABLE_ASYNC_DNS
+    std::vector<std::string> addrs;
+    NameResolver res;
+    res.setSocktype(SOCK_DGRAM);
+    res.setFamily(AF_INET);
+    try {
+      res.resolve(addrs, host);
+    } catch(RecoverableException& e) {
+      A2_LOG_INFO_EX(EX_EXCEPTION_CAUGHT, e);
+    }
+    if(!addrs.empty()) {
+      addr = addrs.front();
+      e_->cacheIPAddress(host, addr, port);
+    } else {
+      A2_LOG_INFO(fmt("CUID#%lld - Could not resolve UDP tracker %s",
+                      getCuid(), host.c_str()));
+    }
+  }
+  return sendUDPAnnRequest(host, addr, port);
+}
+
+#ifdef ENABLE_ASYNC_DNS
+
+void TrackerWatcherCommand::processUDPTrackerNameResolution()
+{
+  std::string addr;
+  switch(asyncNameResolver_->getStatus()) {
+  case AsyncNameResolver::STATUS_SUCCESS: {
+    const std::vector<std::string>& addrs =
+      asyncNameResolver_->getResolvedAddresses();
+    A2_LOG_INFO(fmt(MSG_NAME_RESOLUTION_COMPLETE,
+                    getCuid(),
+                    udpTrackerHost_.c_str(),
+                    strjoin(addrs.begin(), addrs.end(), ", ").c_str()));
+    for(std::vector<std::string>::const_iterator i = addrs.begin(),
+          eoi = addrs.end(); i != eoi; ++i) {
+      e_->cacheIPAddress(udpTrackerHost_, *i, udpTrackerPort_);
+    }
+    addr = e_->findCachedIPAddress(udpTrackerHost_, udpTrackerPort_);
+    break;
+  }
+  case AsyncNameResolver::STATUS_ERROR:
+    A2_LOG_INFO(fmt(MSG_NAME_RESOLUTION_FAILED,
+                    getCuid(),
+                    udpTrackerHost_.c_str(),
+                    asyncNameResolver_->getError().c_str()));
+    break;
+  default:
+    return;
+  }
+  releaseAsyncNameResolver();
+  udpTrackerRequest_ =
+    sendUDPAnnRequest(udpTrackerHost_, addr, udpTrackerPort_);
+}
+
+void TrackerWatcherCommand::releaseAsyncNameResolver()
+{
+  if(asyncNameResolver_) {
+    e_->deleteNameResolverCheck(asyncNameResolver_, this);
+    asyncNameResolver_.reset();
+  }
+}
+
+#endif // ENABLE_ASYNC_DNS
+
+SharedHandle<UDPTrackerRequest> TrackerWatcherCommand::sendUDPAnnRequest
+(const std::string& host, const std::string& addr, uint16_t port)
+{
+  SharedHandle<UDPTrackerRequest> req =
+    btAnnounce_->createUDPTrackerRequest(addr, port);
+  if(addr.empty()) {
+    req->state = UDPT_STA_COMPLETE;
+    req->error = UDPT_ERR_NETWORK;
+    return req;
+  }
+  SharedHandle<UDPTrackerClient> client = e_->getUDPTrackerClient();
+  if(!client) {
+    try {
+      SharedHandle<SocketCore> socket(new SocketCore(SOCK_DGRAM));
+      socket->bind(A2STR::NIL, 0, AF_INET);
+      socket->setNonBlockingMode();
+      client.reset(new UDPTrackerClient());
+      e_->setUDPTrackerClient(client);
+      e_->addCommand(new UDPTrackerCommand(e_->newCUID(), e_, socket, client));
+    } catch(RecoverableException& e) {
+      A2_LOG_ERROR_EX(EX_EXCEPTION_CAUGHT, e);
+      req->state = UDPT_STA_COMPLETE;
+      req->error = UDPT_ERR_NETWORK;
+      return req;
+    }
+  }
+  A2_LOG_INFO(fmt("CUID#%lld - Sending announce to UDP tracker %s(%s):%u",
+                  getCuid(), host.c_str(), addr.c_str(), port));
+  client->addRequest(req);
+  return req;
+}
+
+SharedHandle<HttpTrackerRequest> TrackerWatcherCommand::createHttpAnnRequest
+(const std::string& uri)
+{
+  SharedHandle<HttpTrackerRequest> req;
+  const SharedHandle<Option>& option = getOption();
+  if(!option->blank(PREF_HTTP_PROXY) || !option->blank(PREF_ALL_PROXY)) {
+    return req;
+  }
+  SharedHandle<Request> request(new Request());
+  if(!request->setUri(uri) || request->getProtocol() != Request::PROTO_HTTP) {
+    return req;
+  }
+  request->setKeepAliveHint(true);
+  SharedHandle<HttpRequest> httpRequest(new HttpRequest());
+  httpRequest->setUserAgent(option->get(PREF_USER_AGENT));
+  httpRequest->setRequest(request);
+  httpRequest->addHeader(option->get(PREF_HEADER));
+  httpRequest->setCookieStorage(e_->getCookieStorage());
+  httpRequest->setAuthConfigFactory(e_->getAuthConfigFactory(), option.get());
+  httpRequest->disableContentEncoding();
+  req.reset(new HttpTrackerRequest());
+  req->httpRequest = httpRequest;
+  req->timeout = option->getAsInt(PREF_BT_TRACKER_TIMEOUT);
+  HttpTrackerCommand* command =
+    e_->findHttpTrackerCommand(request->getHost(), request->getPort());
+  if(!command) {
+    command = new HttpTrackerCommand
+      (e_->newCUID(), e_, request->getHost(), request->getPort());
+    e_->addCommand(command);
+  }
+  command->addRequest(req);
+  A2_LOG_DEBUG(fmt("CUID#%lld - Queued announce to HTTP tracker %s:%u",
+                   getCuid(), request->getHost().c_str(),
+                   request->getPort()));
+  return req;
+}
+
 namespace {
 bool backupTrackerIsAvailable
 (const SharedHandle<DownloadContext>& context)
@@ -50,6 +50,11 @@ class PieceStorage;
 class BtRuntime;
 class BtAnnounce;
 class Option;
+struct UDPTrackerRequest;
+struct HttpTrackerRequest;
+#ifdef ENABLE_ASYNC_DNS
+class AsyncNameResolver;
+#endif // ENABLE_ASYNC_DNS
 
 class TrackerWatcherCommand : public Command
 {
@@ -67,6 +72,19 @@ private:
   SharedHandle<BtAnnounce> btAnnounce_;
 
   SharedHandle<RequestGroup> trackerRequestGroup_;
+
+  SharedHandle<UDPTrackerRequest> udpTrackerRequest_;
+
+  SharedHandle<HttpTrackerRequest> httpTrackerRequest_;
+
+#ifdef ENABLE_ASYNC_DNS
+  // Resolves the host name of the UDP tracker in udpTrackerHost_.
+  SharedHandle<AsyncNameResolver> asyncNameResolver_;
+#endif // ENABLE_ASYNC_DNS
+
+  std::string udpTrackerHost_;
+
+  uint16_t udpTrackerPort_;
   /**
    * Returns a command for announce request. Returns 0 if no announce request
    * is needed.
@@ -77,6 +95,43 @@ private:
 
   void processTrackerResponse(const std::string& response);
 
+  // Creates the announce request to the UDP tracker at host:port and
+  // hands it to the UDPTrackerClient of DownloadEngine. If host
+  // cannot be resolved, the returned request is already completed
+  // with error. UDP trackers are only reached over IPv4, so IPv6
+  // literal hosts are rejected in the same way. If host is being
+  // resolved asynchronously, returns null handle and
+  // processUDPTrackerNameResolution() creates the request later.
+  SharedHandle<UDPTrackerRequest> createUDPAnnRequest
+  (const std::string& host, uint16_t port);
+
+  // Hands the announce request to the UDP tracker at addr:port to the
+  // UDPTrackerClient. If addr is empty, the returned request is
+  // already completed with error.
+  SharedHandle<UDPTrackerRequest> sendUDPAnnRequest
+  (const std::string& host, const std::string& addr, uint16_t port);
+
+#ifdef ENABLE_ASYNC_DNS
+  // Creates the announce request to the UDP tracker when the name
+  // resolution started by createUDPAnnRequest() finishes.
+  void processUDPTrackerNameResolution();
+
+  void releaseAsyncNameResolver();
+#endif // ENABLE_ASYNC_DNS
+
+  void processUDPTrackerResponse();
+
+  // Creates the announce request to HTTP tracker and hands it to the
+  // HttpTrackerCommand for the tracker host. Returns null handle if
+  // uri cannot be handled by HttpTrackerCommand, for example, HTTPS
+  // or proxy is used. In that case, RequestGroup must be used.
+  SharedHandle<HttpTrackerRequest> createHttpAnnRequest
+  (const std::string& uri);
+
+  void processHttpTrackerResponse();
+
+  void addConnection();
+
   const SharedHandle<Option>& getOption() const;
 public:
   TrackerWatcherCommand(cuid_t cuid,
@@ -85,6 +140,9 @@ public:
 
   virtual ~TrackerWatcherCommand();
 
+  // Returns RequestGroup for HTTP tracker announce. If the request
+  // is handled without RequestGroup, returns null handle and the
+  // request is stored in udpTrackerRequest_ or httpTrackerRequest_.
   SharedHandle<RequestGroup> createAnnounce();
 
   virtual bool execute();
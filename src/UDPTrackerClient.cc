@@ -0,0 +1,434 @@
+/* <!-- copyright */
+/*
+ * aria2 - The high speed download utility
+ *
+ * Copyright (C) 2011 Tatsuhiro Tsujikawa
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.  If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so.  If you
+ * do not wish to do so, delete this exception statement from your
+ * version.  If you delete this exception statement from all source
+ * files in the program, then also delete it here.
+ */
+/* copyright --> */
+#include "UDPTrackerClient.h"
+
+#include <cstring>
+#include <cassert>
+#include <limits>
+
+#include "UDPTrackerRequest.h"
+#include "bittorrent_helper.h"
+#include "SimpleRandomizer.h"
+#include "LogFactory.h"
+#include "Logger.h"
+#include "util.h"
+#include "fmt.h"
+#include "a2netcompat.h"
+
+namespace aria2 {
+
+namespace {
+const int64_t UDPT_INITIAL_CONNECTION_ID = 0x41727101980LL;
+
+const size_t CONNECT_REQUEST_LENGTH = 16;
+const size_t ANNOUNCE_REQUEST_LENGTH = 98;
+const size_t CONNECT_REPLY_LENGTH = 16;
+const size_t ANNOUNCE_REPLY_MIN_LENGTH = 20;
+const size_t COMPACT_PEER_LENGTH = 6;
+} // namespace
+
+namespace {
+void setInt64Param(unsigned char* dest, int64_t param)
+{
+  uint64_t v = param;
+  for(int i = 7; i >= 0; --i) {
+    dest[i] = v & 0xffu;
+    v >>= 8;
+  }
+}
+} // namespace
+
+namespace {
+int64_t getInt64Param(const unsigned char* msg, size_t pos)
+{
+  uint64_t v = 0;
+  for(size_t i = 0; i < 8; ++i) {
+    v <<= 8;
+    v |= msg[pos+i];
+  }
+  return v;
+}
+} // namespace
+
+namespace {
+const char* getActionStr(int action)
+{
+  switch(action) {
+  case UDPT_ACT_CONNECT:
+    return "CONNECT";
+  case UDPT_ACT_ANNOUNCE:
+    return "ANNOUNCE";
+  case UDPT_ACT_ERROR:
+    return "ERROR";
+  default:
+    return "(unknown)";
+  }
+}
+} // namespace
+
+namespace {
+void completeRequest(const SharedHandle<UDPTrackerRequest>& req, int error)
+{
+  req->state = UDPT_STA_COMPLETE;
+  req->error = error;
+}
+} // namespace
+
+const time_t UDPTrackerClient::CONNECTION_ID_TIMEOUT;
+const time_t UDPTrackerClient::INITIAL_TIMEOUT;
+const int UDPTrackerClient::MAX_RETRY;
+
+UDPTrackerClient::UDPTrackerConnection::UDPTrackerConnection()
+  : connecting(false),
+    connectionId(0),
+    lastUpdated(0)
+{}
+
+UDPTrackerClient::UDPTrackerClient() {}
+
+UDPTrackerClient::~UDPTrackerClient() {}
+
+void UDPTrackerClient::addRequest(const SharedHandle<UDPTrackerRequest>& req)
+{
+  req->state = UDPT_STA_PENDING;
+  req->error = UDPT_ERR_SUCCESS;
+  req->failCount = 0;
+  pendingRequests_.push_back(req);
+}
+
+UDPTrackerClient::UDPTrackerConnection* UDPTrackerClient::getConnection
+(const Endpoint& endpoint, const Timer& now)
+{
+  std::map<Endpoint, UDPTrackerConnection>::iterator i =
+    connectionIdCache_.find(endpoint);
+  if(i == connectionIdCache_.end()) {
+    return 0;
+  }
+  if(!(*i).second.connecting &&
+     (*i).second.lastUpdated.difference(now) >= CONNECTION_ID_TIMEOUT) {
+    A2_LOG_DEBUG(fmt("UDPT connection ID for %s:%u expired",
+                     endpoint.first.c_str(), endpoint.second));
+    connectionIdCache_.erase(i);
+    return 0;
+  }
+  return &(*i).second;
+}
+
+namespace {
+void failRequests
+(std::deque<SharedHandle<UDPTrackerRequest> >& requests,
+ const std::string& remoteAddr, uint16_t remotePort, int error)
+{
+  std::deque<SharedHandle<UDPTrackerRequest> > remaining;
+  for(std::deque<SharedHandle<UDPTrackerRequest> >::const_iterator i =
+        requests.begin(), eoi = requests.end(); i != eoi; ++i) {
+    if((*i)->action != UDPT_ACT_CONNECT &&
+       (*i)->remoteAddr == remoteAddr && (*i)->remotePort == remotePort) {
+      completeRequest(*i, error);
+    } else {
+      remaining.push_back(*i);
+    }
+  }
+  requests.swap(remaining);
+}
+} // namespace
+
+void UDPTrackerClient::failConnect(const Endpoint& endpoint, int error)
+{
+  connectionIdCache_.erase(endpoint);
+  failRequests(connectRequests_, endpoint.first, endpoint.second, error);
+  failRequests(pendingRequests_, endpoint.first, endpoint.second, error);
+}
+
+int32_t UDPTrackerClient::generateTransactionId()
+{
+  return SimpleRandomizer::getInstance()->getRandomNumber
+    (std::numeric_limits<int32_t>::max());
+}
+
+ssize_t UDPTrackerClient::createRequest
+(unsigned char* data, size_t length, std::string& remoteAddr,
+ uint16_t& remotePort, const Timer& now)
+{
+  while(!pendingRequests_.empty()) {
+    SharedHandle<UDPTrackerRequest> req = pendingRequests_.front();
+    if(req->action == UDPT_ACT_CONNECT) {
+      assert(length >= CONNECT_REQUEST_LENGTH);
+      req->transactionId = generateTransactionId();
+      setInt64Param(data, UDPT_INITIAL_CONNECTION_ID);
+      bittorrent::setIntParam(data+8, req->action);
+      bittorrent::setIntParam(data+12, req->transactionId);
+      remoteAddr = req->remoteAddr;
+      remotePort = req->remotePort;
+      A2_LOG_DEBUG(fmt("UDPT sending CONNECT to %s:%u transaction_id=%08x",
+                       remoteAddr.c_str(), remotePort, req->transactionId));
+      return CONNECT_REQUEST_LENGTH;
+    }
+    Endpoint endpoint(req->remoteAddr, req->remotePort);
+    UDPTrackerConnection* c = getConnection(endpoint, now);
+    if(!c) {
+      // Obtain connection ID first. The announce request is sent
+      // when the connect reply is received.
+      SharedHandle<UDPTrackerRequest> creq(new UDPTrackerRequest());
+      creq->action = UDPT_ACT_CONNECT;
+      creq->remoteAddr = req->remoteAddr;
+      creq->remotePort = req->remotePort;
+      pendingRequests_.push_front(creq);
+      UDPTrackerConnection& nc = connectionIdCache_[endpoint];
+      nc.connecting = true;
+      nc.lastUpdated = now;
+      continue;
+    }
+    if(c->connecting) {
+      pendingRequests_.pop_front();
+      connectRequests_.push_back(req);
+      continue;
+    }
+    assert(length >= ANNOUNCE_REQUEST_LENGTH);
+    assert(req->infohash.size() == 20 && req->peerId.size() == 20);
+    req->connectionId = c->connectionId;
+    req->transactionId = generateTransactionId();
+    setInt64Param(data, req->connectionId);
+    bittorrent::setIntParam(data+8, req->action);
+    bittorrent::setIntParam(data+12, req->transactionId);
+    memcpy(data+16, req->infohash.data(), req->infohash.size());
+    memcpy(data+36, req->peerId.data(), req->peerId.size());
+    setInt64Param(data+56, req->downloaded);
+    setInt64Param(data+64, req->left);
+    setInt64Param(data+72, req->uploaded);
+    bittorrent::setIntParam(data+80, req->event);
+    // ip is already in network byte order
+    memcpy(data+84, &req->ip, sizeof(req->ip));
+    bittorrent::setIntParam(data+88, req->key);
+    bittorrent::setIntParam(data+92, req->numWant);
+    bittorrent::setShortIntParam(data+96, req->port);
+    remoteAddr = req->remoteAddr;
+    remotePort = req->remotePort;
+    A2_LOG_DEBUG(fmt("UDPT sending ANNOUNCE to %s:%u transaction_id=%08x"
+                     " event=%d",
+                     remoteAddr.c_str(), remotePort, req->transactionId,
+                     req->event));
+    return ANNOUNCE_REQUEST_LENGTH;
+  }
+  return -1;
+}
+
+void UDPTrackerClient::requestSent(const Timer& now)
+{
+  assert(!pendingRequests_.empty());
+  SharedHandle<UDPTrackerRequest> req = pendingRequests_.front();
+  pendingRequests_.pop_front();
+  req->dispatched = now;
+  inflightRequests_.push_back(req);
+}
+
+void UDPTrackerClient::requestFail(int error)
+{
+  assert(!pendingRequests_.empty());
+  SharedHandle<UDPTrackerRequest> req = pendingRequests_.front();
+  pendingRequests_.pop_front();
+  A2_LOG_INFO(fmt("UDPT failed to send %s to %s:%u",
+                  getActionStr(req->action), req->remoteAddr.c_str(),
+                  req->remotePort));
+  completeRequest(req, error);
+  if(req->action == UDPT_ACT_CONNECT) {
+    failConnect(Endpoint(req->remoteAddr, req->remotePort), error);
+  }
+}
+
+int UDPTrackerClient::receiveReply
+(const unsigned char* data, size_t length, const std::string& remoteAddr,
+ uint16_t remotePort, const Timer& now)
+{
+  if(length < 8) {
+    return -1;
+  }
+  int32_t action = bittorrent::getIntParam(data, 0);
+  int32_t transactionId = bittorrent::getIntParam(data, 4);
+  std::deque<SharedHandle<UDPTrackerRequest> >::iterator i =
+    inflightRequests_.begin();
+  for(; i != inflightRequests_.end(); ++i) {
+    if((*i)->transactionId == transactionId &&
+       (*i)->remotePort == remotePort && (*i)->remoteAddr == remoteAddr) {
+      break;
+    }
+  }
+  if(i == inflightRequests_.end()) {
+    A2_LOG_DEBUG(fmt("UDPT received %s from %s:%u, but no matching request"
+                     " found. transaction_id=%08x",
+                     getActionStr(action), remoteAddr.c_str(), remotePort,
+                     transactionId));
+    return -1;
+  }
+  SharedHandle<UDPTrackerRequest> req = *i;
+  Endpoint endpoint(remoteAddr, remotePort);
+  if(action == UDPT_ACT_CONNECT) {
+    if(req->action != UDPT_ACT_CONNECT || length < CONNECT_REPLY_LENGTH) {
+      return -1;
+    }
+    inflightRequests_.erase(i);
+    completeRequest(req, UDPT_ERR_SUCCESS);
+    UDPTrackerConnection& c = connectionIdCache_[endpoint];
+    c.connecting = false;
+    c.connectionId = getInt64Param(data, 8);
+    c.lastUpdated = now;
+    A2_LOG_DEBUG(fmt("UDPT received CONNECT reply from %s:%u"
+                     " connection_id=%016llx",
+                     remoteAddr.c_str(), remotePort,
+                     static_cast<unsigned long long>(c.connectionId)));
+    // Send the requests waiting for this connection ID first.
+    std::deque<SharedHandle<UDPTrackerRequest> > remaining;
+    std::deque<SharedHandle<UDPTrackerRequest> > ready;
+    for(std::deque<SharedHandle<UDPTrackerRequest> >::const_iterator j =
+          connectRequests_.begin(), eoj = connectRequests_.end(); j != eoj;
+        ++j) {
+      if((*j)->remoteAddr == remoteAddr && (*j)->remotePort == remotePort) {
+        ready.push_back(*j);
+      } else {
+        remaining.push_back(*j);
+      }
+    }
+    connectRequests_.swap(remaining);
+    pendingRequests_.insert(pendingRequests_.begin(),
+                            ready.begin(), ready.end());
+  } else if(action == UDPT_ACT_ANNOUNCE) {
+    if(req->action != UDPT_ACT_ANNOUNCE ||
+       length < ANNOUNCE_REPLY_MIN_LENGTH) {
+      return -1;
+    }
+    inflightRequests_.erase(i);
+    SharedHandle<UDPTrackerReply> reply(new UDPTrackerReply());
+    reply->action = action;
+    reply->transactionId = transactionId;
+    reply->interval = bittorrent::getIntParam(data, 8);
+    reply->leechers = bittorrent::getIntParam(data, 12);
+    reply->seeders = bittorrent::getIntParam(data, 16);
+    for(size_t pos = ANNOUNCE_REPLY_MIN_LENGTH;
+        pos+COMPACT_PEER_LENGTH <= length; pos += COMPACT_PEER_LENGTH) {
+      std::pair<std::string, uint16_t> p =
+        bittorrent::unpackcompact(data+pos, AF_INET);
+      if(p.first.empty() || p.second == 0) {
+        continue;
+      }
+      reply->peers.push_back(p);
+    }
+    req->reply = reply;
+    completeRequest(req, UDPT_ERR_SUCCESS);
+    A2_LOG_DEBUG(fmt("UDPT received ANNOUNCE reply from %s:%u"
+                     " interval=%d, leechers=%d, seeders=%d, num_peers=%lu",
+                     remoteAddr.c_str(), remotePort,
+                     reply->interval, reply->leechers, reply->seeders,
+                     static_cast<unsigned long>(reply->peers.size())));
+  } else if(action == UDPT_ACT_ERROR) {
+    inflightRequests_.erase(i);
+    A2_LOG_INFO(fmt("UDPT received ERROR reply from %s:%u for %s: %s",
+                    remoteAddr.c_str(), remotePort,
+                    getActionStr(req->action),
+                    std::string(&data[8], &data[length]).c_str()));
+    completeRequest(req, UDPT_ERR_TRACKER);
+    if(req->action == UDPT_ACT_CONNECT) {
+      failConnect(endpoint, UDPT_ERR_TRACKER);
+    } else {
+      // The connection ID may be rejected by the tracker. Obtain new
+      // one next time.
+      std::map<Endpoint, UDPTrackerConnection>::iterator c =
+        connectionIdCache_.find(endpoint);
+      if(c != connectionIdCache_.end() && !(*c).second.connecting) {
+        connectionIdCache_.erase(c);
+      }
+    }
+  } else {
+    return -1;
+  }
+  return 0;
+}
+
+void UDPTrackerClient::handleTimeout(const Timer& now)
+{
+  std::deque<SharedHandle<UDPTrackerRequest> > inflight;
+  std::deque<SharedHandle<UDPTrackerRequest> > failed;
+  for(std::deque<SharedHandle<UDPTrackerRequest> >::const_iterator i =
+        inflightRequests_.begin(), eoi = inflightRequests_.end(); i != eoi;
+      ++i) {
+    const SharedHandle<UDPTrackerRequest>& req = *i;
+    time_t timeout = INITIAL_TIMEOUT << req->failCount;
+    if(req->dispatched.difference(now) < timeout) {
+      inflight.push_back(req);
+    } else if(req->failCount < MAX_RETRY) {
+      ++req->failCount;
+      A2_LOG_DEBUG(fmt("UDPT %s to %s:%u timed out. Retransmitting (%d)",
+                       getActionStr(req->action), req->remoteAddr.c_str(),
+                       req->remotePort, req->failCount));
+      pendingRequests_.push_back(req);
+    } else {
+      failed.push_back(req);
+    }
+  }
+  inflightRequests_.swap(inflight);
+  for(std::deque<SharedHandle<UDPTrackerRequest> >::const_iterator i =
+        failed.begin(), eoi = failed.end(); i != eoi; ++i) {
+    A2_LOG_INFO(fmt("UDPT %s to %s:%u timed out",
+                    getActionStr((*i)->action), (*i)->remoteAddr.c_str(),
+                    (*i)->remotePort));
+    completeRequest(*i, UDPT_ERR_TIMEOUT);
+    if((*i)->action == UDPT_ACT_CONNECT) {
+      failConnect(Endpoint((*i)->remoteAddr, (*i)->remotePort),
+                  UDPT_ERR_TIMEOUT);
+    }
+  }
+}
+
+namespace {
+template<typename InputIterator>
+void completeRequests(InputIterator first, InputIterator last, int error)
+{
+  for(; first != last; ++first) {
+    completeRequest(*first, error);
+  }
+}
+} // namespace
+
+void UDPTrackerClient::failAll(int error)
+{
+  completeRequests(pendingRequests_.begin(), pendingRequests_.end(), error);
+  completeRequests(connectRequests_.begin(), connectRequests_.end(), error);
+  completeRequests(inflightRequests_.begin(), inflightRequests_.end(), error);
+  pendingRequests_.clear();
+  connectRequests_.clear();
+  inflightRequests_.clear();
+  connectionIdCache_.clear();
+}
+
+} // namespace aria2
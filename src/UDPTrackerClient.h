@@ -0,0 +1,154 @@
+/* <!-- copyright */
+/*
+ * aria2 - The high speed download utility
+ *
+ * Copyright (C) 2011 Tatsuhiro Tsujikawa
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.  If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so.  If you
+ * do not wish to do so, delete this exception statement from your
+ * version.  If you delete this exception statement from all source
+ * files in the program, then also delete it here.
+ */
+/* copyright --> */
+#ifndef D_UDP_TRACKER_CLIENT_H
+#define D_UDP_TRACKER_CLIENT_H
+
+#include "common.h"
+
+#include <string>
+#include <deque>
+#include <map>
+
+#include "SharedHandle.h"
+#include "TimerA2.h"
+
+namespace aria2 {
+
+struct UDPTrackerRequest;
+
+// Implements the client side of UDP Tracker Protocol (BEP 15). This
+// class does not do any I/O by itself. The caller sends the packets
+// created by createRequest() and feeds the received packets to
+// receiveReply(), so that a single UDP socket can be shared among
+// all torrents. The connection ID obtained from a tracker is cached
+// and reused by the subsequent announce requests to the same
+// tracker while it is valid.
+class UDPTrackerClient {
+public:
+  // The connection ID is valid for this period of time in seconds.
+  static const time_t CONNECTION_ID_TIMEOUT = 60;
+  // The timeout for the first transmission in seconds. The timeout
+  // is doubled for each retransmission.
+  static const time_t INITIAL_TIMEOUT = 15;
+  // The maximum number of retransmissions.
+  static const int MAX_RETRY = 2;
+
+  UDPTrackerClient();
+
+  ~UDPTrackerClient();
+
+  // Adds req to the send queue. remoteAddr and remotePort of req
+  // must be filled. remoteAddr must be numeric IPv4 address.
+  void addRequest(const SharedHandle<UDPTrackerRequest>& req);
+
+  // Processes the packet received from remoteAddr:remotePort.
+  // Returns 0 if data is a reply to one of our requests. Otherwise
+  // returns -1.
+  int receiveReply
+  (const unsigned char* data, size_t length, const std::string& remoteAddr,
+   uint16_t remotePort, const Timer& now);
+
+  // Writes the next packet to be sent in data and stores its
+  // destination in remoteAddr and remotePort. Returns the number of
+  // bytes written. If there is no packet to send, returns -1. Call
+  // requestSent() or requestFail() after the packet is sent. If the
+  // packet cannot be sent now, just call this function again later.
+  ssize_t createRequest
+  (unsigned char* data, size_t length, std::string& remoteAddr,
+   uint16_t& remotePort, const Timer& now);
+
+  // Tells that the packet created by the last createRequest() call
+  // was sent.
+  void requestSent(const Timer& now);
+
+  // Tells that the packet created by the last createRequest() call
+  // could not be sent. error is one of UDPTrackerError.
+  void requestFail(int error);
+
+  // Retransmits timed out requests, or fails them if they were
+  // retransmitted MAX_RETRY times.
+  void handleTimeout(const Timer& now);
+
+  // Fails all requests with error.
+  void failAll(int error);
+
+  // Returns true if there is no request which is not completed yet.
+  bool noRequest() const
+  {
+    return pendingRequests_.empty() && connectRequests_.empty() &&
+      inflightRequests_.empty();
+  }
+
+  // Returns the number of requests which is not completed yet.
+  size_t getNumRequest() const
+  {
+    return pendingRequests_.size()+connectRequests_.size()+
+      inflightRequests_.size();
+  }
+private:
+  struct UDPTrackerConnection {
+    // true if connect request is in flight.
+    bool connecting;
+    int64_t connectionId;
+    Timer lastUpdated;
+    UDPTrackerConnection();
+  };
+
+  typedef std::pair<std::string, uint16_t> Endpoint;
+
+  // Returns the connection ID cache entry for endpoint. Returns 0 if
+  // no entry is found or the entry has expired.
+  UDPTrackerConnection* getConnection
+  (const Endpoint& endpoint, const Timer& now);
+
+  // Discards the connection ID of endpoint and fails the announce
+  // requests to endpoint.
+  void failConnect(const Endpoint& endpoint, int error);
+
+  int32_t generateTransactionId();
+
+  // The requests to be sent, in order. This may contain connect
+  // requests created by this object.
+  std::deque<SharedHandle<UDPTrackerRequest> > pendingRequests_;
+  // The announce requests waiting for the connection ID.
+  std::deque<SharedHandle<UDPTrackerRequest> > connectRequests_;
+  // The requests sent and waiting for reply.
+  std::deque<SharedHandle<UDPTrackerRequest> > inflightRequests_;
+  std::map<Endpoint, UDPTrackerConnection> connectionIdCache_;
+};
+
+} // namespace aria2
+
+#endif // D_UDP_TRACKER_CLIENT_H
@@ -0,0 +1,132 @@
+/* <!-- copyright */
+/*
+ * aria2 - The high speed download utility
+ *
+ * Copyright (C) 2011 Tatsuhiro Tsujikawa
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.  If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so.  If you
+ * do not wish to do so, delete this exception statement from your
+ * version.  If you delete this exception statement from all source
+ * files in the program, then also delete it here.
+ */
+/* copyright --> */
+#include "UDPTrackerCommand.h"
+#include "DownloadEngine.h"
+#include "RequestGroupMan.h"
+#include "UDPTrackerClient.h"
+#include "UDPTrackerRequest.h"
+#include "SocketCore.h"
+#include "RecoverableException.h"
+#include "message.h"
+#include "Logger.h"
+#include "LogFactory.h"
+#include "wallclock.h"
+#include "fmt.h"
+
+namespace aria2 {
+
+UDPTrackerCommand::UDPTrackerCommand
+(cuid_t cuid, DownloadEngine* e,
+ const SharedHandle<SocketCore>& socket,
+ const SharedHandle<UDPTrackerClient>& udpTrackerClient)
+  : Command(cuid),
+    e_(e),
+    socket_(socket),
+    udpTrackerClient_(udpTrackerClient)
+{
+  e_->addSocketForReadCheck(socket_, this);
+}
+
+UDPTrackerCommand::~UDPTrackerCommand()
+{
+  e_->deleteSocketForReadCheck(socket_, this);
+  udpTrackerClient_->failAll(UDPT_ERR_SHUTDOWN);
+  if(e_->getUDPTrackerClient().get() == udpTrackerClient_.get()) {
+    e_->setUDPTrackerClient(SharedHandle<UDPTrackerClient>());
+  }
+}
+
+void UDPTrackerCommand::receiveReply()
+{
+  unsigned char data[1500];
+  for(;;) {
+    std::pair<std::string, uint16_t> remoteAddr;
+    ssize_t length;
+    try {
+      length = socket_->readDataFrom(data, sizeof(data), remoteAddr);
+    } catch(RecoverableException& e) {
+      A2_LOG_INFO_EX(EX_EXCEPTION_CAUGHT, e);
+      break;
+    }
+    if(length == 0) {
+      break;
+    }
+    udpTrackerClient_->receiveReply(data, length, remoteAddr.first,
+                                    remoteAddr.second, global::wallclock);
+  }
+}
+
+void UDPTrackerCommand::sendRequest()
+{
+  unsigned char data[100];
+  for(;;) {
+    std::string remoteAddr;
+    uint16_t remotePort;
+    ssize_t length = udpTrackerClient_->createRequest
+      (data, sizeof(data), remoteAddr, remotePort, global::wallclock);
+    if(length == -1) {
+      break;
+    }
+    try {
+      if(socket_->writeData(data, length, remoteAddr, remotePort) == 0) {
+        // Try again later
+        break;
+      }
+      udpTrackerClient_->requestSent(global::wallclock);
+    } catch(RecoverableException& e) {
+      A2_LOG_INFO_EX(EX_EXCEPTION_CAUGHT, e);
+      udpTrackerClient_->requestFail(UDPT_ERR_NETWORK);
+    }
+  }
+}
+
+bool UDPTrackerCommand::execute()
+{
+  // After halt is requested, keep running until "stopped" announce
+  // requests are completed. If another request is added after this
+  // command exited, TrackerWatcherCommand creates new one.
+  if(e_->getRequestGroupMan()->downloadFinished() ||
+     e_->isForceHaltRequested() ||
+     (e_->isHaltRequested() && udpTrackerClient_->noRequest())) {
+    return true;
+  }
+  receiveReply();
+  udpTrackerClient_->handleTimeout(global::wallclock);
+  sendRequest();
+  e_->addCommand(this);
+  return false;
+}
+
+} // namespace aria2
@@ -216,6 +216,25 @@ public:
 
   virtual void enterEndGame() {}
 
+  virtual bool isStreamingMode()
+  {
+    return false;
+  }
+
+  virtual void addWastedLength(size_t length) {}
+
+  virtual uint64_t getWastedLength()
+  {
+    return 0;
+  }
+
+  virtual void addHashReread(size_t length) {}
+
+  virtual size_t getNumHashReread()
+  {
+    return 0;
+  }
+
   virtual void setEndGamePieceNum(size_t num) {}
 
   virtual SharedHandle<DiskAdaptor> getDiskAdaptor();
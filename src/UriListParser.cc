@@ -50,6 +50,13 @@ UriListParser::UriListParser(std::istream& in):in_(in)
   optparser_.setOptionHandlers(OptionHandlerFactory::createOptionHandlers());
 }
 
+UriListParser::UriListParser(const SharedHandle<std::istream>& in)
+  : inHolder_(in),
+    in_(*in)
+{
+  optparser_.setOptionHandlers(OptionHandlerFactory::createOptionHandlers());
+}
+
 UriListParser::~UriListParser() {}
 
 void UriListParser::getOptions(Option& op)
@@ -43,11 +43,15 @@
 
 #include "Option.h"
 #include "OptionParser.h"
+#include "SharedHandle.h"
 
 namespace aria2 {
 
 class UriListParser {
 private:
+  // Holds the stream if this object owns it.
+  SharedHandle<std::istream> inHolder_;
+
   std::istream& in_;
 
   OptionParser optparser_;
@@ -58,6 +62,10 @@ private:
 public:
   UriListParser(std::istream& in);
 
+  // This object shares the ownership of in, so that in is kept open
+  // while this object is alive.
+  UriListParser(const SharedHandle<std::istream>& in);
+
   ~UriListParser();
 
   void parseNext(std::vector<std::string>& uris, Option& op);
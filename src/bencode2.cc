@@ -36,6 +36,8 @@
 
 #include <fstream>
 #include <sstream>
+#include <iterator>
+#include <limits>
 
 #include "fmt.h"
 #include "DlAbortEx.h"
@@ -46,84 +48,130 @@ namespace aria2 {
 namespace bencode2 {
 
 namespace {
-SharedHandle<ValueBase> decodeiter(std::istream& ss, size_t depth);
+SharedHandle<ValueBase> decodeiter
+(const unsigned char*& p, const unsigned char* last, size_t depth);
 } // namespace
 
 namespace {
-void checkdelim(std::istream& ss, const char delim = ':')
+void checkdelim
+(const unsigned char*& p, const unsigned char* last, const char delim = ':')
 {
-  char d;
-  if(!(ss.get(d) && d == delim)) {
+  if(p == last || *p != delim) {
     throw DL_ABORT_EX2
       (fmt("Bencode decoding failed: Delimiter '%c' not found.",
            delim),
        error_code::BENCODE_PARSE_ERROR);
   }
+  ++p;
 }
 } // namespace
 
 namespace {
-std::string decoderawstring(std::istream& ss)
+bool isDigit(unsigned char c)
 {
-  int length;
-  ss >> length;
-  if(!ss || length < 0) {
+  return '0' <= c && c <= '9';
+}
+} // namespace
+
+namespace {
+// Reads the length of byte string and returns [first, last) of the
+// string body. The body is not copied.
+std::pair<const unsigned char*, const unsigned char*> decoderawstring
+(const unsigned char*& p, const unsigned char* last)
+{
+  if(p == last || !isDigit(*p)) {
     throw DL_ABORT_EX2("Bencode decoding failed:"
                        " A positive integer expected but none found.",
                        error_code::BENCODE_PARSE_ERROR);
   }
-  // TODO check length, it must be less than or equal to INT_MAX
-  checkdelim(ss);
-  char* buf = new char[length];
-  ss.read(buf, length);
-  std::string str(&buf[0], &buf[length]);
-  delete [] buf;
-  if(ss.gcount() != static_cast<int>(length)) {
+  size_t length = 0;
+  for(; p != last && isDigit(*p); ++p) {
+    size_t nlength = length*10+(*p-'0');
+    if(nlength/10 != length) {
+      throw DL_ABORT_EX2("Bencode decoding failed:"
+                         " A positive integer expected but none found.",
+                         error_code::BENCODE_PARSE_ERROR);
+    }
+    length = nlength;
+  }
+  checkdelim(p, last);
+  size_t left = last-p;
+  if(left < length) {
     throw DL_ABORT_EX2
       (fmt("Bencode decoding failed:"
            " Expected %lu bytes of data, but only %ld read.",
            static_cast<unsigned long>(length),
-           static_cast<long int>(ss.gcount())),
+           static_cast<long int>(left)),
        error_code::BENCODE_PARSE_ERROR);
   }
-  return str;
+  const unsigned char* first = p;
+  p += length;
+  return std::make_pair(first, p);
 }
 } // namespace
 
 namespace {
-SharedHandle<ValueBase> decodestring(std::istream& ss)
+SharedHandle<ValueBase> decodestring
+(const unsigned char*& p, const unsigned char* last)
 {
-  return String::g(decoderawstring(ss));
+  std::pair<const unsigned char*, const unsigned char*> r =
+    decoderawstring(p, last);
+  return String::g(r.first, r.second-r.first);
 }
 } // namespace
 
 namespace {
-SharedHandle<ValueBase> decodeinteger(std::istream& ss)
+SharedHandle<ValueBase> decodeinteger
+(const unsigned char*& p, const unsigned char* last)
 {
-  Integer::ValueType iv;
-  ss >> iv;
-  if(!ss) {
+  bool neg = false;
+  if(p != last && *p == '-') {
+    neg = true;
+    ++p;
+  }
+  if(p == last || !isDigit(*p)) {
     throw DL_ABORT_EX2("Bencode decoding failed:"
                        " Integer expected but none found",
                        error_code::BENCODE_PARSE_ERROR);
   }
-  checkdelim(ss, 'e');
+  // Accumulate in negative range so that the minimum value of
+  // Integer::ValueType can be decoded.
+  Integer::ValueType iv = 0;
+  for(; p != last && isDigit(*p); ++p) {
+    Integer::ValueType d = *p-'0';
+    if(iv < (std::numeric_limits<Integer::ValueType>::min()+d)/10) {
+      throw DL_ABORT_EX2("Bencode decoding failed:"
+                         " Integer expected but none found",
+                         error_code::BENCODE_PARSE_ERROR);
+    }
+    iv = iv*10-d;
+  }
+  if(!neg) {
+    if(iv == std::numeric_limits<Integer::ValueType>::min()) {
+      throw DL_ABORT_EX2("Bencode decoding failed:"
+                         " Integer expected but none found",
+                         error_code::BENCODE_PARSE_ERROR);
+    }
+    iv = -iv;
+  }
+  checkdelim(p, last, 'e');
   return Integer::g(iv);
 }
 } // namespace
 
 namespace {
-SharedHandle<ValueBase> decodedict(std::istream& ss, size_t depth)
+SharedHandle<ValueBase> decodedict
+(const unsigned char*& p, const unsigned char* last, size_t depth)
 {
   SharedHandle<Dict> dict = Dict::g();
-  char c;
-  while(ss.get(c)) {
-    if(c == 'e') {
+  while(p != last) {
+    if(*p == 'e') {
+      ++p;
       return dict;
     } else {
-      ss.unget();
-      std::string key = decoderawstring(ss);
-      dict->put(key, decodeiter(ss, depth));
+      std::pair<const unsigned char*, const unsigned char*> r =
+        decoderawstring(p, last);
+      dict->put(std::string(r.first, r.second), decodeiter(p, last, depth));
     }
   }
   throw DL_ABORT_EX2("Bencode decoding failed:"
@@ -133,16 +181,16 @@ SharedHandle<ValueBase> decodedict(std::istream& ss, size_t depth)
 } // namespace
 
 namespace {
-SharedHandle<ValueBase> decodelist(std::istream& ss, size_t depth)
+SharedHandle<ValueBase> decodelist
+(const unsigned char*& p, const unsigned char* last, size_t depth)
 {
   SharedHandle<List> list = List::g();
-  char c;
-  while(ss.get(c)) {
-    if(c == 'e') {
+  while(p != last) {
+    if(*p == 'e') {
+      ++p;
       return list;
     } else {
-      ss.unget();
-      list->append(decodeiter(ss, depth));
+      list->append(decodeiter(p, last, depth));
     }
   }
   throw DL_ABORT_EX2("Bencode decoding failed:"
@@ -162,32 +210,38 @@ void checkDepth(size_t depth)
 } // namespace
 
 namespace {
-SharedHandle<ValueBase> decodeiter(std::istream& ss, size_t depth)
+SharedHandle<ValueBase> decodeiter
+(const unsigned char*& p, const unsigned char* last, size_t depth)
 {
   checkDepth(depth);
-  char c;
-  if(!ss.get(c)) {
+  if(p == last) {
     throw DL_ABORT_EX2("Bencode decoding failed:"
                        " Unexpected EOF in term context."
                        " 'd', 'l', 'i' or digit is expected.",
                        error_code::BENCODE_PARSE_ERROR);
   }
+  unsigned char c = *p;
   if(c == 'd') {
-    return decodedict(ss, depth+1);
+    ++p;
+    return decodedict(p, last, depth+1);
   } else if(c == 'l') {
-    return decodelist(ss, depth+1);
+    ++p;
+    return decodelist(p, last, depth+1);
   } else if(c == 'i') {
-    return decodeinteger(ss);
+    ++p;
+    return decodeinteger(p, last);
   } else {
-    ss.unget();
-    return decodestring(ss);
+    return decodestring(p, last);
   }
 }
 } // namespace
 
 SharedHandle<ValueBase> decode(std::istream& in)
 {
-  return decodeiter(in, 0);
+  const std::string s((std::istreambuf_iterator<char>(in)),
+                      std::istreambuf_iterator<char>());
+  const unsigned char* p = reinterpret_cast<const unsigned char*>(s.data());
+  return decodeiter(p, p+s.size(), 0);
 }
 
 SharedHandle<ValueBase> decode(const std::string& s)
@@ -198,24 +252,25 @@ SharedHandle<ValueBase> decode(const std::string& s)
 
 SharedHandle<ValueBase> decode(const std::string& s, size_t& end)
 {
-  if(s.empty()) {
-    return SharedHandle<ValueBase>();
-  }
-  std::istringstream ss(s);
-
-  SharedHandle<ValueBase> vlb = decodeiter(ss, 0);
-  end = ss.tellg();
-  return vlb;
+  return decode(reinterpret_cast<const unsigned char*>(s.data()), s.size(),
+                end);
 }
 
 SharedHandle<ValueBase> decode(const unsigned char* data, size_t length)
 {
-  return decode(std::string(&data[0], &data[length]));
+  size_t end;
+  return decode(data, length, end);
 }
 
 SharedHandle<ValueBase> decode(const unsigned char* data, size_t length, size_t& end)
 {
-  return decode(std::string(&data[0], &data[length]), end);
+  if(length == 0) {
+    return SharedHandle<ValueBase>();
+  }
+  const unsigned char* p = data;
+  SharedHandle<ValueBase> vlb = decodeiter(p, data+length, 0);
+  end = p-data;
+  return vlb;
 }
 
 SharedHandle<ValueBase> decodeFromFile(const std::string& filename)
@@ -48,6 +48,8 @@ namespace bencode2 {
 
 const size_t MAX_STRUCTURE_DEPTH = 100;
 
+// Decode the data read from in. in is read until EOF and the data
+// after the first bencoded value is ignored.
 SharedHandle<ValueBase> decode(std::istream& in);
 
 // Decode the data in s.
@@ -130,6 +130,8 @@ const std::set<std::string>& listRequestOptions()
     PREF_BT_SAVE_METADATA,
     PREF_BT_SEED_UNVERIFIED,
     PREF_BT_STOP_TIMEOUT,
+    PREF_BT_STREAM_POSITION,
+    PREF_BT_STREAM_WINDOW,
     PREF_BT_TRACKER_INTERVAL,
     PREF_BT_TRACKER_TIMEOUT,
     PREF_BT_TRACKER_CONNECT_TIMEOUT,
@@ -494,22 +496,23 @@ void createRequestGroupForUri
   }
 }
 
-namespace {
-void createRequestGroupForUriList
+bool createRequestGroupFromUriListParser
 (std::vector<SharedHandle<RequestGroup> >& result,
- const SharedHandle<Option>& option,
- std::istream& in)
+ const Option* option,
+ UriListParser* uriListParser)
 {
-  UriListParser p(in);
-  while(p.hasNext()) {
+  // Since result already contains some entries, we cache the size of
+  // result and check whether new RequestGroup is added.
+  size_t num = result.size();
+  while(uriListParser->hasNext()) {
     std::vector<std::string> uris;
     SharedHandle<Option> tempOption(new Option());
-    p.parseNext(uris, *tempOption.get());
+    uriListParser->parseNext(uris, *tempOption.get());
     if(uris.empty()) {
       continue;
     }
 
-    SharedHandle<Option> requestOption(new Option(*option.get()));
+    SharedHandle<Option> requestOption(new Option(*option));
     for(std::set<std::string>::const_iterator i =
           listRequestOptions().begin(), eoi = listRequestOptions().end();
         i != eoi; ++i) {
@@ -519,27 +522,38 @@ void createRequestGroupForUriList
     }
 
     createRequestGroupForUri(result, requestOption, uris);
+    if(num < result.size()) {
+      return true;
+    }
   }
+  return false;
 }
-} // namespace
 
-void createRequestGroupForUriList
-(std::vector<SharedHandle<RequestGroup> >& result,
- const SharedHandle<Option>& option)
+SharedHandle<UriListParser> openUriListParser(const std::string& filename)
 {
-  if(option->get(PREF_INPUT_FILE) == "-") {
-    createRequestGroupForUriList(result, option, std::cin);
+  if(filename == "-") {
+    return SharedHandle<UriListParser>(new UriListParser(std::cin));
   } else {
-    if(!File(option->get(PREF_INPUT_FILE)).isFile()) {
+    if(!File(filename).isFile()) {
       throw DL_ABORT_EX
-        (fmt(EX_FILE_OPEN, option->get(PREF_INPUT_FILE).c_str(),
-             "No such file"));
+        (fmt(EX_FILE_OPEN, filename.c_str(), "No such file"));
     }
-    std::ifstream f(option->get(PREF_INPUT_FILE).c_str(), std::ios::binary);
-    createRequestGroupForUriList(result, option, f);
+    SharedHandle<std::istream> f
+      (new std::ifstream(filename.c_str(), std::ios::binary));
+    return SharedHandle<UriListParser>(new UriListParser(f));
   }
 }
 
+void createRequestGroupForUriList
+(std::vector<SharedHandle<RequestGroup> >& result,
+ const SharedHandle<Option>& option)
+{
+  SharedHandle<UriListParser> uriListParser =
+    openUriListParser(option->get(PREF_INPUT_FILE));
+  while(createRequestGroupFromUriListParser(result, option.get(),
+                                            uriListParser.get()));
+}
+
 SharedHandle<MetadataInfo>
 createMetadataInfoFromFirstFileEntry(const SharedHandle<DownloadContext>& dctx)
 {
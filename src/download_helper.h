@@ -49,6 +49,7 @@ class RequestGroup;
 class Option;
 class MetadataInfo;
 class DownloadContext;
+class UriListParser;
 
 const std::set<std::string>& listRequestOptions();
 
@@ -86,6 +87,19 @@ void createRequestGroupForUriList
 (std::vector<SharedHandle<RequestGroup> >& result,
  const SharedHandle<Option>& option);
 
+// Reads one entry from uriListParser and creates RequestGroup objects
+// from it. Entries which produce no RequestGroup are skipped. Returns
+// true if at least one RequestGroup is appended to result. Returns
+// false if uriListParser has no more entry.
+bool createRequestGroupFromUriListParser
+(std::vector<SharedHandle<RequestGroup> >& result,
+ const Option* option,
+ UriListParser* uriListParser);
+
+// Creates UriListParser which reads filename. If filename is "-",
+// stdin is used.
+SharedHandle<UriListParser> openUriListParser(const std::string& filename);
+
 // Create RequestGroup object using provided uris.  If ignoreLocalPath
 // is true, a path to torrent file abd metalink file are ignored.  If
 // throwOnError is true, exception will be thrown when Metalink
@@ -36,7 +36,6 @@
 
 #include <sstream>
 
-#include "array_fun.h"
 #include "DlAbortEx.h"
 #include "error_code.h"
 #include "a2functional.h"
@@ -58,17 +57,30 @@ decode
 } // namespace
 
 namespace {
-const char WS[] = { 0x20, 0x09, 0x0a, 0x0d };
-const char ESCAPE_CHARS[] = { '"', '\\', '/', '\b', '\f', '\n', '\r', '\t' };
 const size_t MAX_STRUCTURE_DEPTH = 100;
 } // namespace
 
+namespace {
+bool isWs(char c)
+{
+  switch(c) {
+  case 0x20:
+  case 0x09:
+  case 0x0a:
+  case 0x0d:
+    return true;
+  default:
+    return false;
+  }
+}
+} // namespace
+
 namespace {
 std::string::const_iterator skipWs
 (std::string::const_iterator first,
  std::string::const_iterator last)
 {
-  while(first != last && std::find(vbegin(WS), vend(WS), *first) != vend(WS)) {
+  while(first != last && isWs(*first)) {
     ++first;
   }
   return first;
@@ -156,7 +168,7 @@ decodeString
       break;
     }
     if(*first == '\\') {
-      s += std::string(offset, first);
+      s.append(offset, first);
       ++first;
       checkEof(first, last);
       if(*first == 'u') {
@@ -236,9 +248,7 @@ decodeString
     }
   }
   checkEof(first, last);
-  if(std::distance(offset, first) > 0) {
-    s += std::string(offset, first);
-  }
+  s.append(offset, first);
   if(!util::isUtf8(s)) {
     throw DL_ABORT_EX2("JSON decoding failed: Non UTF-8 string.",
                        error_code::JSON_PARSE_ERROR);
@@ -484,121 +494,53 @@ SharedHandle<ValueBase> decode(const std::string& json)
   return r.first;
 }
 
-std::string jsonEscape(const std::string& s)
+namespace {
+// Escape sequences of ASCII characters less than 0x20. The characters
+// which do not have short form are escaped as \u00XX.
+const char* const CONTROL_ESCAPES[] = {
+  "\\u0000", "\\u0001", "\\u0002", "\\u0003",
+  "\\u0004", "\\u0005", "\\u0006", "\\u0007",
+  "\\b", "\\t", "\\n", "\\u000B",
+  "\\f", "\\r", "\\u000E", "\\u000F",
+  "\\u0010", "\\u0011", "\\u0012", "\\u0013",
+  "\\u0014", "\\u0015", "\\u0016", "\\u0017",
+  "\\u0018", "\\u0019", "\\u001A", "\\u001B",
+  "\\u001C", "\\u001D", "\\u001E", "\\u001F"
+};
+} // namespace
+
+void jsonEscape(std::string& out, const std::string& s)
 {
-  std::string t;
+  out.reserve(out.size()+s.size());
+  std::string::const_iterator offset = s.begin();
   for(std::string::const_iterator i = s.begin(), eoi = s.end(); i != eoi;
       ++i) {
-    if(*i == '"' || *i == '\\' || *i == '/') {
-      t += '\\';
-      t += *i;
-    } else if(*i == '\b') {
-      t += "\\b";
-    } else if(*i == '\f') {
-      t += "\\f";
-    } else if(*i == '\n') {
-      t += "\\n";
-    } else if(*i == '\r') {
-      t += "\\r";
-    } else if(*i == '\t') {
-      t += "\\t";
-    } else if(in(static_cast<unsigned char>(*i), 0x00u, 0x1Fu)) {
-      t += "\\u00";
-      char temp[3];
-      temp[2] = '\0';
-      temp[0] = (*i >> 4);
-      temp[1] = (*i)&0x0Fu;
-      for(int j = 0; j < 2; ++j) {
-        if(temp[j] < 10) {
-          temp[j] += '0';
-        } else {
-          temp[j] += 'A'-10;
-        }
-      }
-      t += temp;
-    } else {
-      t += *i;
+    unsigned char c = *i;
+    if(c < 0x20u) {
+      out.append(offset, i);
+      out += CONTROL_ESCAPES[c];
+      offset = i+1;
+    } else if(c == '"' || c == '\\' || c == '/') {
+      out.append(offset, i);
+      out += '\\';
+      out += c;
+      offset = i+1;
     }
   }
+  out.append(offset, s.end());
+}
+
+std::string jsonEscape(const std::string& s)
+{
+  std::string t;
+  jsonEscape(t, s);
   return t;
 }
 
 std::string encode(const ValueBase* vlb)
 {
-  class JsonValueBaseVisitor:public ValueBaseVisitor {
-  private:
-    std::ostringstream out_;
-  public:
-    virtual void visit(const String& string)
-    {
-      const std::string& s = string.s();
-      std::string t = jsonEscape(s);
-      out_ << '"';
-      out_.write(t.data(), t.size());
-      out_ << '"';
-    }
-
-    virtual void visit(const Integer& integer)
-    {
-      out_ << integer.i();
-    }
-
-    virtual void visit(const Bool& boolValue)
-    {
-      out_ << (boolValue.val() ? "true" : "false");
-    }
-
-    virtual void visit(const Null& nullValue)
-    {
-      out_ << "null";
-    }
-
-    virtual void visit(const List& list)
-    {
-      out_ << '[';
-      List::ValueType::const_iterator i = list.begin();
-      if(!list.empty()) {
-        (*i)->accept(*this);
-      }
-      ++i;
-      for(List::ValueType::const_iterator eoi = list.end(); i != eoi; ++i){
-        out_ << ',';
-        (*i)->accept(*this);
-      }
-      out_ << ']';
-    }
-
-    virtual void visit(const Dict& dict)
-    {
-      out_ << '{';
-      Dict::ValueType::const_iterator i = dict.begin();
-      if(!dict.empty()) {
-        std::string key = jsonEscape((*i).first);
-        out_ << '"';
-        out_.write(key.data(), key.size());
-        out_ << "\":";
-        (*i).second->accept(*this);
-      }
-      ++i;
-      for(Dict::ValueType::const_iterator eoi = dict.end(); i != eoi; ++i){
-        out_ << ',';
-        std::string key = jsonEscape((*i).first);
-        out_ << '"';
-        out_.write(key.data(), key.size());
-        out_ << "\":";
-        (*i).second->accept(*this);
-      }
-      out_ << '}';
-    }
-
-    std::string getResult() const
-    {
-      return out_.str();
-    }
-  };
-  JsonValueBaseVisitor visitor;
-  vlb->accept(visitor);
-  return visitor.getResult();
+  std::ostringstream out;
+  return encode(out, vlb).str();
 }
 
 // Serializes JSON object or array.
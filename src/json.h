@@ -47,6 +47,9 @@ SharedHandle<ValueBase> decode(const std::string& json);
 
 std::string jsonEscape(const std::string& s);
 
+// Appends JSON-escaped s to out.
+void jsonEscape(std::string& out, const std::string& s);
+
 template<typename OutputStream>
 OutputStream& encode(OutputStream& out, const ValueBase* vlb)
 {
@@ -110,10 +113,15 @@ OutputStream& encode(OutputStream& out, const ValueBase* vlb)
   private:
     void encodeString(const std::string& s)
     {
-      std::string t = jsonEscape(s);
-      out_ << "\"" << t << "\"";
+      // Reuse buf_ to avoid memory allocation per string.
+      buf_.clear();
+      buf_ += '"';
+      jsonEscape(buf_, s);
+      buf_ += '"';
+      out_ << buf_;
     }
     OutputStream& out_;
+    std::string buf_;
   };
   JsonValueBaseVisitor visitor(out);
   vlb->accept(visitor);
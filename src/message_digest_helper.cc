@@ -38,6 +38,7 @@
 #include <cstdlib>
 
 #include "MessageDigest.h"
+#include "DigestThreadPool.h"
 #include "DlAbortEx.h"
 #include "message.h"
 #include "DefaultDiskWriter.h"
@@ -76,6 +77,17 @@ std::string hexDigest
 (const SharedHandle<MessageDigest>& ctx,
  const SharedHandle<BinaryStream>& bs,
  off_t offset, uint64_t length)
+{
+  updateDigest(ctx, bs, offset, length);
+  return ctx->hexDigest();
+}
+
+namespace {
+template<typename Digest>
+void readAndUpdate
+(const SharedHandle<Digest>& ctx,
+ const SharedHandle<BinaryStream>& bs,
+ off_t offset, uint64_t length)
 {
   size_t BUFSIZE = 4096;
   unsigned char BUF[BUFSIZE];
@@ -97,7 +109,23 @@ std::string hexDigest
     }
     ctx->update(BUF, readLength);
   }
-  return ctx->hexDigest();
+}
+} // namespace
+
+void updateDigest
+(const SharedHandle<MessageDigest>& ctx,
+ const SharedHandle<BinaryStream>& bs,
+ off_t offset, uint64_t length)
+{
+  readAndUpdate(ctx, bs, offset, length);
+}
+
+void updateDigest
+(const SharedHandle<DigestStream>& stream,
+ const SharedHandle<BinaryStream>& bs,
+ off_t offset, uint64_t length)
+{
+  readAndUpdate(stream, bs, offset, length);
 }
 
 void digest
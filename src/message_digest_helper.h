@@ -45,6 +45,7 @@ namespace aria2 {
 
 class BinaryStream;
 class MessageDigest;
+class DigestStream;
 
 namespace message_digest {
 
@@ -74,6 +75,24 @@ std::string hexDigest
  const SharedHandle<BinaryStream>& bs,
  off_t offset, uint64_t length);
 
+/**
+ * Feeds length bytes of bs, starting at offset, to ctx. ctx is not
+ * finalized, so that more data can be fed to it.
+ */
+void updateDigest
+(const SharedHandle<MessageDigest>& ctx,
+ const SharedHandle<BinaryStream>& bs,
+ off_t offset, uint64_t length);
+
+/**
+ * Same as above, but feeds the data to stream, which hashes it on
+ * DigestThreadPool. The data is read in the calling thread.
+ */
+void updateDigest
+(const SharedHandle<DigestStream>& stream,
+ const SharedHandle<BinaryStream>& bs,
+ off_t offset, uint64_t length);
+
 /**
  * Stores *raw* message digest into md.
  * Throws exception when mdLength is less than the size of message digest.
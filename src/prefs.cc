@@ -57,6 +57,8 @@ const std::string PREF_CONNECT_TIMEOUT("connect-timeout");
 const std::string PREF_MAX_TRIES("max-tries");
 // values: 1*digit
 const std::string PREF_AUTO_SAVE_INTERVAL("auto-save-interval");
+// value: true | false
+const std::string PREF_AUTO_SAVE_IN_PLACE("auto-save-in-place");
 // values: a string that your file system recognizes as a file name.
 const std::string PREF_LOG("log");
 // values: a string that your file system recognizes as a directory.
@@ -103,6 +105,12 @@ const std::string PREF_MAX_DOWNLOADS("max-downloads");
 const std::string PREF_INPUT_FILE("input-file");
 // value: 1*digit
 const std::string PREF_MAX_CONCURRENT_DOWNLOADS("max-concurrent-downloads");
+// value: 1*digit
+const std::string PREF_MAX_CONCURRENT_FILE_ALLOCATIONS
+("max-concurrent-file-allocations");
+// value: 1*digit
+const std::string PREF_FILE_ALLOCATION_SPEED_LIMIT
+("file-allocation-speed-limit");
 // value: true | false
 const std::string PREF_FORCE_SEQUENTIAL("force-sequential");
 // value: true | false
@@ -220,6 +228,14 @@ const std::string PREF_RETRY_WAIT("retry-wait");
 const std::string PREF_ASYNC_DNS_SERVER("async-dns-server");
 // value: true | false
 const std::string PREF_SHOW_CONSOLE_READOUT("show-console-readout");
+// value: true | false
+const std::string PREF_DEFERRED_INPUT("deferred-input");
+// value: true | false
+const std::string PREF_PROFILE_COMMANDS("profile-commands");
+// value: 1*digit
+const std::string PREF_SLOW_COMMAND_THRESHOLD("slow-command-threshold");
+// value: 1*digit
+const std::string PREF_HASH_THREADS("hash-threads");
 
 /**
  * FTP related preferences
@@ -378,6 +394,10 @@ const std::string PREF_BT_TRACKER_INTERVAL("bt-tracker-interval");
 const std::string PREF_BT_STOP_TIMEOUT("bt-stop-timeout");
 // values: head[=SIZE]|tail[=SIZE], ...
 const std::string PREF_BT_PRIORITIZE_PIECE("bt-prioritize-piece");
+// values: 1*digit
+const std::string PREF_BT_STREAM_WINDOW("bt-stream-window");
+// values: 1*digit
+const std::string PREF_BT_STREAM_POSITION("bt-stream-position");
 // values: true | false
 const std::string PREF_BT_SAVE_METADATA("bt-save-metadata");
 // values: true | false
@@ -398,6 +418,8 @@ const std::string PREF_ON_BT_DOWNLOAD_COMPLETE("on-bt-download-complete");
 const std::string PREF_BT_TRACKER("bt-tracker");
 // values: string
 const std::string PREF_BT_EXCLUDE_TRACKER("bt-exclude-tracker");
+// values: a string that your file system recognizes as a file name.
+const std::string PREF_BT_PIECE_INDEX("bt-piece-index");
 
 /**
  * Metalink related preferences
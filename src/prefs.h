@@ -61,6 +61,8 @@ extern const std::string PREF_CONNECT_TIMEOUT;
 extern const std::string PREF_MAX_TRIES;
 // values: 1*digit
 extern const std::string PREF_AUTO_SAVE_INTERVAL;
+// value: true | false
+extern const std::string PREF_AUTO_SAVE_IN_PLACE;
 // values: a string that your file system recognizes as a file name.
 extern const std::string PREF_LOG;
 // values: a string that your file system recognizes as a directory.
@@ -107,6 +109,10 @@ extern const std::string PREF_MAX_DOWNLOADS;
 extern const std::string PREF_INPUT_FILE;
 // value: 1*digit
 extern const std::string PREF_MAX_CONCURRENT_DOWNLOADS;
+// value: 1*digit
+extern const std::string PREF_MAX_CONCURRENT_FILE_ALLOCATIONS;
+// value: 1*digit
+extern const std::string PREF_FILE_ALLOCATION_SPEED_LIMIT;
 // value: true | false
 extern const std::string PREF_FORCE_SEQUENTIAL;
 // value: true | false
@@ -224,6 +230,14 @@ extern const std::string PREF_RETRY_WAIT;
 extern const std::string PREF_ASYNC_DNS_SERVER;
 // value: true | false
 extern const std::string PREF_SHOW_CONSOLE_READOUT;
+// value: true | false
+extern const std::string PREF_DEFERRED_INPUT;
+// value: true | false
+extern const std::string PREF_PROFILE_COMMANDS;
+// value: 1*digit
+extern const std::string PREF_SLOW_COMMAND_THRESHOLD;
+// value: 1*digit
+extern const std::string PREF_HASH_THREADS;
 
 /**
  * FTP related preferences
@@ -382,6 +396,10 @@ extern const std::string PREF_BT_TRACKER_INTERVAL;
 extern const std::string PREF_BT_STOP_TIMEOUT;
 // values: head[=SIZE]|tail[=SIZE], ...
 extern const std::string PREF_BT_PRIORITIZE_PIECE;
+// values: 1*digit
+extern const std::string PREF_BT_STREAM_WINDOW;
+// values: 1*digit
+extern const std::string PREF_BT_STREAM_POSITION;
 // values: true | false
 extern const std::string PREF_BT_SAVE_METADATA;
 // values: true | false
@@ -402,6 +420,8 @@ extern const std::string PREF_ON_BT_DOWNLOAD_COMPLETE;
 extern const std::string PREF_BT_TRACKER;
 // values: string
 extern const std::string PREF_BT_EXCLUDE_TRACKER;
+// values: a string that your file system recognizes as a file name.
+extern const std::string PREF_BT_PIECE_INDEX;
 
 /**
  * Metalink related preferences
@@ -0,0 +1,532 @@
+/* <!-- copyright */
+/*
+ * aria2 - The high speed download utility
+ *
+ * Copyright (C) 2011 Tatsuhiro Tsujikawa
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.  If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so.  If you
+ * do not wish to do so, delete this exception statement from your
+ * version.  If you delete this exception statement from all source
+ * files in the program, then also delete it here.
+ */
+/* copyright --> */
+#include "sha1.h"
+
+#include <cassert>
+#include <cstring>
+#include <algorithm>
+
+#if (defined(__x86_64__) || defined(__i386__)) &&                       \
+  (defined(__clang__) ||                                                \
+   (defined(__GNUC__) &&                                                \
+    (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))))
+# define A2_SHA1_X86 1
+# include <cpuid.h>
+# include <immintrin.h>
+#endif
+
+namespace aria2 {
+
+namespace sha1 {
+
+namespace {
+const uint32_t H0[] = {
+  0x67452301u, 0xefcdab89u, 0x98badcfeu, 0x10325476u, 0xc3d2e1f0u
+};
+} // namespace
+
+namespace {
+const uint32_t K[] = { 0x5a827999u, 0x6ed9eba1u, 0x8f1bbcdcu, 0xca62c1d6u };
+} // namespace
+
+namespace {
+inline uint32_t rotl(uint32_t x, int n)
+{
+  return (x << n) | (x >> (32-n));
+}
+} // namespace
+
+namespace {
+inline uint32_t loadBE32(const unsigned char* p)
+{
+  return (static_cast<uint32_t>(p[0]) << 24) |
+    (static_cast<uint32_t>(p[1]) << 16) |
+    (static_cast<uint32_t>(p[2]) << 8) | p[3];
+}
+} // namespace
+
+namespace {
+inline void storeBE32(unsigned char* p, uint32_t x)
+{
+  p[0] = x >> 24;
+  p[1] = x >> 16;
+  p[2] = x >> 8;
+  p[3] = x;
+}
+} // namespace
+
+#define GENERIC_ROUND(F, KT)                    \
+  {                                             \
+    uint32_t temp = rotl(a, 5)+(F)+e+KT+w[t];   \
+    e = d;                                      \
+    d = c;                                      \
+    c = rotl(b, 30);                            \
+    b = a;                                      \
+    a = temp;                                   \
+  }
+
+namespace {
+void compressGeneric(uint32_t* s, const unsigned char* data, size_t blocks)
+{
+  uint32_t w[80];
+  for(; blocks > 0; --blocks, data += BLOCK_LENGTH) {
+    for(int t = 0; t < 16; ++t) {
+      w[t] = loadBE32(data+t*4);
+    }
+    for(int t = 16; t < 80; ++t) {
+      w[t] = rotl(w[t-3]^w[t-8]^w[t-14]^w[t-16], 1);
+    }
+    uint32_t a = s[0], b = s[1], c = s[2], d = s[3], e = s[4];
+    int t = 0;
+    for(; t < 20; ++t) {
+      GENERIC_ROUND(d^(b&(c^d)), K[0]);
+    }
+    for(; t < 40; ++t) {
+      GENERIC_ROUND(b^c^d, K[1]);
+    }
+    for(; t < 60; ++t) {
+      GENERIC_ROUND((b&c)|(d&(b|c)), K[2]);
+    }
+    for(; t < 80; ++t) {
+      GENERIC_ROUND(b^c^d, K[3]);
+    }
+    s[0] += a;
+    s[1] += b;
+    s[2] += c;
+    s[3] += d;
+    s[4] += e;
+  }
+}
+} // namespace
+
+#undef GENERIC_ROUND
+
+#ifdef A2_SHA1_X86
+
+namespace {
+enum {
+  CPU_SHANI = 1,
+  CPU_AVX2 = 1 << 1
+};
+} // namespace
+
+namespace {
+int detectCpuFeatures()
+{
+  unsigned int eax, ebx, ecx, edx;
+  if(!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+    return 0;
+  }
+  bool ssse3 = ecx & (1u << 9);
+  bool sse41 = ecx & (1u << 19);
+  bool osxsave = ecx & (1u << 27);
+  bool avx = ecx & (1u << 28);
+  if(__get_cpuid_max(0, 0) < 7) {
+    return 0;
+  }
+  __cpuid_count(7, 0, eax, ebx, ecx, edx);
+  int features = 0;
+  if((ebx & (1u << 29)) && ssse3 && sse41) {
+    features |= CPU_SHANI;
+  }
+  if((ebx & (1u << 5)) && osxsave && avx) {
+    // The OS must save the YMM registers on context switch.
+    uint32_t xcr0lo, xcr0hi;
+    __asm__ ("xgetbv" : "=a"(xcr0lo), "=d"(xcr0hi) : "c"(0));
+    if((xcr0lo & 6) == 6) {
+      features |= CPU_AVX2;
+    }
+  }
+  return features;
+}
+} // namespace
+
+namespace {
+int getCpuFeatures()
+{
+  static int features = detectCpuFeatures();
+  return features;
+}
+} // namespace
+
+// Each group of 4 rounds from 16 on follows the same pattern: cur
+// holds W[4g..4g+3], next is completed with sha1msg2, prev is started
+// with sha1msg1 and prev2 is advanced with xor.
+#define SHANI_ROUNDS(EX, EY, CUR, NEXT, PREV, PREV2, FUNC)     \
+  EX = _mm_sha1nexte_epu32(EX, CUR);                           \
+  EY = abcd;                                                   \
+  NEXT = _mm_sha1msg2_epu32(NEXT, CUR);                        \
+  abcd = _mm_sha1rnds4_epu32(abcd, EX, FUNC);                  \
+  PREV = _mm_sha1msg1_epu32(PREV, CUR);                        \
+  PREV2 = _mm_xor_si128(PREV2, CUR)
+
+namespace {
+__attribute__((target("sha,sse4.1,ssse3")))
+void compressShaNi(uint32_t* s, const unsigned char* data, size_t blocks)
+{
+  const __m128i mask = _mm_set_epi64x(0x0001020304050607LL,
+                                      0x08090a0b0c0d0e0fLL);
+  __m128i abcd = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
+  abcd = _mm_shuffle_epi32(abcd, 0x1b);
+  __m128i e0 = _mm_set_epi32(s[4], 0, 0, 0);
+  __m128i e1;
+  for(; blocks > 0; --blocks, data += BLOCK_LENGTH) {
+    __m128i abcdSave = abcd;
+    __m128i e0Save = e0;
+    __m128i m0 = _mm_shuffle_epi8
+      (_mm_loadu_si128(reinterpret_cast<const __m128i*>(data)), mask);
+    __m128i m1 = _mm_shuffle_epi8
+      (_mm_loadu_si128(reinterpret_cast<const __m128i*>(data+16)), mask);
+    __m128i m2 = _mm_shuffle_epi8
+      (_mm_loadu_si128(reinterpret_cast<const __m128i*>(data+32)), mask);
+    __m128i m3 = _mm_shuffle_epi8
+      (_mm_loadu_si128(reinterpret_cast<const __m128i*>(data+48)), mask);
+    // Rounds 0-15 load the message.
+    e0 = _mm_add_epi32(e0, m0);
+    e1 = abcd;
+    abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+
+    e1 = _mm_sha1nexte_epu32(e1, m1);
+    e0 = abcd;
+    abcd = _mm_sha1rnds4_epu32(abcd, e1, 0);
+    m0 = _mm_sha1msg1_epu32(m0, m1);
+
+    e0 = _mm_sha1nexte_epu32(e0, m2);
+    e1 = abcd;
+    abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+    m1 = _mm_sha1msg1_epu32(m1, m2);
+    m0 = _mm_xor_si128(m0, m2);
+
+    SHANI_ROUNDS(e1, e0, m3, m0, m2, m1, 0);
+    // Rounds 16-79. Message words computed after round 79 are unused.
+    SHANI_ROUNDS(e0, e1, m0, m1, m3, m2, 0);
+    SHANI_ROUNDS(e1, e0, m1, m2, m0, m3, 1);
+    SHANI_ROUNDS(e0, e1, m2, m3, m1, m0, 1);
+    SHANI_ROUNDS(e1, e0, m3, m0, m2, m1, 1);
+    SHANI_ROUNDS(e0, e1, m0, m1, m3, m2, 1);
+    SHANI_ROUNDS(e1, e0, m1, m2, m0, m3, 1);
+    SHANI_ROUNDS(e0, e1, m2, m3, m1, m0, 2);
+    SHANI_ROUNDS(e1, e0, m3, m0, m2, m1, 2);
+    SHANI_ROUNDS(e0, e1, m0, m1, m3, m2, 2);
+    SHANI_ROUNDS(e1, e0, m1, m2, m0, m3, 2);
+    SHANI_ROUNDS(e0, e1, m2, m3, m1, m0, 2);
+    SHANI_ROUNDS(e1, e0, m3, m0, m2, m1, 3);
+    SHANI_ROUNDS(e0, e1, m0, m1, m3, m2, 3);
+    SHANI_ROUNDS(e1, e0, m1, m2, m0, m3, 3);
+    SHANI_ROUNDS(e0, e1, m2, m3, m1, m0, 3);
+
+    e1 = _mm_sha1nexte_epu32(e1, m3);
+    e0 = abcd;
+    abcd = _mm_sha1rnds4_epu32(abcd, e1, 3);
+
+    e0 = _mm_sha1nexte_epu32(e0, e0Save);
+    abcd = _mm_add_epi32(abcd, abcdSave);
+  }
+  abcd = _mm_shuffle_epi32(abcd, 0x1b);
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(s), abcd);
+  s[4] = _mm_extract_epi32(e0, 3);
+}
+} // namespace
+
+#undef SHANI_ROUNDS
+
+#define AVX2_ROTL(X, N)                                                 \
+  _mm256_or_si256(_mm256_slli_epi32(X, N), _mm256_srli_epi32(X, 32-N))
+
+#define AVX2_ROUND(F, KT)                                               \
+  {                                                                     \
+    __m256i wt;                                                         \
+    if(t < 16) {                                                        \
+      wt = w[t];                                                        \
+    } else {                                                            \
+      wt = _mm256_xor_si256(_mm256_xor_si256(w[(t-3)&15], w[(t-8)&15]), \
+                            _mm256_xor_si256(w[(t-14)&15], w[t&15]));   \
+      wt = AVX2_ROTL(wt, 1);                                            \
+      w[t&15] = wt;                                                     \
+    }                                                                   \
+    __m256i temp = _mm256_add_epi32                                     \
+      (_mm256_add_epi32(AVX2_ROTL(a, 5), F),                            \
+       _mm256_add_epi32(_mm256_add_epi32(e, KT), wt));                  \
+    e = d;                                                              \
+    d = c;                                                              \
+    c = AVX2_ROTL(b, 30);                                               \
+    b = a;                                                              \
+    a = temp;                                                           \
+  }
+
+namespace {
+// Hashes MAX_LANES messages in the lanes of 256 bit registers.
+__attribute__((target("avx2")))
+void compressAvx2
+(uint32_t h[5][MAX_LANES], const unsigned char* const* data, size_t blocks)
+{
+  const __m256i bswap = _mm256_set_epi8
+    (12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3,
+     12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
+  const __m256i k0 = _mm256_set1_epi32(K[0]);
+  const __m256i k1 = _mm256_set1_epi32(K[1]);
+  const __m256i k2 = _mm256_set1_epi32(K[2]);
+  const __m256i k3 = _mm256_set1_epi32(K[3]);
+  __m256i s[5];
+  for(int i = 0; i < 5; ++i) {
+    s[i] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(h[i]));
+  }
+  __m256i w[16];
+  for(size_t offset = 0; blocks > 0; --blocks, offset += BLOCK_LENGTH) {
+    // Transpose 8 words of each message so that w[t] holds word t of
+    // all messages.
+    for(int half = 0; half < 2; ++half) {
+      __m256i r[8];
+      for(int i = 0; i < 8; ++i) {
+        r[i] = _mm256_shuffle_epi8
+          (_mm256_loadu_si256(reinterpret_cast<const __m256i*>
+                              (data[i]+offset+half*32)), bswap);
+      }
+      __m256i t0 = _mm256_unpacklo_epi32(r[0], r[1]);
+      __m256i t1 = _mm256_unpackhi_epi32(r[0], r[1]);
+      __m256i t2 = _mm256_unpacklo_epi32(r[2], r[3]);
+      __m256i t3 = _mm256_unpackhi_epi32(r[2], r[3]);
+      __m256i t4 = _mm256_unpacklo_epi32(r[4], r[5]);
+      __m256i t5 = _mm256_unpackhi_epi32(r[4], r[5]);
+      __m256i t6 = _mm256_unpacklo_epi32(r[6], r[7]);
+      __m256i t7 = _mm256_unpackhi_epi32(r[6], r[7]);
+      __m256i u0 = _mm256_unpacklo_epi64(t0, t2);
+      __m256i u1 = _mm256_unpackhi_epi64(t0, t2);
+      __m256i u2 = _mm256_unpacklo_epi64(t1, t3);
+      __m256i u3 = _mm256_unpackhi_epi64(t1, t3);
+      __m256i u4 = _mm256_unpacklo_epi64(t4, t6);
+      __m256i u5 = _mm256_unpackhi_epi64(t4, t6);
+      __m256i u6 = _mm256_unpacklo_epi64(t5, t7);
+      __m256i u7 = _mm256_unpackhi_epi64(t5, t7);
+      __m256i* dst = w+half*8;
+      dst[0] = _mm256_permute2x128_si256(u0, u4, 0x20);
+      dst[1] = _mm256_permute2x128_si256(u1, u5, 0x20);
+      dst[2] = _mm256_permute2x128_si256(u2, u6, 0x20);
+      dst[3] = _mm256_permute2x128_si256(u3, u7, 0x20);
+      dst[4] = _mm256_permute2x128_si256(u0, u4, 0x31);
+      dst[5] = _mm256_permute2x128_si256(u1, u5, 0x31);
+      dst[6] = _mm256_permute2x128_si256(u2, u6, 0x31);
+      dst[7] = _mm256_permute2x128_si256(u3, u7, 0x31);
+    }
+    __m256i a = s[0], b = s[1], c = s[2], d = s[3], e = s[4];
+    int t = 0;
+    for(; t < 20; ++t) {
+      AVX2_ROUND(_mm256_xor_si256
+                 (d, _mm256_and_si256(b, _mm256_xor_si256(c, d))), k0);
+    }
+    for(; t < 40; ++t) {
+      AVX2_ROUND(_mm256_xor_si256(_mm256_xor_si256(b, c), d), k1);
+    }
+    for(; t < 60; ++t) {
+      AVX2_ROUND(_mm256_or_si256
+                 (_mm256_and_si256(b, c),
+                  _mm256_and_si256(d, _mm256_or_si256(b, c))), k2);
+    }
+    for(; t < 80; ++t) {
+      AVX2_ROUND(_mm256_xor_si256(_mm256_xor_si256(b, c), d), k3);
+    }
+    s[0] = _mm256_add_epi32(s[0], a);
+    s[1] = _mm256_add_epi32(s[1], b);
+    s[2] = _mm256_add_epi32(s[2], c);
+    s[3] = _mm256_add_epi32(s[3], d);
+    s[4] = _mm256_add_epi32(s[4], e);
+  }
+  for(int i = 0; i < 5; ++i) {
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(h[i]), s[i]);
+  }
+}
+} // namespace
+
+#undef AVX2_ROUND
+#undef AVX2_ROTL
+
+#endif // A2_SHA1_X86
+
+bool isSupported(Impl impl)
+{
+  switch(impl) {
+  case IMPL_GENERIC:
+    return true;
+#ifdef A2_SHA1_X86
+  case IMPL_SHANI:
+    return getCpuFeatures()&CPU_SHANI;
+  case IMPL_AVX2:
+    return getCpuFeatures()&CPU_AVX2;
+#endif // A2_SHA1_X86
+  default:
+    return false;
+  }
+}
+
+const char* getImplName(Impl impl)
+{
+  switch(impl) {
+  case IMPL_SHANI:
+    return "sha-ni";
+  case IMPL_AVX2:
+    return "avx2";
+  default:
+    return "generic";
+  }
+}
+
+size_t getLanes(Impl impl)
+{
+  return impl == IMPL_AVX2 ? MAX_LANES : 1;
+}
+
+Impl getBatchImpl()
+{
+  if(isSupported(IMPL_AVX2)) {
+    return IMPL_AVX2;
+  } else if(isSupported(IMPL_SHANI)) {
+    return IMPL_SHANI;
+  } else {
+    return IMPL_GENERIC;
+  }
+}
+
+MultiContext::MultiContext(size_t n, Impl impl)
+  : impl_(isSupported(impl) ? impl : IMPL_GENERIC),
+    n_(n)
+{
+  assert(0 < n && n <= MAX_LANES);
+  reset();
+}
+
+void MultiContext::reset()
+{
+  for(size_t i = 0; i < 5; ++i) {
+    std::fill(&h_[i][0], &h_[i][MAX_LANES], H0[i]);
+  }
+  bufLength_ = 0;
+  length_ = 0;
+}
+
+void MultiContext::compress(const unsigned char* const* data, size_t blocks)
+{
+#ifdef A2_SHA1_X86
+  if(impl_ == IMPL_AVX2) {
+    // Unused lanes hash a copy of the first message.
+    const unsigned char* lanes[MAX_LANES];
+    for(size_t i = 0; i < MAX_LANES; ++i) {
+      lanes[i] = data[i < n_ ? i : 0];
+    }
+    compressAvx2(h_, lanes, blocks);
+    return;
+  }
+#endif // A2_SHA1_X86
+  for(size_t i = 0; i < n_; ++i) {
+    uint32_t s[5];
+    for(size_t j = 0; j < 5; ++j) {
+      s[j] = h_[j][i];
+    }
+#ifdef A2_SHA1_X86
+    if(impl_ == IMPL_SHANI) {
+      compressShaNi(s, data[i], blocks);
+    } else {
+      compressGeneric(s, data[i], blocks);
+    }
+#else // !A2_SHA1_X86
+    compressGeneric(s, data[i], blocks);
+#endif // !A2_SHA1_X86
+    for(size_t j = 0; j < 5; ++j) {
+      h_[j][i] = s[j];
+    }
+  }
+}
+
+void MultiContext::update(const unsigned char* const* data, size_t length)
+{
+  const unsigned char* p[MAX_LANES];
+  length_ += length;
+  size_t offset = 0;
+  if(bufLength_ > 0) {
+    offset = std::min(BLOCK_LENGTH-bufLength_, length);
+    for(size_t i = 0; i < n_; ++i) {
+      memcpy(buf_[i]+bufLength_, data[i], offset);
+      p[i] = buf_[i];
+    }
+    bufLength_ += offset;
+    if(bufLength_ < BLOCK_LENGTH) {
+      return;
+    }
+    compress(p, 1);
+    bufLength_ = 0;
+  }
+  size_t blocks = (length-offset)/BLOCK_LENGTH;
+  if(blocks > 0) {
+    for(size_t i = 0; i < n_; ++i) {
+      p[i] = data[i]+offset;
+    }
+    compress(p, blocks);
+    offset += blocks*BLOCK_LENGTH;
+  }
+  if(offset < length) {
+    bufLength_ = length-offset;
+    for(size_t i = 0; i < n_; ++i) {
+      memcpy(buf_[i], data[i]+offset, bufLength_);
+    }
+  }
+}
+
+void MultiContext::digest(unsigned char* const* md)
+{
+  // All messages have the same length, so they need the same number
+  // of padding blocks.
+  unsigned char pad[MAX_LANES][BLOCK_LENGTH*2];
+  size_t padLength = bufLength_ < BLOCK_LENGTH-8 ?
+    BLOCK_LENGTH : BLOCK_LENGTH*2;
+  uint64_t bits = length_*8;
+  const unsigned char* p[MAX_LANES];
+  for(size_t i = 0; i < n_; ++i) {
+    memcpy(pad[i], buf_[i], bufLength_);
+    pad[i][bufLength_] = 0x80;
+    memset(pad[i]+bufLength_+1, 0, padLength-bufLength_-1);
+    storeBE32(pad[i]+padLength-8, bits >> 32);
+    storeBE32(pad[i]+padLength-4, bits);
+    p[i] = pad[i];
+  }
+  compress(p, padLength/BLOCK_LENGTH);
+  for(size_t i = 0; i < n_; ++i) {
+    for(size_t j = 0; j < 5; ++j) {
+      storeBE32(md[i]+j*4, h_[j][i]);
+    }
+  }
+}
+
+} // namespace sha1
+
+} // namespace aria2
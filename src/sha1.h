@@ -0,0 +1,120 @@
+/* <!-- copyright */
+/*
+ * aria2 - The high speed download utility
+ *
+ * Copyright (C) 2011 Tatsuhiro Tsujikawa
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.  If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so.  If you
+ * do not wish to do so, delete this exception statement from your
+ * version.  If you delete this exception statement from all source
+ * files in the program, then also delete it here.
+ */
+/* copyright --> */
+#ifndef D_SHA1_H
+#define D_SHA1_H
+
+#include "common.h"
+
+#include <cstddef>
+#include <stdint.h>
+
+namespace aria2 {
+
+// Built-in SHA-1 engine for hashing many equally sized pieces, such as
+// in piece hash verification.  The compression function is selected
+// at runtime: SHA-NI hashes one message at a time with the dedicated
+// instructions, and AVX2 hashes up to 8 messages in parallel lanes.
+// Other hashing goes through MessageDigest.
+namespace sha1 {
+
+const size_t DIGEST_LENGTH = 20;
+
+const size_t BLOCK_LENGTH = 64;
+
+// The maximum number of messages hashed together by MultiContext.
+const size_t MAX_LANES = 8;
+
+enum Impl {
+  IMPL_GENERIC,
+  IMPL_SHANI,
+  IMPL_AVX2
+};
+
+// Returns true if impl can be used on this CPU and was compiled in.
+bool isSupported(Impl impl);
+
+const char* getImplName(Impl impl);
+
+// Returns the number of messages impl hashes at once.
+size_t getLanes(Impl impl);
+
+// Returns the fastest supported impl for hashing several equally
+// sized messages.  AVX2 is preferred over SHA-NI because 8 lanes of
+// AVX2 have more throughput than SHA-NI hashing one message at a time.
+Impl getBatchImpl();
+
+// Hashes n messages, 1 <= n <= MAX_LANES, which all have the same
+// length.
+class MultiContext {
+private:
+  Impl impl_;
+  size_t n_;
+  // State of each message, word-major so that lanes are contiguous.
+  uint32_t h_[5][MAX_LANES];
+  // Trailing bytes not filling a block yet. Its length is the same for
+  // all messages.
+  unsigned char buf_[MAX_LANES][BLOCK_LENGTH];
+  size_t bufLength_;
+  uint64_t length_;
+
+  void compress(const unsigned char* const* data, size_t blocks);
+public:
+  MultiContext(size_t n, Impl impl = getBatchImpl());
+
+  void reset();
+
+  // Appends length bytes from data[i] to message i, for each i < n.
+  void update(const unsigned char* const* data, size_t length);
+
+  // Writes the digest of message i to md[i], which must have room for
+  // DIGEST_LENGTH bytes.  Call reset() to reuse this object.
+  void digest(unsigned char* const* md);
+
+  size_t getNumMessages() const
+  {
+    return n_;
+  }
+
+  Impl getImpl() const
+  {
+    return impl_;
+  }
+};
+
+} // namespace sha1
+
+} // namespace aria2
+
+#endif // D_SHA1_H
@@ -139,6 +139,19 @@
     "                              entirely until allocation finishes. 'falloc' may\n" \
     "                              not be available if your system doesn't have\n" \
     "                              posix_fallocate() function.")
+#define TEXT_FILE_ALLOCATION_SPEED_LIMIT                                \
+  _(" --file-allocation-speed-limit=SPEED Set the maximum number of bytes per\n" \
+    "                              second written to pre-allocate files. 0 means\n" \
+    "                              unrestricted.\n"                    \
+    "                              This option has no effect with\n"   \
+    "                              --file-allocation=falloc, and little effect with\n" \
+    "                              'prealloc' on file systems supporting\n" \
+    "                              fallocate(), because the whole file is allocated\n" \
+    "                              in a single call.\n"                \
+    "                              You can append K or M(1K = 1024, 1M = 1024K).")
+#define TEXT_MAX_CONCURRENT_FILE_ALLOCATIONS                            \
+  _(" --max-concurrent-file-allocations=N Set maximum number of files which are\n" \
+    "                              pre-allocated in parallel.")
 #define TEXT_NO_FILE_ALLOCATION_LIMIT                                   \
   _(" --no-file-allocation-limit=SIZE No file allocation is made for files whose\n" \
     "                              size is smaller than SIZE.\n"        \
@@ -466,6 +479,13 @@
     "                              If 0 is given, a control file is not saved during\n" \
     "                              download. aria2 saves a control file when it stops\n" \
     "                              regardless of the value.")
+#define TEXT_AUTO_SAVE_IN_PLACE                                         \
+  _(" --auto-save-in-place[=true|false] Once a control file is written, update\n" \
+    "                              only the changed parts of it in place instead of\n" \
+    "                              rewriting the whole file. This reduces I/O for\n" \
+    "                              downloads with large bitfields, but the file may\n" \
+    "                              be left inconsistent if aria2 is killed while\n" \
+    "                              saving it.")
 #define TEXT_CERTIFICATE                                                \
   _(" --certificate=FILE           Use the client certificate in FILE.\n" \
     "                              The certificate must be in PEM format.\n" \
@@ -573,6 +593,20 @@
     "                              tail=SIZE means the range of last SIZE bytes of\n" \
     "                              each file. SIZE can include K or M(1K = 1024, 1M =\n" \
     "                              1024K). If SIZE is omitted, SIZE=1M is used.")
+#define TEXT_BT_STREAM_WINDOW                                           \
+  _(" --bt-stream-window=SIZE      Download pieces in the range of SIZE bytes\n" \
+    "                              from the position given by --bt-stream-position\n" \
+    "                              in order, before other pieces. Blocks of pieces\n" \
+    "                              in this range may be requested from more than\n" \
+    "                              one peer. This is useful for playing a file while\n" \
+    "                              downloading it. If 0 is given, this feature is\n" \
+    "                              disabled.\n"                        \
+    "                              You can append K or M(1K = 1024, 1M = 1024K).")
+#define TEXT_BT_STREAM_POSITION                                         \
+  _(" --bt-stream-position=POS     Set the playback position in bytes, counted from\n" \
+    "                              the beginning of the torrent, used by\n" \
+    "                              --bt-stream-window option.\n"       \
+    "                              You can append K or M(1K = 1024, 1M = 1024K).")
 #define TEXT_INTERFACE                                                  \
   _(" --interface=INTERFACE        Bind sockets to given interface. You can specify\n" \
     "                              interface name, IP address and hostname.")
@@ -725,6 +759,13 @@
     "                              announce URIs. When specifying '*' in shell\n" \
     "                              command-line, don't forget to escape or quote it.\n" \
     "                              See also --bt-tracker option.")
+#define TEXT_BT_PIECE_INDEX                                             \
+  _(" --bt-piece-index=FILE        Keep an index of the pieces of completed\n" \
+    "                              BitTorrent downloads in FILE. Before a piece is\n" \
+    "                              requested from peers, aria2 looks up its hash in\n" \
+    "                              the index and, if a local file holds the same\n" \
+    "                              data, copies the piece from there. Only pieces\n" \
+    "                              lying within a single file are indexed.")
 #define TEXT_MAX_DOWNLOAD_RESULT                \
   _(" --max-download-result=NUM    Set maximum number of download result kept in\n" \
     "                              memory. The download results are completed/error/\n" \
@@ -783,8 +824,28 @@
   _(" --xml-rpc-listen-port=PORT   Deprecated. Use --rpc-listen-port instead.")
 #define TEXT_SHOW_CONSOLE_READOUT                                       \
   _(" --show-console-readout[=true|false] Show console readout.")
+#define TEXT_PROFILE_COMMANDS                                           \
+  _(" --profile-commands[=true|false] Measure the time taken by each command in\n" \
+    "                              the event loop. The totals per command type are\n" \
+    "                              logged at exit and served at /metrics of the RPC\n" \
+    "                              server.")
+#define TEXT_SLOW_COMMAND_THRESHOLD                                     \
+  _(" --slow-command-threshold=MSEC Log a command which takes MSEC milliseconds or\n" \
+    "                              more to execute. 0 disables this feature.")
+#define TEXT_HASH_THREADS                                               \
+  _(" --hash-threads=N             Compute piece hashes and checksums in N worker\n" \
+    "                              threads instead of the main thread. 0 disables\n" \
+    "                              this feature.")
 #define TEXT_METALINK_BASE_URI                  \
   _(" --metalink-base-uri=URI      Specify base URI to resolve relative URI in\n" \
     "                              metalink:url and metalink:metaurl element in a\n" \
     "                              metalink file stored in local disk. If URI points\n" \
     "                              to a directory, URI must end with '/'.")
+#define TEXT_DEFERRED_INPUT                                             \
+  _(" --deferred-input[=true|false] If true is given, aria2 does not read all URIs\n" \
+    "                              and options from file specified by -i option at\n" \
+    "                              startup, but it reads one by one when it needs\n" \
+    "                              later. This may reduce memory usage and startup\n" \
+    "                              time if input file contains a lot of URIs to\n" \
+    "                              download. If false is given, aria2 reads all URIs\n" \
+    "                              and options at startup.")
@@ -0,0 +1,82 @@
+#include "common.h"
+
+#include <sys/time.h>
+
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <iostream>
+#include <vector>
+#include <algorithm>
+
+#include "Platform.h"
+#include "SocketCore.h"
+#include "util.h"
+#include "Benchmark.h"
+
+// Runs the benchmarks registered by A2_BENCHMARK_REGISTRATION and
+// prints one JSON object per benchmark to stdout, for example:
+//
+// {"name":"BitfieldMan.countMissingBlock","iterations":1000,
+//  "repeat":5,"minNsPerOp":1234.5,"medianNsPerOp":1240.0}
+//
+// Usage: aria2bench [-r REPEAT] [PATTERN...]
+//
+// If PATTERNs are given, only the benchmarks whose name contains one
+// of them are run.
+int main(int argc, char* argv[]) {
+  aria2::Platform platform;
+
+  aria2::SocketCore::setProtocolFamily(AF_INET);
+  aria2::setDefaultAIFlags(0);
+  aria2::util::mkdirs(A2_TEST_OUT_DIR);
+
+  size_t repeat = 5;
+  std::vector<std::string> patterns;
+  for(int i = 1; i < argc; ++i) {
+    if(strcmp(argv[i], "-r") == 0 && i+1 < argc) {
+      repeat = std::max(1, atoi(argv[++i]));
+    } else {
+      patterns.push_back(argv[i]);
+    }
+  }
+  const std::vector<aria2::BenchmarkEntry>& registry =
+    aria2::getBenchmarkRegistry();
+  for(std::vector<aria2::BenchmarkEntry>::const_iterator i =
+        registry.begin(), eoi = registry.end(); i != eoi; ++i) {
+    if(!patterns.empty()) {
+      bool match = false;
+      for(std::vector<std::string>::const_iterator j = patterns.begin(),
+            eoj = patterns.end(); j != eoj && !match; ++j) {
+        match = (*i).name.find(*j) != std::string::npos;
+      }
+      if(!match) {
+        continue;
+      }
+    }
+    aria2::Benchmark* bench = (*i).factory();
+    bench->setUp();
+    // Warm up caches before measurement.
+    bench->run(std::max((size_t)1, (*i).iterations/10));
+    std::vector<double> nsPerOp;
+    for(size_t r = 0; r < repeat; ++r) {
+      struct timeval start, end;
+      gettimeofday(&start, 0);
+      bench->run((*i).iterations);
+      gettimeofday(&end, 0);
+      nsPerOp.push_back
+        (aria2::util::difftv(end, start)*1000.0/(*i).iterations);
+    }
+    bench->tearDown();
+    delete bench;
+    std::sort(nsPerOp.begin(), nsPerOp.end());
+    printf("{\"name\":\"%s\",\"iterations\":%lu,\"repeat\":%lu,"
+           "\"minNsPerOp\":%.1f,\"medianNsPerOp\":%.1f}\n",
+           (*i).name.c_str(),
+           static_cast<unsigned long>((*i).iterations),
+           static_cast<unsigned long>(repeat),
+           nsPerOp.front(), nsPerOp[nsPerOp.size()/2]);
+    fflush(stdout);
+  }
+  return 0;
+}
@@ -0,0 +1,40 @@
+#include "Benchmark.h"
+
+namespace aria2 {
+
+std::vector<BenchmarkEntry>& getBenchmarkRegistry()
+{
+  static std::vector<BenchmarkEntry> registry;
+  return registry;
+}
+
+BenchmarkRegistration::BenchmarkRegistration
+(const std::string& name, BenchmarkFactory factory, size_t iterations)
+{
+  BenchmarkEntry entry;
+  entry.name = name;
+  entry.factory = factory;
+  entry.iterations = iterations;
+  getBenchmarkRegistry().push_back(entry);
+}
+
+namespace {
+volatile size_t sink;
+uint32_t randomState = 2463534242U;
+} // namespace
+
+void benchmarkSink(size_t value)
+{
+  sink += value;
+}
+
+uint32_t benchmarkRandom()
+{
+  // xorshift32
+  randomState ^= randomState << 13;
+  randomState ^= randomState >> 17;
+  randomState ^= randomState << 5;
+  return randomState;
+}
+
+} // namespace aria2
@@ -0,0 +1,63 @@
+#ifndef D_BENCHMARK_H
+#define D_BENCHMARK_H
+
+#include "common.h"
+
+#include <string>
+#include <vector>
+
+namespace aria2 {
+
+// Base class of benchmarks run by aria2bench. setUp() and tearDown()
+// are not timed. run(n) must perform the measured operation n times.
+class Benchmark {
+public:
+  virtual ~Benchmark() {}
+
+  virtual void setUp() {}
+
+  virtual void run(size_t n) = 0;
+
+  virtual void tearDown() {}
+};
+
+typedef Benchmark* (*BenchmarkFactory)();
+
+struct BenchmarkEntry {
+  std::string name;
+  BenchmarkFactory factory;
+  // The number of operations performed in one measurement.
+  size_t iterations;
+};
+
+std::vector<BenchmarkEntry>& getBenchmarkRegistry();
+
+class BenchmarkRegistration {
+public:
+  BenchmarkRegistration
+  (const std::string& name, BenchmarkFactory factory, size_t iterations);
+};
+
+template<typename T>
+Benchmark* createBenchmark()
+{
+  return new T();
+}
+
+// Passes the result of the measured operation here, so that the
+// compiler does not optimize the operation away.
+void benchmarkSink(size_t value);
+
+// Returns a pseudo random number. The sequence is the same in every
+// run, so that the results are reproducible.
+uint32_t benchmarkRandom();
+
+} // namespace aria2
+
+#define A2_BENCHMARK_REGISTRATION(klass, name, iterations)              \
+  namespace {                                                           \
+  BenchmarkRegistration klass##Registration                             \
+  (name, &createBenchmark<klass>, iterations);                          \
+  }
+
+#endif // D_BENCHMARK_H
@@ -0,0 +1,53 @@
+#include "Benchmark.h"
+
+#include "bencode2.h"
+#include "ValueBase.h"
+#include "util.h"
+
+namespace aria2 {
+
+namespace {
+// Decodes a multi-file torrent with 256 files and 4096 pieces.
+class Bencode2DecodeBench:public Benchmark {
+private:
+  std::string torrent_;
+public:
+  virtual void setUp()
+  {
+    SharedHandle<Dict> info = Dict::g();
+    SharedHandle<List> files = List::g();
+    for(size_t i = 0; i < 256; ++i) {
+      SharedHandle<Dict> file = Dict::g();
+      file->put("length", Integer::g(1024*1024+i));
+      SharedHandle<List> path = List::g();
+      path->append(String::g("dir"));
+      path->append(String::g("file"+util::uitos(i)+".dat"));
+      file->put("path", path);
+      files->append(file);
+    }
+    info->put("files", files);
+    info->put("name", String::g("benchmark"));
+    info->put("piece length", Integer::g(64*1024));
+    std::string pieces;
+    for(size_t i = 0; i < 4096*20; ++i) {
+      pieces += static_cast<char>(benchmarkRandom());
+    }
+    info->put("pieces", String::g(pieces));
+    SharedHandle<Dict> torrent = Dict::g();
+    torrent->put("announce", String::g("http://tracker.example.org/announce"));
+    torrent->put("info", info);
+    torrent_ = bencode2::encode(torrent);
+  }
+
+  virtual void run(size_t n)
+  {
+    for(size_t i = 0; i < n; ++i) {
+      benchmarkSink(asDict(bencode2::decode(torrent_))->size());
+    }
+  }
+};
+} // namespace
+
+A2_BENCHMARK_REGISTRATION(Bencode2DecodeBench, "bencode2.decode", 100);
+
+} // namespace aria2
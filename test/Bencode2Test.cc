@@ -1,8 +1,12 @@
 #include "bencode2.h"
 
+#include <limits>
+#include <sstream>
+
 #include <cppunit/extensions/HelperMacros.h>
 
 #include "RecoverableException.h"
+#include "util.h"
 
 namespace aria2 {
 
@@ -11,6 +15,8 @@ class Bencode2Test:public CppUnit::TestFixture {
   CPPUNIT_TEST_SUITE(Bencode2Test);
   CPPUNIT_TEST(testDecode);
   CPPUNIT_TEST(testDecode_overflow);
+  CPPUNIT_TEST(testDecode_integer);
+  CPPUNIT_TEST(testDecode_truncated);
   CPPUNIT_TEST(testEncode);
   CPPUNIT_TEST_SUITE_END();
 private:
@@ -18,6 +24,8 @@ private:
 public:
   void testDecode();
   void testDecode_overflow();
+  void testDecode_integer();
+  void testDecode_truncated();
   void testEncode();
 };
 
@@ -160,6 +168,16 @@ void Bencode2Test::testDecode()
     CPPUNIT_ASSERT_EQUAL(std::string("aria2"), asString(s)->s());
     CPPUNIT_ASSERT_EQUAL((size_t)7, end);
   }
+  {
+    // stream is read to the end and trailing garbage is ignored.
+    std::istringstream in("d4:name5:aria2etrail");
+    SharedHandle<ValueBase> d = bencode2::decode(in);
+    CPPUNIT_ASSERT_EQUAL(std::string("aria2"),
+                         asString(asDict(d)->get("name"))->s());
+    std::string rest;
+    in >> rest;
+    CPPUNIT_ASSERT(rest.empty());
+  }
 }
 
 void Bencode2Test::testDecode_overflow()
@@ -180,6 +198,53 @@ void Bencode2Test::testDecode_overflow()
   }
 }
 
+void Bencode2Test::testDecode_integer()
+{
+  CPPUNIT_ASSERT_EQUAL((Integer::ValueType)-12345,
+                       asInteger(bencode2::decode("i-12345e"))->i());
+  CPPUNIT_ASSERT_EQUAL(std::numeric_limits<Integer::ValueType>::max(),
+                       asInteger(bencode2::decode
+                                 ("i9223372036854775807e"))->i());
+  CPPUNIT_ASSERT_EQUAL(std::numeric_limits<Integer::ValueType>::min(),
+                       asInteger(bencode2::decode
+                                 ("i-9223372036854775808e"))->i());
+  const char* bad[] = {
+    "i9223372036854775808e",
+    "i-9223372036854775809e",
+    "ie",
+    "i-e",
+    "i 1e",
+    "99999999999999999999:a"
+  };
+  for(size_t i = 0; i < sizeof(bad)/sizeof(bad[0]); ++i) {
+    try {
+      bencode2::decode(bad[i]);
+      CPPUNIT_FAIL(std::string("exception must be thrown: ")+bad[i]);
+    } catch(RecoverableException& e) {
+      // success
+    }
+  }
+}
+
+void Bencode2Test::testDecode_truncated()
+{
+  // Every proper prefix of a valid torrent file must be rejected.
+  std::string data = bencode2::encode
+    (bencode2::decodeFromFile(A2_TEST_DIR"/test.torrent"));
+  const unsigned char* p = reinterpret_cast<const unsigned char*>(data.data());
+  size_t end;
+  CPPUNIT_ASSERT(bencode2::decode(p, data.size(), end));
+  CPPUNIT_ASSERT_EQUAL(data.size(), end);
+  for(size_t i = 1; i < data.size(); ++i) {
+    try {
+      bencode2::decode(p, i);
+      CPPUNIT_FAIL("exception must be thrown. length="+util::uitos(i));
+    } catch(RecoverableException& e) {
+      // success
+    }
+  }
+}
+
 void Bencode2Test::testEncode()
 {
   {
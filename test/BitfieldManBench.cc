@@ -0,0 +1,132 @@
+#include "Benchmark.h"
+
+#include <vector>
+
+#include "BitfieldMan.h"
+
+namespace aria2 {
+
+namespace {
+const size_t NUM_PIECES = 16384;
+const size_t PIECE_LENGTH = 16*1024;
+
+// 90% of pieces are complete and 5% are in use. The rest are
+// missing.
+class BitfieldManBench:public Benchmark {
+protected:
+  BitfieldMan bitfield_;
+public:
+  BitfieldManBench():bitfield_(PIECE_LENGTH, (uint64_t)PIECE_LENGTH*NUM_PIECES)
+  {}
+
+  virtual void setUp()
+  {
+    for(size_t i = 0; i < NUM_PIECES; ++i) {
+      uint32_t r = benchmarkRandom()%100;
+      if(r < 90) {
+        bitfield_.setBit(i);
+      } else if(r < 95) {
+        bitfield_.setUseBit(i);
+      }
+    }
+  }
+};
+} // namespace
+
+namespace {
+class GetFirstMissingUnusedIndexBench:public BitfieldManBench {
+public:
+  virtual void setUp()
+  {
+    // Worst case: only the last piece is missing.
+    bitfield_.setAllBit();
+    bitfield_.unsetBit(NUM_PIECES-1);
+  }
+
+  virtual void run(size_t n)
+  {
+    for(size_t i = 0; i < n; ++i) {
+      size_t index;
+      bitfield_.getFirstMissingUnusedIndex(index);
+      benchmarkSink(index);
+    }
+  }
+};
+} // namespace
+
+A2_BENCHMARK_REGISTRATION(GetFirstMissingUnusedIndexBench,
+                          "BitfieldMan.getFirstMissingUnusedIndex", 1000);
+
+namespace {
+class GetSparseMissingUnusedIndexBench:public BitfieldManBench {
+private:
+  std::vector<unsigned char> ignoreBitfield_;
+public:
+  virtual void setUp()
+  {
+    BitfieldManBench::setUp();
+    ignoreBitfield_.assign(bitfield_.getBitfieldLength(), 0);
+  }
+
+  virtual void run(size_t n)
+  {
+    for(size_t i = 0; i < n; ++i) {
+      size_t index = 0;
+      bitfield_.getSparseMissingUnusedIndex
+        (index, 1024*1024, &ignoreBitfield_[0], ignoreBitfield_.size());
+      benchmarkSink(index);
+    }
+  }
+};
+} // namespace
+
+A2_BENCHMARK_REGISTRATION(GetSparseMissingUnusedIndexBench,
+                          "BitfieldMan.getSparseMissingUnusedIndex", 1000);
+
+namespace {
+class GetAllMissingUnusedIndexesBench:public BitfieldManBench {
+private:
+  BitfieldMan peerBitfield_;
+  std::vector<unsigned char> misbitfield_;
+public:
+  GetAllMissingUnusedIndexesBench():
+    peerBitfield_(PIECE_LENGTH, (uint64_t)PIECE_LENGTH*NUM_PIECES) {}
+
+  virtual void setUp()
+  {
+    BitfieldManBench::setUp();
+    peerBitfield_.setAllBit();
+    misbitfield_.resize(bitfield_.getBitfieldLength());
+  }
+
+  virtual void run(size_t n)
+  {
+    for(size_t i = 0; i < n; ++i) {
+      benchmarkSink(bitfield_.getAllMissingUnusedIndexes
+                    (&misbitfield_[0], misbitfield_.size(),
+                     peerBitfield_.getBitfield(),
+                     peerBitfield_.getBitfieldLength()));
+    }
+  }
+};
+} // namespace
+
+A2_BENCHMARK_REGISTRATION(GetAllMissingUnusedIndexesBench,
+                          "BitfieldMan.getAllMissingUnusedIndexes", 10000);
+
+namespace {
+class CountMissingBlockNowBench:public BitfieldManBench {
+public:
+  virtual void run(size_t n)
+  {
+    for(size_t i = 0; i < n; ++i) {
+      benchmarkSink(bitfield_.countMissingBlockNow());
+    }
+  }
+};
+} // namespace
+
+A2_BENCHMARK_REGISTRATION(CountMissingBlockNowBench,
+                          "BitfieldMan.countMissingBlockNow", 10000);
+
+} // namespace aria2
@@ -0,0 +1,84 @@
+#include "CommandProfiler.h"
+
+#include <typeinfo>
+
+#include <cppunit/extensions/HelperMacros.h>
+
+namespace aria2 {
+
+class CommandProfilerTest:public CppUnit::TestFixture {
+
+  CPPUNIT_TEST_SUITE(CommandProfilerTest);
+  CPPUNIT_TEST(testCommandExecuted);
+  CPPUNIT_TEST(testGetCommandName);
+  CPPUNIT_TEST(testToText);
+  CPPUNIT_TEST_SUITE_END();
+public:
+  void testCommandExecuted();
+  void testGetCommandName();
+  void testToText();
+};
+
+
+CPPUNIT_TEST_SUITE_REGISTRATION(CommandProfilerTest);
+
+namespace {
+class MockCommand:public Command {
+public:
+  MockCommand():Command(1) {}
+  virtual bool execute() { return true; }
+};
+} // namespace
+
+void CommandProfilerTest::testCommandExecuted()
+{
+  CommandProfiler profiler;
+  profiler.commandExecuted("N5aria210FooCommandE", 1, 100);
+  profiler.commandExecuted("N5aria210FooCommandE", 2, 300);
+  profiler.commandExecuted("N5aria210BarCommandE", 3, 50);
+  std::map<std::string, CommandProfiler::Stat> stats = profiler.getStats();
+  CPPUNIT_ASSERT_EQUAL((size_t)2, stats.size());
+  CPPUNIT_ASSERT_EQUAL((uint64_t)2, stats["FooCommand"].count);
+  CPPUNIT_ASSERT_EQUAL((int64_t)400, stats["FooCommand"].total);
+  CPPUNIT_ASSERT_EQUAL((int64_t)300, stats["FooCommand"].max);
+  CPPUNIT_ASSERT_EQUAL((uint64_t)1, stats["BarCommand"].count);
+}
+
+void CommandProfilerTest::testGetCommandName()
+{
+  CPPUNIT_ASSERT_EQUAL(std::string("DownloadCommand"),
+                       CommandProfiler::getCommandName
+                       ("N5aria215DownloadCommandE"));
+  CPPUNIT_ASSERT_EQUAL(std::string("MockCommand"),
+                       CommandProfiler::getCommandName
+                       ("N5aria212_GLOBAL__N_111MockCommandE"));
+  CPPUNIT_ASSERT_EQUAL(std::string("Command"),
+                       CommandProfiler::getCommandName("7Command"));
+  CPPUNIT_ASSERT_EQUAL(std::string("Command"),
+                       CommandProfiler::getCommandName("Command"));
+  CPPUNIT_ASSERT_EQUAL(std::string("N5aria27CommandX"),
+                       CommandProfiler::getCommandName("N5aria27CommandX"));
+  CPPUNIT_ASSERT_EQUAL(std::string("N5aria2100FooE"),
+                       CommandProfiler::getCommandName("N5aria2100FooE"));
+#ifdef __GNUC__
+  MockCommand command;
+  CPPUNIT_ASSERT_EQUAL(std::string("MockCommand"),
+                       CommandProfiler::getCommandName
+                       (typeid(command).name()));
+#endif // __GNUC__
+}
+
+void CommandProfilerTest::testToText()
+{
+  CommandProfiler profiler;
+  profiler.commandExecuted("N5aria210FooCommandE", 1, 1500000);
+  std::string text = profiler.toText();
+  CPPUNIT_ASSERT
+    (text.find("aria2_command_executions_total{command=\"FooCommand\"} 1\n")
+     != std::string::npos);
+  CPPUNIT_ASSERT
+    (text.find("aria2_command_seconds_total{command=\"FooCommand\"}"
+               " 1.500000\n") != std::string::npos);
+}
+
+} // namespace aria2
@@ -0,0 +1,116 @@
+#include "DHKeyPool.h"
+
+#include <cstring>
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "DHKeyExchange.h"
+
+namespace aria2 {
+
+class DHKeyPoolTest:public CppUnit::TestFixture {
+
+  CPPUNIT_TEST_SUITE(DHKeyPoolTest);
+  CPPUNIT_TEST(testRefill);
+  CPPUNIT_TEST(testPop);
+  CPPUNIT_TEST(testAddHandshakeTime);
+  CPPUNIT_TEST(testSetCapacity);
+  CPPUNIT_TEST(testAdjustCapacity);
+  CPPUNIT_TEST_SUITE_END();
+public:
+  void testRefill();
+  void testPop();
+  void testAddHandshakeTime();
+  void testSetCapacity();
+  void testAdjustCapacity();
+};
+
+
+CPPUNIT_TEST_SUITE_REGISTRATION(DHKeyPoolTest);
+
+void DHKeyPoolTest::testRefill()
+{
+  DHKeyPool pool(3);
+  CPPUNIT_ASSERT_EQUAL((size_t)2, pool.refill(2));
+  CPPUNIT_ASSERT_EQUAL((size_t)2, pool.size());
+  CPPUNIT_ASSERT_EQUAL((size_t)1, pool.refill(2));
+  CPPUNIT_ASSERT_EQUAL((size_t)3, pool.size());
+  CPPUNIT_ASSERT_EQUAL((size_t)0, pool.refill(2));
+}
+
+void DHKeyPoolTest::testPop()
+{
+  DHKeyPool pool(1);
+  pool.refill(1);
+  SharedHandle<DHKeyExchange> dhA = pool.pop();
+  CPPUNIT_ASSERT_EQUAL((uint64_t)1, pool.getNumHit());
+  CPPUNIT_ASSERT_EQUAL((size_t)0, pool.size());
+  SharedHandle<DHKeyExchange> dhB = pool.pop();
+  CPPUNIT_ASSERT_EQUAL((uint64_t)1, pool.getNumMiss());
+  CPPUNIT_ASSERT(dhA.get() != dhB.get());
+
+  // Both keys have public keys generated and agree on the secret.
+  unsigned char publicKeyA[96];
+  unsigned char publicKeyB[96];
+  dhA->getPublicKey(publicKeyA, sizeof(publicKeyA));
+  dhB->getPublicKey(publicKeyB, sizeof(publicKeyB));
+  unsigned char secretA[96];
+  unsigned char secretB[96];
+  dhA->computeSecret(secretA, sizeof(secretA), publicKeyB, sizeof(publicKeyB));
+  dhB->computeSecret(secretB, sizeof(secretB), publicKeyA, sizeof(publicKeyA));
+  CPPUNIT_ASSERT(memcmp(secretA, secretB, sizeof(secretA)) == 0);
+}
+
+void DHKeyPoolTest::testAddHandshakeTime()
+{
+  DHKeyPool pool;
+  pool.addHandshakeTime(100);
+  pool.addHandshakeTime(50);
+  CPPUNIT_ASSERT_EQUAL((uint64_t)2, pool.getNumHandshake());
+  CPPUNIT_ASSERT_EQUAL((int64_t)150, pool.getHandshakeTime());
+}
+
+void DHKeyPoolTest::testSetCapacity()
+{
+  DHKeyPool pool(3);
+  pool.refill(3);
+  pool.setCapacity(1);
+  CPPUNIT_ASSERT_EQUAL((size_t)1, pool.size());
+  CPPUNIT_ASSERT_EQUAL((size_t)0, pool.refill(1));
+}
+
+void DHKeyPoolTest::testAdjustCapacity()
+{
+  DHKeyPool pool;
+  pool.adjustCapacity();
+  CPPUNIT_ASSERT_EQUAL(DHKeyPool::DEFAULT_CAPACITY, pool.getCapacity());
+  // A miss doubles the capacity.
+  pool.pop();
+  pool.adjustCapacity();
+  CPPUNIT_ASSERT_EQUAL(DHKeyPool::DEFAULT_CAPACITY*2, pool.getCapacity());
+  pool.refill(DHKeyPool::DEFAULT_CAPACITY+1);
+  // Demand keeps the capacity.
+  for(size_t i = 0; i < DHKeyPool::SHRINK_DELAY; ++i) {
+    for(size_t j = 0; j < DHKeyPool::DEFAULT_CAPACITY/2; ++j) {
+      pool.pop();
+      pool.refill(1);
+    }
+    pool.adjustCapacity();
+  }
+  CPPUNIT_ASSERT_EQUAL(DHKeyPool::DEFAULT_CAPACITY*2, pool.getCapacity());
+  // Idle pool shrinks after SHRINK_DELAY calls and drops surplus keys.
+  for(size_t i = 0; i < DHKeyPool::SHRINK_DELAY-1; ++i) {
+    pool.adjustCapacity();
+  }
+  CPPUNIT_ASSERT_EQUAL(DHKeyPool::DEFAULT_CAPACITY*2, pool.getCapacity());
+  pool.adjustCapacity();
+  CPPUNIT_ASSERT_EQUAL(DHKeyPool::DEFAULT_CAPACITY, pool.getCapacity());
+  CPPUNIT_ASSERT_EQUAL(DHKeyPool::DEFAULT_CAPACITY, pool.size());
+  // but not below DEFAULT_CAPACITY.
+  for(size_t i = 0; i < DHKeyPool::SHRINK_DELAY; ++i) {
+    pool.adjustCapacity();
+  }
+  CPPUNIT_ASSERT_EQUAL(DHKeyPool::DEFAULT_CAPACITY, pool.getCapacity());
+}
+
+} // namespace aria2
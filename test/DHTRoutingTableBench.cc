@@ -0,0 +1,59 @@
+#include "Benchmark.h"
+
+#include <cstring>
+
+#include "DHTRoutingTable.h"
+#include "DHTNode.h"
+#include "DHTConstants.h"
+
+namespace aria2 {
+
+namespace {
+void createID(unsigned char* id)
+{
+  for(size_t i = 0; i < DHT_ID_LENGTH; ++i) {
+    id[i] = benchmarkRandom();
+  }
+}
+} // namespace
+
+namespace {
+// Looks up the closest nodes to random IDs in a table filled with
+// 1000 candidate nodes.
+class DHTRoutingTableBench:public Benchmark {
+private:
+  SharedHandle<DHTRoutingTable> table_;
+  std::vector<std::string> targets_;
+public:
+  virtual void setUp()
+  {
+    unsigned char id[DHT_ID_LENGTH];
+    createID(id);
+    table_.reset(new DHTRoutingTable(SharedHandle<DHTNode>(new DHTNode(id))));
+    for(size_t i = 0; i < 1000; ++i) {
+      createID(id);
+      table_->addNode(SharedHandle<DHTNode>(new DHTNode(id)));
+    }
+    for(size_t i = 0; i < 256; ++i) {
+      createID(id);
+      targets_.push_back(std::string(&id[0], &id[DHT_ID_LENGTH]));
+    }
+  }
+
+  virtual void run(size_t n)
+  {
+    for(size_t i = 0; i < n; ++i) {
+      std::vector<SharedHandle<DHTNode> > nodes;
+      table_->getClosestKNodes
+        (nodes, reinterpret_cast<const unsigned char*>
+         (targets_[i%targets_.size()].data()));
+      benchmarkSink(nodes.size());
+    }
+  }
+};
+} // namespace
+
+A2_BENCHMARK_REGISTRATION(DHTRoutingTableBench,
+                          "DHTRoutingTable.getClosestKNodes", 10000);
+
+} // namespace aria2
@@ -0,0 +1,81 @@
+#include "DefaultBtInteractive.h"
+
+#include <algorithm>
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "BtConstants.h"
+#include "PeerStat.h"
+
+namespace aria2 {
+
+class DefaultBtInteractiveTest:public CppUnit::TestFixture {
+
+  CPPUNIT_TEST_SUITE(DefaultBtInteractiveTest);
+  CPPUNIT_TEST(testCalculateMaxOutstandingRequest);
+  CPPUNIT_TEST(testCalculateMaxOutstandingRequest_delayedPeer);
+  CPPUNIT_TEST_SUITE_END();
+public:
+  void testCalculateMaxOutstandingRequest();
+  void testCalculateMaxOutstandingRequest_delayedPeer();
+};
+
+
+CPPUNIT_TEST_SUITE_REGISTRATION(DefaultBtInteractiveTest);
+
+void DefaultBtInteractiveTest::testCalculateMaxOutstandingRequest()
+{
+  // Slow peer: lower bound
+  CPPUNIT_ASSERT_EQUAL((size_t)DEFAULT_MAX_OUTSTANDING_REQUEST,
+                       DefaultBtInteractive::calculateMaxOutstandingRequest
+                       (0, 100));
+  CPPUNIT_ASSERT_EQUAL((size_t)DEFAULT_MAX_OUTSTANDING_REQUEST,
+                       DefaultBtInteractive::calculateMaxOutstandingRequest
+                       (16*1024, 100));
+  // 1MiB/s, 200ms: BDP is 12.8 blocks, rounded up to 13.
+  CPPUNIT_ASSERT_EQUAL((size_t)26,
+                       DefaultBtInteractive::calculateMaxOutstandingRequest
+                       (1024*1024, 200));
+  // 100MiB/s, 300ms: upper bound
+  CPPUNIT_ASSERT_EQUAL((size_t)UB_MAX_OUTSTANDING_REQUEST,
+                       DefaultBtInteractive::calculateMaxOutstandingRequest
+                       (100*1024*1024, 300));
+}
+
+// Simulates a peer behind a link with the given bandwidth and one way
+// delay.  The peer sends blocks in request order, so once the link is
+// full a block also waits for the ones requested before it and its
+// round trip time includes that queueing delay.
+void DefaultBtInteractiveTest::
+testCalculateMaxOutstandingRequest_delayedPeer()
+{
+  const int64_t delay = 150;
+  const uint64_t bandwidth = 4*1024*1024;
+  const uint64_t blockLength = MAX_BLOCK_LENGTH;
+  // 4MiB/s * 300ms / 16KiB
+  const size_t bdp = 77;
+  PeerStat stat;
+  size_t numOutstanding = DEFAULT_MAX_OUTSTANDING_REQUEST;
+  int round;
+  for(round = 0; round < 20; ++round) {
+    int64_t rtt = std::max((int64_t)(delay*2+blockLength*1000/bandwidth),
+                           (int64_t)(numOutstanding*blockLength*1000/
+                                     bandwidth));
+    unsigned int speed =
+      std::min(bandwidth, numOutstanding*blockLength*1000/rtt);
+    stat.updateBlockRtt(rtt);
+    numOutstanding = DefaultBtInteractive::calculateMaxOutstandingRequest
+      (speed, stat.getMinBlockRtt());
+    if(round == 4) {
+      // The old fixed step of 6 needed 25 full drains of the queue to
+      // fill the link.
+      CPPUNIT_ASSERT(numOutstanding >= bdp);
+    }
+  }
+  // Once the link is full, the queue depth stays at about twice the
+  // BDP instead of growing with the queueing delay.
+  CPPUNIT_ASSERT(numOutstanding >= bdp*2);
+  CPPUNIT_ASSERT(numOutstanding <= bdp*2+2);
+}
+
+} // namespace aria2
@@ -40,6 +40,7 @@ class DefaultBtMessageDispatcherTest:public CppUnit::TestFixture {
   CPPUNIT_TEST(testIsOutstandingRequest);
   CPPUNIT_TEST(testGetOutstandingRequest);
   CPPUNIT_TEST(testRemoveOutstandingRequest);
+  CPPUNIT_TEST(testDoCancelOutstandingRequestAction);
   CPPUNIT_TEST_SUITE_END();
 private:
   SharedHandle<DownloadContext> dctx_;
@@ -68,6 +69,7 @@ public:
   void testIsOutstandingRequest();
   void testGetOutstandingRequest();
   void testRemoveOutstandingRequest();
+  void testDoCancelOutstandingRequestAction();
 
   class MockBtMessage2 : public MockBtMessage {
   private:
@@ -428,4 +430,28 @@ void DefaultBtMessageDispatcherTest::testRemoveOutstandingRequest() {
   CPPUNIT_ASSERT(!piece->isBlockUsed(blockIndex));
 }
 
+void DefaultBtMessageDispatcherTest::testDoCancelOutstandingRequestAction()
+{
+  SharedHandle<Piece> piece(new Piece(1, 1024*1024));
+  RequestSlot slot(1, 16*1024, 16*1024, 1, piece);
+  btMessageDispatcher->addOutstandingRequest(slot);
+  CPPUNIT_ASSERT_EQUAL((size_t)1, piece->countBlockRequest(1));
+  // Adding the same slot again is ignored.
+  btMessageDispatcher->addOutstandingRequest(slot);
+  CPPUNIT_ASSERT_EQUAL((size_t)1, piece->countBlockRequest(1));
+
+  CPPUNIT_ASSERT(!btMessageDispatcher->doCancelOutstandingRequestAction
+                 (1, 0, 16*1024));
+  CPPUNIT_ASSERT_EQUAL((size_t)0, btMessageDispatcher->countMessageInQueue());
+
+  CPPUNIT_ASSERT(btMessageDispatcher->doCancelOutstandingRequestAction
+                 (1, 16*1024, 16*1024));
+  CPPUNIT_ASSERT_EQUAL((size_t)0, piece->countBlockRequest(1));
+  CPPUNIT_ASSERT(!btMessageDispatcher->isOutstandingRequest(1, 1));
+  CPPUNIT_ASSERT_EQUAL((size_t)1, btMessageDispatcher->countMessageInQueue());
+  SharedHandle<MockBtMessage2> msg = dynamic_pointer_cast<MockBtMessage2>
+    (btMessageDispatcher->getMessageQueue().front());
+  CPPUNIT_ASSERT_EQUAL(std::string("cancel"), msg->type);
+}
+
 } // namespace aria2
@@ -1,6 +1,7 @@
 #include "DefaultBtProgressInfoFile.h"
 
 #include <fstream>
+#include <sstream>
 
 #include <cppunit/extensions/HelperMacros.h>
 
@@ -38,6 +39,8 @@ class DefaultBtProgressInfoFileTest:public CppUnit::TestFixture {
 #endif // !WORDS_BIGENDIAN
   CPPUNIT_TEST(testLoad_nonBt_pieceLengthShorter);
   CPPUNIT_TEST(testUpdateFilename);
+  CPPUNIT_TEST(testIsDirty);
+  CPPUNIT_TEST(testSave_inPlace);
   CPPUNIT_TEST_SUITE_END();
 private:
 
@@ -97,6 +100,8 @@ public:
 #endif // !WORDS_BIGENDIAN
   void testLoad_nonBt_pieceLengthShorter();
   void testUpdateFilename();
+  void testIsDirty();
+  void testSave_inPlace();
 };
 
 #undef BLOCK_LENGTH
@@ -576,4 +581,73 @@ void DefaultBtProgressInfoFileTest::testUpdateFilename()
                        infoFile.getFilename());
 }
 
+void DefaultBtProgressInfoFileTest::testIsDirty()
+{
+  initializeMembers(1024, 81920);
+
+  SharedHandle<DownloadContext> dctx
+    (new DownloadContext(1024, 81920, A2_TEST_OUT_DIR"/dirty-temp"));
+  DefaultBtProgressInfoFile infoFile(dctx, pieceStorage_, option_.get());
+
+  CPPUNIT_ASSERT(infoFile.isDirty());
+  infoFile.save();
+  CPPUNIT_ASSERT(!infoFile.isDirty());
+
+  pieceStorage_->setCompletedLength(1024);
+  CPPUNIT_ASSERT(infoFile.isDirty());
+  infoFile.save();
+  CPPUNIT_ASSERT(!infoFile.isDirty());
+
+  std::vector<SharedHandle<Piece> > inFlightPieces;
+  inFlightPieces.push_back(SharedHandle<Piece>(new Piece(1, 1024)));
+  pieceStorage_->addInFlightPiece(inFlightPieces);
+  CPPUNIT_ASSERT(infoFile.isDirty());
+  infoFile.save();
+  CPPUNIT_ASSERT(!infoFile.isDirty());
+
+  infoFile.removeFile();
+  CPPUNIT_ASSERT(infoFile.isDirty());
+}
+
+namespace {
+std::string readFile(const std::string& filename)
+{
+  std::ifstream in(filename.c_str(), std::ios::binary);
+  std::stringstream ss;
+  ss << in.rdbuf();
+  return ss.str();
+}
+} // namespace
+
+void DefaultBtProgressInfoFileTest::testSave_inPlace()
+{
+  initializeMembers(1024, 81920);
+  option_->put(PREF_AUTO_SAVE_IN_PLACE, A2_V_TRUE);
+
+  SharedHandle<DownloadContext> dctx
+    (new DownloadContext(1024, 81920, A2_TEST_OUT_DIR"/inplace-temp"));
+  DefaultBtProgressInfoFile infoFile(dctx, pieceStorage_, option_.get());
+  infoFile.save();
+
+  bitfield_->setBit(3);
+  bitfield_->setBit(4);
+  bitfield_->setBit(79);
+  pieceStorage_->setCompletedLength(3072);
+  std::vector<SharedHandle<Piece> > inFlightPieces;
+  inFlightPieces.push_back(SharedHandle<Piece>(new Piece(1, 1024)));
+  pieceStorage_->addInFlightPiece(inFlightPieces);
+  infoFile.save();
+
+  // The result must be identical to the file written from scratch.
+  SharedHandle<DownloadContext> fullDctx
+    (new DownloadContext(1024, 81920, A2_TEST_OUT_DIR"/inplace-full-temp"));
+  option_->put(PREF_AUTO_SAVE_IN_PLACE, A2_V_FALSE);
+  DefaultBtProgressInfoFile fullInfoFile
+    (fullDctx, pieceStorage_, option_.get());
+  fullInfoFile.save();
+
+  CPPUNIT_ASSERT(readFile(fullInfoFile.getFilename()) ==
+                 readFile(infoFile.getFilename()));
+}
+
 } // namespace aria2
@@ -23,6 +23,7 @@ class DefaultBtRequestFactoryTest:public CppUnit::TestFixture {
   CPPUNIT_TEST(testRemoveCompletedPiece);
   CPPUNIT_TEST(testCreateRequestMessages);
   CPPUNIT_TEST(testCreateRequestMessages_onEndGame);
+  CPPUNIT_TEST(testCreateRequestMessages_onEndGame_maxBlockRequest);
   CPPUNIT_TEST(testRemoveTargetPiece);
   CPPUNIT_TEST(testGetTargetPieceIndexes);
   CPPUNIT_TEST_SUITE_END();
@@ -38,6 +39,7 @@ public:
   void testRemoveCompletedPiece();
   void testCreateRequestMessages();
   void testCreateRequestMessages_onEndGame();
+  void testCreateRequestMessages_onEndGame_maxBlockRequest();
   void testRemoveTargetPiece();
   void testGetTargetPieceIndexes();
 
@@ -180,7 +182,7 @@ void DefaultBtRequestFactoryTest::testCreateRequestMessages_onEndGame() {
   requestFactory_->addTargetPiece(piece2);
 
   std::vector<SharedHandle<BtMessage> > msgs;
-  requestFactory_->createRequestMessagesOnEndGame(msgs, 3);
+  requestFactory_->createRequestMessagesOnEndGame(msgs, 3, 1);
 
   std::vector<SharedHandle<MockBtRequestMessage> > mmsgs;
   for(std::vector<SharedHandle<BtMessage> >::iterator i = msgs.begin();
@@ -205,6 +207,44 @@ void DefaultBtRequestFactoryTest::testCreateRequestMessages_onEndGame() {
   CPPUNIT_ASSERT_EQUAL((size_t)1, msg->blockIndex);
 }
 
+void DefaultBtRequestFactoryTest::
+testCreateRequestMessages_onEndGame_maxBlockRequest()
+{
+  int PIECE_LENGTH = 16*1024*2;
+  SharedHandle<Piece> piece1(new Piece(0, PIECE_LENGTH));
+  SharedHandle<Piece> piece2(new Piece(1, PIECE_LENGTH));
+  piece1->addBlockRequest(0);
+  piece1->addBlockRequest(0);
+  piece1->addBlockRequest(1);
+  piece2->addBlockRequest(1);
+  requestFactory_->addTargetPiece(piece1);
+  requestFactory_->addTargetPiece(piece2);
+
+  std::vector<SharedHandle<BtMessage> > msgs;
+  requestFactory_->createRequestMessagesOnEndGame(msgs, 10, 1);
+  // Only the block nobody has requested
+  CPPUNIT_ASSERT_EQUAL((size_t)1, msgs.size());
+  SharedHandle<MockBtRequestMessage> msg =
+    dynamic_pointer_cast<MockBtRequestMessage>(msgs[0]);
+  CPPUNIT_ASSERT_EQUAL((size_t)1, msg->index);
+  CPPUNIT_ASSERT_EQUAL((size_t)0, msg->blockIndex);
+
+  msgs.clear();
+  requestFactory_->createRequestMessagesOnEndGame(msgs, 2, 2);
+  CPPUNIT_ASSERT_EQUAL((size_t)2, msgs.size());
+  // The block with fewer requests comes first.
+  msg = dynamic_pointer_cast<MockBtRequestMessage>(msgs[0]);
+  CPPUNIT_ASSERT_EQUAL((size_t)1, msg->index);
+  CPPUNIT_ASSERT_EQUAL((size_t)0, msg->blockIndex);
+  msg = dynamic_pointer_cast<MockBtRequestMessage>(msgs[1]);
+  CPPUNIT_ASSERT_EQUAL((size_t)1, msg->blockIndex);
+
+  msgs.clear();
+  requestFactory_->createRequestMessagesOnEndGame(msgs, 10, 2);
+  // Block 0 of piece1 already has 2 requests.
+  CPPUNIT_ASSERT_EQUAL((size_t)3, msgs.size());
+}
+
 void DefaultBtRequestFactoryTest::testRemoveTargetPiece() {
   SharedHandle<Piece> piece1(new Piece(0, 16*1024));
 
@@ -10,6 +10,7 @@
 #include "FileEntry.h"
 #include "RarestPieceSelector.h"
 #include "InOrderPieceSelector.h"
+#include "StreamPieceSelector.h"
 #include "DownloadContext.h"
 #include "bittorrent_helper.h"
 #include "DiskAdaptor.h"
@@ -27,6 +28,7 @@ class DefaultPieceStorageTest:public CppUnit::TestFixture {
   CPPUNIT_TEST(testGetMissingPiece_many);
   CPPUNIT_TEST(testGetMissingPiece_excludedIndexes);
   CPPUNIT_TEST(testGetMissingPiece_manyWithExcludedIndexes);
+  CPPUNIT_TEST(testGetMissingPiece_stream);
   CPPUNIT_TEST(testGetMissingFastPiece);
   CPPUNIT_TEST(testGetMissingFastPiece_excludedIndexes);
   CPPUNIT_TEST(testHasMissingPiece);
@@ -61,6 +63,7 @@ public:
   void testGetMissingPiece_many();
   void testGetMissingPiece_excludedIndexes();
   void testGetMissingPiece_manyWithExcludedIndexes();
+  void testGetMissingPiece_stream();
   void testGetMissingFastPiece();
   void testGetMissingFastPiece_excludedIndexes();
   void testHasMissingPiece();
@@ -160,6 +163,35 @@ void DefaultPieceStorageTest::testGetMissingPiece_manyWithExcludedIndexes() {
   CPPUNIT_ASSERT(pieces.empty());
 }
 
+void DefaultPieceStorageTest::testGetMissingPiece_stream()
+{
+  DefaultPieceStorage pss(dctx_, option_.get());
+  SharedHandle<StreamPieceSelector> selector
+    (new StreamPieceSelector(pieceSelector_, option_.get(),
+                             dctx_->getPieceLength()));
+  pss.setStreamPieceSelector(selector);
+  peer->setAllBitfield();
+  CPPUNIT_ASSERT(!pss.isStreamingMode());
+
+  option_->put(PREF_BT_STREAM_POSITION, "128");
+  option_->put(PREF_BT_STREAM_WINDOW, "128");
+  CPPUNIT_ASSERT(pss.isStreamingMode());
+  SharedHandle<Piece> piece = pss.getMissingPiece(peer);
+  CPPUNIT_ASSERT_EQUAL((size_t)1, piece->getIndex());
+
+  // Piece 1 is in use, but it is shared because it is in the window.
+  std::vector<SharedHandle<Piece> > pieces;
+  pss.getMissingPiece(pieces, 1, peer);
+  CPPUNIT_ASSERT_EQUAL((size_t)2, pieces.size());
+  CPPUNIT_ASSERT(piece.get() == pieces[0].get());
+  CPPUNIT_ASSERT_EQUAL((size_t)0, pieces[1]->getIndex());
+
+  // The shared piece is not deleted while it may be used by another
+  // peer.
+  pss.cancelPiece(piece);
+  CPPUNIT_ASSERT(piece.get() == pss.getPiece(1).get());
+}
+
 void DefaultPieceStorageTest::testGetMissingFastPiece() {
   DefaultPieceStorage pss(dctx_, option_.get());
   pss.setPieceSelector(pieceSelector_);
@@ -0,0 +1,169 @@
+#include "DigestThreadPool.h"
+
+#include <poll.h>
+
+#include <algorithm>
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "MessageDigest.h"
+
+namespace aria2 {
+
+class DigestThreadPoolTest:public CppUnit::TestFixture {
+
+  CPPUNIT_TEST_SUITE(DigestThreadPoolTest);
+  CPPUNIT_TEST(testUpdate);
+  CPPUNIT_TEST(testUpdate_noThread);
+  CPPUNIT_TEST(testDestroy);
+  CPPUNIT_TEST(testRequestNotification);
+  CPPUNIT_TEST(testRequestNotification_noThread);
+  CPPUNIT_TEST_SUITE_END();
+public:
+  void testUpdate();
+  void testUpdate_noThread();
+  void testDestroy();
+  void testRequestNotification();
+  void testRequestNotification_noThread();
+};
+
+
+CPPUNIT_TEST_SUITE_REGISTRATION(DigestThreadPoolTest);
+
+namespace {
+std::string makeData(size_t length, int seed)
+{
+  std::string data(length, '\0');
+  for(size_t i = 0; i < length; ++i) {
+    data[i] = (i*31+seed)&0xff;
+  }
+  return data;
+}
+} // namespace
+
+namespace {
+std::string hexDigest(const std::string& algo, const std::string& data)
+{
+  SharedHandle<MessageDigest> ctx = MessageDigest::create(algo);
+  ctx->update(data.data(), data.size());
+  return ctx->hexDigest();
+}
+} // namespace
+
+void DigestThreadPoolTest::testUpdate()
+{
+  SharedHandle<DigestThreadPool> pool(new DigestThreadPool(2));
+#ifdef HAVE_PTHREAD
+  CPPUNIT_ASSERT_EQUAL((size_t)2, pool->getNumThreads());
+#endif // HAVE_PTHREAD
+  const size_t NUM_STREAMS = 4;
+  std::string data[NUM_STREAMS];
+  SharedHandle<DigestStream> streams[NUM_STREAMS];
+  for(size_t i = 0; i < NUM_STREAMS; ++i) {
+    data[i] = makeData(1024*1024+i, i);
+    streams[i].reset
+      (new DigestStream(MessageDigest::create("sha-1"), pool));
+  }
+  // Interleave the updates so that the streams are hashed
+  // concurrently.
+  const size_t BLOCK_LENGTH = 16*1024;
+  for(size_t offset = 0; offset < data[NUM_STREAMS-1].size();
+      offset += BLOCK_LENGTH) {
+    for(size_t i = 0; i < NUM_STREAMS; ++i) {
+      if(offset < data[i].size()) {
+        size_t length = std::min(BLOCK_LENGTH, data[i].size()-offset);
+        streams[i]->update
+          (reinterpret_cast<const unsigned char*>(data[i].data())+offset,
+           length);
+      }
+    }
+  }
+  for(size_t i = 0; i < NUM_STREAMS; ++i) {
+    streams[i]->wait();
+    CPPUNIT_ASSERT_EQUAL(hexDigest("sha-1", data[i]),
+                         streams[i]->getContext()->hexDigest());
+  }
+}
+
+void DigestThreadPoolTest::testUpdate_noThread()
+{
+  std::string data = makeData(100000, 7);
+  SharedHandle<DigestThreadPool> pool(new DigestThreadPool(0));
+  CPPUNIT_ASSERT_EQUAL((size_t)0, pool->getNumThreads());
+  DigestStream stream(MessageDigest::create("sha-1"), pool);
+  stream.update(reinterpret_cast<const unsigned char*>(data.data()),
+                data.size());
+  // Hashed synchronously, so no wait() is needed.
+  CPPUNIT_ASSERT_EQUAL(hexDigest("sha-1", data),
+                       stream.getContext()->hexDigest());
+
+  DigestStream nopool(MessageDigest::create("sha-1"),
+                      SharedHandle<DigestThreadPool>());
+  nopool.update(reinterpret_cast<const unsigned char*>(data.data()),
+                data.size());
+  CPPUNIT_ASSERT_EQUAL(hexDigest("sha-1", data),
+                       nopool.getContext()->hexDigest());
+}
+
+void DigestThreadPoolTest::testDestroy()
+{
+  std::string data = makeData(4*1024*1024, 3);
+  SharedHandle<MessageDigest> ctx = MessageDigest::create("sha-1");
+  {
+    SharedHandle<DigestThreadPool> pool(new DigestThreadPool(1));
+    DigestStream stream(ctx, pool);
+    stream.update(reinterpret_cast<const unsigned char*>(data.data()),
+                  data.size());
+    // The destructor of stream waits for the pending data.
+  }
+  CPPUNIT_ASSERT_EQUAL(hexDigest("sha-1", data), ctx->hexDigest());
+}
+
+namespace {
+bool readable(int fd, int timeout)
+{
+  struct pollfd p;
+  p.fd = fd;
+  p.events = POLLIN;
+  p.revents = 0;
+  return poll(&p, 1, timeout) == 1 && (p.revents&POLLIN);
+}
+} // namespace
+
+void DigestThreadPoolTest::testRequestNotification()
+{
+#ifdef HAVE_PTHREAD
+  std::string data = makeData(16*1024*1024, 5);
+  SharedHandle<DigestThreadPool> pool(new DigestThreadPool(1));
+  CPPUNIT_ASSERT(pool->getNotifyFd() != -1);
+  CPPUNIT_ASSERT(!readable(pool->getNotifyFd(), 0));
+  DigestStream stream(MessageDigest::create("sha-1"), pool);
+  stream.update(reinterpret_cast<const unsigned char*>(data.data()),
+                data.size());
+  if(stream.requestNotification()) {
+    CPPUNIT_ASSERT(readable(pool->getNotifyFd(), 60*1000));
+  }
+  CPPUNIT_ASSERT(!stream.busy());
+  CPPUNIT_ASSERT_EQUAL(hexDigest("sha-1", data),
+                       stream.getContext()->hexDigest());
+  pool->clearNotification();
+  CPPUNIT_ASSERT(!readable(pool->getNotifyFd(), 0));
+  // Nothing is pending, so no notification is made.
+  CPPUNIT_ASSERT(!stream.requestNotification());
+#endif // HAVE_PTHREAD
+}
+
+void DigestThreadPoolTest::testRequestNotification_noThread()
+{
+  SharedHandle<DigestThreadPool> pool(new DigestThreadPool(0));
+  CPPUNIT_ASSERT_EQUAL(-1, pool->getNotifyFd());
+  DigestStream stream(MessageDigest::create("sha-1"), pool);
+  std::string data = makeData(1024, 1);
+  stream.update(reinterpret_cast<const unsigned char*>(data.data()),
+                data.size());
+  CPPUNIT_ASSERT(!stream.busy());
+  CPPUNIT_ASSERT(!stream.requestNotification());
+  pool->clearNotification();
+}
+
+} // namespace aria2
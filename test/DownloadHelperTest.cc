@@ -11,9 +11,10 @@
 #include "Option.h"
 #include "array_fun.h"
 #include "prefs.h"
-#include "Exception.h"
+#include "RecoverableException.h"
 #include "util.h"
 #include "FileEntry.h"
+#include "UriListParser.h"
 #ifdef ENABLE_BITTORRENT
 # include "bittorrent_helper.h"
 #endif // ENABLE_BITTORRENT
@@ -26,6 +27,7 @@ class DownloadHelperTest:public CppUnit::TestFixture {
   CPPUNIT_TEST(testCreateRequestGroupForUri);
   CPPUNIT_TEST(testCreateRequestGroupForUri_parameterized);
   CPPUNIT_TEST(testCreateRequestGroupForUriList);
+  CPPUNIT_TEST(testCreateRequestGroupFromUriListParser);
 
 #ifdef ENABLE_BITTORRENT
   CPPUNIT_TEST(testCreateRequestGroupForUri_BitTorrent);
@@ -51,6 +53,7 @@ public:
   void testCreateRequestGroupForUri();
   void testCreateRequestGroupForUri_parameterized();
   void testCreateRequestGroupForUriList();
+  void testCreateRequestGroupFromUriListParser();
 
 #ifdef ENABLE_BITTORRENT
   void testCreateRequestGroupForUri_BitTorrent();
@@ -306,6 +309,40 @@ void DownloadHelperTest::testCreateRequestGroupForUriList()
                        fileISOCtx->getBasePath());
 }
 
+void DownloadHelperTest::testCreateRequestGroupFromUriListParser()
+{
+  option_->put(PREF_DIR, "/tmp");
+  option_->put(PREF_OUT, "file.out");
+
+  SharedHandle<UriListParser> uriListParser =
+    openUriListParser(A2_TEST_DIR"/input_uris.txt");
+  std::vector<SharedHandle<RequestGroup> > result;
+
+  // Each call reads input up to the next RequestGroup.
+  CPPUNIT_ASSERT(createRequestGroupFromUriListParser
+                 (result, option_.get(), uriListParser.get()));
+  CPPUNIT_ASSERT_EQUAL((size_t)1, result.size());
+  CPPUNIT_ASSERT_EQUAL(std::string("/mydownloads/myfile.out"),
+                       result[0]->getDownloadContext()->getBasePath());
+
+  CPPUNIT_ASSERT(createRequestGroupFromUriListParser
+                 (result, option_.get(), uriListParser.get()));
+  CPPUNIT_ASSERT_EQUAL((size_t)2, result.size());
+  CPPUNIT_ASSERT_EQUAL(std::string("/tmp/file.out"),
+                       result[1]->getDownloadContext()->getBasePath());
+
+  CPPUNIT_ASSERT(!createRequestGroupFromUriListParser
+                 (result, option_.get(), uriListParser.get()));
+  CPPUNIT_ASSERT_EQUAL((size_t)2, result.size());
+
+  try {
+    openUriListParser(A2_TEST_DIR"/no_such_file.txt");
+    CPPUNIT_FAIL("exception must be thrown.");
+  } catch(RecoverableException& e) {
+    // success
+  }
+}
+
 #ifdef ENABLE_BITTORRENT
 void DownloadHelperTest::testCreateRequestGroupForBitTorrent()
 {
@@ -0,0 +1,50 @@
+#include "FileAllocationMan.h"
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "FileAllocationEntry.h"
+#include "wallclock.h"
+
+namespace aria2 {
+
+class FileAllocationManTest:public CppUnit::TestFixture {
+
+  CPPUNIT_TEST_SUITE(FileAllocationManTest);
+  CPPUNIT_TEST(testIsThrottled);
+  CPPUNIT_TEST_SUITE_END();
+public:
+  void setUp()
+  {
+    global::wallclock.reset();
+  }
+
+  void tearDown()
+  {
+    global::wallclock.reset();
+  }
+
+  void testIsThrottled();
+};
+
+
+CPPUNIT_TEST_SUITE_REGISTRATION(FileAllocationManTest);
+
+void FileAllocationManTest::testIsThrottled()
+{
+  FileAllocationMan faman;
+  faman.addAllocatedLength(1024);
+  // unlimited
+  CPPUNIT_ASSERT(!faman.isThrottled());
+
+  faman.setMaxSpeed(1024);
+  CPPUNIT_ASSERT(faman.isThrottled());
+
+  global::wallclock.advance(1);
+  CPPUNIT_ASSERT(!faman.isThrottled());
+  faman.addAllocatedLength(1023);
+  CPPUNIT_ASSERT(!faman.isThrottled());
+  faman.addAllocatedLength(1);
+  CPPUNIT_ASSERT(faman.isThrottled());
+}
+
+} // namespace aria2
@@ -0,0 +1,92 @@
+#include "HttpConnection.h"
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "SocketCore.h"
+#include "SocketRecvBuffer.h"
+#include "HttpRequest.h"
+#include "HttpResponse.h"
+#include "Request.h"
+#include "PiecedSegment.h"
+#include "Piece.h"
+#include "FileEntry.h"
+#include "Option.h"
+#include "AuthConfigFactory.h"
+#include "util.h"
+
+namespace aria2 {
+
+class HttpConnectionTest:public CppUnit::TestFixture {
+
+  CPPUNIT_TEST_SUITE(HttpConnectionTest);
+  CPPUNIT_TEST(testPipelineRefillNeeded);
+  CPPUNIT_TEST_SUITE_END();
+public:
+  void testPipelineRefillNeeded();
+};
+
+
+CPPUNIT_TEST_SUITE_REGISTRATION(HttpConnectionTest);
+
+void HttpConnectionTest::testPipelineRefillNeeded()
+{
+  SocketCore listenSocket;
+  listenSocket.bind(0);
+  listenSocket.beginListen();
+  std::pair<std::string, uint16_t> addrinfo;
+  listenSocket.getAddrInfo(addrinfo);
+  SharedHandle<SocketCore> client(new SocketCore());
+  client->establishConnection("localhost", addrinfo.second);
+  SharedHandle<SocketCore> server(listenSocket.acceptConnection());
+  client->setBlockingMode();
+  server->setBlockingMode();
+
+  Option option;
+  SharedHandle<AuthConfigFactory> authConfigFactory(new AuthConfigFactory());
+  SharedHandle<Request> request(new Request());
+  request->setUri("http://localhost/file");
+  request->setMaxPipelinedRequest(4);
+  SharedHandle<FileEntry> fileEntry(new FileEntry("file", 1024*1024*4, 0));
+
+  HttpConnection httpConnection
+    (1, client, SharedHandle<SocketRecvBuffer>(new SocketRecvBuffer(client)));
+  CPPUNIT_ASSERT(httpConnection.pipelineRefillNeeded(4));
+  for(size_t i = 0; i < 4; ++i) {
+    SharedHandle<Piece> piece(new Piece(i, 1024*1024));
+    SharedHandle<Segment> segment(new PiecedSegment(1024*1024, piece));
+    SharedHandle<HttpRequest> httpRequest(new HttpRequest());
+    httpRequest->setRequest(request);
+    httpRequest->setSegment(segment);
+    httpRequest->setFileEntry(fileEntry);
+    httpRequest->setAuthConfigFactory(authConfigFactory, &option);
+    httpConnection.sendRequest(httpRequest);
+  }
+  CPPUNIT_ASSERT_EQUAL((size_t)4, httpConnection.getOutstandingRequestCount());
+  // While more than half of the pipeline is in flight, responses are
+  // read without refilling.
+  CPPUNIT_ASSERT(!httpConnection.pipelineRefillNeeded
+                 (request->getMaxPipelinedRequest()));
+
+  std::string responses;
+  for(size_t i = 0; i < 4; ++i) {
+    responses += "HTTP/1.1 206 Partial Content\r\n"
+      "Content-Length: 0\r\n"
+      "\r\n";
+  }
+  server->writeData(responses.data(), responses.size());
+
+  const bool expected[] = { false, true, true, true };
+  for(size_t i = 0; i < 4; ++i) {
+    SharedHandle<HttpResponse> httpResponse;
+    while(!httpResponse) {
+      httpResponse = httpConnection.receiveResponse();
+    }
+    CPPUNIT_ASSERT_EQUAL(3-i, httpConnection.getOutstandingRequestCount());
+    // The pipeline is refilled once it drains to 2 requests.
+    CPPUNIT_ASSERT_EQUAL(expected[i],
+                         httpConnection.pipelineRefillNeeded
+                         (request->getMaxPipelinedRequest()));
+  }
+}
+
+} // namespace aria2
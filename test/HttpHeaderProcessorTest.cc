@@ -21,6 +21,7 @@ class HttpHeaderProcessorTest:public CppUnit::TestFixture {
   CPPUNIT_TEST(testBeyondLimit);
   CPPUNIT_TEST(testGetHeaderString);
   CPPUNIT_TEST(testGetHttpRequestHeader);
+  CPPUNIT_TEST(testUpdate_splitLines);
   CPPUNIT_TEST_SUITE_END();
   
 public:
@@ -35,6 +36,7 @@ public:
   void testBeyondLimit();
   void testGetHeaderString();
   void testGetHttpRequestHeader();
+  void testUpdate_splitLines();
 };
 
 
@@ -220,4 +222,44 @@ void HttpHeaderProcessorTest::testGetHttpRequestHeader()
   CPPUNIT_ASSERT_EQUAL(std::string("close"),httpHeader->getFirst("Connection"));
 }
 
+void HttpHeaderProcessorTest::testUpdate_splitLines()
+{
+  HttpHeaderProcessor proc;
+  std::string hd = "HTTP/1.1 200 OK\r\n"
+    "Content-Length: 9187\r\n"
+    "Multi-Line: text1\r\n"
+    "  text2\r\n"
+    "Duplicate: foo\r\n"
+    "duplicate: bar\n"
+    "\r\nputbackme";
+  // Feed header one byte at a time.
+  for(size_t i = 0; i < hd.size()-10; ++i) {
+    proc.update(hd.substr(i, 1));
+    CPPUNIT_ASSERT(!proc.eoh());
+  }
+  proc.update(hd.substr(hd.size()-10, 2));
+  CPPUNIT_ASSERT(proc.eoh());
+  CPPUNIT_ASSERT_EQUAL((size_t)1, proc.getPutBackDataLength());
+  proc.update("utbackme");
+  CPPUNIT_ASSERT_EQUAL((size_t)9, proc.getPutBackDataLength());
+
+  SharedHandle<HttpHeader> header = proc.getHttpResponseHeader();
+  CPPUNIT_ASSERT_EQUAL(200, header->getStatusCode());
+  CPPUNIT_ASSERT_EQUAL((uint64_t)9187ULL,
+                       header->getFirstAsULLInt("content-length"));
+  CPPUNIT_ASSERT_EQUAL(std::string("text1 text2"),
+                       header->getFirst("Multi-Line"));
+  std::vector<std::string> dup = header->get("Duplicate");
+  CPPUNIT_ASSERT_EQUAL((size_t)2, dup.size());
+  CPPUNIT_ASSERT_EQUAL(std::string("foo"), dup[0]);
+  CPPUNIT_ASSERT_EQUAL(std::string("bar"), dup[1]);
+  CPPUNIT_ASSERT(!header->defined("HTTP/1.1 200 OK"));
+
+  proc.clear();
+  CPPUNIT_ASSERT(!proc.eoh());
+  proc.update("HTTP/1.1 404 Not Found\r\n\r\n");
+  CPPUNIT_ASSERT(proc.eoh());
+  CPPUNIT_ASSERT_EQUAL(404, proc.getHttpResponseHeader()->getStatusCode());
+}
+
 } // namespace aria2
@@ -0,0 +1,312 @@
+#include "HttpTrackerCommand.h"
+
+#include <deque>
+#include <vector>
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "HttpTrackerRequest.h"
+#include "HttpRequest.h"
+#include "Request.h"
+#include "DownloadEngine.h"
+#include "SelectEventPoll.h"
+#include "RequestGroupMan.h"
+#include "RequestGroup.h"
+#include "SocketCore.h"
+#include "Option.h"
+#include "prefs.h"
+#include "AuthConfigFactory.h"
+#include "TimerA2.h"
+#include "wallclock.h"
+#include "fmt.h"
+
+namespace aria2 {
+
+namespace {
+struct MockTrackerServer {
+  SharedHandle<SocketCore> listenSocket;
+  // Accepted connections. They are kept open until the test ends.
+  std::vector<SharedHandle<SocketCore> > sockets;
+  // Canned responses and whether the connection is closed after each
+  // of them.
+  std::deque<std::pair<std::string, bool> > responses;
+  // Everything received from the clients.
+  std::string requests;
+
+  void addResponse(const std::string& response, bool close = false)
+  {
+    responses.push_back(std::make_pair(response, close));
+  }
+};
+
+// Serves MockTrackerServer: sends one canned response for each
+// received request header. Exits when all responses are sent.
+class MockTrackerServerCommand:public Command {
+private:
+  DownloadEngine* e_;
+  MockTrackerServer* server_;
+  SharedHandle<SocketCore> socket_;
+  std::string buf_;
+  Timer startTime_;
+public:
+  MockTrackerServerCommand
+  (cuid_t cuid, DownloadEngine* e, MockTrackerServer* server)
+    : Command(cuid), e_(e), server_(server)
+  {}
+
+  virtual bool execute()
+  {
+    if(!socket_) {
+      socket_.reset(server_->listenSocket->tryAcceptConnection());
+      if(socket_) {
+        server_->sockets.push_back(socket_);
+      }
+    }
+    while(socket_ && socket_->isReadable(0)) {
+      char data[4096];
+      size_t len = sizeof(data);
+      socket_->readData(data, len);
+      if(len == 0) {
+        socket_.reset();
+        break;
+      }
+      buf_.append(&data[0], &data[len]);
+      server_->requests.append(&data[0], &data[len]);
+      std::string::size_type eoh;
+      while(socket_ && (eoh = buf_.find("\r\n\r\n")) != std::string::npos) {
+        buf_.erase(0, eoh+4);
+        std::pair<std::string, bool> response = server_->responses.front();
+        server_->responses.pop_front();
+        socket_->setBlockingMode();
+        socket_->writeData(response.first);
+        socket_->setNonBlockingMode();
+        if(response.second) {
+          server_->sockets.pop_back();
+          socket_.reset();
+          buf_.clear();
+        }
+      }
+    }
+    if(server_->responses.empty() ||
+       startTime_.difference(global::wallclock) >= 10) {
+      return true;
+    }
+    e_->setNoWait(true);
+    e_->addCommand(this);
+    return false;
+  }
+};
+} // namespace
+
+class HttpTrackerCommandTest:public CppUnit::TestFixture {
+
+  CPPUNIT_TEST_SUITE(HttpTrackerCommandTest);
+  CPPUNIT_TEST(testExecute);
+  CPPUNIT_TEST(testExecute_error);
+  CPPUNIT_TEST(testExecute_redirect);
+#ifdef ENABLE_ASYNC_DNS
+  CPPUNIT_TEST(testExecute_asyncDNS);
+#endif // ENABLE_ASYNC_DNS
+  CPPUNIT_TEST_SUITE_END();
+private:
+  SharedHandle<Option> option_;
+  SharedHandle<DownloadEngine> e_;
+
+  void startServer(MockTrackerServer& server, uint16_t& port)
+  {
+    server.listenSocket.reset(new SocketCore());
+    server.listenSocket->bind(0);
+    server.listenSocket->beginListen();
+    server.listenSocket->setNonBlockingMode();
+    std::pair<std::string, uint16_t> addrinfo;
+    server.listenSocket->getAddrInfo(addrinfo);
+    port = addrinfo.second;
+    e_->addCommand
+      (new MockTrackerServerCommand(e_->newCUID(), e_.get(), &server));
+  }
+
+  SharedHandle<HttpTrackerRequest> createRequest(const std::string& uri)
+  {
+    SharedHandle<Request> request(new Request());
+    request->setUri(uri);
+    request->setKeepAliveHint(true);
+    SharedHandle<HttpRequest> httpRequest(new HttpRequest());
+    httpRequest->setRequest(request);
+    httpRequest->setAuthConfigFactory(e_->getAuthConfigFactory(),
+                                      option_.get());
+    httpRequest->disableContentEncoding();
+    SharedHandle<HttpTrackerRequest> req(new HttpTrackerRequest());
+    req->httpRequest = httpRequest;
+    req->timeout = 10;
+    return req;
+  }
+public:
+  void setUp()
+  {
+    option_.reset(new Option());
+    e_.reset(new DownloadEngine(SharedHandle<EventPoll>
+                                (new SelectEventPoll())));
+    e_->setOption(option_.get());
+    e_->setAuthConfigFactory
+      (SharedHandle<AuthConfigFactory>(new AuthConfigFactory()));
+    e_->setRequestGroupMan
+      (SharedHandle<RequestGroupMan>
+       (new RequestGroupMan(std::vector<SharedHandle<RequestGroup> >(), 1,
+                            option_.get())));
+  }
+
+  void tearDown()
+  {
+    e_.reset();
+  }
+
+  void testExecute();
+  void testExecute_error();
+  void testExecute_redirect();
+#ifdef ENABLE_ASYNC_DNS
+  void testExecute_asyncDNS();
+#endif // ENABLE_ASYNC_DNS
+};
+
+
+CPPUNIT_TEST_SUITE_REGISTRATION(HttpTrackerCommandTest);
+
+void HttpTrackerCommandTest::testExecute()
+{
+  MockTrackerServer server;
+  uint16_t port;
+  startServer(server, port);
+  server.addResponse("HTTP/1.1 200 OK\r\n"
+                      "Content-Length: 3\r\n"
+                      "\r\n"
+                      "foo");
+  server.addResponse("HTTP/1.1 200 OK\r\n"
+                      "Transfer-Encoding: chunked\r\n"
+                      "\r\n"
+                      "3\r\nbar\r\n"
+                      "0\r\n\r\n");
+  SharedHandle<HttpTrackerRequest> req1 =
+    createRequest(fmt("http://127.0.0.1:%u/announce?n=1", port));
+  SharedHandle<HttpTrackerRequest> req2 =
+    createRequest(fmt("http://127.0.0.1:%u/announce?n=2", port));
+  HttpTrackerCommand* command =
+    new HttpTrackerCommand(e_->newCUID(), e_.get(), "127.0.0.1", port);
+  command->addRequest(req1);
+  command->addRequest(req2);
+  e_->addCommand(command);
+  e_->run();
+
+  CPPUNIT_ASSERT_EQUAL((int)HTTPT_STA_COMPLETE, req1->state);
+  CPPUNIT_ASSERT_EQUAL((int)HTTPT_ERR_SUCCESS, req1->error);
+  CPPUNIT_ASSERT_EQUAL(std::string("foo"), req1->response);
+  CPPUNIT_ASSERT_EQUAL((int)HTTPT_STA_COMPLETE, req2->state);
+  CPPUNIT_ASSERT_EQUAL((int)HTTPT_ERR_SUCCESS, req2->error);
+  CPPUNIT_ASSERT_EQUAL(std::string("bar"), req2->response);
+  // Both requests are sent through one connection, which is pooled
+  // afterwards.
+  CPPUNIT_ASSERT_EQUAL((size_t)1, server.sockets.size());
+  CPPUNIT_ASSERT(server.requests.find("GET /announce?n=1 HTTP/1.1") !=
+                 std::string::npos);
+  CPPUNIT_ASSERT(server.requests.find("GET /announce?n=2 HTTP/1.1") !=
+                 std::string::npos);
+  CPPUNIT_ASSERT(e_->popPooledSocket("127.0.0.1", port, "", 0));
+}
+
+void HttpTrackerCommandTest::testExecute_error()
+{
+  MockTrackerServer server;
+  uint16_t port;
+  startServer(server, port);
+  server.addResponse("HTTP/1.1 404 Not Found\r\n"
+                      "Content-Length: 0\r\n"
+                      "\r\n");
+  // Connection is closed in the middle of the body.
+  server.addResponse("HTTP/1.1 200 OK\r\n"
+                      "Content-Length: 10\r\n"
+                      "\r\n"
+                      "foo", true);
+  SharedHandle<HttpTrackerRequest> req1 =
+    createRequest(fmt("http://127.0.0.1:%u/announce?n=1", port));
+  SharedHandle<HttpTrackerRequest> req2 =
+    createRequest(fmt("http://127.0.0.1:%u/announce?n=2", port));
+  HttpTrackerCommand* command =
+    new HttpTrackerCommand(e_->newCUID(), e_.get(), "127.0.0.1", port);
+  command->addRequest(req1);
+  command->addRequest(req2);
+  e_->addCommand(command);
+  e_->run();
+
+  CPPUNIT_ASSERT_EQUAL((int)HTTPT_STA_COMPLETE, req1->state);
+  CPPUNIT_ASSERT_EQUAL((int)HTTPT_ERR_HTTP, req1->error);
+  CPPUNIT_ASSERT_EQUAL((int)HTTPT_STA_COMPLETE, req2->state);
+  CPPUNIT_ASSERT_EQUAL((int)HTTPT_ERR_NETWORK, req2->error);
+  CPPUNIT_ASSERT(!e_->popPooledSocket("127.0.0.1", port, "", 0));
+}
+
+void HttpTrackerCommandTest::testExecute_redirect()
+{
+  MockTrackerServer server1, server2;
+  uint16_t port1, port2;
+  startServer(server1, port1);
+  startServer(server2, port2);
+  // Redirect within the same host keeps the connection.
+  server1.addResponse("HTTP/1.1 302 Found\r\n"
+                       "Location: /announce2\r\n"
+                       "Content-Length: 0\r\n"
+                       "\r\n");
+  server1.addResponse
+    (fmt("HTTP/1.1 302 Found\r\n"
+         "Location: http://127.0.0.1:%u/announce3\r\n"
+         "Content-Length: 0\r\n"
+         "\r\n", port2));
+  server2.addResponse("HTTP/1.1 200 OK\r\n"
+                       "Content-Length: 3\r\n"
+                       "\r\n"
+                       "foo");
+  SharedHandle<HttpTrackerRequest> req =
+    createRequest(fmt("http://127.0.0.1:%u/announce", port1));
+  HttpTrackerCommand* command =
+    new HttpTrackerCommand(e_->newCUID(), e_.get(), "127.0.0.1", port1);
+  command->addRequest(req);
+  e_->addCommand(command);
+  e_->run();
+
+  CPPUNIT_ASSERT_EQUAL((int)HTTPT_STA_COMPLETE, req->state);
+  CPPUNIT_ASSERT_EQUAL((int)HTTPT_ERR_SUCCESS, req->error);
+  CPPUNIT_ASSERT_EQUAL(std::string("foo"), req->response);
+  CPPUNIT_ASSERT_EQUAL((size_t)1, server1.sockets.size());
+  CPPUNIT_ASSERT(server1.requests.find("GET /announce2 HTTP/1.1") !=
+                 std::string::npos);
+  CPPUNIT_ASSERT(server2.requests.find("GET /announce3 HTTP/1.1") !=
+                 std::string::npos);
+  CPPUNIT_ASSERT_EQUAL((unsigned int)2,
+                       req->httpRequest->getRequest()->getRedirectCount());
+}
+
+#ifdef ENABLE_ASYNC_DNS
+void HttpTrackerCommandTest::testExecute_asyncDNS()
+{
+  option_->put(PREF_ASYNC_DNS, A2_V_TRUE);
+  MockTrackerServer server;
+  uint16_t port;
+  startServer(server, port);
+  server.addResponse("HTTP/1.1 200 OK\r\n"
+                      "Content-Length: 3\r\n"
+                      "\r\n"
+                      "foo");
+  SharedHandle<HttpTrackerRequest> req =
+    createRequest(fmt("http://localhost:%u/announce", port));
+  HttpTrackerCommand* command =
+    new HttpTrackerCommand(e_->newCUID(), e_.get(), "localhost", port);
+  command->addRequest(req);
+  e_->addCommand(command);
+  e_->run();
+
+  CPPUNIT_ASSERT_EQUAL((int)HTTPT_ERR_SUCCESS, req->error);
+  CPPUNIT_ASSERT_EQUAL(std::string("foo"), req->response);
+  CPPUNIT_ASSERT_EQUAL(std::string("127.0.0.1"),
+                       e_->findCachedIPAddress("localhost", port));
+}
+#endif // ENABLE_ASYNC_DNS
+
+} // namespace aria2
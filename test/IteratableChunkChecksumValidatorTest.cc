@@ -1,5 +1,7 @@
 #include "IteratableChunkChecksumValidator.h"
 
+#include <fstream>
+
 #include <cppunit/extensions/HelperMacros.h>
 
 #include "DownloadContext.h"
@@ -8,6 +10,8 @@
 #include "DiskAdaptor.h"
 #include "FileEntry.h"
 #include "PieceSelector.h"
+#include "MessageDigest.h"
+#include "util.h"
 
 namespace aria2 {
 
@@ -16,6 +20,7 @@ class IteratableChunkChecksumValidatorTest:public CppUnit::TestFixture {
   CPPUNIT_TEST_SUITE(IteratableChunkChecksumValidatorTest);
   CPPUNIT_TEST(testValidate);
   CPPUNIT_TEST(testValidate_readError);
+  CPPUNIT_TEST(testValidate_batch);
   CPPUNIT_TEST_SUITE_END();
 private:
 
@@ -26,6 +31,7 @@ public:
 
   void testValidate();
   void testValidate_readError();
+  void testValidate_batch();
 };
 
 
@@ -104,4 +110,56 @@ void IteratableChunkChecksumValidatorTest::testValidate_readError() {
   CPPUNIT_ASSERT(!ps->hasPiece(4));
 }
 
+void IteratableChunkChecksumValidatorTest::testValidate_batch() {
+  // 11 pieces of 1024 bytes and the last piece of 100 bytes. The file
+  // lacks the last 2 pieces.
+  const size_t pieceLength = 1024;
+  const size_t numPieces = 12;
+  std::string data;
+  for(size_t i = 0; i < pieceLength*10; ++i) {
+    data += static_cast<char>(i*7+i/pieceLength);
+  }
+  std::string filename = A2_TEST_OUT_DIR"/aria2_IteratableChunkChecksumValidatorTest_batch";
+  {
+    std::ofstream out(filename.c_str(), std::ios::binary);
+    out << data;
+  }
+  std::deque<std::string> hashes;
+  for(size_t i = 0; i < 10; ++i) {
+    SharedHandle<MessageDigest> ctx = MessageDigest::sha1();
+    ctx->update(data.data()+i*pieceLength, pieceLength);
+    hashes.push_back(ctx->hexDigest());
+  }
+  hashes.push_back("ffffffffffffffffffffffffffffffffffffffff");
+  hashes.push_back("ffffffffffffffffffffffffffffffffffffffff");
+  hashes[3] = "0000000000000000000000000000000000000000";
+
+  Option option;
+  SharedHandle<DownloadContext> dctx
+    (new DownloadContext(pieceLength, pieceLength*11+100, filename));
+  dctx->setPieceHashes(hashes.begin(), hashes.end());
+  dctx->setPieceHashAlgo("sha-1");
+  SharedHandle<DefaultPieceStorage> ps(new DefaultPieceStorage(dctx, &option));
+  ps->initStorage();
+  ps->getDiskAdaptor()->enableReadOnly();
+  ps->getDiskAdaptor()->openFile();
+
+  IteratableChunkChecksumValidator validator(dctx, ps);
+  validator.setBatchImpl(sha1::IMPL_AVX2);
+  validator.init();
+
+  // Pieces #0-#7 are validated at once.
+  validator.validateChunk();
+  CPPUNIT_ASSERT_EQUAL((off_t)(pieceLength*8), validator.getCurrentOffset());
+  // Pieces #8-#10 cannot be read at once, so #8 is validated alone.
+  validator.validateChunk();
+  CPPUNIT_ASSERT_EQUAL((off_t)(pieceLength*9), validator.getCurrentOffset());
+  while(!validator.finished()) {
+    validator.validateChunk();
+  }
+  for(size_t i = 0; i < numPieces; ++i) {
+    CPPUNIT_ASSERT_EQUAL(i != 3 && i < 10, ps->hasPiece(i));
+  }
+}
+
 } // namespace aria2
@@ -0,0 +1,44 @@
+#include "Benchmark.h"
+
+#include "json.h"
+#include "ValueBase.h"
+#include "util.h"
+
+namespace aria2 {
+
+namespace {
+// Decodes a batch of 100 JSON-RPC requests.
+class JsonDecodeBench:public Benchmark {
+private:
+  std::string json_;
+public:
+  virtual void setUp()
+  {
+    json_ = "[";
+    for(size_t i = 0; i < 100; ++i) {
+      if(i > 0) {
+        json_ += ",";
+      }
+      json_ += "{\"jsonrpc\":\"2.0\",\"id\":\"";
+      json_ += util::uitos(i);
+      json_ += "\",\"method\":\"aria2.addUri\","
+        "\"params\":[[\"http://example.org/file\\u0030.iso\","
+        "\"http://mirror.example.org/file0.iso\"],"
+        "{\"split\":\"5\",\"max-connection-per-server\":2,"
+        "\"seed-ratio\":1.5,\"check-integrity\":true,\"header\":null}]}";
+    }
+    json_ += "]";
+  }
+
+  virtual void run(size_t n)
+  {
+    for(size_t i = 0; i < n; ++i) {
+      benchmarkSink(asList(json::decode(json_))->size());
+    }
+  }
+};
+} // namespace
+
+A2_BENCHMARK_REGISTRATION(JsonDecodeBench, "json.decode", 100);
+
+} // namespace aria2
@@ -436,6 +436,16 @@ void JsonTest::testEncode()
     CPPUNIT_ASSERT_EQUAL(std::string("[\"\\u001F\"]"),
                          json::encode(&list));
   }
+  {
+    // escaped characters between normal characters
+    List list;
+    std::string s = "ab\"cd";
+    s += 0x01u;
+    s += "ef/";
+    list.append(s);
+    CPPUNIT_ASSERT_EQUAL(std::string("[\"ab\\\"cd\\u0001ef\\/\"]"),
+                         json::encode(&list));
+  }
   {
     List list;
     list.append(Bool::gTrue());
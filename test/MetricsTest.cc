@@ -0,0 +1,93 @@
+#include "Metrics.h"
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "array_fun.h"
+
+namespace aria2 {
+
+class MetricsTest:public CppUnit::TestFixture {
+
+  CPPUNIT_TEST_SUITE(MetricsTest);
+  CPPUNIT_TEST(testHistogram);
+  CPPUNIT_TEST(testToText);
+  CPPUNIT_TEST_SUITE_END();
+public:
+  void testHistogram();
+  void testToText();
+};
+
+
+CPPUNIT_TEST_SUITE_REGISTRATION(MetricsTest);
+
+void MetricsTest::testHistogram()
+{
+  int64_t bounds[] = { 10, 100 };
+  MetricHistogram histogram(bounds, A2_ARRAY_LEN(bounds));
+  histogram.observe(5);
+  histogram.observe(10);
+  histogram.observe(11);
+  histogram.observe(1000);
+  CPPUNIT_ASSERT_EQUAL((size_t)3, histogram.getCounts().size());
+  CPPUNIT_ASSERT_EQUAL((uint64_t)2, histogram.getCounts()[0]);
+  CPPUNIT_ASSERT_EQUAL((uint64_t)1, histogram.getCounts()[1]);
+  CPPUNIT_ASSERT_EQUAL((uint64_t)1, histogram.getCounts()[2]);
+  CPPUNIT_ASSERT_EQUAL((int64_t)1026, histogram.getSum());
+  CPPUNIT_ASSERT_EQUAL((uint64_t)4, histogram.getCount());
+}
+
+void MetricsTest::testToText()
+{
+  Metrics metrics;
+  metrics.addReceivedBytes(Metrics::PROTO_HTTP, 100);
+  metrics.addReceivedBytes(Metrics::PROTO_BITTORRENT, 16384);
+  metrics.addSentBytes(Metrics::PROTO_BITTORRENT, 5);
+  metrics.increaseStreamConnections();
+  metrics.increaseStreamConnections();
+  metrics.decreaseStreamConnections();
+  metrics.increasePeerConnections();
+  metrics.increasePieceHashFailures();
+  metrics.observeDiskWrite(30);
+  metrics.observeDiskWrite(2000000);
+  std::string text = metrics.toText();
+  CPPUNIT_ASSERT
+    (text.find("# TYPE aria2_received_bytes_total counter\n")
+     != std::string::npos);
+  CPPUNIT_ASSERT
+    (text.find("aria2_received_bytes_total{protocol=\"http\"} 100\n")
+     != std::string::npos);
+  CPPUNIT_ASSERT
+    (text.find("aria2_received_bytes_total{protocol=\"ftp\"} 0\n")
+     != std::string::npos);
+  CPPUNIT_ASSERT
+    (text.find("aria2_received_bytes_total{protocol=\"bittorrent\"} 16384\n")
+     != std::string::npos);
+  CPPUNIT_ASSERT
+    (text.find("aria2_sent_bytes_total{protocol=\"bittorrent\"} 5\n")
+     != std::string::npos);
+  CPPUNIT_ASSERT
+    (text.find("aria2_connections{type=\"server\"} 1\n") != std::string::npos);
+  CPPUNIT_ASSERT
+    (text.find("aria2_connections{type=\"peer\"} 1\n") != std::string::npos);
+  CPPUNIT_ASSERT
+    (text.find("aria2_piece_hash_failures_total 1\n") != std::string::npos);
+  CPPUNIT_ASSERT
+    (text.find("aria2_disk_write_seconds_bucket{le=\"0.000010\"} 0\n")
+     != std::string::npos);
+  CPPUNIT_ASSERT
+    (text.find("aria2_disk_write_seconds_bucket{le=\"0.000050\"} 1\n")
+     != std::string::npos);
+  CPPUNIT_ASSERT
+    (text.find("aria2_disk_write_seconds_bucket{le=\"1.000000\"} 1\n")
+     != std::string::npos);
+  CPPUNIT_ASSERT
+    (text.find("aria2_disk_write_seconds_bucket{le=\"+Inf\"} 2\n")
+     != std::string::npos);
+  CPPUNIT_ASSERT
+    (text.find("aria2_disk_write_seconds_sum 2.000030\n")
+     != std::string::npos);
+  CPPUNIT_ASSERT
+    (text.find("aria2_disk_write_seconds_count 2\n") != std::string::npos);
+}
+
+} // namespace aria2
@@ -64,6 +64,12 @@ public:
   
   virtual void addOutstandingRequest(const RequestSlot& slot) {}
 
+  virtual bool doCancelOutstandingRequestAction
+  (size_t index, uint32_t begin, size_t length)
+  {
+    return false;
+  }
+
   virtual size_t countOutstandingUpload()
   {
     return 0;
@@ -26,6 +26,10 @@ public:
 
   virtual void save() {}
 
+  virtual bool isDirty() {
+    return true;
+  }
+
   virtual void load() {}
 
   virtual void removeFile() {}
@@ -27,7 +27,8 @@ public:
   (std::vector<SharedHandle<BtMessage> >& requests, size_t max) {}
 
   virtual void createRequestMessagesOnEndGame
-  (std::vector<SharedHandle<BtMessage> >& requests, size_t max) {}
+  (std::vector<SharedHandle<BtMessage> >& requests, size_t max,
+   size_t maxBlockRequest) {}
 
   virtual void getTargetPieceIndexes(std::vector<size_t>& indexes) const {}
 };
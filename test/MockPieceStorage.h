@@ -20,6 +20,8 @@ private:
   BitfieldMan* bitfieldMan;
   bool selectiveDownloadingMode;
   bool endGame;
+  uint64_t wastedLength;
+  size_t numHashReread;
   SharedHandle<DiskAdaptor> diskAdaptor;
   std::deque<size_t> pieceLengthList;
   std::deque<SharedHandle<Piece> > inFlightPieces;
@@ -33,6 +35,8 @@ public:
                      bitfieldMan(0),
                      selectiveDownloadingMode(false),
                      endGame(false),
+                     wastedLength(0),
+                     numHashReread(0),
                      downloadFinished_(false),
                      allDownloadFinished_(false) {}
 
@@ -210,6 +214,30 @@ public:
     this->endGame = true;
   }
 
+  virtual bool isStreamingMode() {
+    return false;
+  }
+
+  virtual void addWastedLength(size_t length)
+  {
+    wastedLength += length;
+  }
+
+  virtual uint64_t getWastedLength()
+  {
+    return wastedLength;
+  }
+
+  virtual void addHashReread(size_t length)
+  {
+    ++numHashReread;
+  }
+
+  virtual size_t getNumHashReread()
+  {
+    return numHashReread;
+  }
+
   virtual SharedHandle<DiskAdaptor> getDiskAdaptor() {
     return diskAdaptor;
   }
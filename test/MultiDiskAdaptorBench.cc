@@ -0,0 +1,67 @@
+#include "Benchmark.h"
+
+#include <cstring>
+
+#include "MultiDiskAdaptor.h"
+#include "FileEntry.h"
+#include "File.h"
+#include "util.h"
+
+namespace aria2 {
+
+namespace {
+const size_t NUM_FILES = 16;
+const size_t FILE_LENGTH = 1024*1024;
+const size_t BLOCK_LENGTH = 16*1024;
+
+// Writes 16KiB blocks to 16 files of 1MiB. Every block is written at
+// an offset that is not aligned to the block length, so that some of
+// the writes span 2 files.
+class MultiDiskAdaptorWriteBench:public Benchmark {
+private:
+  SharedHandle<MultiDiskAdaptor> adaptor_;
+  std::vector<SharedHandle<FileEntry> > fileEntries_;
+  unsigned char data_[BLOCK_LENGTH];
+public:
+  virtual void setUp()
+  {
+    memset(data_, 'a', sizeof(data_));
+    for(size_t i = 0; i < NUM_FILES; ++i) {
+      std::string path = A2_TEST_OUT_DIR"/aria2_MultiDiskAdaptorBench";
+      path += util::uitos(i);
+      File(path).remove();
+      fileEntries_.push_back
+        (SharedHandle<FileEntry>
+         (new FileEntry(path, FILE_LENGTH, (off_t)i*FILE_LENGTH)));
+    }
+    adaptor_.reset(new MultiDiskAdaptor());
+    adaptor_->setPieceLength(256*1024);
+    adaptor_->setFileEntries(fileEntries_.begin(), fileEntries_.end());
+    adaptor_->openFile();
+  }
+
+  virtual void run(size_t n)
+  {
+    const size_t numBlocks = NUM_FILES*FILE_LENGTH/BLOCK_LENGTH-1;
+    for(size_t i = 0; i < n; ++i) {
+      off_t offset = (off_t)(benchmarkRandom()%numBlocks)*BLOCK_LENGTH+
+        BLOCK_LENGTH/2;
+      adaptor_->writeData(data_, sizeof(data_), offset);
+    }
+  }
+
+  virtual void tearDown()
+  {
+    adaptor_->closeFile();
+    for(std::vector<SharedHandle<FileEntry> >::const_iterator i =
+          fileEntries_.begin(), eoi = fileEntries_.end(); i != eoi; ++i) {
+      File((*i)->getPath()).remove();
+    }
+  }
+};
+} // namespace
+
+A2_BENCHMARK_REGISTRATION(MultiDiskAdaptorWriteBench,
+                          "MultiDiskAdaptor.writeData", 1000);
+
+} // namespace aria2
@@ -11,6 +11,7 @@ class PeerTest:public CppUnit::TestFixture {
   CPPUNIT_TEST(testGetId);
   CPPUNIT_TEST(testOperatorEqual);
   CPPUNIT_TEST(testCountSeeder);
+  CPPUNIT_TEST(testUpdateBlockRtt);
   CPPUNIT_TEST_SUITE_END();
 private:
   SharedHandle<Peer> peer;
@@ -25,6 +26,7 @@ public:
   void testGetId();
   void testOperatorEqual();
   void testCountSeeder();
+  void testUpdateBlockRtt();
 };
 
 
@@ -77,4 +79,18 @@ void PeerTest::testCountSeeder()
   CPPUNIT_ASSERT_EQUAL((size_t)3, countSeeder(peers.begin(), peers.end()));
 }
 
+void PeerTest::testUpdateBlockRtt()
+{
+  CPPUNIT_ASSERT_EQUAL((int64_t)0, peer->getMinBlockRtt());
+  peer->updateBlockRtt(800);
+  CPPUNIT_ASSERT_EQUAL((int64_t)800, peer->getMinBlockRtt());
+  peer->updateBlockRtt(1200);
+  CPPUNIT_ASSERT_EQUAL((int64_t)800, peer->getMinBlockRtt());
+  peer->updateBlockRtt(300);
+  CPPUNIT_ASSERT_EQUAL((int64_t)300, peer->getMinBlockRtt());
+  // 0 means not measured, so the lowest value stored is 1.
+  peer->updateBlockRtt(0);
+  CPPUNIT_ASSERT_EQUAL((int64_t)1, peer->getMinBlockRtt());
+}
+
 } // namespace aria2
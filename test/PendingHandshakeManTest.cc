@@ -0,0 +1,59 @@
+#include "PendingHandshakeMan.h"
+
+#include <cppunit/extensions/HelperMacros.h>
+
+namespace aria2 {
+
+class PendingHandshakeManTest:public CppUnit::TestFixture {
+
+  CPPUNIT_TEST_SUITE(PendingHandshakeManTest);
+  CPPUNIT_TEST(testAdmit);
+  CPPUNIT_TEST(testAddAndRemove);
+  CPPUNIT_TEST_SUITE_END();
+public:
+  void testAdmit();
+  void testAddAndRemove();
+};
+
+
+CPPUNIT_TEST_SUITE_REGISTRATION(PendingHandshakeManTest);
+
+void PendingHandshakeManTest::testAdmit()
+{
+  PendingHandshakeMan man(3, 2);
+  CPPUNIT_ASSERT(man.admit("192.168.0.1"));
+  man.add("192.168.0.1");
+  CPPUNIT_ASSERT(man.admit("192.168.0.1"));
+  man.add("192.168.0.1");
+  // per-host limit
+  CPPUNIT_ASSERT(!man.admit("192.168.0.1"));
+  CPPUNIT_ASSERT(man.admit("192.168.0.2"));
+  man.add("192.168.0.2");
+  // global limit
+  CPPUNIT_ASSERT(!man.admit("192.168.0.3"));
+
+  CPPUNIT_ASSERT_EQUAL((uint64_t)3, man.getNumAccepted());
+  CPPUNIT_ASSERT_EQUAL((uint64_t)2, man.getNumRejected());
+
+  man.remove("192.168.0.1");
+  CPPUNIT_ASSERT(man.admit("192.168.0.3"));
+}
+
+void PendingHandshakeManTest::testAddAndRemove()
+{
+  PendingHandshakeMan man;
+  man.add("192.168.0.1");
+  man.add("192.168.0.1");
+  man.add("192.168.0.2");
+  CPPUNIT_ASSERT_EQUAL((size_t)3, man.countPending());
+  CPPUNIT_ASSERT_EQUAL((size_t)2, man.countPending("192.168.0.1"));
+  man.remove("192.168.0.1");
+  man.remove("192.168.0.1");
+  CPPUNIT_ASSERT_EQUAL((size_t)0, man.countPending("192.168.0.1"));
+  CPPUNIT_ASSERT_EQUAL((size_t)1, man.countPending());
+  // Removing unknown host is no-op.
+  man.remove("192.168.0.1");
+  CPPUNIT_ASSERT_EQUAL((size_t)1, man.countPending());
+}
+
+} // namespace aria2
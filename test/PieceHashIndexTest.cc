@@ -0,0 +1,177 @@
+#include "PieceHashIndex.h"
+
+#include <sstream>
+#include <fstream>
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "DownloadContext.h"
+#include "FileEntry.h"
+#include "array_fun.h"
+#include "File.h"
+#include "TestUtil.h"
+
+namespace aria2 {
+
+class PieceHashIndexTest:public CppUnit::TestFixture {
+
+  CPPUNIT_TEST_SUITE(PieceHashIndexTest);
+  CPPUNIT_TEST(testLoad);
+  CPPUNIT_TEST(testAddDownload);
+  CPPUNIT_TEST(testAdd);
+  CPPUNIT_TEST(testRemove);
+  CPPUNIT_TEST(testSave);
+  CPPUNIT_TEST(testLoad_compact);
+  CPPUNIT_TEST_SUITE_END();
+public:
+  void testLoad();
+  void testSave();
+  void testLoad_compact();
+  void testAddDownload();
+  void testAdd();
+  void testRemove();
+};
+
+
+CPPUNIT_TEST_SUITE_REGISTRATION(PieceHashIndexTest);
+
+void PieceHashIndexTest::testLoad()
+{
+  std::stringstream ss;
+  ss << "sha-1 aaaa 0 512 /data/a\n"
+     << "sha-1 bbbb 1024 512 /data/with space\n"
+     // malformed lines are ignored
+     << "sha-1 cccc 0 512\n"
+     << "sha-1 dddd x 512 /data/a\n"
+     << "sha-1 eeee 0 0 /data/a\n"
+     << "\n"
+     // later line overrides earlier one
+     << "sha-1 aaaa 512 512 /data/b\n"
+     // removal line
+     << "sha-1 ffff 0 512 /data/a\n"
+     << "sha-1 ffff -\n";
+  PieceHashIndex index("/dev/null");
+  CPPUNIT_ASSERT(index.load(ss));
+  CPPUNIT_ASSERT_EQUAL((size_t)2, index.countPieces());
+  // 4 malformed lines, the overridden aaaa line, the removed ffff
+  // line and the removal line itself.
+  CPPUNIT_ASSERT_EQUAL((size_t)7, index.getNumObsoleteLines());
+
+  const PieceHashIndex::Location* loc = index.find("sha-1", "aaaa");
+  CPPUNIT_ASSERT(loc);
+  CPPUNIT_ASSERT_EQUAL(std::string("/data/b"), loc->path);
+  CPPUNIT_ASSERT_EQUAL((off_t)512, loc->offset);
+  CPPUNIT_ASSERT_EQUAL((size_t)512, loc->length);
+
+  loc = index.find("sha-1", "bbbb");
+  CPPUNIT_ASSERT(loc);
+  CPPUNIT_ASSERT_EQUAL(std::string("/data/with space"), loc->path);
+  CPPUNIT_ASSERT_EQUAL((off_t)1024, loc->offset);
+
+  CPPUNIT_ASSERT(!index.find("sha-1", "cccc"));
+  CPPUNIT_ASSERT(!index.find("md5", "aaaa"));
+}
+
+void PieceHashIndexTest::testAddDownload()
+{
+  // Piece 1 spans 2 files and piece 3 is not downloaded.
+  SharedHandle<DownloadContext> dctx(new DownloadContext());
+  dctx->setPieceLength(512);
+  SharedHandle<FileEntry> entries[] = {
+    SharedHandle<FileEntry>(new FileEntry("/data/a", 1000, 0)),
+    SharedHandle<FileEntry>(new FileEntry("/data/b", 1048, 1000))
+  };
+  dctx->setFileEntries(vbegin(entries), vend(entries));
+  std::string hashes[] = { "h0", "h1", "h2", "h3" };
+  dctx->setPieceHashes(vbegin(hashes), vend(hashes));
+  dctx->setPieceHashAlgo("sha-1");
+  unsigned char bitfield[] = { 0xe0 };
+
+  PieceHashIndex index("/dev/null");
+  std::stringstream ss;
+  CPPUNIT_ASSERT_EQUAL((size_t)2, index.addDownload(dctx, bitfield, ss));
+  CPPUNIT_ASSERT_EQUAL(std::string("sha-1 h0 0 512 /data/a\n"
+                                   "sha-1 h2 24 512 /data/b\n"),
+                       ss.str());
+  CPPUNIT_ASSERT_EQUAL((size_t)2, index.countPieces());
+  CPPUNIT_ASSERT(!index.find("sha-1", "h1"));
+  CPPUNIT_ASSERT(!index.find("sha-1", "h3"));
+
+  // Already indexed pieces are not written again.
+  std::stringstream ss2;
+  CPPUNIT_ASSERT_EQUAL((size_t)0, index.addDownload(dctx, bitfield, ss2));
+  CPPUNIT_ASSERT(ss2.str().empty());
+
+  // What was written loads back the same.
+  PieceHashIndex index2("/dev/null");
+  CPPUNIT_ASSERT(index2.load(ss));
+  CPPUNIT_ASSERT_EQUAL((size_t)2, index2.countPieces());
+  CPPUNIT_ASSERT(*index.find("sha-1", "h2") == *index2.find("sha-1", "h2"));
+}
+
+void PieceHashIndexTest::testAdd()
+{
+  PieceHashIndex index("/dev/null");
+  PieceHashIndex::Location a("/data/a", 0, 512);
+  PieceHashIndex::Location b("/data/b", 0, 512);
+  CPPUNIT_ASSERT(index.add("sha-1", "h0", a));
+  CPPUNIT_ASSERT(!index.add("sha-1", "h0", a));
+  CPPUNIT_ASSERT(index.add("sha-1", "h0", b));
+  CPPUNIT_ASSERT(*index.find("sha-1", "h0") == b);
+  CPPUNIT_ASSERT_EQUAL((size_t)1, index.countPieces());
+}
+
+void PieceHashIndexTest::testRemove()
+{
+  PieceHashIndex index("/dev/null");
+  index.add("sha-1", "h0", PieceHashIndex::Location("/data/a", 0, 512));
+  index.add("sha-1", "h1", PieceHashIndex::Location("/data/a", 512, 512));
+  std::stringstream ss;
+  index.remove("sha-1", "h0", ss);
+  index.remove("sha-1", "none", ss);
+  CPPUNIT_ASSERT_EQUAL(std::string("sha-1 h0 -\n"), ss.str());
+  CPPUNIT_ASSERT(!index.find("sha-1", "h0"));
+  CPPUNIT_ASSERT(index.find("sha-1", "h1"));
+  CPPUNIT_ASSERT_EQUAL((size_t)1, index.countPieces());
+}
+
+void PieceHashIndexTest::testSave()
+{
+  PieceHashIndex index("/dev/null");
+  index.add("sha-1", "h1", PieceHashIndex::Location("/data/b", 24, 512));
+  index.add("sha-1", "h0", PieceHashIndex::Location("/data/a", 0, 512));
+  std::stringstream ss;
+  CPPUNIT_ASSERT(index.save(ss));
+  CPPUNIT_ASSERT_EQUAL(std::string("sha-1 h0 0 512 /data/a\n"
+                                   "sha-1 h1 24 512 /data/b\n"),
+                       ss.str());
+}
+
+void PieceHashIndexTest::testLoad_compact()
+{
+  File f(A2_TEST_OUT_DIR"/aria2_PieceHashIndexTest_testLoad_compact");
+  {
+    std::ofstream out(f.getPath().c_str(), std::ios::binary);
+    out << "sha-1 h0 0 512 /data/a\n"
+        << "sha-1 h1 512 512 /data/a\n"
+        << "sha-1 h0 0 512 /data/a\n"
+        << "sha-1 h1 -\n";
+  }
+  PieceHashIndex index(f.getPath());
+  CPPUNIT_ASSERT(index.load());
+  CPPUNIT_ASSERT_EQUAL((size_t)1, index.countPieces());
+  CPPUNIT_ASSERT_EQUAL((size_t)0, index.getNumObsoleteLines());
+  CPPUNIT_ASSERT_EQUAL(std::string("sha-1 h0 0 512 /data/a\n"),
+                       readFile(f.getPath()));
+  // Removal is appended to the file.
+  index.remove("sha-1", "h0");
+  CPPUNIT_ASSERT_EQUAL(std::string("sha-1 h0 0 512 /data/a\n"
+                                   "sha-1 h0 -\n"),
+                       readFile(f.getPath()));
+  PieceHashIndex index2(f.getPath());
+  CPPUNIT_ASSERT(index2.load());
+  CPPUNIT_ASSERT_EQUAL((size_t)0, index2.countPieces());
+  CPPUNIT_ASSERT_EQUAL(std::string(), readFile(f.getPath()));
+}
+
+} // namespace aria2
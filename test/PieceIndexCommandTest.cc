@@ -0,0 +1,124 @@
+#include "PieceIndexCommand.h"
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "PieceHashIndex.h"
+#include "DownloadEngine.h"
+#include "SelectEventPoll.h"
+#include "RequestGroup.h"
+#include "DownloadContext.h"
+#include "DefaultPieceStorage.h"
+#include "DiskAdaptor.h"
+#include "BtRuntime.h"
+#include "Option.h"
+#include "File.h"
+#include "util.h"
+#include "TestUtil.h"
+
+namespace aria2 {
+
+class PieceIndexCommandTest:public CppUnit::TestFixture {
+
+  CPPUNIT_TEST_SUITE(PieceIndexCommandTest);
+  CPPUNIT_TEST(testExecute_copy);
+  CPPUNIT_TEST(testExecute_addDownload);
+  CPPUNIT_TEST_SUITE_END();
+private:
+  static const char* hashes_[];
+
+  SharedHandle<Option> option_;
+  SharedHandle<RequestGroup> requestGroup_;
+  SharedHandle<DownloadContext> dctx_;
+  SharedHandle<DefaultPieceStorage> pieceStorage_;
+  SharedHandle<PieceHashIndex> index_;
+public:
+  void setUp()
+  {
+    option_.reset(new Option());
+    dctx_.reset(new DownloadContext
+                (100, 250, A2_TEST_OUT_DIR"/aria2_PieceIndexCommandTest_out"));
+    dctx_->setPieceHashes(&hashes_[0], &hashes_[3]);
+    dctx_->setPieceHashAlgo("sha-1");
+    requestGroup_.reset(new RequestGroup(option_));
+    requestGroup_->setDownloadContext(dctx_);
+    pieceStorage_.reset(new DefaultPieceStorage(dctx_, option_.get()));
+    pieceStorage_->initStorage();
+    pieceStorage_->getDiskAdaptor()->initAndOpenFile();
+    File indexFile(A2_TEST_OUT_DIR"/aria2_PieceIndexCommandTest_index");
+    indexFile.remove();
+    index_.reset(new PieceHashIndex(indexFile.getPath()));
+  }
+
+  void tearDown()
+  {
+    pieceStorage_->getDiskAdaptor()->closeFile();
+  }
+
+  PieceIndexCommand* createCommand(DownloadEngine* e)
+  {
+    PieceIndexCommand* command =
+      new PieceIndexCommand(1, requestGroup_.get(), e, index_);
+    command->setPieceStorage(pieceStorage_);
+    command->setBtRuntime(SharedHandle<BtRuntime>(new BtRuntime()));
+    return command;
+  }
+
+  void testExecute_copy();
+  void testExecute_addDownload();
+};
+
+
+CPPUNIT_TEST_SUITE_REGISTRATION(PieceIndexCommandTest);
+
+// The hashes of the 3 pieces of chunkChecksumTestFile250.txt.
+const char* PieceIndexCommandTest::hashes_[] = {
+  "29b0e7878271645fffb7eec7db4a7473a1c00bc1",
+  "4df75a661cb7eb2733d9cdaa7f772eae3a4e2976",
+  "0a4ea2f7dd7c52ddf2099a444ab2184b4d341bdb"
+};
+
+void PieceIndexCommandTest::testExecute_copy()
+{
+  std::string src = A2_TEST_DIR"/chunkChecksumTestFile250.txt";
+  index_->add("sha-1", hashes_[0], PieceHashIndex::Location(src, 0, 100));
+  // Stale entry: the data at the location does not match the hash.
+  index_->add("sha-1", hashes_[1], PieceHashIndex::Location(src, 0, 100));
+  DownloadEngine e(SharedHandle<EventPoll>(new SelectEventPoll()));
+  // e owns the command once execute() returns false.
+  CPPUNIT_ASSERT(!createCommand(&e)->execute());
+
+  CPPUNIT_ASSERT(pieceStorage_->hasPiece(0));
+  CPPUNIT_ASSERT(!pieceStorage_->hasPiece(1));
+  CPPUNIT_ASSERT(!pieceStorage_->isPieceUsed(1));
+  CPPUNIT_ASSERT(!pieceStorage_->hasPiece(2));
+  CPPUNIT_ASSERT(!pieceStorage_->isPieceUsed(2));
+  CPPUNIT_ASSERT_EQUAL(readFile(src).substr(0, 100),
+                       readFile(dctx_->getBasePath()).substr(0, 100));
+  // The stale entry is removed from the index and its file.
+  CPPUNIT_ASSERT(index_->find("sha-1", hashes_[0]));
+  CPPUNIT_ASSERT(!index_->find("sha-1", hashes_[1]));
+  CPPUNIT_ASSERT_EQUAL(std::string("sha-1 ")+hashes_[1]+" -\n",
+                       readFile(index_->getFilename()));
+}
+
+void PieceIndexCommandTest::testExecute_addDownload()
+{
+  pieceStorage_->markAllPiecesDone();
+  DownloadEngine e(SharedHandle<EventPoll>(new SelectEventPoll()));
+  PieceIndexCommand* command = createCommand(&e);
+  CPPUNIT_ASSERT(command->execute());
+  delete command;
+
+  CPPUNIT_ASSERT_EQUAL((size_t)3, index_->countPieces());
+  const PieceHashIndex::Location* loc = index_->find("sha-1", hashes_[2]);
+  CPPUNIT_ASSERT(loc);
+  CPPUNIT_ASSERT(util::endsWith(loc->path, "/aria2_PieceIndexCommandTest_out"));
+  CPPUNIT_ASSERT_EQUAL((off_t)200, loc->offset);
+  CPPUNIT_ASSERT_EQUAL((size_t)50, loc->length);
+
+  PieceHashIndex index(index_->getFilename());
+  CPPUNIT_ASSERT(index.load());
+  CPPUNIT_ASSERT_EQUAL((size_t)3, index.countPieces());
+}
+
+} // namespace aria2
@@ -0,0 +1,85 @@
+#include "Benchmark.h"
+
+#include "PieceStatMan.h"
+#include "BitfieldMan.h"
+#include "SharedHandle.h"
+
+namespace aria2 {
+
+namespace {
+const size_t NUM_PIECES = 16384;
+const size_t NUM_PEERS = 50;
+
+class PieceStatManBench:public Benchmark {
+protected:
+  PieceStatMan pieceStatMan_;
+  std::vector<SharedHandle<BitfieldMan> > peerBitfields_;
+public:
+  PieceStatManBench():pieceStatMan_(NUM_PIECES, false) {}
+
+  virtual void setUp()
+  {
+    for(size_t i = 0; i < NUM_PEERS; ++i) {
+      SharedHandle<BitfieldMan> bitfield(new BitfieldMan(1, NUM_PIECES));
+      for(size_t j = 0; j < NUM_PIECES; ++j) {
+        if(benchmarkRandom()%2) {
+          bitfield->setBit(j);
+        }
+      }
+      peerBitfields_.push_back(bitfield);
+    }
+  }
+};
+} // namespace
+
+namespace {
+// Measures a peer joining and leaving the swarm.
+class AddSubtractPieceStatsBench:public PieceStatManBench {
+public:
+  virtual void run(size_t n)
+  {
+    for(size_t i = 0; i < n; ++i) {
+      const SharedHandle<BitfieldMan>& bitfield =
+        peerBitfields_[i%peerBitfields_.size()];
+      pieceStatMan_.addPieceStats(bitfield->getBitfield(),
+                                  bitfield->getBitfieldLength());
+      pieceStatMan_.subtractPieceStats(bitfield->getBitfield(),
+                                       bitfield->getBitfieldLength());
+    }
+    benchmarkSink(pieceStatMan_.getRarerPieceIndexes().front());
+  }
+};
+} // namespace
+
+A2_BENCHMARK_REGISTRATION(AddSubtractPieceStatsBench,
+                          "PieceStatMan.addSubtractPieceStats", 50);
+
+namespace {
+// Measures a peer announcing a new piece with a bitfield update.
+class UpdatePieceStatsBench:public PieceStatManBench {
+public:
+  virtual void run(size_t n)
+  {
+    BitfieldMan bitfield(*peerBitfields_[0]);
+    BitfieldMan oldBitfield(bitfield);
+    for(size_t i = 0; i < n; ++i) {
+      size_t index = benchmarkRandom()%NUM_PIECES;
+      if(bitfield.isBitSet(index)) {
+        bitfield.unsetBit(index);
+      } else {
+        bitfield.setBit(index);
+      }
+      pieceStatMan_.updatePieceStats(bitfield.getBitfield(),
+                                     bitfield.getBitfieldLength(),
+                                     oldBitfield.getBitfield());
+      oldBitfield = bitfield;
+    }
+    benchmarkSink(pieceStatMan_.getRarerPieceIndexes().front());
+  }
+};
+} // namespace
+
+A2_BENCHMARK_REGISTRATION(UpdatePieceStatsBench,
+                          "PieceStatMan.updatePieceStats", 100);
+
+} // namespace aria2
@@ -1,9 +1,15 @@
 #include "Piece.h"
 
 #include <string>
+#include <vector>
 
 #include <cppunit/extensions/HelperMacros.h>
 
+#include "ByteArrayDiskWriter.h"
+#ifdef ENABLE_MESSAGE_DIGEST
+# include "DigestThreadPool.h"
+#endif // ENABLE_MESSAGE_DIGEST
+
 namespace aria2 {
 
 class PieceTest:public CppUnit::TestFixture {
@@ -11,10 +17,15 @@ class PieceTest:public CppUnit::TestFixture {
   CPPUNIT_TEST_SUITE(PieceTest);
   CPPUNIT_TEST(testCompleteBlock);
   CPPUNIT_TEST(testGetCompletedLength);
+  CPPUNIT_TEST(testBlockRequest);
 
 #ifdef ENABLE_MESSAGE_DIGEST
 
   CPPUNIT_TEST(testUpdateHash);
+  CPPUNIT_TEST(testUpdateHash_outOfOrder);
+  CPPUNIT_TEST(testUpdateHash_totalBufferLength);
+  CPPUNIT_TEST(testUpdateHashWithRead);
+  CPPUNIT_TEST(testUpdateHash_threadPool);
 
 #endif // ENABLE_MESSAGE_DIGEST
 
@@ -26,10 +37,15 @@ public:
 
   void testCompleteBlock();
   void testGetCompletedLength();
+  void testBlockRequest();
 
 #ifdef ENABLE_MESSAGE_DIGEST
 
   void testUpdateHash();
+  void testUpdateHash_outOfOrder();
+  void testUpdateHash_totalBufferLength();
+  void testUpdateHashWithRead();
+  void testUpdateHash_threadPool();
 
 #endif // ENABLE_MESSAGE_DIGEST
 };
@@ -47,6 +63,24 @@ void PieceTest::testCompleteBlock()
   CPPUNIT_ASSERT(p.hasBlock(5));
 }
 
+void PieceTest::testBlockRequest()
+{
+  Piece p(0, 16*1024*4);
+  CPPUNIT_ASSERT_EQUAL((size_t)0, p.countBlockRequest(1));
+  p.addBlockRequest(1);
+  p.addBlockRequest(1);
+  p.addBlockRequest(3);
+  CPPUNIT_ASSERT_EQUAL((size_t)2, p.countBlockRequest(1));
+  CPPUNIT_ASSERT_EQUAL((size_t)1, p.countBlockRequest(3));
+  p.removeBlockRequest(1);
+  CPPUNIT_ASSERT_EQUAL((size_t)1, p.countBlockRequest(1));
+  p.removeBlockRequest(0);
+  CPPUNIT_ASSERT_EQUAL((size_t)0, p.countBlockRequest(0));
+  // Out of range
+  p.addBlockRequest(4);
+  CPPUNIT_ASSERT_EQUAL((size_t)0, p.countBlockRequest(4));
+}
+
 void PieceTest::testGetCompletedLength()
 {
   size_t blockLength = 16*1024;
@@ -84,6 +118,138 @@ void PieceTest::testUpdateHash()
                        p.getHashString());
 }
 
+void PieceTest::testUpdateHash_outOfOrder()
+{
+  Piece p(0, 16, 2*1024*1024);
+  p.setHashAlgo("sha-1");
+  std::string data("SPAM!SPAM!SPAM!!");
+  const unsigned char* d = reinterpret_cast<const unsigned char*>(data.c_str());
+
+  CPPUNIT_ASSERT(p.updateHash(11, d+11, 5));
+  CPPUNIT_ASSERT(p.updateHash(5, d+5, 6));
+  // Duplicate block is not buffered.
+  CPPUNIT_ASSERT(!p.updateHash(5, d+5, 6));
+  CPPUNIT_ASSERT_EQUAL((size_t)11, p.getHashBufferLength());
+  CPPUNIT_ASSERT(!p.isHashCalculated());
+
+  CPPUNIT_ASSERT(p.updateHash(0, d, 5));
+  CPPUNIT_ASSERT_EQUAL((size_t)0, p.getHashBufferLength());
+  CPPUNIT_ASSERT(p.isHashCalculated());
+  CPPUNIT_ASSERT_EQUAL(std::string("d9189aff79e075a2e60271b9556a710dc1bc7de7"),
+                       p.getHashString());
+
+  // Buffer is full.
+  Piece q(0, Piece::MAX_HASH_BUFFER_LENGTH*2, Piece::MAX_HASH_BUFFER_LENGTH);
+  q.setHashAlgo("sha-1");
+  std::string block(Piece::MAX_HASH_BUFFER_LENGTH, 'a');
+  const unsigned char* b = reinterpret_cast<const unsigned char*>(block.data());
+  CPPUNIT_ASSERT(q.updateHash(1, b, 1));
+  CPPUNIT_ASSERT(!q.updateHash(2, b, Piece::MAX_HASH_BUFFER_LENGTH));
+  CPPUNIT_ASSERT_EQUAL((size_t)1, q.getHashBufferLength());
+}
+
+void PieceTest::testUpdateHash_totalBufferLength()
+{
+  const size_t n =
+    Piece::MAX_TOTAL_HASH_BUFFER_LENGTH/Piece::MAX_HASH_BUFFER_LENGTH;
+  std::string block(Piece::MAX_HASH_BUFFER_LENGTH, 'a');
+  const unsigned char* b = reinterpret_cast<const unsigned char*>(block.data());
+  {
+    std::vector<SharedHandle<Piece> > pieces;
+    for(size_t i = 0; i < n; ++i) {
+      SharedHandle<Piece> p
+        (new Piece(i, Piece::MAX_HASH_BUFFER_LENGTH+1,
+                   Piece::MAX_HASH_BUFFER_LENGTH));
+      p->setHashAlgo("sha-1");
+      CPPUNIT_ASSERT(p->updateHash(1, b, Piece::MAX_HASH_BUFFER_LENGTH));
+      pieces.push_back(p);
+    }
+    CPPUNIT_ASSERT_EQUAL((size_t)Piece::MAX_TOTAL_HASH_BUFFER_LENGTH,
+                         Piece::getTotalHashBufferLength());
+    // All pieces share the budget.
+    Piece q(n, 2, 1);
+    q.setHashAlgo("sha-1");
+    CPPUNIT_ASSERT(!q.updateHash(1, b, 1));
+    CPPUNIT_ASSERT(q.updateHash(0, b, 1));
+
+    // Filling the gap releases the buffer.
+    CPPUNIT_ASSERT(pieces[0]->updateHash(0, b, 1));
+    CPPUNIT_ASSERT(pieces[0]->isHashCalculated());
+    CPPUNIT_ASSERT_EQUAL
+      ((size_t)(Piece::MAX_TOTAL_HASH_BUFFER_LENGTH-
+                Piece::MAX_HASH_BUFFER_LENGTH),
+       Piece::getTotalHashBufferLength());
+    pieces[1]->destroyHashContext();
+    CPPUNIT_ASSERT_EQUAL
+      ((size_t)(Piece::MAX_TOTAL_HASH_BUFFER_LENGTH-
+                Piece::MAX_HASH_BUFFER_LENGTH*2),
+       Piece::getTotalHashBufferLength());
+  }
+  // Destroyed pieces release their buffer.
+  CPPUNIT_ASSERT_EQUAL((size_t)0, Piece::getTotalHashBufferLength());
+}
+
+void PieceTest::testUpdateHashWithRead()
+{
+  SharedHandle<ByteArrayDiskWriter> dw(new ByteArrayDiskWriter());
+  dw->setString("xxSPAM!SPAM!SPAM!!");
+  Piece p(0, 16, 2*1024*1024);
+  p.setHashAlgo("sha-1");
+  std::string data("SPAM!SPAM!SPAM!!");
+  const unsigned char* d = reinterpret_cast<const unsigned char*>(data.c_str());
+
+  CPPUNIT_ASSERT(p.updateHash(0, d, 5));
+  CPPUNIT_ASSERT(p.updateHash(11, d+11, 5));
+  CPPUNIT_ASSERT_EQUAL((size_t)11, p.updateHashWithRead(dw, 2));
+  CPPUNIT_ASSERT_EQUAL((size_t)0, p.getHashBufferLength());
+  CPPUNIT_ASSERT(p.isHashCalculated());
+  CPPUNIT_ASSERT_EQUAL(std::string("d9189aff79e075a2e60271b9556a710dc1bc7de7"),
+                       p.getHashString());
+}
+
+void PieceTest::testUpdateHash_threadPool()
+{
+  DigestThreadPool::setInstance
+    (SharedHandle<DigestThreadPool>(new DigestThreadPool(2)));
+  SharedHandle<ByteArrayDiskWriter> dw(new ByteArrayDiskWriter());
+  dw->setString("xxSPAM!SPAM!SPAM!!");
+  std::string data("SPAM!SPAM!SPAM!!");
+  const unsigned char* d = reinterpret_cast<const unsigned char*>(data.c_str());
+  {
+    Piece p(0, 16, 2*1024*1024);
+    p.setHashAlgo("sha-1");
+    CPPUNIT_ASSERT(p.updateHash(11, d+11, 5));
+    CPPUNIT_ASSERT(p.updateHash(0, d, 5));
+    CPPUNIT_ASSERT(p.updateHash(5, d+5, 6));
+    CPPUNIT_ASSERT(p.isHashCalculated());
+    CPPUNIT_ASSERT_EQUAL
+      (std::string("d9189aff79e075a2e60271b9556a710dc1bc7de7"),
+       p.getHashString());
+  }
+  {
+    Piece p(0, 16, 2*1024*1024);
+    p.setHashAlgo("sha-1");
+    CPPUNIT_ASSERT(p.updateHash(0, d, 5));
+    CPPUNIT_ASSERT_EQUAL((size_t)11, p.updateHashWithRead(dw, 2));
+#ifdef HAVE_PTHREAD
+    // The read data may still be hashed on the pool.
+    p.getDigestStream()->wait();
+#endif // HAVE_PTHREAD
+    CPPUNIT_ASSERT(!p.isHashPending());
+    CPPUNIT_ASSERT_EQUAL
+      (std::string("d9189aff79e075a2e60271b9556a710dc1bc7de7"),
+       p.getHashString());
+  }
+  DigestThreadPool::setInstance(SharedHandle<DigestThreadPool>());
+  {
+    Piece p(0, 16, 2*1024*1024);
+    p.setHashAlgo("sha-1");
+    CPPUNIT_ASSERT_EQUAL((size_t)16, p.updateHashWithRead(dw, 2));
+    CPPUNIT_ASSERT(!p.isHashPending());
+    CPPUNIT_ASSERT(!p.getDigestStream());
+  }
+}
+
 #endif // ENABLE_MESSAGE_DIGEST
 
 } // namespace aria2
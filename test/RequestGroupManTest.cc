@@ -1,6 +1,7 @@
 #include "RequestGroupMan.h"
 
 #include <fstream>
+#include <sstream>
 
 #include <cppunit/extensions/HelperMacros.h>
 
@@ -15,6 +16,9 @@
 #include "File.h"
 #include "array_fun.h"
 #include "RecoverableException.h"
+#include "UriListParser.h"
+#include "DownloadEngine.h"
+#include "SelectEventPoll.h"
 
 namespace aria2 {
 
@@ -26,6 +30,10 @@ class RequestGroupManTest : public CppUnit::TestFixture {
   CPPUNIT_TEST(testLoadServerStat);
   CPPUNIT_TEST(testSaveServerStat);
   CPPUNIT_TEST(testChangeReservedGroupPosition);
+  CPPUNIT_TEST(testFindReservedGroup);
+  CPPUNIT_TEST(testFindDownloadResult);
+  CPPUNIT_TEST(testFillRequestGroupFromReserver_parserError);
+  CPPUNIT_TEST(testChangeLog);
   CPPUNIT_TEST_SUITE_END();
 private:
   SharedHandle<Option> option_;
@@ -41,6 +49,10 @@ public:
   void testLoadServerStat();
   void testSaveServerStat();
   void testChangeReservedGroupPosition();
+  void testFindReservedGroup();
+  void testFindDownloadResult();
+  void testFillRequestGroupFromReserver_parserError();
+  void testChangeLog();
 };
 
 
@@ -168,4 +180,134 @@ void RequestGroupManTest::testChangeReservedGroupPosition()
   }
 }
 
+void RequestGroupManTest::testFindReservedGroup()
+{
+  SharedHandle<RequestGroup> gs[] = {
+    SharedHandle<RequestGroup>(new RequestGroup(option_)),
+    SharedHandle<RequestGroup>(new RequestGroup(option_)),
+    SharedHandle<RequestGroup>(new RequestGroup(option_))
+  };
+  std::vector<SharedHandle<RequestGroup> > groups(vbegin(gs), vend(gs));
+  RequestGroupMan rm(groups, 0, option_.get());
+
+  CPPUNIT_ASSERT_EQUAL(gs[0].get(), rm.findReservedGroup(1).get());
+  CPPUNIT_ASSERT_EQUAL(gs[2].get(), rm.findReservedGroup(3).get());
+  CPPUNIT_ASSERT(!rm.findReservedGroup(4));
+
+  SharedHandle<RequestGroup> g4(new RequestGroup(option_));
+  rm.addReservedGroup(g4);
+  SharedHandle<RequestGroup> g5(new RequestGroup(option_));
+  rm.insertReservedGroup(0, g5);
+  CPPUNIT_ASSERT_EQUAL(g4.get(), rm.findReservedGroup(4).get());
+  CPPUNIT_ASSERT_EQUAL(g5.get(), rm.findReservedGroup(5).get());
+
+  CPPUNIT_ASSERT_EQUAL
+    ((size_t)4, rm.changeReservedGroupPosition(5, 0, RequestGroupMan::POS_END));
+  CPPUNIT_ASSERT_EQUAL(g5.get(), rm.findReservedGroup(5).get());
+  CPPUNIT_ASSERT_EQUAL(g5.get(), rm.getReservedGroups()[4].get());
+
+  CPPUNIT_ASSERT(rm.removeReservedGroup(2));
+  CPPUNIT_ASSERT(!rm.removeReservedGroup(2));
+  CPPUNIT_ASSERT(!rm.findReservedGroup(2));
+  CPPUNIT_ASSERT_EQUAL((size_t)4, rm.getReservedGroups().size());
+  try {
+    rm.changeReservedGroupPosition(2, 0, RequestGroupMan::POS_SET);
+    CPPUNIT_FAIL("exception must be thrown.");
+  } catch(RecoverableException& e) {
+    // success
+  }
+
+  CPPUNIT_ASSERT(!rm.findRequestGroup(1));
+  rm.addRequestGroup(gs[0]);
+  CPPUNIT_ASSERT_EQUAL(gs[0].get(), rm.findRequestGroup(1).get());
+}
+
+void RequestGroupManTest::testFindDownloadResult()
+{
+  option_->put(PREF_MAX_DOWNLOAD_RESULT, "2");
+  RequestGroupMan rm(std::vector<SharedHandle<RequestGroup> >(), 0,
+                     option_.get());
+  SharedHandle<DownloadResult> drs[3];
+  for(size_t i = 0; i < A2_ARRAY_LEN(drs); ++i) {
+    drs[i].reset(new DownloadResult());
+    drs[i]->gid = i+1;
+    drs[i]->result = error_code::FINISHED;
+  }
+  rm.addDownloadResult(drs[0]);
+  rm.addDownloadResult(drs[1]);
+  CPPUNIT_ASSERT_EQUAL(drs[0].get(), rm.findDownloadResult(1).get());
+  CPPUNIT_ASSERT_EQUAL(drs[1].get(), rm.findDownloadResult(2).get());
+  // drs[0] is removed because of --max-download-result
+  rm.addDownloadResult(drs[2]);
+  CPPUNIT_ASSERT(!rm.findDownloadResult(1));
+  CPPUNIT_ASSERT_EQUAL(drs[2].get(), rm.findDownloadResult(3).get());
+
+  CPPUNIT_ASSERT(!rm.removeDownloadResult(1));
+  CPPUNIT_ASSERT(rm.removeDownloadResult(2));
+  CPPUNIT_ASSERT(!rm.findDownloadResult(2));
+  CPPUNIT_ASSERT_EQUAL((size_t)1, rm.getDownloadResults().size());
+
+  rm.purgeDownloadResult();
+  CPPUNIT_ASSERT(!rm.findDownloadResult(3));
+}
+
+void RequestGroupManTest::testFillRequestGroupFromReserver_parserError()
+{
+  SharedHandle<RequestGroup> paused(new RequestGroup(option_));
+  paused->setPauseRequested(true);
+  RequestGroupMan rm
+    (std::vector<SharedHandle<RequestGroup> >(), 1, option_.get());
+  rm.addReservedGroup(paused);
+  SharedHandle<std::stringstream> in(new std::stringstream());
+  *in << "http://localhost/file\n"
+      << " max-download-limit=bad\n";
+  rm.setUriListParser(SharedHandle<UriListParser>(new UriListParser(in)));
+  DownloadEngine e(SharedHandle<EventPoll>(new SelectEventPoll()));
+  try {
+    rm.fillRequestGroupFromReserver(&e);
+    CPPUNIT_FAIL("exception must be thrown.");
+  } catch(RecoverableException& ex) {
+    // success
+  }
+  // The paused group must not be lost.
+  CPPUNIT_ASSERT_EQUAL((size_t)1, rm.getReservedGroups().size());
+  CPPUNIT_ASSERT(rm.findReservedGroup(paused->getGID()));
+}
+
+void RequestGroupManTest::testChangeLog()
+{
+  SharedHandle<RequestGroup> rg1(new RequestGroup(option_));
+  SharedHandle<RequestGroup> rg2(new RequestGroup(option_));
+  RequestGroupMan rm
+    (std::vector<SharedHandle<RequestGroup> >(), 1, option_.get());
+  rm.addReservedGroup(rg1);
+  rm.addReservedGroup(rg2);
+  CPPUNIT_ASSERT_EQUAL((int64_t)2, rm.getVersion());
+  CPPUNIT_ASSERT(rm.changeLogAvailable(0));
+  CPPUNIT_ASSERT(!rm.changeLogAvailable(3));
+  rm.removeReservedGroup(rg1->getGID());
+  std::deque<RequestGroupMan::Change>::const_iterator i =
+    rm.getChangesSince(1);
+  CPPUNIT_ASSERT_EQUAL(rg2->getGID(), (*i).gid);
+  CPPUNIT_ASSERT_EQUAL(RequestGroupMan::CHANGE_WAITING, (*i).type);
+  ++i;
+  CPPUNIT_ASSERT_EQUAL((int64_t)3, (*i).version);
+  CPPUNIT_ASSERT_EQUAL(rg1->getGID(), (*i).gid);
+  CPPUNIT_ASSERT_EQUAL(RequestGroupMan::CHANGE_REMOVED, (*i).type);
+  ++i;
+  CPPUNIT_ASSERT(rm.getChangesEnd() == i);
+
+  // Changes of a download which is not waiting are not recorded.
+  rm.markChanged(rg1);
+  CPPUNIT_ASSERT_EQUAL((int64_t)3, rm.getVersion());
+
+  // Old changes are dropped.
+  for(int j = 0; j < 4096; ++j) {
+    rm.markChanged(rg2);
+  }
+  CPPUNIT_ASSERT(!rm.changeLogAvailable(2));
+  CPPUNIT_ASSERT(rm.changeLogAvailable(3));
+  CPPUNIT_ASSERT(rm.getChangesSince(rm.getVersion()) == rm.getChangesEnd());
+}
+
 } // namespace aria2
@@ -19,6 +19,7 @@ class RequestTest:public CppUnit::TestFixture {
   CPPUNIT_TEST(testSetUri_supportsPersistentConnection);
   CPPUNIT_TEST(testRedirectUri);
   CPPUNIT_TEST(testRedirectUri2);
+  CPPUNIT_TEST(testRedirectUri_port);
   CPPUNIT_TEST(testRedirectUri_supportsPersistentConnection);
   CPPUNIT_TEST(testResetUri);
   CPPUNIT_TEST(testResetUri_supportsPersistentConnection);
@@ -35,6 +36,7 @@ public:
   void testSetUri_supportsPersistentConnection();
   void testRedirectUri();
   void testRedirectUri2();
+  void testRedirectUri_port();
   void testRedirectUri_supportsPersistentConnection();
   void testResetUri();
   void testResetUri_supportsPersistentConnection();
@@ -162,6 +164,23 @@ void RequestTest::testRedirectUri()
                        req.getCurrentUri());
 }
 
+void RequestTest::testRedirectUri_port()
+{
+  Request req;
+  req.setUri("http://[::1]:8080/dir/announce?a=1");
+  CPPUNIT_ASSERT(req.redirectUri("/abspath/file"));
+  CPPUNIT_ASSERT_EQUAL(std::string("http://[::1]:8080/abspath/file"),
+                       req.getCurrentUri());
+  CPPUNIT_ASSERT_EQUAL((uint16_t)8080, req.getPort());
+  CPPUNIT_ASSERT(req.redirectUri("relpath"));
+  CPPUNIT_ASSERT_EQUAL(std::string("http://[::1]:8080/abspath/relpath"),
+                       req.getCurrentUri());
+  req.setUri("http://localhost:8080?a=1");
+  CPPUNIT_ASSERT(req.redirectUri("/abspath"));
+  CPPUNIT_ASSERT_EQUAL(std::string("http://localhost:8080/abspath"),
+                       req.getCurrentUri());
+}
+
 void RequestTest::testRedirectUri2()
 {
   Request req;
@@ -61,6 +61,7 @@ class RpcMethodTest:public CppUnit::TestFixture {
   CPPUNIT_TEST(testTellStatus_withoutGid);
   CPPUNIT_TEST(testTellWaiting);
   CPPUNIT_TEST(testTellWaiting_fail);
+  CPPUNIT_TEST(testTellChanged);
   CPPUNIT_TEST(testGetVersion);
   CPPUNIT_TEST(testNoSuchMethod);
   CPPUNIT_TEST(testGatherStoppedDownload);
@@ -87,6 +88,7 @@ public:
     option_.reset(new Option());
     option_->put(PREF_DIR, A2_TEST_OUT_DIR"/aria2_RpcMethodTest");
     option_->put(PREF_SEGMENT_SIZE, "1048576");
+    option_->put(PREF_MAX_DOWNLOAD_RESULT, "1000");
     File(option_->get(PREF_DIR)).mkdirs();
     e_.reset
       (new DownloadEngine(SharedHandle<EventPoll>(new SelectEventPoll())));
@@ -125,6 +127,7 @@ public:
   void testTellStatus_withoutGid();
   void testTellWaiting();
   void testTellWaiting_fail();
+  void testTellChanged();
   void testGetVersion();
   void testNoSuchMethod();
   void testGatherStoppedDownload();
@@ -692,6 +695,116 @@ void RpcMethodTest::testTellWaiting_fail()
   CPPUNIT_ASSERT_EQUAL(1, res.code);
 }
 
+void RpcMethodTest::testTellChanged()
+{
+  addUri("http://1/", e_);
+  addUri("http://2/", e_);
+  addUri("http://3/", e_);
+  const SharedHandle<RequestGroupMan>& rgman = e_->getRequestGroupMan();
+
+  TellChangedRpcMethod m;
+  RpcRequest req(TellChangedRpcMethod::getMethodName(), List::g());
+  req.params->append(Integer::g(0));
+  req.params->append(Integer::g(0));
+  RpcResponse res = m.execute(req, e_.get());
+  CPPUNIT_ASSERT_EQUAL(0, res.code);
+  const Dict* resParams = asDict(res.param);
+  int64_t version = asInteger(resParams->get("version"))->i();
+  int64_t epoch = asInteger(resParams->get("epoch"))->i();
+  CPPUNIT_ASSERT_EQUAL(rgman->getEpoch(), epoch);
+  CPPUNIT_ASSERT_EQUAL(std::string("true"), getString(resParams, "full"));
+  const List* waiting = asList(resParams->get("waiting"));
+  CPPUNIT_ASSERT_EQUAL((size_t)3, waiting->size());
+  CPPUNIT_ASSERT_EQUAL(std::string("1"), getString(asDict(waiting->get(0)),
+                                                   "gid"));
+  CPPUNIT_ASSERT_EQUAL((size_t)0, asList(resParams->get("stopped"))->size());
+
+  // Nothing changed
+  req.params->set(0, Integer::g(version));
+  req.params->set(1, Integer::g(epoch));
+  res = m.execute(req, e_.get());
+  CPPUNIT_ASSERT_EQUAL(0, res.code);
+  resParams = asDict(res.param);
+  CPPUNIT_ASSERT_EQUAL(version, asInteger(resParams->get("version"))->i());
+  CPPUNIT_ASSERT(!resParams->containsKey("waiting"));
+
+  PauseRpcMethod pm;
+  RpcRequest preq(PauseRpcMethod::getMethodName(), List::g());
+  preq.params->append("2");
+  CPPUNIT_ASSERT_EQUAL(0, pm.execute(preq, e_.get()).code);
+  rgman->removeReservedGroup(1);
+  SharedHandle<DownloadResult> dr(new DownloadResult());
+  dr->gid = 4;
+  dr->sessionTime = 0;
+  dr->result = error_code::FINISHED;
+  dr->belongsTo = 0;
+  rgman->addDownloadResult(dr);
+
+  res = m.execute(req, e_.get());
+  CPPUNIT_ASSERT_EQUAL(0, res.code);
+  resParams = asDict(res.param);
+  CPPUNIT_ASSERT(version < asInteger(resParams->get("version"))->i());
+  CPPUNIT_ASSERT(!resParams->containsKey("full"));
+  waiting = asList(resParams->get("waiting"));
+  CPPUNIT_ASSERT_EQUAL((size_t)1, waiting->size());
+  CPPUNIT_ASSERT_EQUAL(std::string("2"), getString(asDict(waiting->get(0)),
+                                                   "gid"));
+  CPPUNIT_ASSERT_EQUAL(std::string("paused"),
+                       getString(asDict(waiting->get(0)), "status"));
+  const List* stopped = asList(resParams->get("stopped"));
+  CPPUNIT_ASSERT_EQUAL((size_t)1, stopped->size());
+  CPPUNIT_ASSERT_EQUAL(std::string("4"), getString(asDict(stopped->get(0)),
+                                                   "gid"));
+  const List* removedGids = asList(resParams->get("removedGids"));
+  CPPUNIT_ASSERT_EQUAL((size_t)1, removedGids->size());
+  CPPUNIT_ASSERT_EQUAL(std::string("1"), asString(removedGids->get(0))->s());
+  // The order of the queue is unchanged.
+  CPPUNIT_ASSERT(!resParams->containsKey("waitingGids"));
+  version = asInteger(resParams->get("version"))->i();
+
+  // Moving a download sends the order of the queue.
+  rgman->changeReservedGroupPosition(3, 0, RequestGroupMan::POS_SET);
+  req.params->set(0, Integer::g(version));
+  res = m.execute(req, e_.get());
+  resParams = asDict(res.param);
+  CPPUNIT_ASSERT_EQUAL((size_t)0, asList(resParams->get("waiting"))->size());
+  const List* waitingGids = asList(resParams->get("waitingGids"));
+  CPPUNIT_ASSERT_EQUAL((size_t)2, waitingGids->size());
+  CPPUNIT_ASSERT_EQUAL(std::string("3"), asString(waitingGids->get(0))->s());
+  CPPUNIT_ASSERT_EQUAL(std::string("2"), asString(waitingGids->get(1))->s());
+
+  // Version newer than the current one, for example after restart,
+  // gets everything.
+  req.params->set(0, Integer::g(rgman->getVersion()+100));
+  res = m.execute(req, e_.get());
+  resParams = asDict(res.param);
+  CPPUNIT_ASSERT_EQUAL(std::string("true"), getString(resParams, "full"));
+  CPPUNIT_ASSERT_EQUAL((size_t)2, asList(resParams->get("waiting"))->size());
+  CPPUNIT_ASSERT_EQUAL((size_t)1, asList(resParams->get("stopped"))->size());
+
+  // Version issued by another instance gets everything even if the
+  // version itself is known.
+  req.params->set(0, Integer::g(rgman->getVersion()));
+  req.params->set(1, Integer::g(epoch+1));
+  res = m.execute(req, e_.get());
+  resParams = asDict(res.param);
+  CPPUNIT_ASSERT_EQUAL(std::string("true"), getString(resParams, "full"));
+  CPPUNIT_ASSERT_EQUAL((size_t)2, asList(resParams->get("waiting"))->size());
+  CPPUNIT_ASSERT_EQUAL(epoch, asInteger(resParams->get("epoch"))->i());
+
+  // epoch is missing
+  req = RpcRequest(TellChangedRpcMethod::getMethodName(), List::g());
+  req.params->append(Integer::g(rgman->getVersion()));
+  res = m.execute(req, e_.get());
+  resParams = asDict(res.param);
+  CPPUNIT_ASSERT_EQUAL(std::string("true"), getString(resParams, "full"));
+
+  // version is missing
+  req = RpcRequest(TellChangedRpcMethod::getMethodName(), List::g());
+  res = m.execute(req, e_.get());
+  CPPUNIT_ASSERT_EQUAL(1, res.code);
+}
+
 void RpcMethodTest::testGetVersion()
 {
   GetVersionRpcMethod m;
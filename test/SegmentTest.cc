@@ -13,6 +13,9 @@ class SegmentTest : public CppUnit::TestFixture {
   CPPUNIT_TEST(testUpdateWrittenLength_lastPiece);
   CPPUNIT_TEST(testUpdateWrittenLength_incompleteLastPiece);
   CPPUNIT_TEST(testClear);
+#ifdef ENABLE_MESSAGE_DIGEST
+  CPPUNIT_TEST(testUpdateHash_resume);
+#endif // ENABLE_MESSAGE_DIGEST
   CPPUNIT_TEST_SUITE_END();
 private:
 
@@ -23,6 +26,9 @@ public:
   void testUpdateWrittenLength_lastPiece();
   void testUpdateWrittenLength_incompleteLastPiece();
   void testClear();
+#ifdef ENABLE_MESSAGE_DIGEST
+  void testUpdateHash_resume();
+#endif // ENABLE_MESSAGE_DIGEST
 };
 
 
@@ -72,4 +78,28 @@ void SegmentTest::testClear()
   CPPUNIT_ASSERT_EQUAL((size_t)0, s.getWrittenLength());
 }
 
+#ifdef ENABLE_MESSAGE_DIGEST
+
+void SegmentTest::testUpdateHash_resume()
+{
+  SharedHandle<Piece> p(new Piece(0, 16*1024*10));
+  p->setHashAlgo("sha-1");
+  PiecedSegment s(16*1024*10, p);
+  // Data written before resuming is not hashed, so data after it is
+  // not buffered.
+  s.updateWrittenLength(16*1024);
+  std::string data(16*1024, 'a');
+  const unsigned char* d = reinterpret_cast<const unsigned char*>(data.data());
+  CPPUNIT_ASSERT(!s.updateHash(s.getWrittenLength(), d, data.size()));
+  CPPUNIT_ASSERT_EQUAL((size_t)0, p->getHashBufferLength());
+
+  SharedHandle<Piece> q(new Piece(0, 16*1024*10));
+  q->setHashAlgo("sha-1");
+  PiecedSegment t(16*1024*10, q);
+  CPPUNIT_ASSERT(t.updateHash(0, d, data.size()));
+  CPPUNIT_ASSERT_EQUAL((size_t)16*1024, q->getHashedLength());
+}
+
+#endif // ENABLE_MESSAGE_DIGEST
+
 } // namespace aria2
@@ -10,9 +10,11 @@ class SequentialPickerTest:public CppUnit::TestFixture {
 
   CPPUNIT_TEST_SUITE(SequentialPickerTest);
   CPPUNIT_TEST(testPick);
+  CPPUNIT_TEST(testPick_maxPicked);
   CPPUNIT_TEST_SUITE_END();
 public:
   void testPick();
+  void testPick_maxPicked();
 };
 
 
@@ -37,7 +39,7 @@ void SequentialPickerTest::testPick()
   CPPUNIT_ASSERT(picker.isPicked());
   CPPUNIT_ASSERT_EQUAL(*Integer(new int(1)), *picker.getPickedEntry());
 
-  picker.dropPickedEntry();
+  picker.dropPickedEntry(picker.getPickedEntry());
 
   CPPUNIT_ASSERT(!picker.isPicked());
   CPPUNIT_ASSERT(picker.hasNext());
@@ -48,4 +50,32 @@ void SequentialPickerTest::testPick()
   CPPUNIT_ASSERT(!picker.hasNext());
 }
 
+void SequentialPickerTest::testPick_maxPicked()
+{
+  SequentialPicker<int> picker;
+  picker.setMaxPicked(2);
+  Integer e1(new int(1));
+  Integer e2(new int(2));
+  Integer e3(new int(3));
+  picker.pushEntry(e1);
+  picker.pushEntry(e2);
+  picker.pushEntry(e3);
+
+  CPPUNIT_ASSERT(picker.canPickNext());
+  picker.pickNext();
+  CPPUNIT_ASSERT(picker.canPickNext());
+  picker.pickNext();
+  CPPUNIT_ASSERT(!picker.canPickNext());
+  CPPUNIT_ASSERT(picker.hasNext());
+  CPPUNIT_ASSERT_EQUAL((size_t)2, picker.countPickedEntry());
+
+  picker.dropPickedEntry(e2);
+  CPPUNIT_ASSERT_EQUAL((size_t)1, picker.countPickedEntry());
+  CPPUNIT_ASSERT_EQUAL(1, *picker.getPickedEntry());
+  CPPUNIT_ASSERT(picker.canPickNext());
+  picker.pickNext();
+  CPPUNIT_ASSERT_EQUAL(3, *picker.getPickedEntries()[1]);
+  CPPUNIT_ASSERT(!picker.canPickNext());
+}
+
 } // namespace aria2
@@ -0,0 +1,93 @@
+#include "Benchmark.h"
+
+#include <vector>
+
+#include "sha1.h"
+#include "MessageDigest.h"
+
+namespace aria2 {
+
+namespace {
+const size_t PIECE_LENGTH = 256*1024;
+} // namespace
+
+namespace {
+// Hashes sha1::MAX_LANES pieces of 256KiB, as done when verifying
+// downloaded files.
+class Sha1Bench:public Benchmark {
+protected:
+  std::vector<unsigned char> data_;
+
+  const unsigned char* getPiece(size_t index) const
+  {
+    return &data_[index*PIECE_LENGTH];
+  }
+public:
+  virtual void setUp()
+  {
+    data_.resize(PIECE_LENGTH*sha1::MAX_LANES);
+    for(size_t i = 0; i < data_.size(); ++i) {
+      data_[i] = benchmarkRandom();
+    }
+  }
+};
+} // namespace
+
+namespace {
+// The backend of MessageDigest, one piece at a time.
+class Sha1MessageDigestBench:public Sha1Bench {
+public:
+  virtual void run(size_t n)
+  {
+    SharedHandle<MessageDigest> ctx = MessageDigest::sha1();
+    unsigned char md[sha1::DIGEST_LENGTH];
+    for(size_t i = 0; i < n; ++i) {
+      for(size_t j = 0; j < sha1::MAX_LANES; ++j) {
+        ctx->reset();
+        ctx->update(getPiece(j), PIECE_LENGTH);
+        ctx->digest(md);
+        benchmarkSink(md[0]);
+      }
+    }
+  }
+};
+} // namespace
+
+namespace {
+// The built-in engine with impl, all pieces at once. If impl is not
+// supported by the CPU, the generic implementation is measured.
+template<sha1::Impl impl>
+class Sha1MultiBench:public Sha1Bench {
+public:
+  virtual void run(size_t n)
+  {
+    const unsigned char* data[sha1::MAX_LANES];
+    unsigned char md[sha1::MAX_LANES][sha1::DIGEST_LENGTH];
+    unsigned char* mds[sha1::MAX_LANES];
+    for(size_t j = 0; j < sha1::MAX_LANES; ++j) {
+      data[j] = getPiece(j);
+      mds[j] = md[j];
+    }
+    sha1::MultiContext ctx(sha1::MAX_LANES, impl);
+    for(size_t i = 0; i < n; ++i) {
+      ctx.reset();
+      ctx.update(data, PIECE_LENGTH);
+      ctx.digest(mds);
+      benchmarkSink(md[0][0]);
+    }
+  }
+};
+} // namespace
+
+namespace {
+typedef Sha1MultiBench<sha1::IMPL_GENERIC> Sha1GenericBench;
+typedef Sha1MultiBench<sha1::IMPL_SHANI> Sha1ShaNiBench;
+typedef Sha1MultiBench<sha1::IMPL_AVX2> Sha1Avx2Bench;
+} // namespace
+
+A2_BENCHMARK_REGISTRATION(Sha1MessageDigestBench, "sha1.messageDigest", 1);
+A2_BENCHMARK_REGISTRATION(Sha1GenericBench, "sha1.generic", 1);
+A2_BENCHMARK_REGISTRATION(Sha1ShaNiBench, "sha1.shani", 1);
+A2_BENCHMARK_REGISTRATION(Sha1Avx2Bench, "sha1.avx2", 1);
+
+} // namespace aria2
@@ -0,0 +1,181 @@
+#include "sha1.h"
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "MessageDigest.h"
+#include "util.h"
+#include "array_fun.h"
+
+namespace aria2 {
+
+class Sha1Test:public CppUnit::TestFixture {
+
+  CPPUNIT_TEST_SUITE(Sha1Test);
+  CPPUNIT_TEST(testDigest);
+  CPPUNIT_TEST(testDigest_multi);
+  CPPUNIT_TEST(testUpdate_split);
+  CPPUNIT_TEST(testGetBatchImpl);
+  CPPUNIT_TEST_SUITE_END();
+public:
+  void testDigest();
+  void testDigest_multi();
+  void testUpdate_split();
+  void testGetBatchImpl();
+};
+
+
+CPPUNIT_TEST_SUITE_REGISTRATION(Sha1Test);
+
+namespace {
+const sha1::Impl impls[] = {
+  sha1::IMPL_GENERIC, sha1::IMPL_SHANI, sha1::IMPL_AVX2
+};
+} // namespace
+
+namespace {
+std::string makeData(size_t length, size_t seed)
+{
+  std::string data(length, '\0');
+  for(size_t i = 0; i < length; ++i) {
+    data[i] = (i*131+seed*7+(i>>8))&0xff;
+  }
+  return data;
+}
+} // namespace
+
+namespace {
+std::string hexDigest(sha1::Impl impl, const std::string& data)
+{
+  sha1::MultiContext ctx(1, impl);
+  const unsigned char* p =
+    reinterpret_cast<const unsigned char*>(data.data());
+  ctx.update(&p, data.size());
+  unsigned char md[sha1::DIGEST_LENGTH];
+  unsigned char* mds = md;
+  ctx.digest(&mds);
+  return util::toHex(md, sizeof(md));
+}
+} // namespace
+
+namespace {
+std::string refHexDigest(const std::string& data)
+{
+  SharedHandle<MessageDigest> ctx = MessageDigest::sha1();
+  ctx->update(data.data(), data.size());
+  return ctx->hexDigest();
+}
+} // namespace
+
+void Sha1Test::testDigest()
+{
+  for(size_t i = 0; i < A2_ARRAY_LEN(impls); ++i) {
+    if(!sha1::isSupported(impls[i])) {
+      continue;
+    }
+    CPPUNIT_ASSERT_EQUAL(std::string("da39a3ee5e6b4b0d3255bfef95601890afd80709"),
+                         hexDigest(impls[i], ""));
+    CPPUNIT_ASSERT_EQUAL(std::string("a9993e364706816aba3e25717850c26c9cd0d89d"),
+                         hexDigest(impls[i], "abc"));
+    CPPUNIT_ASSERT_EQUAL
+      (std::string("84983e441c3bd26ebaae4aa1f95129e5e54670f1"),
+       hexDigest(impls[i],
+                 "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"));
+    size_t lengths[] = { 1, 55, 56, 63, 64, 65, 119, 120, 128, 16384, 100003 };
+    for(size_t j = 0; j < A2_ARRAY_LEN(lengths); ++j) {
+      std::string data = makeData(lengths[j], j);
+      CPPUNIT_ASSERT_EQUAL(refHexDigest(data), hexDigest(impls[i], data));
+    }
+  }
+}
+
+void Sha1Test::testDigest_multi()
+{
+  size_t lengths[] = { 0, 3, 64, 100, 16384, 65536+17 };
+  for(size_t i = 0; i < A2_ARRAY_LEN(impls); ++i) {
+    if(!sha1::isSupported(impls[i])) {
+      continue;
+    }
+    for(size_t n = 1; n <= sha1::MAX_LANES; ++n) {
+      for(size_t j = 0; j < A2_ARRAY_LEN(lengths); ++j) {
+        std::string data[sha1::MAX_LANES];
+        const unsigned char* p[sha1::MAX_LANES];
+        unsigned char md[sha1::MAX_LANES][sha1::DIGEST_LENGTH];
+        unsigned char* mds[sha1::MAX_LANES];
+        for(size_t k = 0; k < n; ++k) {
+          data[k] = makeData(lengths[j], k);
+          p[k] = reinterpret_cast<const unsigned char*>(data[k].data());
+          mds[k] = md[k];
+        }
+        sha1::MultiContext ctx(n, impls[i]);
+        CPPUNIT_ASSERT_EQUAL(impls[i], ctx.getImpl());
+        ctx.update(p, lengths[j]);
+        ctx.digest(mds);
+        for(size_t k = 0; k < n; ++k) {
+          CPPUNIT_ASSERT_EQUAL(refHexDigest(data[k]),
+                               util::toHex(md[k], sha1::DIGEST_LENGTH));
+        }
+      }
+    }
+  }
+}
+
+void Sha1Test::testUpdate_split()
+{
+  const size_t n = 5;
+  std::string data[n];
+  for(size_t k = 0; k < n; ++k) {
+    data[k] = makeData(10000, k);
+  }
+  // Split the messages at offsets which do not fall on block
+  // boundaries.
+  size_t splits[] = { 0, 1, 62, 63, 64, 200, 1000, 4095, 10000 };
+  for(size_t i = 0; i < A2_ARRAY_LEN(impls); ++i) {
+    if(!sha1::isSupported(impls[i])) {
+      continue;
+    }
+    sha1::MultiContext ctx(n, impls[i]);
+    for(size_t s = 1; s < A2_ARRAY_LEN(splits); ++s) {
+      const unsigned char* p[n];
+      for(size_t k = 0; k < n; ++k) {
+        p[k] = reinterpret_cast<const unsigned char*>(data[k].data())+
+          splits[s-1];
+      }
+      ctx.update(p, splits[s]-splits[s-1]);
+    }
+    unsigned char md[n][sha1::DIGEST_LENGTH];
+    unsigned char* mds[n];
+    for(size_t k = 0; k < n; ++k) {
+      mds[k] = md[k];
+    }
+    ctx.digest(mds);
+    for(size_t k = 0; k < n; ++k) {
+      CPPUNIT_ASSERT_EQUAL(refHexDigest(data[k]),
+                           util::toHex(md[k], sha1::DIGEST_LENGTH));
+    }
+    // Reusable after reset()
+    ctx.reset();
+    const unsigned char* p[n];
+    for(size_t k = 0; k < n; ++k) {
+      p[k] = reinterpret_cast<const unsigned char*>("abc");
+    }
+    ctx.update(p, 3);
+    ctx.digest(mds);
+    CPPUNIT_ASSERT_EQUAL(std::string("a9993e364706816aba3e25717850c26c9cd0d89d"),
+                         util::toHex(md[n-1], sha1::DIGEST_LENGTH));
+  }
+}
+
+void Sha1Test::testGetBatchImpl()
+{
+  CPPUNIT_ASSERT(sha1::isSupported(sha1::IMPL_GENERIC));
+  CPPUNIT_ASSERT(sha1::isSupported(sha1::getBatchImpl()));
+  CPPUNIT_ASSERT_EQUAL((size_t)8, sha1::getLanes(sha1::IMPL_AVX2));
+  CPPUNIT_ASSERT_EQUAL((size_t)1, sha1::getLanes(sha1::IMPL_SHANI));
+  if(!sha1::isSupported(sha1::IMPL_AVX2)) {
+    // Falls back to the generic implementation.
+    sha1::MultiContext ctx(2, sha1::IMPL_AVX2);
+    CPPUNIT_ASSERT_EQUAL(sha1::IMPL_GENERIC, ctx.getImpl());
+  }
+}
+
+} // namespace aria2
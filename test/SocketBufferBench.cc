@@ -0,0 +1,65 @@
+#include "Benchmark.h"
+
+#include "SocketBuffer.h"
+#include "SocketCore.h"
+#include "SharedHandle.h"
+
+namespace aria2 {
+
+namespace {
+// Pushes small messages, such as BitTorrent have messages, over a
+// loopback connection. The buffer is flushed every 64 messages.
+class SocketBufferSendBench:public Benchmark {
+private:
+  SharedHandle<SocketCore> client_;
+  SharedHandle<SocketCore> server_;
+  SharedHandle<SocketBuffer> buffer_;
+
+  void drain()
+  {
+    while(!buffer_->sendBufferIsEmpty()) {
+      buffer_->send();
+      unsigned char buf[4096];
+      size_t len = sizeof(buf);
+      server_->readData(buf, len);
+    }
+    size_t len;
+    do {
+      unsigned char buf[4096];
+      len = sizeof(buf);
+      server_->readData(buf, len);
+    } while(len > 0);
+  }
+public:
+  virtual void setUp()
+  {
+    SocketCore listenSocket;
+    listenSocket.bind(0);
+    listenSocket.beginListen();
+    std::pair<std::string, uint16_t> addrinfo;
+    listenSocket.getAddrInfo(addrinfo);
+    client_.reset(new SocketCore());
+    client_->establishConnection("localhost", addrinfo.second);
+    server_.reset(listenSocket.acceptConnection());
+    client_->setBlockingMode();
+    server_->setNonBlockingMode();
+    buffer_.reset(new SocketBuffer(client_));
+  }
+
+  virtual void run(size_t n)
+  {
+    std::string message(17, 'a');
+    for(size_t i = 0; i < n; ++i) {
+      buffer_->pushStr(message);
+      if(i%64 == 63) {
+        drain();
+      }
+    }
+    drain();
+  }
+};
+} // namespace
+
+A2_BENCHMARK_REGISTRATION(SocketBufferSendBench, "SocketBuffer.send", 10000);
+
+} // namespace aria2
@@ -1,5 +1,6 @@
 #include "SocketCore.h"
 #include "Exception.h"
+#include "SharedHandle.h"
 #include <iostream>
 #include <cppunit/extensions/HelperMacros.h>
 
@@ -10,6 +11,7 @@ class SocketCoreTest:public CppUnit::TestFixture {
   CPPUNIT_TEST_SUITE(SocketCoreTest);
   CPPUNIT_TEST(testWriteAndReadDatagram);
   CPPUNIT_TEST(testGetSocketError);
+  CPPUNIT_TEST(testTryAcceptConnection);
   CPPUNIT_TEST_SUITE_END();
 public:
   void setUp() {}
@@ -18,6 +20,7 @@ public:
 
   void testWriteAndReadDatagram();
   void testGetSocketError();
+  void testTryAcceptConnection();
 };
 
 
@@ -69,4 +72,30 @@ void SocketCoreTest::testGetSocketError()
   CPPUNIT_ASSERT_EQUAL(std::string(""), s.getSocketError());
 }
 
+void SocketCoreTest::testTryAcceptConnection()
+{
+  SocketCore server;
+  server.bind(0);
+  server.beginListen();
+  server.setNonBlockingMode();
+  std::pair<std::string, uint16_t> addr;
+  server.getAddrInfo(addr);
+
+  CPPUNIT_ASSERT(!server.tryAcceptConnection());
+
+  SocketCore c1;
+  c1.establishConnection("localhost", addr.second);
+  c1.isWritable(1);
+  SocketCore c2;
+  c2.establishConnection("localhost", addr.second);
+  c2.isWritable(1);
+  server.isReadable(1);
+
+  SharedHandle<SocketCore> s1(server.tryAcceptConnection());
+  CPPUNIT_ASSERT(s1);
+  SharedHandle<SocketCore> s2(server.tryAcceptConnection());
+  CPPUNIT_ASSERT(s2);
+  CPPUNIT_ASSERT(!server.tryAcceptConnection());
+}
+
 } // namespace aria2
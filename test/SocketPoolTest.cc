@@ -0,0 +1,150 @@
+#include "SocketPool.h"
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "SocketCore.h"
+#include "wallclock.h"
+
+namespace aria2 {
+
+class SocketPoolTest:public CppUnit::TestFixture {
+
+  CPPUNIT_TEST_SUITE(SocketPoolTest);
+  CPPUNIT_TEST(testAddAndPop);
+  CPPUNIT_TEST(testPop_lifo);
+  CPPUNIT_TEST(testAdd_maxSizePerKey);
+  CPPUNIT_TEST(testAdd_maxSize);
+  CPPUNIT_TEST(testRemoveStaleEntry_timeout);
+  CPPUNIT_TEST(testRemoveStaleEntry_closedByPeer);
+  CPPUNIT_TEST_SUITE_END();
+
+  std::map<std::string, std::string> noOptions_;
+public:
+  void setUp()
+  {
+    global::wallclock.reset();
+  }
+
+  void testAddAndPop();
+  void testPop_lifo();
+  void testAdd_maxSizePerKey();
+  void testAdd_maxSize();
+  void testRemoveStaleEntry_timeout();
+  void testRemoveStaleEntry_closedByPeer();
+};
+
+
+CPPUNIT_TEST_SUITE_REGISTRATION(SocketPoolTest);
+
+void SocketPoolTest::testAddAndPop()
+{
+  SocketPool pool;
+  SharedHandle<SocketCore> sock(new SocketCore());
+  std::map<std::string, std::string> options;
+  options["baseWorkingDir"] = "/";
+  pool.add("localhost:80", sock, options, 15);
+  CPPUNIT_ASSERT_EQUAL((size_t)1, pool.size());
+
+  CPPUNIT_ASSERT(!pool.pop("localhost:8080"));
+  CPPUNIT_ASSERT_EQUAL((uint64_t)1, pool.getNumMiss());
+
+  std::map<std::string, std::string> poppedOptions;
+  CPPUNIT_ASSERT(sock.get() == pool.pop(poppedOptions, "localhost:80").get());
+  CPPUNIT_ASSERT_EQUAL(std::string("/"), poppedOptions["baseWorkingDir"]);
+  CPPUNIT_ASSERT_EQUAL((uint64_t)1, pool.getNumHit());
+  CPPUNIT_ASSERT_EQUAL((size_t)0, pool.size());
+  CPPUNIT_ASSERT(!pool.pop("localhost:80"));
+}
+
+void SocketPoolTest::testPop_lifo()
+{
+  SocketPool pool;
+  SharedHandle<SocketCore> sock1(new SocketCore());
+  SharedHandle<SocketCore> sock2(new SocketCore());
+  pool.add("localhost:80", sock1, noOptions_, 15);
+  pool.add("localhost:80", sock2, noOptions_, 15);
+  CPPUNIT_ASSERT(sock2.get() == pool.pop("localhost:80").get());
+  CPPUNIT_ASSERT(sock1.get() == pool.pop("localhost:80").get());
+}
+
+void SocketPoolTest::testAdd_maxSizePerKey()
+{
+  SocketPool pool(10, 2);
+  SharedHandle<SocketCore> sock1(new SocketCore());
+  SharedHandle<SocketCore> sock2(new SocketCore());
+  SharedHandle<SocketCore> sock3(new SocketCore());
+  SharedHandle<SocketCore> sock4(new SocketCore());
+  pool.add("localhost:80", sock1, noOptions_, 15);
+  pool.add("localhost:80", sock2, noOptions_, 15);
+  pool.add("localhost:8080", sock3, noOptions_, 15);
+  pool.add("localhost:80", sock4, noOptions_, 15);
+  CPPUNIT_ASSERT_EQUAL((size_t)3, pool.size());
+  CPPUNIT_ASSERT_EQUAL((size_t)2, pool.count("localhost:80"));
+  CPPUNIT_ASSERT_EQUAL((uint64_t)1, pool.getNumEvicted());
+  CPPUNIT_ASSERT(sock4.get() == pool.pop("localhost:80").get());
+  CPPUNIT_ASSERT(sock2.get() == pool.pop("localhost:80").get());
+  CPPUNIT_ASSERT(!pool.pop("localhost:80"));
+}
+
+void SocketPoolTest::testAdd_maxSize()
+{
+  SocketPool pool(2, 2);
+  SharedHandle<SocketCore> sock1(new SocketCore());
+  SharedHandle<SocketCore> sock2(new SocketCore());
+  SharedHandle<SocketCore> sock3(new SocketCore());
+  pool.add("alpha:80", sock1, noOptions_, 15);
+  pool.add("bravo:80", sock2, noOptions_, 15);
+  pool.add("charlie:80", sock3, noOptions_, 15);
+  CPPUNIT_ASSERT_EQUAL((size_t)2, pool.size());
+  CPPUNIT_ASSERT_EQUAL((uint64_t)1, pool.getNumEvicted());
+  CPPUNIT_ASSERT(!pool.pop("alpha:80"));
+  CPPUNIT_ASSERT(sock2.get() == pool.pop("bravo:80").get());
+  CPPUNIT_ASSERT(sock3.get() == pool.pop("charlie:80").get());
+}
+
+void SocketPoolTest::testRemoveStaleEntry_timeout()
+{
+  SocketPool pool;
+  pool.add("alpha:80", SharedHandle<SocketCore>(new SocketCore()),
+           noOptions_, 15);
+  pool.add("bravo:80", SharedHandle<SocketCore>(new SocketCore()),
+           noOptions_, 5);
+  pool.add("charlie:80", SharedHandle<SocketCore>(new SocketCore()),
+           noOptions_, 10);
+  global::wallclock.advance(10);
+  pool.removeStaleEntry(false);
+  CPPUNIT_ASSERT_EQUAL((size_t)1, pool.size());
+  CPPUNIT_ASSERT_EQUAL((size_t)1, pool.count("alpha:80"));
+  CPPUNIT_ASSERT_EQUAL((uint64_t)2, pool.getNumTimedOut());
+
+  global::wallclock.advance(5);
+  CPPUNIT_ASSERT(!pool.pop("alpha:80"));
+  CPPUNIT_ASSERT_EQUAL((size_t)0, pool.size());
+}
+
+void SocketPoolTest::testRemoveStaleEntry_closedByPeer()
+{
+  SocketCore server;
+  server.bind(0);
+  server.beginListen();
+  std::pair<std::string, uint16_t> addr;
+  server.getAddrInfo(addr);
+
+  SharedHandle<SocketCore> sock(new SocketCore());
+  sock->establishConnection("localhost", addr.second);
+  sock->isWritable(1);
+  SharedHandle<SocketCore> accepted(server.acceptConnection());
+
+  SocketPool pool;
+  pool.add("localhost:80", sock, noOptions_, 15);
+  pool.removeStaleEntry(true);
+  CPPUNIT_ASSERT_EQUAL((size_t)1, pool.size());
+
+  accepted->closeConnection();
+  CPPUNIT_ASSERT(sock->isReadable(1));
+  pool.removeStaleEntry(true);
+  CPPUNIT_ASSERT_EQUAL((size_t)0, pool.size());
+  CPPUNIT_ASSERT_EQUAL((uint64_t)1, pool.getNumClosedByPeer());
+}
+
+} // namespace aria2
@@ -0,0 +1,81 @@
+#include "StreamPieceSelector.h"
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "BitfieldMan.h"
+#include "MockPieceSelector.h"
+#include "Option.h"
+#include "prefs.h"
+
+namespace aria2 {
+
+class StreamPieceSelectorTest:public CppUnit::TestFixture {
+
+  CPPUNIT_TEST_SUITE(StreamPieceSelectorTest);
+  CPPUNIT_TEST(testSelect);
+  CPPUNIT_TEST(testGetWindow);
+  CPPUNIT_TEST_SUITE_END();
+public:
+  void testSelect();
+  void testGetWindow();
+};
+
+
+CPPUNIT_TEST_SUITE_REGISTRATION(StreamPieceSelectorTest);
+
+void StreamPieceSelectorTest::testSelect()
+{
+  size_t pieceLength = 1024;
+  BitfieldMan bf(pieceLength, pieceLength*256);
+  bf.setBit(1);
+  bf.setBit(10);
+  bf.setBit(12);
+  Option option;
+  option.put(PREF_BT_STREAM_POSITION, "10240");
+  option.put(PREF_BT_STREAM_WINDOW, "4096");
+  StreamPieceSelector selector
+    (SharedHandle<PieceSelector>(new MockPieceSelector()), &option,
+     pieceLength);
+
+  size_t index;
+  CPPUNIT_ASSERT(selector.select(index, bf.getBitfield(), bf.countBlock()));
+  CPPUNIT_ASSERT_EQUAL((size_t)10, index);
+  bf.unsetBit(10);
+  CPPUNIT_ASSERT(selector.select(index, bf.getBitfield(), bf.countBlock()));
+  CPPUNIT_ASSERT_EQUAL((size_t)12, index);
+  bf.unsetBit(12);
+  // Piece 1 is not in the window, so MockPieceSelector is used.
+  CPPUNIT_ASSERT(!selector.select(index, bf.getBitfield(), bf.countBlock()));
+
+  // Moving the position changes the window.
+  option.put(PREF_BT_STREAM_POSITION, "1500");
+  CPPUNIT_ASSERT(selector.select(index, bf.getBitfield(), bf.countBlock()));
+  CPPUNIT_ASSERT_EQUAL((size_t)1, index);
+}
+
+void StreamPieceSelectorTest::testGetWindow()
+{
+  Option option;
+  option.put(PREF_BT_STREAM_POSITION, "1500");
+  option.put(PREF_BT_STREAM_WINDOW, "0");
+  StreamPieceSelector selector
+    (SharedHandle<PieceSelector>(new MockPieceSelector()), &option, 1024);
+  size_t first, last;
+  CPPUNIT_ASSERT(!selector.getWindow(first, last, 256));
+
+  option.put(PREF_BT_STREAM_WINDOW, "1024");
+  CPPUNIT_ASSERT(selector.getWindow(first, last, 256));
+  CPPUNIT_ASSERT_EQUAL((size_t)1, first);
+  CPPUNIT_ASSERT_EQUAL((size_t)3, last);
+
+  // The window is truncated at the last piece.
+  option.put(PREF_BT_STREAM_POSITION, "261000");
+  CPPUNIT_ASSERT(selector.getWindow(first, last, 256));
+  CPPUNIT_ASSERT_EQUAL((size_t)254, first);
+  CPPUNIT_ASSERT_EQUAL((size_t)256, last);
+
+  option.put(PREF_BT_STREAM_POSITION, "262144");
+  CPPUNIT_ASSERT(!selector.getWindow(first, last, 256));
+}
+
+} // namespace aria2
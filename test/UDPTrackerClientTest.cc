@@ -0,0 +1,363 @@
+/* <!-- copyright */
+/*
+ * aria2 - The high speed download utility
+ *
+ * Copyright (C) 2011 Tatsuhiro Tsujikawa
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations
+ * including the two.
+ * You must obey the GNU General Public License in all respects
+ * for all of the code used other than OpenSSL.  If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so.  If you
+ * do not wish to do so, delete this exception statement from your
+ * version.  If you delete this exception statement from all source
+ * files in the program, then also delete it here.
+ */
+/* copyright --> */
+#include "UDPTrackerClient.h"
+
+#include <cstring>
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "UDPTrackerRequest.h"
+#include "bittorrent_helper.h"
+#include "a2netcompat.h"
+
+namespace aria2 {
+
+class UDPTrackerClientTest:public CppUnit::TestFixture {
+
+  CPPUNIT_TEST_SUITE(UDPTrackerClientTest);
+  CPPUNIT_TEST(testConnectFollowedByAnnounce);
+  CPPUNIT_TEST(testConnectionIdCache);
+  CPPUNIT_TEST(testTimeout);
+  CPPUNIT_TEST(testErrorReply);
+  CPPUNIT_TEST(testRequestFail);
+  CPPUNIT_TEST(testFailAll);
+  CPPUNIT_TEST_SUITE_END();
+public:
+  void testConnectFollowedByAnnounce();
+  void testConnectionIdCache();
+  void testTimeout();
+  void testErrorReply();
+  void testRequestFail();
+  void testFailAll();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(UDPTrackerClientTest);
+
+namespace {
+SharedHandle<UDPTrackerRequest> createAnnounce
+(const std::string& remoteAddr, uint16_t remotePort)
+{
+  SharedHandle<UDPTrackerRequest> req(new UDPTrackerRequest());
+  req->remoteAddr = remoteAddr;
+  req->remotePort = remotePort;
+  req->action = UDPT_ACT_ANNOUNCE;
+  req->infohash = std::string(20, 'i');
+  req->peerId = std::string(20, 'p');
+  req->downloaded = 1000000000000LL;
+  req->left = 2;
+  req->uploaded = 3;
+  req->event = UDPT_EVT_STARTED;
+  req->key = 0xcafebabe;
+  req->numWant = 50;
+  req->port = 6889;
+  return req;
+}
+} // namespace
+
+namespace {
+int64_t getInt64(const unsigned char* data)
+{
+  uint64_t v = 0;
+  for(size_t i = 0; i < 8; ++i) {
+    v = (v << 8) | data[i];
+  }
+  return v;
+}
+} // namespace
+
+namespace {
+void setInt64(unsigned char* data, int64_t v)
+{
+  uint64_t u = v;
+  for(int i = 7; i >= 0; --i) {
+    data[i] = u & 0xff;
+    u >>= 8;
+  }
+}
+} // namespace
+
+namespace {
+size_t createConnectReply
+(unsigned char* data, int32_t transactionId, int64_t connectionId)
+{
+  bittorrent::setIntParam(data, UDPT_ACT_CONNECT);
+  bittorrent::setIntParam(data+4, transactionId);
+  setInt64(data+8, connectionId);
+  return 16;
+}
+} // namespace
+
+void UDPTrackerClientTest::testConnectFollowedByAnnounce()
+{
+  UDPTrackerClient client;
+  Timer now(1000);
+  unsigned char data[100];
+  std::string remoteAddr;
+  uint16_t remotePort = 0;
+  SharedHandle<UDPTrackerRequest> req = createAnnounce("192.168.0.1", 6969);
+  client.addRequest(req);
+
+  ssize_t rv = client.createRequest(data, sizeof(data), remoteAddr,
+                                    remotePort, now);
+  CPPUNIT_ASSERT_EQUAL((ssize_t)16, rv);
+  CPPUNIT_ASSERT_EQUAL(std::string("192.168.0.1"), remoteAddr);
+  CPPUNIT_ASSERT_EQUAL((uint16_t)6969, remotePort);
+  CPPUNIT_ASSERT_EQUAL((int64_t)0x41727101980LL, getInt64(data));
+  CPPUNIT_ASSERT_EQUAL((int32_t)UDPT_ACT_CONNECT,
+                       (int32_t)bittorrent::getIntParam(data, 8));
+  int32_t transactionId = bittorrent::getIntParam(data, 12);
+  client.requestSent(now);
+
+  // The announce request waits for the connection ID.
+  CPPUNIT_ASSERT_EQUAL((ssize_t)-1,
+                       client.createRequest(data, sizeof(data), remoteAddr,
+                                            remotePort, now));
+  CPPUNIT_ASSERT_EQUAL((size_t)2, client.getNumRequest());
+
+  unsigned char reply[100];
+  size_t replyLength = createConnectReply(reply, transactionId, 12345678);
+  // Wrong transaction ID
+  bittorrent::setIntParam(reply+4, transactionId+1);
+  CPPUNIT_ASSERT_EQUAL(-1, client.receiveReply(reply, replyLength,
+                                               "192.168.0.1", 6969, now));
+  // Wrong remote address
+  bittorrent::setIntParam(reply+4, transactionId);
+  CPPUNIT_ASSERT_EQUAL(-1, client.receiveReply(reply, replyLength,
+                                               "192.168.0.2", 6969, now));
+  CPPUNIT_ASSERT_EQUAL(0, client.receiveReply(reply, replyLength,
+                                              "192.168.0.1", 6969, now));
+
+  rv = client.createRequest(data, sizeof(data), remoteAddr, remotePort, now);
+  CPPUNIT_ASSERT_EQUAL((ssize_t)98, rv);
+  CPPUNIT_ASSERT_EQUAL((int64_t)12345678, getInt64(data));
+  CPPUNIT_ASSERT_EQUAL((int32_t)UDPT_ACT_ANNOUNCE,
+                       (int32_t)bittorrent::getIntParam(data, 8));
+  transactionId = bittorrent::getIntParam(data, 12);
+  CPPUNIT_ASSERT_EQUAL(req->infohash,
+                       std::string(&data[16], &data[36]));
+  CPPUNIT_ASSERT_EQUAL(req->peerId, std::string(&data[36], &data[56]));
+  CPPUNIT_ASSERT_EQUAL((int64_t)1000000000000LL, getInt64(data+56));
+  CPPUNIT_ASSERT_EQUAL((int64_t)2, getInt64(data+64));
+  CPPUNIT_ASSERT_EQUAL((int64_t)3, getInt64(data+72));
+  CPPUNIT_ASSERT_EQUAL((int32_t)UDPT_EVT_STARTED,
+                       (int32_t)bittorrent::getIntParam(data, 80));
+  CPPUNIT_ASSERT_EQUAL((uint32_t)0xcafebabe,
+                       (uint32_t)bittorrent::getIntParam(data, 88));
+  CPPUNIT_ASSERT_EQUAL((int32_t)50,
+                       (int32_t)bittorrent::getIntParam(data, 92));
+  CPPUNIT_ASSERT_EQUAL((uint16_t)6889, bittorrent::getShortIntParam(data, 96));
+  client.requestSent(now);
+
+  bittorrent::setIntParam(reply, UDPT_ACT_ANNOUNCE);
+  bittorrent::setIntParam(reply+4, transactionId);
+  bittorrent::setIntParam(reply+8, 1800);
+  bittorrent::setIntParam(reply+12, 10);
+  bittorrent::setIntParam(reply+16, 20);
+  bittorrent::packcompact(reply+20, "192.168.0.10", 6881);
+  bittorrent::packcompact(reply+26, "192.168.0.11", 6882);
+  CPPUNIT_ASSERT_EQUAL(0, client.receiveReply(reply, 32, "192.168.0.1", 6969,
+                                              now));
+  CPPUNIT_ASSERT_EQUAL((int)UDPT_STA_COMPLETE, req->state);
+  CPPUNIT_ASSERT_EQUAL((int)UDPT_ERR_SUCCESS, req->error);
+  CPPUNIT_ASSERT(req->reply);
+  CPPUNIT_ASSERT_EQUAL((int32_t)1800, req->reply->interval);
+  CPPUNIT_ASSERT_EQUAL((int32_t)10, req->reply->leechers);
+  CPPUNIT_ASSERT_EQUAL((int32_t)20, req->reply->seeders);
+  CPPUNIT_ASSERT_EQUAL((size_t)2, req->reply->peers.size());
+  CPPUNIT_ASSERT_EQUAL(std::string("192.168.0.10"),
+                       req->reply->peers[0].first);
+  CPPUNIT_ASSERT_EQUAL((uint16_t)6881, req->reply->peers[0].second);
+  CPPUNIT_ASSERT_EQUAL(std::string("192.168.0.11"),
+                       req->reply->peers[1].first);
+  CPPUNIT_ASSERT_EQUAL((uint16_t)6882, req->reply->peers[1].second);
+  CPPUNIT_ASSERT(client.noRequest());
+}
+
+void UDPTrackerClientTest::testConnectionIdCache()
+{
+  UDPTrackerClient client;
+  Timer now(1000);
+  unsigned char data[100];
+  std::string remoteAddr;
+  uint16_t remotePort = 0;
+  SharedHandle<UDPTrackerRequest> req1 = createAnnounce("192.168.0.1", 6969);
+  SharedHandle<UDPTrackerRequest> req2 = createAnnounce("192.168.0.1", 6969);
+  client.addRequest(req1);
+  client.addRequest(req2);
+
+  // Only one connect request is sent for 2 announce requests.
+  CPPUNIT_ASSERT_EQUAL((ssize_t)16,
+                       client.createRequest(data, sizeof(data), remoteAddr,
+                                            remotePort, now));
+  int32_t transactionId = bittorrent::getIntParam(data, 12);
+  client.requestSent(now);
+  CPPUNIT_ASSERT_EQUAL((ssize_t)-1,
+                       client.createRequest(data, sizeof(data), remoteAddr,
+                                            remotePort, now));
+  unsigned char reply[16];
+  createConnectReply(reply, transactionId, 1);
+  CPPUNIT_ASSERT_EQUAL(0, client.receiveReply(reply, sizeof(reply),
+                                              "192.168.0.1", 6969, now));
+  for(int i = 0; i < 2; ++i) {
+    CPPUNIT_ASSERT_EQUAL((ssize_t)98,
+                         client.createRequest(data, sizeof(data), remoteAddr,
+                                              remotePort, now));
+    CPPUNIT_ASSERT_EQUAL((int64_t)1, getInt64(data));
+    client.requestSent(now);
+  }
+  CPPUNIT_ASSERT_EQUAL((ssize_t)-1,
+                       client.createRequest(data, sizeof(data), remoteAddr,
+                                            remotePort, now));
+
+  // The cached connection ID is reused.
+  SharedHandle<UDPTrackerRequest> req3 = createAnnounce("192.168.0.1", 6969);
+  client.addRequest(req3);
+  now.advance(UDPTrackerClient::CONNECTION_ID_TIMEOUT-1);
+  CPPUNIT_ASSERT_EQUAL((ssize_t)98,
+                       client.createRequest(data, sizeof(data), remoteAddr,
+                                            remotePort, now));
+  client.requestSent(now);
+
+  // The connection ID has expired.
+  SharedHandle<UDPTrackerRequest> req4 = createAnnounce("192.168.0.1", 6969);
+  client.addRequest(req4);
+  now.advance(1);
+  CPPUNIT_ASSERT_EQUAL((ssize_t)16,
+                       client.createRequest(data, sizeof(data), remoteAddr,
+                                            remotePort, now));
+}
+
+void UDPTrackerClientTest::testTimeout()
+{
+  UDPTrackerClient client;
+  Timer now(1000);
+  unsigned char data[100];
+  std::string remoteAddr;
+  uint16_t remotePort = 0;
+  SharedHandle<UDPTrackerRequest> req = createAnnounce("192.168.0.1", 6969);
+  client.addRequest(req);
+  time_t timeout = UDPTrackerClient::INITIAL_TIMEOUT;
+  for(int i = 0; i <= UDPTrackerClient::MAX_RETRY; ++i) {
+    CPPUNIT_ASSERT_EQUAL((ssize_t)16,
+                         client.createRequest(data, sizeof(data), remoteAddr,
+                                              remotePort, now));
+    client.requestSent(now);
+    now.advance(timeout-1);
+    client.handleTimeout(now);
+    CPPUNIT_ASSERT_EQUAL((ssize_t)-1,
+                         client.createRequest(data, sizeof(data), remoteAddr,
+                                              remotePort, now));
+    now.advance(1);
+    client.handleTimeout(now);
+    timeout *= 2;
+  }
+  CPPUNIT_ASSERT_EQUAL((int)UDPT_STA_COMPLETE, req->state);
+  CPPUNIT_ASSERT_EQUAL((int)UDPT_ERR_TIMEOUT, req->error);
+  CPPUNIT_ASSERT(client.noRequest());
+}
+
+void UDPTrackerClientTest::testErrorReply()
+{
+  UDPTrackerClient client;
+  Timer now(1000);
+  unsigned char data[100];
+  std::string remoteAddr;
+  uint16_t remotePort = 0;
+  SharedHandle<UDPTrackerRequest> req = createAnnounce("192.168.0.1", 6969);
+  client.addRequest(req);
+  client.createRequest(data, sizeof(data), remoteAddr, remotePort, now);
+  int32_t transactionId = bittorrent::getIntParam(data, 12);
+  client.requestSent(now);
+
+  unsigned char reply[20];
+  bittorrent::setIntParam(reply, UDPT_ACT_ERROR);
+  bittorrent::setIntParam(reply+4, transactionId);
+  memcpy(reply+8, "banned", 6);
+  CPPUNIT_ASSERT_EQUAL(0, client.receiveReply(reply, 14, "192.168.0.1", 6969,
+                                              now));
+  // Failure of connect request also fails the announce request
+  // waiting for it.
+  CPPUNIT_ASSERT_EQUAL((int)UDPT_STA_COMPLETE, req->state);
+  CPPUNIT_ASSERT_EQUAL((int)UDPT_ERR_TRACKER, req->error);
+  CPPUNIT_ASSERT(client.noRequest());
+}
+
+void UDPTrackerClientTest::testRequestFail()
+{
+  UDPTrackerClient client;
+  Timer now(1000);
+  unsigned char data[100];
+  std::string remoteAddr;
+  uint16_t remotePort = 0;
+  SharedHandle<UDPTrackerRequest> req1 = createAnnounce("192.168.0.1", 6969);
+  SharedHandle<UDPTrackerRequest> req2 = createAnnounce("192.168.0.2", 6969);
+  client.addRequest(req1);
+  client.addRequest(req2);
+  CPPUNIT_ASSERT_EQUAL((ssize_t)16,
+                       client.createRequest(data, sizeof(data), remoteAddr,
+                                            remotePort, now));
+  CPPUNIT_ASSERT_EQUAL(std::string("192.168.0.1"), remoteAddr);
+  client.requestFail(UDPT_ERR_NETWORK);
+  // The announce request waiting for the connection ID also fails.
+  CPPUNIT_ASSERT_EQUAL((int)UDPT_STA_COMPLETE, req1->state);
+  CPPUNIT_ASSERT_EQUAL((int)UDPT_ERR_NETWORK, req1->error);
+  CPPUNIT_ASSERT_EQUAL((ssize_t)16,
+                       client.createRequest(data, sizeof(data), remoteAddr,
+                                            remotePort, now));
+  CPPUNIT_ASSERT_EQUAL(std::string("192.168.0.2"), remoteAddr);
+  CPPUNIT_ASSERT_EQUAL((int)UDPT_STA_PENDING, req2->state);
+}
+
+void UDPTrackerClientTest::testFailAll()
+{
+  UDPTrackerClient client;
+  Timer now(1000);
+  unsigned char data[100];
+  std::string remoteAddr;
+  uint16_t remotePort = 0;
+  SharedHandle<UDPTrackerRequest> req1 = createAnnounce("192.168.0.1", 6969);
+  SharedHandle<UDPTrackerRequest> req2 = createAnnounce("192.168.0.2", 6969);
+  client.addRequest(req1);
+  client.addRequest(req2);
+  client.createRequest(data, sizeof(data), remoteAddr, remotePort, now);
+  client.requestSent(now);
+  client.failAll(UDPT_ERR_SHUTDOWN);
+  CPPUNIT_ASSERT(client.noRequest());
+  CPPUNIT_ASSERT_EQUAL((int)UDPT_ERR_SHUTDOWN, req1->error);
+  CPPUNIT_ASSERT_EQUAL((int)UDPT_STA_COMPLETE, req2->state);
+  CPPUNIT_ASSERT_EQUAL((int)UDPT_ERR_SHUTDOWN, req2->error);
+}
+
+} // namespace aria2